@@ -0,0 +1,315 @@
+/*
+ * ============================================================================
+ * ACL.h - Longest-Prefix-Match Access Control (ntpd-style restrict lists)
+ * ============================================================================
+ *
+ * One access list shared by the NTP server and the web server, so rules like
+ * "LAN may query, WAN only gets KoD, management VLAN gets the UI" are
+ * expressed once.
+ *
+ * Rule syntax (rules separated by ';' or newlines):
+ *   <ipv4>[/<len>] [flag ...]
+ *   default [flag ...]                  (same as 0.0.0.0/0)
+ *
+ * Flags:
+ *   ignore   - drop everything (NTP and HTTP), no reply
+ *   noserve  - do not serve time (dropped, or DENY KoD with 'kod')
+ *   limited  - apply per-client NTP rate limiting
+ *   kod      - send Kiss-o'-Death instead of silently dropping
+ *   noquery  - no web UI / API access
+ *
+ * The most specific (longest) matching prefix wins, as in ntpd. A rule
+ * with no flags grants full access.
+ *
+ * Rules are compiled at configuration time into a sorted table of
+ * disjoint address ranges, each carrying the flags of its longest match.
+ * A lookup is a binary search over at most 2 * ACL_MAX_RULES + 1 ranges
+ * (<= 6 probes), with no allocation, on the packet path.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef ACL_H
+#define ACL_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define ACL_MAX_RULES 16                     // Rules per list
+#define ACL_MAX_RANGES (2 * ACL_MAX_RULES + 1) // Compiled ranges (worst case)
+
+// Restrict flags
+#define ACL_IGNORE   0x01
+#define ACL_NOSERVE  0x02
+#define ACL_LIMITED  0x04
+#define ACL_KOD      0x08
+#define ACL_NOQUERY  0x10
+
+// Behaviour with no rules: rate limited with KoD, as before ACLs existed
+#define ACL_DEFAULT_FLAGS (ACL_LIMITED | ACL_KOD)
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * One Source Rule
+ */
+struct ACLRule {
+    uint32_t network;                        // Host byte order, masked
+    uint8_t prefixLength;                    // 0-32
+    uint8_t flags;                           // ACL_* flags
+};
+
+/**
+ * One Compiled Range [start, next range's start)
+ */
+struct ACLRange {
+    uint32_t start;                          // Host byte order
+    uint8_t flags;
+};
+
+// ============================================================================
+// ACCESS CONTROL CLASS
+// ============================================================================
+
+class AccessControl {
+public:
+    AccessControl() {
+        clear();
+    }
+
+    /**
+     * Remove all rules (everything gets ACL_DEFAULT_FLAGS)
+     */
+    void clear() {
+        ruleCount = 0;
+        ranges[0].start = 0;
+        ranges[0].flags = ACL_DEFAULT_FLAGS;
+        rangeCount = 1;
+        error = "";
+    }
+
+    /**
+     * Parse and compile a rule list
+     * On error the current table is kept and getError() says why
+     * @param text Rule text
+     * @return True if compiled
+     */
+    bool compile(const char* text) {
+        ACLRule parsed[ACL_MAX_RULES];
+        uint8_t parsedCount = 0;
+
+        String rules(text ? text : "");
+        rules.replace('\n', ';');
+        rules.replace('\r', ';');
+
+        int start = 0;
+        while (start <= (int)rules.length()) {
+            int end = rules.indexOf(';', start);
+            if (end < 0) end = rules.length();
+
+            String line = rules.substring(start, end);
+            line.trim();
+            start = end + 1;
+            if (line.length() == 0) continue;
+
+            if (parsedCount >= ACL_MAX_RULES) {
+                error = "Too many rules (max " + String(ACL_MAX_RULES) + ")";
+                return false;
+            }
+            if (!parseRule(line, parsed[parsedCount])) {
+                error = "Invalid rule: " + line;
+                return false;
+            }
+            parsedCount++;
+        }
+
+        memcpy(ruleList, parsed, sizeof(ACLRule) * parsedCount);
+        ruleCount = parsedCount;
+        build();
+        error = "";
+        return true;
+    }
+
+    /**
+     * Get restrict flags for an address - packet path
+     * @param ip Address to look up
+     * @return ACL_* flags
+     */
+    uint8_t lookup(IPAddress ip) const {
+        uint32_t addr = ((uint32_t)ip[0] << 24) | ((uint32_t)ip[1] << 16) |
+                        ((uint32_t)ip[2] << 8) | ip[3];
+
+        // Last range whose start <= addr (ranges[0].start is always 0)
+        uint8_t lo = 0;
+        uint8_t hi = rangeCount - 1;
+        while (lo < hi) {
+            uint8_t mid = (lo + hi + 1) / 2;
+            if (ranges[mid].start <= addr) {
+                lo = mid;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return ranges[lo].flags;
+    }
+
+    /**
+     * Check a flag for an address
+     */
+    bool has(IPAddress ip, uint8_t flag) const {
+        return (lookup(ip) & flag) != 0;
+    }
+
+    uint8_t getRuleCount() const { return ruleCount; }
+    uint8_t getRangeCount() const { return rangeCount; }
+    const ACLRule& getRule(uint8_t index) const { return ruleList[index]; }
+    const ACLRange& getRange(uint8_t index) const { return ranges[index]; }
+    const String& getError() const { return error; }
+
+    /**
+     * Format flags as rule text (e.g. "limited kod")
+     */
+    static String flagsToString(uint8_t flags) {
+        String out;
+        if (flags & ACL_IGNORE)  out += "ignore ";
+        if (flags & ACL_NOSERVE) out += "noserve ";
+        if (flags & ACL_LIMITED) out += "limited ";
+        if (flags & ACL_KOD)     out += "kod ";
+        if (flags & ACL_NOQUERY) out += "noquery ";
+        out.trim();
+        return out;
+    }
+
+    /**
+     * Format a host-order address
+     */
+    static String addressToString(uint32_t addr) {
+        return IPAddress(addr >> 24, (addr >> 16) & 0xFF, (addr >> 8) & 0xFF, addr & 0xFF).toString();
+    }
+
+private:
+    ACLRule ruleList[ACL_MAX_RULES];
+    uint8_t ruleCount;
+    ACLRange ranges[ACL_MAX_RANGES];
+    uint8_t rangeCount;
+    String error;
+
+    static uint32_t maskFor(uint8_t prefixLength) {
+        return prefixLength == 0 ? 0 : 0xFFFFFFFFUL << (32 - prefixLength);
+    }
+
+    static bool parseRule(String line, ACLRule& rule) {
+        line.replace('\t', ' ');
+        int space = line.indexOf(' ');
+        String target = space < 0 ? line : line.substring(0, space);
+        String flagText = space < 0 ? "" : line.substring(space + 1);
+
+        // Target: "default" or a.b.c.d[/len]
+        if (target.equalsIgnoreCase("default")) {
+            rule.network = 0;
+            rule.prefixLength = 0;
+        } else {
+            int slash = target.indexOf('/');
+            String addrText = slash < 0 ? target : target.substring(0, slash);
+            IPAddress addr;
+            if (!addr.fromString(addrText)) {
+                return false;
+            }
+
+            long length = 32;
+            if (slash >= 0) {
+                String lenText = target.substring(slash + 1);
+                if (lenText.length() == 0 || lenText.length() > 2) return false;
+                for (uint8_t i = 0; i < lenText.length(); i++) {
+                    if (!isDigit(lenText[i])) return false;
+                }
+                length = lenText.toInt();
+                if (length > 32) return false;
+            }
+
+            uint32_t network = ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) |
+                               ((uint32_t)addr[2] << 8) | addr[3];
+            rule.prefixLength = length;
+            rule.network = network & maskFor(rule.prefixLength);
+        }
+
+        // Flags
+        rule.flags = 0;
+        flagText.trim();
+        while (flagText.length() > 0) {
+            int next = flagText.indexOf(' ');
+            String flag = next < 0 ? flagText : flagText.substring(0, next);
+            flagText = next < 0 ? "" : flagText.substring(next + 1);
+            flagText.trim();
+
+            if (flag.length() == 0)              continue;
+            if (flag.equalsIgnoreCase("ignore"))  rule.flags |= ACL_IGNORE;
+            else if (flag.equalsIgnoreCase("noserve")) rule.flags |= ACL_NOSERVE;
+            else if (flag.equalsIgnoreCase("limited")) rule.flags |= ACL_LIMITED;
+            else if (flag.equalsIgnoreCase("kod"))     rule.flags |= ACL_KOD;
+            else if (flag.equalsIgnoreCase("noquery")) rule.flags |= ACL_NOQUERY;
+            else return false;
+        }
+        return true;
+    }
+
+    // Flags of the longest rule containing addr
+    uint8_t longestMatch(uint32_t addr) const {
+        int8_t best = -1;
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            if ((addr & maskFor(ruleList[i].prefixLength)) != ruleList[i].network) continue;
+            // Later rules win ties, so a repeated prefix overrides the earlier one
+            if (best < 0 || ruleList[i].prefixLength >= ruleList[best].prefixLength) {
+                best = i;
+            }
+        }
+        return best < 0 ? ACL_DEFAULT_FLAGS : ruleList[best].flags;
+    }
+
+    // Compile rules into sorted disjoint ranges
+    void build() {
+        // Every rule contributes its first address and the one past its last
+        uint32_t bounds[ACL_MAX_RANGES];
+        uint8_t boundCount = 0;
+        bounds[boundCount++] = 0;
+        for (uint8_t i = 0; i < ruleCount; i++) {
+            bounds[boundCount++] = ruleList[i].network;
+            uint32_t last = ruleList[i].network | ~maskFor(ruleList[i].prefixLength);
+            if (last != 0xFFFFFFFFUL) {
+                bounds[boundCount++] = last + 1;
+            }
+        }
+
+        // Sort (small n, insertion sort) and drop duplicates
+        for (uint8_t i = 1; i < boundCount; i++) {
+            uint32_t v = bounds[i];
+            int8_t j = i - 1;
+            while (j >= 0 && bounds[j] > v) {
+                bounds[j + 1] = bounds[j];
+                j--;
+            }
+            bounds[j + 1] = v;
+        }
+
+        // Flags are constant between consecutive bounds; merge equal neighbours
+        rangeCount = 0;
+        for (uint8_t i = 0; i < boundCount; i++) {
+            if (i > 0 && bounds[i] == bounds[i - 1]) continue;
+            uint8_t flags = longestMatch(bounds[i]);
+            if (rangeCount > 0 && ranges[rangeCount - 1].flags == flags) continue;
+            ranges[rangeCount].start = bounds[i];
+            ranges[rangeCount].flags = flags;
+            rangeCount++;
+        }
+    }
+};
+
+#endif // ACL_H
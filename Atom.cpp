@@ -19,8 +19,10 @@
 
 #include "Atom.h"
 
+#if FEATURE_WEB_SERVER
 // Response size threshold for automatic chunked encoding
 #define WEBRESPONSE_CHUNK_THRESHOLD 1024
+#endif
 
 /**
  * Constructor - HARDENED TWO-PHASE DESIGN
@@ -60,6 +62,7 @@ Atom::Atom(const AtomNetworkConfig& config)
         _macAddress[i] = 0x00;
     }
     
+#if FEATURE_WEB_SERVER
     // Initialize web server components with bounds checking
     _webServer = nullptr;
     _404Handler = nullptr;
@@ -68,6 +71,7 @@ Atom::Atom(const AtomNetworkConfig& config)
     
     // Reserve memory for routes to prevent frequent reallocations
     _routes.reserve(min((uint16_t)ATOM_MAX_ROUTES, (uint16_t)16));
+#endif
     
     // Initialize timing for security monitoring
     _lastRateLimitCleanup = millis();
@@ -466,6 +470,7 @@ bool Atom::begin() {
         
         _notifyStatusChange(true, "Network initialized successfully with security enhancements");
         
+#if FEATURE_WEB_SERVER
         // Auto-start web server if enabled and memory allows
         if (_webServerEnabled && _checkMemoryPressure()) {
             // Validate port number
@@ -477,6 +482,7 @@ bool Atom::begin() {
             
             startWebServer(safePort);
         }
+#endif
     } else {
         _status.lastError = 2;
         _status.lastErrorMessage = "Failed to obtain valid IP address";
@@ -549,6 +555,7 @@ void Atom::maintain() {
         }
     }
     
+#if FEATURE_WEB_SERVER
     // Handle web server clients with resource limits
     if (_webServerEnabled && _status.webServerRunning && _checkMemoryPressure()) {
         try {
@@ -558,6 +565,7 @@ void Atom::maintain() {
             // Continue operation - don't let one bad client crash everything
         }
     }
+#endif
     
     // Clean up rate limiting data periodically
     if (now - _lastRateLimitCleanup > 60000) { // Every minute
@@ -626,10 +634,12 @@ AtomNetworkStatus Atom::getStatus() const {
         status.webServerPort = 0;
     }
     
+#if FEATURE_WEB_SERVER
     // Bounds check on route count
     if (status.registeredRoutes > ATOM_MAX_ROUTES) {
         status.registeredRoutes = _routes.size(); // Use actual count
     }
+#endif
     
     return status;
 }
@@ -662,6 +672,15 @@ void Atom::onStatusChange(AtomStatusCallback callback) {
     _statusCallback = callback;
 }
 
+/**
+ * Set request callback
+ * Invoked for every parsed request before route dispatch
+ */
+void Atom::onRequest(AtomRequestCallback callback) {
+    // Store callback (nullptr is valid for clearing)
+    _requestCallback = callback;
+}
+
 /**
  * Force reconnection attempt - HARDENED
  * Enhanced with state management and error recovery
@@ -687,6 +706,7 @@ bool Atom::reconnect() {
         return false;
     }
     
+#if FEATURE_WEB_SERVER
     // Stop web server during reconnection to free resources
     bool wasWebServerRunning = _status.webServerRunning;
     uint16_t previousPort = _status.webServerPort;
@@ -695,6 +715,7 @@ bool Atom::reconnect() {
         stopWebServer();
         delay(100); // Allow time for cleanup
     }
+#endif
     
     // Clean up active connections
     _cleanupActiveConnections();
@@ -716,11 +737,13 @@ bool Atom::reconnect() {
     if (success) {
         _logSecurityEvent(AtomSecurityEvent::TIMEOUT_EXCEEDED, "Reconnection successful in " + String(reconnectTime) + "ms");
         
+#if FEATURE_WEB_SERVER
         // Restart web server if it was running and memory allows
         if (wasWebServerRunning && _checkMemoryPressure()) {
             uint16_t portToUse = (previousPort > 0 && previousPort <= 65535) ? previousPort : 80;
             startWebServer(portToUse);
         }
+#endif
     } else {
         _logSecurityEvent(AtomSecurityEvent::RESOURCE_EXHAUSTION, "Reconnection failed after " + String(reconnectTime) + "ms");
     }
@@ -984,6 +1007,7 @@ void Atom::_updateStatus() {
         
         _notifyStatusChange(currentlyConnected, message);
         
+#if FEATURE_WEB_SERVER
         // Handle web server during network changes
         if (!currentlyConnected && _status.webServerRunning) {
             if (_config.enableDiagnostics) {
@@ -998,6 +1022,7 @@ void Atom::_updateStatus() {
                            _config.webServerPort : 80;
             startWebServer(port);
         }
+#endif
     }
 }
 
@@ -1046,6 +1071,7 @@ String Atom::_macToString(const byte mac[6]) {
     return result;
 }
 
+#if FEATURE_WEB_SERVER
 // ============================================================================
 // Web Server Implementation - HARDENED
 // (Unchanged from original implementation - these methods work the same)
@@ -1384,8 +1410,16 @@ void Atom::handleWebClients() {
                 return;
             }
             
-            // Check rate limiting
+            // Check access control list
             IPAddress clientIP = client.remoteIP();
+            if (!_isClientAllowed(clientIP)) {
+                _logSecurityEvent(AtomSecurityEvent::ACCESS_DENIED, "Access denied for IP: " + clientIP.toString());
+                _securityStats.blockedRequests++;
+                client.stop();
+                return;
+            }
+            
+            // Check rate limiting
             if (!_checkRateLimit(clientIP)) {
                 _logSecurityEvent(AtomSecurityEvent::RATE_LIMIT_EXCEEDED, "Rate limit exceeded for IP: " + clientIP.toString());
                 _securityStats.rateLimitBlocks++;
@@ -1418,6 +1452,8 @@ void Atom::handleWebClients() {
     }
 }
 
+#endif // FEATURE_WEB_SERVER
+
 // ============================================================================
 // Client Interface Implementation - HARDENED
 // (Unchanged from original implementation - these methods work the same)
@@ -1829,6 +1865,7 @@ void Atom::clearSecurityLog() {
     _securityLog.clear();
 }
 
+#if FEATURE_WEB_SERVER
 // ============================================================================
 // Private Web Server Methods - HARDENED
 // (Unchanged from original implementation - these methods work the same)
@@ -1856,6 +1893,13 @@ void Atom::_handleSingleClient() {
         }
         
         IPAddress clientIP = client.remoteIP();
+        if (!_isClientAllowed(clientIP)) {
+            _logSecurityEvent(AtomSecurityEvent::ACCESS_DENIED, "Access denied: " + clientIP.toString());
+            _securityStats.blockedRequests++;
+            client.stop();
+            return;
+        }
+        
         if (!_checkRateLimit(clientIP)) {
             _logSecurityEvent(AtomSecurityEvent::RATE_LIMIT_EXCEEDED, "Rate limit exceeded: " + clientIP.toString());
             _securityStats.rateLimitBlocks++;
@@ -1871,9 +1915,10 @@ void Atom::_handleSingleClient() {
             return;
         }
         
-        // Parse request with comprehensive validation
+        // Parse request line and headers; the body is read once the route
+        // is known so streaming routes can consume it themselves
         WebRequest request;
-        if (!request.parseFromClient(client)) {
+        if (!request.parseFromClient(client, true)) {
             _logSecurityEvent(AtomSecurityEvent::MALFORMED_REQUEST, "Failed to parse HTTP request from " + clientIP.toString());
             _securityStats.malformedRequests++;
             
@@ -1920,10 +1965,19 @@ void Atom::_handleSingleClient() {
         
         WebResponse response(client);
         
+        if (_requestCallback) {
+            _requestCallback(request.getMethod(), request.getPath());
+        }
+        
         // Find matching route with security validation
         AtomRoute* route = _findRoute(request.getPath(), request.getMethod());
         
-        if (route && route->handler && route->isValid) {
+        if (!(route && route->streaming) && !request.readBody()) {
+            _logSecurityEvent(AtomSecurityEvent::OVERSIZED_REQUEST, "Request body rejected from " + clientIP.toString());
+            _securityStats.blockedRequests++;
+            response.send(400, "text/plain", "Request body rejected");
+            route = nullptr;
+        } else if (route && route->handler && route->isValid) {
             // Update route statistics
             route->callCount++;
             route->lastCallTime = millis();
@@ -1935,7 +1989,7 @@ void Atom::_handleSingleClient() {
                 _logSecurityEvent(AtomSecurityEvent::RESOURCE_EXHAUSTION, "Route handler exception for " + request.getPath());
                 _sendError(request, response, "Handler exception");
             }
-        } else {
+        } else if (!response.isResponseSent()) {
             // No route found - send 404
             _send404(request, response);
         }
@@ -1976,6 +2030,20 @@ void Atom::_handleSingleClient() {
     }
 }
 
+/**
+ * Add streaming route
+ * Registers normally, then marks the route so its body is left unread
+ */
+void Atom::addStreamingRoute(const String& path, RouteHandler handler, const String& method) {
+    addRoute(path, handler, method);
+    
+    for (auto& route : _routes) {
+        if (route.path == path && route.method == method) {
+            route.streaming = true;
+        }
+    }
+}
+
 /**
  * Find matching route - HARDENED
  * Enhanced route matching with security validation
@@ -2082,6 +2150,8 @@ void Atom::_sendError(WebRequest& request, WebResponse& response, const String&
     response.send(500, "text/html", html);
 }
 
+#endif // FEATURE_WEB_SERVER
+
 // ============================================================================
 // Security Implementation Methods - HARDENED
 // (Unchanged from original implementation - these methods work the same)
@@ -2139,6 +2209,7 @@ bool Atom::_validateConfig(const AtomNetworkConfig& config) {
     return isValid;
 }
 
+#if FEATURE_WEB_SERVER
 /**
  * Check rate limit for client IP - HARDENED
  * (Unchanged from original implementation)
@@ -2179,6 +2250,8 @@ bool Atom::_checkRateLimit(IPAddress clientIP) {
     return false;
 }
 
+#endif
+
 /**
  * Clean up rate limiting data - HARDENED
  * (Unchanged from original implementation)
@@ -2232,6 +2305,7 @@ void Atom::_cleanupActiveConnections() {
     }
 }
 
+#if FEATURE_WEB_SERVER
 /**
  * Validate route parameters - HARDENED
  * (Unchanged from original implementation)
@@ -2262,6 +2336,8 @@ bool Atom::_isValidRoute(const String& path, RouteHandler handler, const String&
     return true;
 }
 
+#endif
+
 /**
  * Log security event - HARDENED
  * (Unchanged from original implementation)
@@ -2297,6 +2373,7 @@ void Atom::_logSecurityEvent(AtomSecurityEvent event, const String& details) {
         case AtomSecurityEvent::BUFFER_OVERFLOW_ATTEMPT:eventName = "BUFFER_OVERFLOW"; break;
         case AtomSecurityEvent::TIMEOUT_EXCEEDED:       eventName = "TIMEOUT"; break;
         case AtomSecurityEvent::RESOURCE_EXHAUSTION:    eventName = "RESOURCE_EXHAUSTION"; break;
+        case AtomSecurityEvent::ACCESS_DENIED:          eventName = "ACCESS_DENIED"; break;
         default:                                        eventName = "UNKNOWN"; break;
     }
     
@@ -2356,10 +2433,20 @@ void Atom::_updateSecurityStats() {
     _securityStats.activeConnections = _activeClients.size();
 }
 
+#if FEATURE_WEB_SERVER
 /**
  * Validate client IP address - HARDENED
  * (Unchanged from original implementation)
  */
+/**
+ * Check client against the access control list
+ * 'ignore' and 'noquery' both refuse the web UI and API
+ */
+bool Atom::_isClientAllowed(IPAddress clientIP) {
+    if (!_accessControl) return true;
+    return !(_accessControl->lookup(clientIP) & (ACL_IGNORE | ACL_NOQUERY));
+}
+
 bool Atom::_isClientIPValid(EthernetClient& client) {
     try {
         IPAddress clientIP = client.remoteIP();
@@ -2395,6 +2482,8 @@ void Atom::_sanitizeRoutes() {
     _status.registeredRoutes = _routes.size();
 }
 
+#endif
+
 /**
  * Check resource limits - HARDENED
  * (Unchanged from original implementation)
@@ -2410,10 +2499,12 @@ bool Atom::_checkResourceLimits() {
         return false;
     }
     
+#if FEATURE_WEB_SERVER
     // Check route count
     if (_routes.size() >= ATOM_MAX_ROUTES) {
         return false;
     }
+#endif
     
     return true;
 }
@@ -2429,8 +2520,10 @@ void Atom::_performSecurityMaintenance() {
     // Clean up disconnected clients
     _cleanupActiveConnections();
     
+#if FEATURE_WEB_SERVER
     // Sanitize routes
     _sanitizeRoutes();
+#endif
     
     // Update statistics
     _updateSecurityStats();
@@ -2441,6 +2534,7 @@ void Atom::_performSecurityMaintenance() {
     }
 }
 
+#if FEATURE_WEB_SERVER
 /**
  * Detect path traversal attempts - HARDENED
  * (Unchanged from original implementation)
@@ -2484,6 +2578,9 @@ WebRequest::WebRequest() {
     _isSuspicious = false;
     _totalSize = 0;
     _parseStartTime = 0;
+    _client = nullptr;
+    _contentLength = 0;
+    _bodyConsumed = 0;
     
     // Reserve memory to prevent frequent reallocations
     _headers.reserve(8);
@@ -2495,8 +2592,9 @@ WebRequest::WebRequest() {
  * Comprehensive protection against malformed and malicious requests
  * (Unchanged from original implementation)
  */
-bool WebRequest::parseFromClient(EthernetClient& client) {
+bool WebRequest::parseFromClient(EthernetClient& client, bool deferBody) {
     _parseStartTime = millis();
+    _client = &client;
     
     String requestLine = "";
     String headerLine = "";
@@ -2578,8 +2676,17 @@ bool WebRequest::parseFromClient(EthernetClient& client) {
         return false;
     }
     
+    if (headersComplete) {
+        String contentLengthStr = getHeader("Content-Length");
+        _contentLength = contentLengthStr.length() > 0 ? contentLengthStr.toInt() : 0;
+        if (_contentLength < 0) {
+            _isValid = false;
+            return false;
+        }
+    }
+    
     // Read body if POST/PUT with size validation
-    if (headersComplete && (_method == "POST" || _method == "PUT")) {
+    if (!deferBody && headersComplete && (_method == "POST" || _method == "PUT")) {
         if (!_parseBody(client)) {
             _isValid = false;
             return false;
@@ -2701,6 +2808,61 @@ bool WebRequest::_parseBody(EthernetClient& client) {
     return true;
 }
 
+/**
+ * Read deferred body into getBody() - HARDENED
+ * Same size limits as an immediate read
+ */
+bool WebRequest::readBody() {
+    if (!_client || _bodyConsumed > 0) {
+        return false;
+    }
+    if (_method != "POST" && _method != "PUT") {
+        return true;
+    }
+    if (!_parseBody(*_client)) {
+        _isValid = false;
+        return false;
+    }
+    _bodyConsumed = _body.length();
+    return true;
+}
+
+/**
+ * Read next chunk of a streamed body
+ * Non-blocking: returns what the socket has buffered right now
+ * @return Bytes read, 0 if none available yet, -1 if body complete or
+ *         connection closed
+ */
+int WebRequest::readBodyChunk(uint8_t* buffer, size_t maxLen) {
+    if (!_client || !buffer || maxLen == 0) {
+        return -1;
+    }
+    
+    size_t remaining = getBodyRemaining();
+    if (remaining == 0) {
+        return -1;
+    }
+    
+    int available = _client->available();
+    if (available <= 0) {
+        return _client->connected() ? 0 : -1;
+    }
+    
+    size_t toRead = min((size_t)available, min(maxLen, remaining));
+    int bytesRead = _client->read(buffer, toRead);
+    if (bytesRead > 0) {
+        _bodyConsumed += bytesRead;
+    }
+    return bytesRead;
+}
+
+size_t WebRequest::getBodyRemaining() const {
+    if (_contentLength <= (long)_bodyConsumed) {
+        return 0;
+    }
+    return _contentLength - _bodyConsumed;
+}
+
 /**
  * Parse query string into parameters - HARDENED
  */
@@ -3132,6 +3294,47 @@ void WebResponse::endChunked() {
     }
 }
 
+/**
+ * Begin raw response - HARDENED
+ * For binary downloads streamed without staging; no Content-Length, the
+ * body is delimited by connection close
+ */
+void WebResponse::beginRaw(const String& contentType) {
+    if (_headersSent || _responseSent || !_clientValid) return;
+    
+    setContentType(contentType);
+    setHeader("Connection", "close");
+    
+    _sendHeaders();
+}
+
+/**
+ * Write raw bytes - HARDENED
+ */
+size_t WebResponse::writeRaw(const uint8_t* data, size_t length) {
+    if (!_headersSent || _responseSent || !_clientValid || !data) return 0;
+    
+    try {
+        size_t written = _client->write(data, length);
+        _totalResponseSize += written;
+        if (written != length) {
+            _clientValid = false;
+        }
+        return written;
+    } catch (...) {
+        _clientValid = false;
+        return 0;
+    }
+}
+
+/**
+ * End raw response - HARDENED
+ */
+void WebResponse::endRaw() {
+    if (!_headersSent || _responseSent) return;
+    _responseSent = true;
+}
+
 /**
  * Private response methods - HARDENED
  */
@@ -3359,3 +3562,5 @@ size_t WebResponse::_estimateResponseSize() {
     
     return size;
 }
+
+#endif // FEATURE_WEB_SERVER
@@ -10,7 +10,8 @@
  * - Hardware detection and diagnostics
  * - Compatible with standard Arduino Client interface
  * - Proper SPI pin configuration for AtomPOE
- * - Built-in web server with flexible routing system
+ * - Built-in web server with flexible routing system (FEATURE_WEB_SERVER;
+ *   the NTP_MINIMAL profile compiles it out - see BuildConfig.h)
  * - Security hardening with DoS protection, rate limiting, and input validation
  * 
  * Dependencies: Ethernet library
@@ -22,14 +23,16 @@
 #ifndef ATOM_H
 #define ATOM_H
 
+#include "BuildConfig.h"
 #include <Arduino.h>
 #include <SPI.h>
 #include <Ethernet.h>
 #include <Client.h>
+#include "ACL.h"
 #include <vector>
 
 // Security and protection constants
-#define ATOM_MAX_ROUTES 32
+#define ATOM_MAX_ROUTES 48
 #define ATOM_MAX_ROUTE_PATH_LENGTH 128
 #define ATOM_MAX_REQUEST_SIZE 8192
 #define ATOM_MAX_HEADER_LENGTH 512
@@ -43,12 +46,14 @@
 #define ATOM_MIN_FREE_HEAP_THRESHOLD 50000
 #define ATOM_SECURITY_LOG_BUFFER_SIZE 2048
 
+#if FEATURE_WEB_SERVER
 // Forward declarations for web server components
 class WebRequest;
 class WebResponse;
 
 // Route handler function type
 typedef void (*RouteHandler)(WebRequest& request, WebResponse& response);
+#endif
 
 /**
  * Security Event Types
@@ -63,7 +68,8 @@ enum class AtomSecurityEvent {
     MEMORY_EXHAUSTION,
     BUFFER_OVERFLOW_ATTEMPT,
     TIMEOUT_EXCEEDED,
-    RESOURCE_EXHAUSTION
+    RESOURCE_EXHAUSTION,
+    ACCESS_DENIED
 };
 
 /**
@@ -141,6 +147,7 @@ struct AtomNetworkStatus {
     uint16_t registeredRoutes = 0;
 };
 
+#if FEATURE_WEB_SERVER
 /**
  * Web Request Class - HARDENED
  * Encapsulates HTTP request data with security validation
@@ -160,6 +167,11 @@ private:
     size_t _totalSize;
     uint32_t _parseStartTime;
     
+    // Body state (deferred/streaming reads)
+    EthernetClient* _client;
+    long _contentLength;
+    size_t _bodyConsumed;
+    
     // Private parsing methods
     void _parseQueryString(const String& queryString);
     bool _parseRequestLine(const String& requestLine);
@@ -183,7 +195,15 @@ public:
     WebRequest();
     
     // Initialize from raw HTTP request
-    bool parseFromClient(EthernetClient& client);
+    // deferBody: read headers only; body is read later by readBody() or
+    // streamed by the handler with readBodyChunk()
+    bool parseFromClient(EthernetClient& client, bool deferBody = false);
+    
+    // Deferred body access
+    bool readBody();
+    int readBodyChunk(uint8_t* buffer, size_t maxLen);
+    long getContentLength() const { return _contentLength; }
+    size_t getBodyRemaining() const;
     
     // Request information
     String getMethod() const { return _method; }
@@ -263,6 +283,11 @@ public:
     void sendChunk(const String& chunk);
     void endChunked();
     
+    // Raw binary response support (body ends when the connection closes)
+    void beginRaw(const String& contentType = "application/octet-stream");
+    size_t writeRaw(const uint8_t* data, size_t length);
+    void endRaw();
+    
     // Status checks
     bool isHeadersSent() const { return _headersSent; }
     bool isResponseSent() const { return _responseSent; }
@@ -270,10 +295,13 @@ public:
     // Direct client access for advanced usage
     EthernetClient& getClient() { return *_client; }
 };
+#endif // FEATURE_WEB_SERVER
 
 // Callback function types
 typedef std::function<void(bool connected, const String& message)> AtomStatusCallback;
+typedef std::function<void(const String& method, const String& path)> AtomRequestCallback;
 
+#if FEATURE_WEB_SERVER
 /**
  * Route Structure - HARDENED
  * Internal route storage with security tracking
@@ -282,16 +310,18 @@ struct AtomRoute {
     String path;
     RouteHandler handler;
     String method;  // Optional method filtering ("GET", "POST", etc.)
+    bool streaming; // Handler reads the body itself (not size capped)
     
     // Security tracking
     bool isValid;
     uint32_t callCount;
     uint32_t lastCallTime;
     
-    AtomRoute() : path(""), handler(nullptr), method(""), isValid(false), callCount(0), lastCallTime(0) {}
+    AtomRoute() : path(""), handler(nullptr), method(""), streaming(false), isValid(false), callCount(0), lastCallTime(0) {}
     AtomRoute(const String& p, RouteHandler h, const String& m = "") 
-        : path(p), handler(h), method(m), isValid(true), callCount(0), lastCallTime(0) {}
+        : path(p), handler(h), method(m), streaming(false), isValid(true), callCount(0), lastCallTime(0) {}
 };
+#endif
 
 /**
  * Atom Network Client Class with Web Server - HARDENED
@@ -408,6 +438,21 @@ public:
      */
     void onStatusChange(AtomStatusCallback callback);
     
+    /**
+     * Set request callback
+     * Called with the method and path of each parsed request, before its
+     * route handler runs (keep it cheap - it is on the request path)
+     * @param callback Function to call per request
+     */
+    void onRequest(AtomRequestCallback callback);
+    
+    /**
+     * Set access control list for the web server
+     * Clients matching 'ignore' or 'noquery' are refused
+     * @param acl Compiled restrict list (must outlive Atom), or nullptr
+     */
+    void setAccessControl(const AccessControl* acl) { _accessControl = acl; }
+    
     /**
      * Force reconnection attempt
      * Useful for recovering from network issues
@@ -415,6 +460,7 @@ public:
      */
     bool reconnect();
     
+#if FEATURE_WEB_SERVER
     // ========================================================================
     // Web Server Methods - HARDENED (unchanged API)
     // ========================================================================
@@ -458,6 +504,16 @@ public:
         addRoute(path, handler, "DELETE");
     }
     
+    /**
+     * Add a streaming route
+     * The request body is not buffered or capped at ATOM_MAX_REQUEST_SIZE;
+     * the handler consumes it with WebRequest::readBodyChunk()
+     * @param path URL path to handle
+     * @param handler Function to call when path is requested
+     * @param method HTTP method (normally "POST" or "PUT")
+     */
+    void addStreamingRoute(const String& path, RouteHandler handler, const String& method);
+    
     /**
      * Remove a route
      * @param path Path to remove
@@ -499,6 +555,7 @@ public:
      * @param handler Function to call for server errors
      */
     void setErrorHandler(RouteHandler handler);
+#endif // FEATURE_WEB_SERVER
     
     // ========================================================================
     // Security Methods - NEW (unchanged API)
@@ -577,18 +634,22 @@ private:
     EthernetClient _client;
     byte _macAddress[6];
     AtomStatusCallback _statusCallback;
+    AtomRequestCallback _requestCallback;
+    const AccessControl* _accessControl = nullptr;
     uint32_t _lastStatusCheck = 0;
     bool _lastConnectedState = false;
     
     // NEW: Two-phase design flag
     bool _hasBegun = false;  // Prevents setters after begin()
     
+#if FEATURE_WEB_SERVER
     // Web server private members
     EthernetServer* _webServer;
     std::vector<AtomRoute> _routes;
     RouteHandler _404Handler;
     RouteHandler _errorHandler;
     bool _webServerEnabled;
+#endif
     
     // Security and monitoring members
     AtomSecurityStats _securityStats;
@@ -611,19 +672,23 @@ private:
     // NEW: Helper methods for setters
     bool _parseMacString(const String& macStr, byte mac[6]);
     
+#if FEATURE_WEB_SERVER
     // Private methods (web server)
     void _handleSingleClient();
     AtomRoute* _findRoute(const String& path, const String& method);
     void _send404(WebRequest& request, WebResponse& response);
     void _sendError(WebRequest& request, WebResponse& response, const String& error);
     bool _pathMatches(const String& routePath, const String& requestPath);
+#endif
     
     // Private methods (security)
     bool _validateConfig(const AtomNetworkConfig& config);
+#if FEATURE_WEB_SERVER
     bool _isValidRoute(const String& path, RouteHandler handler, const String& method);
     bool _detectPathTraversal(const String& path);
     bool _isValidHttpMethod(const String& method);
     bool _checkRateLimit(IPAddress clientIP);
+#endif
     void _cleanupRateLimits();
     bool _checkMemoryPressure();
     void _cleanupActiveConnections();
@@ -631,8 +696,11 @@ private:
     bool _isSafeString(const String& str, size_t maxLength);
     String _truncateString(const String& str, size_t maxLength);
     void _updateSecurityStats();
+#if FEATURE_WEB_SERVER
     bool _isClientIPValid(EthernetClient& client);
+    bool _isClientAllowed(IPAddress clientIP);
     void _sanitizeRoutes();
+#endif
     bool _checkResourceLimits();
     void _performSecurityMaintenance();
 };
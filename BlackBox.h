@@ -0,0 +1,378 @@
+/*
+ * ============================================================================
+ * BlackBox.h - Crash and Stall Recorder for ESP32
+ * ============================================================================
+ *
+ * Keeps a small flight-recorder style record in RTC memory that survives
+ * software resets, panics and watchdog resets (but not power loss). After a
+ * reboot the previous record is preserved so stalls and crashes that only
+ * happen under production load can be diagnosed.
+ *
+ * Recorded:
+ * - Last N loop timing samples and peak loop time
+ * - Loop stage breadcrumb (which subsystem was running)
+ * - Last HTTP route and last NTP client served
+ * - Heap low-water mark
+ * - Reset reason of the following boot
+ * - Panic backtrace (from the core dump summary, when the core dump
+ *   partition is enabled in the build)
+ *
+ * All per-loop updates are plain stores into RTC memory - no checksums,
+ * no flash writes, no allocation.
+ *
+ * Dependencies: esp_system.h (reset reason), esp_core_dump.h (optional)
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef BLACKBOX_H
+#define BLACKBOX_H
+
+#include <Arduino.h>
+#include <esp_system.h>
+#include <esp_attr.h>
+
+#if __has_include(<esp_core_dump.h>)
+#include <esp_core_dump.h>
+#endif
+
+#if defined(CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH) && defined(CONFIG_ESP_COREDUMP_DATA_FORMAT_ELF) && defined(__XTENSA__)
+#define BLACKBOX_HAS_COREDUMP 1
+#else
+#define BLACKBOX_HAS_COREDUMP 0
+#endif
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define BLACKBOX_MAGIC 0x424C4B31            // "BLK1" - record layout version
+#define BLACKBOX_LOOP_SAMPLES 32             // Loop timing samples kept
+#define BLACKBOX_ROUTE_LEN 32                // Max stored HTTP route length
+#define BLACKBOX_BACKTRACE_DEPTH 8           // Backtrace frames kept
+#define BLACKBOX_HEAP_SAMPLE_LOOPS 64        // Loops between heap samples
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Loop Stage Breadcrumb
+ * Set before each subsystem runs; after a watchdog reset it names the
+ * subsystem that never returned
+ */
+enum class BlackBoxStage : uint8_t {
+    BOOT = 0,
+    GPS,
+    NTP,
+    WEB,
+    MQTT,
+    HOUSEKEEPING,
+    IDLE
+};
+
+/**
+ * Black Box Record
+ * Lives in RTC memory; layout is versioned by BLACKBOX_MAGIC
+ */
+struct BlackBoxRecord {
+    uint32_t magic;                          // BLACKBOX_MAGIC when valid
+    uint32_t bootCount;                      // Boots since power-on
+
+    // Loop Timing
+    uint32_t loopCount;                      // Loops completed this boot
+    uint32_t loopSamples[BLACKBOX_LOOP_SAMPLES]; // Last loop times (us)
+    uint16_t loopHead;                       // Next sample slot
+    uint32_t peakLoopTime;                   // Peak loop time this boot (us)
+    uint8_t stage;                           // Current BlackBoxStage
+
+    // Uptime and Heap
+    uint32_t uptimeMs;                       // millis() at last loop
+    uint32_t freeHeap;                       // Free heap at last sample
+    uint32_t minFreeHeap;                    // Heap low-water mark
+
+    // Last Work Served
+    char lastRoute[BLACKBOX_ROUTE_LEN];      // Last HTTP route requested
+    uint32_t lastRouteMs;                    // When the route was requested
+    uint32_t lastNtpClient;                  // Last NTP client (IPv4, network order)
+    uint32_t lastNtpMs;                      // When it was served
+    uint32_t ntpRequests;                    // NTP requests served this boot
+};
+
+/**
+ * Crash Summary
+ * Filled at boot from the reset reason and core dump partition
+ */
+struct BlackBoxCrash {
+    esp_reset_reason_t resetReason;          // Why the previous boot ended
+    bool hasBacktrace;                       // Backtrace captured
+    char task[16];                           // Task that crashed
+    uint32_t pc;                             // Exception program counter
+    uint32_t backtrace[BLACKBOX_BACKTRACE_DEPTH]; // Return addresses
+    uint8_t depth;                           // Valid backtrace frames
+    bool corrupted;                          // Stack was corrupted
+};
+
+// RTC memory is not cleared by software/panic/watchdog resets
+RTC_NOINIT_ATTR static BlackBoxRecord blackBoxRTC;
+
+// ============================================================================
+// BLACKBOX CLASS
+// ============================================================================
+
+class BlackBox {
+public:
+    // ========================================================================
+    // PUBLIC API
+    // ========================================================================
+
+    /**
+     * Initialize recorder - call first thing in setup()
+     * Preserves the previous boot's record and starts a fresh one
+     */
+    void begin();
+
+    /**
+     * Record one loop iteration - call at the end of loop()
+     * @param loopTimeMicros Duration of the iteration
+     */
+    void recordLoop(uint32_t loopTimeMicros);
+
+    /**
+     * Set loop stage breadcrumb
+     * @param stage Subsystem about to run
+     */
+    void setStage(BlackBoxStage stage) { blackBoxRTC.stage = (uint8_t)stage; }
+
+    /**
+     * Record HTTP route being handled
+     * @param path Request path (truncated to BLACKBOX_ROUTE_LEN - 1)
+     */
+    void recordRoute(const String& path);
+
+    /**
+     * Record NTP client served
+     * @param clientIP Client IPv4 address
+     */
+    void recordNtpClient(uint32_t clientIP);
+
+    /**
+     * Check if a record from the previous boot is available
+     * @return True if previous record survived the reset
+     */
+    bool hasPrevious() const { return previousValid; }
+
+    /**
+     * Get record preserved from the previous boot
+     * @return Reference to previous record (check hasPrevious() first)
+     */
+    const BlackBoxRecord& getPrevious() const { return previous; }
+
+    /**
+     * Get live record for this boot
+     * @return Reference to current record
+     */
+    const BlackBoxRecord& getCurrent() const { return blackBoxRTC; }
+
+    /**
+     * Get crash summary for the previous boot
+     * @return Reference to crash summary
+     */
+    const BlackBoxCrash& getCrash() const { return crash; }
+
+    /**
+     * Check if the previous boot ended abnormally
+     * @return True for panic, watchdog or brownout resets
+     */
+    bool previousCrashed() const;
+
+    /**
+     * Get human-readable reset reason
+     * @param reason Reset reason code
+     * @return Reason name
+     */
+    static const char* resetReasonString(esp_reset_reason_t reason);
+
+    /**
+     * Get human-readable stage name
+     * @param stage BlackBoxStage value
+     * @return Stage name
+     */
+    static const char* stageString(uint8_t stage);
+
+    /**
+     * Get one-line summary of the previous boot for logging
+     * @return Summary string
+     */
+    String getPreviousSummary() const;
+
+private:
+    // ========================================================================
+    // INTERNAL STATE
+    // ========================================================================
+
+    BlackBoxRecord previous;                 // Copy of previous boot's record
+    bool previousValid = false;              // Previous record survived
+    BlackBoxCrash crash;                     // Previous boot's crash summary
+
+    // ========================================================================
+    // INTERNAL METHODS
+    // ========================================================================
+
+    void loadCrashSummary();
+};
+
+// ============================================================================
+// IMPLEMENTATION
+// ============================================================================
+
+void BlackBox::begin() {
+    memset(&crash, 0, sizeof(crash));
+    crash.resetReason = esp_reset_reason();
+
+    // RTC contents are garbage after power-on; otherwise they describe the
+    // boot that just ended
+    uint32_t bootCount = 0;
+    previousValid = (crash.resetReason != ESP_RST_POWERON &&
+                     blackBoxRTC.magic == BLACKBOX_MAGIC &&
+                     blackBoxRTC.loopHead < BLACKBOX_LOOP_SAMPLES);
+
+    if (previousValid) {
+        memcpy(&previous, &blackBoxRTC, sizeof(previous));
+        previous.lastRoute[BLACKBOX_ROUTE_LEN - 1] = '\0';
+        bootCount = previous.bootCount + 1;
+    } else {
+        memset(&previous, 0, sizeof(previous));
+    }
+
+    loadCrashSummary();
+
+    // Start fresh record for this boot
+    memset(&blackBoxRTC, 0, sizeof(blackBoxRTC));
+    blackBoxRTC.bootCount = bootCount;
+    blackBoxRTC.stage = (uint8_t)BlackBoxStage::BOOT;
+    blackBoxRTC.freeHeap = ESP.getFreeHeap();
+    blackBoxRTC.minFreeHeap = ESP.getMinFreeHeap();
+    blackBoxRTC.magic = BLACKBOX_MAGIC;
+}
+
+void BlackBox::recordLoop(uint32_t loopTimeMicros) {
+    BlackBoxRecord& r = blackBoxRTC;
+
+    r.loopSamples[r.loopHead] = loopTimeMicros;
+    r.loopHead = (r.loopHead + 1) % BLACKBOX_LOOP_SAMPLES;
+    if (loopTimeMicros > r.peakLoopTime) {
+        r.peakLoopTime = loopTimeMicros;
+    }
+    r.uptimeMs = millis();
+    r.stage = (uint8_t)BlackBoxStage::IDLE;
+
+    // Heap queries take the allocator lock - sample periodically only
+    if ((++r.loopCount % BLACKBOX_HEAP_SAMPLE_LOOPS) == 0) {
+        r.freeHeap = ESP.getFreeHeap();
+        r.minFreeHeap = ESP.getMinFreeHeap();
+    }
+}
+
+void BlackBox::recordRoute(const String& path) {
+    strncpy(blackBoxRTC.lastRoute, path.c_str(), BLACKBOX_ROUTE_LEN - 1);
+    blackBoxRTC.lastRoute[BLACKBOX_ROUTE_LEN - 1] = '\0';
+    blackBoxRTC.lastRouteMs = millis();
+}
+
+void BlackBox::recordNtpClient(uint32_t clientIP) {
+    blackBoxRTC.lastNtpClient = clientIP;
+    blackBoxRTC.lastNtpMs = millis();
+    blackBoxRTC.ntpRequests++;
+}
+
+bool BlackBox::previousCrashed() const {
+    switch (crash.resetReason) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+        case ESP_RST_BROWNOUT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void BlackBox::loadCrashSummary() {
+#if BLACKBOX_HAS_COREDUMP
+    if (crash.resetReason != ESP_RST_PANIC) {
+        return;
+    }
+
+    esp_core_dump_summary_t* summary = (esp_core_dump_summary_t*)malloc(sizeof(esp_core_dump_summary_t));
+    if (!summary) {
+        return;
+    }
+
+    if (esp_core_dump_get_summary(summary) == ESP_OK) {
+        crash.hasBacktrace = true;
+        strncpy(crash.task, summary->exc_task, sizeof(crash.task) - 1);
+        crash.pc = summary->exc_pc;
+        crash.depth = min((uint32_t)summary->exc_bt_info.depth, (uint32_t)BLACKBOX_BACKTRACE_DEPTH);
+        crash.corrupted = summary->exc_bt_info.corrupted;
+        for (uint8_t i = 0; i < crash.depth; i++) {
+            crash.backtrace[i] = summary->exc_bt_info.bt[i];
+        }
+    }
+    free(summary);
+#endif
+}
+
+const char* BlackBox::resetReasonString(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON:   return "power_on";
+        case ESP_RST_EXT:       return "external";
+        case ESP_RST_SW:        return "software";
+        case ESP_RST_PANIC:     return "panic";
+        case ESP_RST_INT_WDT:   return "interrupt_watchdog";
+        case ESP_RST_TASK_WDT:  return "task_watchdog";
+        case ESP_RST_WDT:       return "watchdog";
+        case ESP_RST_DEEPSLEEP: return "deep_sleep";
+        case ESP_RST_BROWNOUT:  return "brownout";
+        case ESP_RST_SDIO:      return "sdio";
+        default:                return "unknown";
+    }
+}
+
+const char* BlackBox::stageString(uint8_t stage) {
+    switch ((BlackBoxStage)stage) {
+        case BlackBoxStage::BOOT:         return "boot";
+        case BlackBoxStage::GPS:          return "gps";
+        case BlackBoxStage::NTP:          return "ntp";
+        case BlackBoxStage::WEB:          return "web";
+        case BlackBoxStage::MQTT:         return "mqtt";
+        case BlackBoxStage::HOUSEKEEPING: return "housekeeping";
+        case BlackBoxStage::IDLE:         return "idle";
+        default:                          return "unknown";
+    }
+}
+
+String BlackBox::getPreviousSummary() const {
+    String summary = "Reset: " + String(resetReasonString(crash.resetReason));
+
+    if (!previousValid) {
+        return summary + " (no previous record)";
+    }
+
+    summary += " | Stage: " + String(stageString(previous.stage));
+    summary += " | Uptime: " + String(previous.uptimeMs / 1000) + "s";
+    summary += " | Peak loop: " + String(previous.peakLoopTime) + "us";
+    summary += " | Min heap: " + String(previous.minFreeHeap);
+    if (previous.lastRoute[0]) {
+        summary += " | Route: " + String(previous.lastRoute);
+    }
+    if (crash.hasBacktrace) {
+        summary += " | PC: 0x" + String(crash.pc, HEX) + " in " + String(crash.task);
+    }
+    return summary;
+}
+
+#endif // BLACKBOX_H
@@ -0,0 +1,135 @@
+/*
+ * ============================================================================
+ * BuildConfig.h - Compile-Time Build Profiles
+ * ============================================================================
+ *
+ * Selects which subsystems are compiled into the firmware. Units that only
+ * serve time can drop the dashboard, REST API and MQTT entirely, freeing
+ * flash, static RAM and loop time for NTP serving.
+ *
+ * Profiles:
+ * - NTP_PROFILE_MINIMAL   : GPS + NTP server only (no web server, no JSON)
+ * - NTP_PROFILE_MONITORED : + JSON REST API on the web server
+ * - NTP_PROFILE_FULL      : + HTML dashboard pages and MQTT (default)
+ *
+ * Select a profile by defining NTP_BUILD_PROFILE before this header is
+ * included, e.g. via build flags:
+ *   PlatformIO:  build_flags = -DNTP_BUILD_PROFILE=NTP_PROFILE_MINIMAL
+ *   arduino-cli: --build-property "build.extra_flags=-DNTP_BUILD_PROFILE=1"
+ *
+ * Individual FEATURE_* flags may also be overridden the same way.
+ * FEATURE_OTA (streaming firmware update) follows FEATURE_WEB_SERVER unless
+ * overridden.
+ *
+ * Debug flags (off by default):
+ * - DEBUG_NMEA_SELFTEST : run the NMEA scan parity fuzz and benchmark at boot
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef BUILD_CONFIG_H
+#define BUILD_CONFIG_H
+
+// ============================================================================
+// PROFILE IDENTIFIERS
+// ============================================================================
+
+#define NTP_PROFILE_MINIMAL   1              // GPS + NTP only
+#define NTP_PROFILE_MONITORED 2              // + JSON REST API
+#define NTP_PROFILE_FULL      3              // + Dashboard pages and MQTT
+
+#ifndef NTP_BUILD_PROFILE
+#define NTP_BUILD_PROFILE NTP_PROFILE_FULL
+#endif
+
+// ============================================================================
+// PROFILE DEFAULTS
+// ============================================================================
+
+#if NTP_BUILD_PROFILE == NTP_PROFILE_MINIMAL
+    #define BUILD_PROFILE_NAME "NTP_MINIMAL"
+    #ifndef FEATURE_WEB_SERVER
+    #define FEATURE_WEB_SERVER 0             // Atom HTTP server and routes
+    #endif
+    #ifndef FEATURE_WEB_API
+    #define FEATURE_WEB_API 0                // JSON endpoints (ArduinoJson)
+    #endif
+    #ifndef FEATURE_WEB_UI
+    #define FEATURE_WEB_UI 0                 // HTML pages and visualizations
+    #endif
+    #ifndef FEATURE_MQTT
+    #define FEATURE_MQTT 0                   // MQTT publishing (PubSubClient)
+    #endif
+    #ifndef FEATURE_MDNS
+    #define FEATURE_MDNS 1                   // mDNS service announcement
+    #endif
+#elif NTP_BUILD_PROFILE == NTP_PROFILE_MONITORED
+    #define BUILD_PROFILE_NAME "NTP_MONITORED"
+    #ifndef FEATURE_WEB_SERVER
+    #define FEATURE_WEB_SERVER 1
+    #endif
+    #ifndef FEATURE_WEB_API
+    #define FEATURE_WEB_API 1
+    #endif
+    #ifndef FEATURE_WEB_UI
+    #define FEATURE_WEB_UI 0
+    #endif
+    #ifndef FEATURE_MQTT
+    #define FEATURE_MQTT 0
+    #endif
+    #ifndef FEATURE_MDNS
+    #define FEATURE_MDNS 1
+    #endif
+#elif NTP_BUILD_PROFILE == NTP_PROFILE_FULL
+    #define BUILD_PROFILE_NAME "FULL"
+    #ifndef FEATURE_WEB_SERVER
+    #define FEATURE_WEB_SERVER 1
+    #endif
+    #ifndef FEATURE_WEB_API
+    #define FEATURE_WEB_API 1
+    #endif
+    #ifndef FEATURE_WEB_UI
+    #define FEATURE_WEB_UI 1
+    #endif
+    #ifndef FEATURE_MQTT
+    #define FEATURE_MQTT 1
+    #endif
+    #ifndef FEATURE_MDNS
+    #define FEATURE_MDNS 1
+    #endif
+#else
+    #error "Unknown NTP_BUILD_PROFILE - use NTP_PROFILE_MINIMAL, NTP_PROFILE_MONITORED or NTP_PROFILE_FULL"
+#endif
+
+#ifndef FEATURE_OTA
+#define FEATURE_OTA FEATURE_WEB_SERVER       // Streaming firmware update endpoint
+#endif
+
+// ============================================================================
+// DEBUG FLAGS
+// ============================================================================
+
+#ifndef DEBUG_NMEA_SELFTEST
+#define DEBUG_NMEA_SELFTEST 0                // NMEAScan::selfTest()/benchmark() in setup()
+#endif
+
+// ============================================================================
+// DEPENDENCY CHECKS
+// ============================================================================
+
+// The dashboard pages poll the JSON API, and the API needs the web server
+#if FEATURE_WEB_UI && !FEATURE_WEB_API
+    #error "FEATURE_WEB_UI requires FEATURE_WEB_API"
+#endif
+
+#if FEATURE_WEB_API && !FEATURE_WEB_SERVER
+    #error "FEATURE_WEB_API requires FEATURE_WEB_SERVER"
+#endif
+
+#if FEATURE_OTA && !FEATURE_WEB_SERVER
+    #error "FEATURE_OTA requires FEATURE_WEB_SERVER"
+#endif
+
+#endif // BUILD_CONFIG_H
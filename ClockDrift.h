@@ -0,0 +1,338 @@
+/*
+ * ============================================================================
+ * ClockDrift.h - Crystal Frequency Estimate with a Persisted Drift File
+ * ============================================================================
+ *
+ * Estimates the frequency error of the ESP32 crystal (and so of the
+ * Timebase) against GPS time, and keeps it in flash like ntpd's drift
+ * file so a reboot starts from the last estimate instead of from zero.
+ *
+ * Why: served time is the last GPS anchor plus Timebase elapsed time. A
+ * 20 ppm crystal adds 20 us per second of extrapolation, and far more when
+ * anchors stop. NMEA sentence starts jitter by around a millisecond, so
+ * measuring the error to 1 ppm from NMEA alone needs baselines of tens of
+ * minutes.
+ *
+ * Estimation:
+ * - Measurement: local elapsed vs GPS elapsed over a growing baseline
+ *   from a reference anchor; its uncertainty is ~1.4 x anchor jitter /
+ *   baseline
+ * - Combined with the prior (restored value, or the previous baseline)
+ *   by inverse-variance weighting
+ * - The reference restarts every DRIFT_MAX_BASELINE_S, so the estimate
+ *   follows temperature; each finished baseline also feeds a linear fit
+ *   of ppm against the chip temperature sensor (temperature coefficient)
+ * - Converged when the uncertainty is below DRIFT_CONVERGED_PPM
+ *
+ * Drift file (NVS namespace "drift", wear-levelled by NVS):
+ * - Frequency, uncertainty, temperature coefficient and the temperature
+ *   at save time
+ * - Written at most every DRIFT_SAVE_INTERVAL_MS and only when the value
+ *   moved, plus once when this boot converges
+ * - On restore the uncertainty is widened by DRIFT_AGING_PPM and the
+ *   value moved along the temperature coefficient, if one was measured
+ * - Also records how long the last cold and warm start took to converge
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef CLOCK_DRIFT_H
+#define CLOCK_DRIFT_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define DRIFT_MIN_BASELINE_S 16              // Shortest baseline used
+#define DRIFT_MAX_BASELINE_S 4096            // Restart reference (tracks temperature)
+#define DRIFT_CONVERGED_PPM 1.0f             // Uncertainty counted as converged
+#define DRIFT_MAX_PPM 200.0f                 // Reject estimates beyond this
+#define DRIFT_WANDER_PPM 0.05f               // Uncertainty added per baseline restart
+#define DRIFT_AGING_PPM 0.5f                 // Uncertainty added to a restored value
+#define DRIFT_JITTER_FLOOR_US 100.0f         // Minimum assumed anchor jitter
+#define DRIFT_JITTER_WEIGHT 0.05f            // EWMA weight of anchor jitter
+#define DRIFT_TEMPCO_MIN_SPAN_C 2.0f         // Temperature spread before fitting
+#define DRIFT_TEMPCO_MIN_SAMPLES 3
+#define DRIFT_SAVE_INTERVAL_MS 3600000       // At most one flash write per hour
+#define DRIFT_SAVE_MIN_CHANGE_PPM 0.05f      // Skip writes that change nothing
+
+#define DRIFT_NVS_NAMESPACE "drift"
+#define DRIFT_RECORD_VERSION 1
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Drift File Contents
+ */
+struct DriftRecord {
+    uint8_t version;
+    float ppm;                               // Frequency error (+ = Timebase fast)
+    float sigmaPPM;                          // Uncertainty at save time
+    float tempcoPPMPerC;                     // Temperature coefficient
+    bool tempcoValid;
+    float temperatureC;                      // Chip temperature at save time
+    uint32_t coldConvergeSeconds;            // Last boot without a stored value (0 = unknown)
+    uint32_t warmConvergeSeconds;            // Last boot with a stored value (0 = unknown)
+    uint32_t saves;                          // Writes over the record's life
+};
+
+/**
+ * Estimator State
+ */
+struct DriftState {
+    float ppm;                               // Current estimate
+    float sigmaPPM;                          // Uncertainty (0 = no estimate yet)
+    float jitterMicros;                      // Anchor jitter (EWMA of |residual|)
+    uint32_t baselineSeconds;                // Current measurement baseline
+    uint32_t samples;                        // Anchors processed
+    uint32_t rejected;                       // Anchors that broke continuity
+    bool restored;                           // Started from the drift file
+    bool converged;
+    uint32_t convergeSeconds;                // First anchor -> converged
+    float temperatureC;                      // Last chip temperature reading
+    uint32_t savedMillis;                    // Last write (0 = not this boot)
+};
+
+// ============================================================================
+// CLOCK DRIFT CLASS
+// ============================================================================
+
+class ClockDrift {
+public:
+    /**
+     * Restore the drift file
+     * @return True if a usable value was loaded
+     */
+    bool begin() {
+        memset(&state, 0, sizeof(state));
+        memset(&record, 0, sizeof(record));
+        record.version = DRIFT_RECORD_VERSION;
+        state.temperatureC = temperatureRead();
+
+        Preferences prefs;
+        DriftRecord stored;
+        bool found = prefs.begin(DRIFT_NVS_NAMESPACE, true) &&
+                     prefs.getBytes("record", &stored, sizeof(stored)) == sizeof(stored);
+        prefs.end();
+        if (!found || stored.version != DRIFT_RECORD_VERSION ||
+            fabsf(stored.ppm) > DRIFT_MAX_PPM || !(stored.sigmaPPM > 0)) {
+            return false;
+        }
+
+        record = stored;
+        priorPPM = stored.ppm;
+        if (stored.tempcoValid) {
+            priorPPM += stored.tempcoPPMPerC * (state.temperatureC - stored.temperatureC);
+        }
+        priorSigma = stored.sigmaPPM + DRIFT_AGING_PPM;
+        state.ppm = priorPPM;
+        state.sigmaPPM = priorSigma;
+        state.restored = true;
+        return true;
+    }
+
+    /**
+     * Feed one GPS time anchor
+     * @param gpsMicros GPS time of the anchor (any epoch, microseconds)
+     * @param anchorMicros Timebase at the anchor
+     * @param nowMillis Current millis()
+     */
+    void update(uint64_t gpsMicros, uint64_t anchorMicros, uint32_t nowMillis) {
+        state.samples++;
+        if (firstAnchorMillis == 0) {
+            firstAnchorMillis = nowMillis ? nowMillis : 1;
+        }
+
+        if (!haveRef) {
+            startBaseline(gpsMicros, anchorMicros);
+            return;
+        }
+
+        // Continuity: a time step or a lost reference shows as an absurd rate
+        int64_t gpsStep = (int64_t)(gpsMicros - lastGps);
+        int64_t localStep = (int64_t)(anchorMicros - lastLocal);
+        if (gpsStep <= 0 || llabs(localStep - gpsStep) > gpsStep / 1000 + 50000) {
+            state.rejected++;
+            startBaseline(gpsMicros, anchorMicros);
+            return;
+        }
+
+        // Anchor jitter from consecutive anchors
+        if (gpsStep <= 2000000) {
+            float residual = (float)(localStep - gpsStep) - state.ppm * (float)gpsStep / 1000000.0f;
+            state.jitterMicros += DRIFT_JITTER_WEIGHT * (fabsf(residual) - state.jitterMicros);
+        }
+        lastGps = gpsMicros;
+        lastLocal = anchorMicros;
+
+        uint64_t gpsElapsed = gpsMicros - refGps;
+        state.baselineSeconds = gpsElapsed / 1000000ULL;
+        if (state.baselineSeconds < DRIFT_MIN_BASELINE_S) {
+            return;
+        }
+
+        // Measurement over the whole baseline
+        int64_t excess = (int64_t)(anchorMicros - refLocal) - (int64_t)gpsElapsed;
+        float measuredPPM = (float)((double)excess * 1000000.0 / (double)gpsElapsed);
+        float jitter = max(state.jitterMicros, DRIFT_JITTER_FLOOR_US);
+        float measuredSigma = 1.414f * jitter / (float)state.baselineSeconds;
+        if (fabsf(measuredPPM) > DRIFT_MAX_PPM) {
+            state.rejected++;
+            startBaseline(gpsMicros, anchorMicros);
+            return;
+        }
+
+        combine(measuredPPM, measuredSigma);
+        checkConverged(nowMillis);
+
+        // Finished baseline: becomes the prior, feeds the temperature fit
+        if (state.baselineSeconds >= DRIFT_MAX_BASELINE_S) {
+            float temperature = temperatureRead();
+            addTempcoSample((baselineStartC + temperature) / 2, measuredPPM);
+            priorPPM = state.ppm;
+            priorSigma = state.sigmaPPM + DRIFT_WANDER_PPM;
+            startBaseline(gpsMicros, anchorMicros);
+        }
+    }
+
+    /**
+     * Write the drift file when due - call from the loop
+     */
+    void process(uint32_t nowMillis) {
+        if (!state.converged) {
+            return;
+        }
+        bool firstThisBoot = state.savedMillis == 0;
+        bool due = nowMillis - state.savedMillis >= DRIFT_SAVE_INTERVAL_MS &&
+                   fabsf(state.ppm - record.ppm) >= DRIFT_SAVE_MIN_CHANGE_PPM;
+        if (firstThisBoot || due) {
+            save(nowMillis);
+        }
+    }
+
+    /**
+     * Forget the drift file (next boot starts cold)
+     */
+    void erase() {
+        Preferences prefs;
+        if (prefs.begin(DRIFT_NVS_NAMESPACE, false)) {
+            prefs.remove("record");
+            prefs.end();
+        }
+    }
+
+    /**
+     * Correction to subtract from Timebase elapsed time - timing path
+     * @param elapsedMicros Timebase microseconds since a GPS anchor
+     * @return Microseconds the Timebase gained over that interval
+     */
+    int64_t correctionMicros(uint64_t elapsedMicros) const {
+        if (state.sigmaPPM <= 0) {
+            return 0;
+        }
+        return (int64_t)((double)elapsedMicros * state.ppm / 1000000.0);
+    }
+
+    const DriftState& getState() const { return state; }
+    const DriftRecord& getRecord() const { return record; }
+
+private:
+    DriftState state = {};
+    DriftRecord record = {};
+
+    // Prior (restored value or previous baseline); sigma 0 = none
+    float priorPPM = 0;
+    float priorSigma = 0;
+
+    // Current baseline
+    bool haveRef = false;
+    uint64_t refGps = 0;
+    uint64_t refLocal = 0;
+    uint64_t lastGps = 0;
+    uint64_t lastLocal = 0;
+    float baselineStartC = 0;
+    uint32_t firstAnchorMillis = 0;
+
+    // Temperature fit (ppm = a + tempco * T)
+    uint16_t tempcoSamples = 0;
+    float sumT = 0, sumF = 0, sumTT = 0, sumTF = 0;
+    float minT = 0, maxT = 0;
+
+    void startBaseline(uint64_t gpsMicros, uint64_t anchorMicros) {
+        haveRef = true;
+        refGps = lastGps = gpsMicros;
+        refLocal = lastLocal = anchorMicros;
+        baselineStartC = temperatureRead();
+        state.temperatureC = baselineStartC;
+        state.baselineSeconds = 0;
+    }
+
+    // Inverse-variance combination of the prior and the measurement
+    void combine(float measuredPPM, float measuredSigma) {
+        if (priorSigma <= 0) {
+            state.ppm = measuredPPM;
+            state.sigmaPPM = measuredSigma;
+            return;
+        }
+        float wp = 1.0f / (priorSigma * priorSigma);
+        float wm = 1.0f / (measuredSigma * measuredSigma);
+        state.ppm = (priorPPM * wp + measuredPPM * wm) / (wp + wm);
+        state.sigmaPPM = 1.0f / sqrtf(wp + wm);
+    }
+
+    void checkConverged(uint32_t nowMillis) {
+        if (state.converged || state.sigmaPPM > DRIFT_CONVERGED_PPM) {
+            return;
+        }
+        state.converged = true;
+        state.convergeSeconds = (nowMillis - firstAnchorMillis) / 1000;
+        if (state.restored) {
+            record.warmConvergeSeconds = state.convergeSeconds;
+        } else {
+            record.coldConvergeSeconds = state.convergeSeconds;
+        }
+    }
+
+    void addTempcoSample(float temperatureC, float ppm) {
+        if (tempcoSamples == 0) {
+            minT = maxT = temperatureC;
+        }
+        minT = min(minT, temperatureC);
+        maxT = max(maxT, temperatureC);
+        tempcoSamples++;
+        sumT += temperatureC;
+        sumF += ppm;
+        sumTT += temperatureC * temperatureC;
+        sumTF += temperatureC * ppm;
+
+        float denom = tempcoSamples * sumTT - sumT * sumT;
+        if (tempcoSamples >= DRIFT_TEMPCO_MIN_SAMPLES && maxT - minT >= DRIFT_TEMPCO_MIN_SPAN_C && denom > 0) {
+            record.tempcoPPMPerC = (tempcoSamples * sumTF - sumT * sumF) / denom;
+            record.tempcoValid = true;
+        }
+    }
+
+    void save(uint32_t nowMillis) {
+        record.version = DRIFT_RECORD_VERSION;
+        record.ppm = state.ppm;
+        record.sigmaPPM = state.sigmaPPM;
+        record.temperatureC = temperatureRead();
+        record.saves++;
+
+        Preferences prefs;
+        if (prefs.begin(DRIFT_NVS_NAMESPACE, false)) {
+            prefs.putBytes("record", &record, sizeof(record));
+            prefs.end();
+        }
+        state.savedMillis = nowMillis ? nowMillis : 1;
+    }
+};
+
+#endif // CLOCK_DRIFT_H
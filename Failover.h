@@ -0,0 +1,457 @@
+/*
+ * ============================================================================
+ * Failover.h - VRRP-style Virtual IP Failover Between Paired Units
+ * ============================================================================
+ *
+ * Two units share one virtual IP (VIP) and one virtual MAC. The healthier
+ * unit owns both and answers NTP on them; clients configured with the VIP
+ * as their only server keep getting time when a unit reboots or loses GPS.
+ *
+ * Protocol (own UDP port, broadcast, modelled on VRRP, RFC 5798):
+ * - The master advertises every FAILOVER_ADVERT_MS with its priority,
+ *   serving state and timing quality
+ * - Backups stay silent and take over when adverts stop for
+ *   FAILOVER_DOWN_INTERVALS intervals plus a priority-dependent skew
+ *   (~300-400 ms), or preempt a master that is clearly less healthy
+ * - Two masters (split brain) resolve to the higher priority, then the
+ *   higher unit address
+ *
+ * Priority is health, not configuration:
+ *   GPS-disciplined   200 + 4 per satellite (max 12) - 2 per HDOP unit
+ *   Peer holdover     100
+ *   Not serving         1
+ * Preemption needs a margin of FAILOVER_PREEMPT_MARGIN sustained for
+ * FAILOVER_PREEMPT_HOLD_MS so two healthy units do not trade the VIP on
+ * every satellite change. A master that stops serving is preempted at
+ * once.
+ *
+ * Takeover: the W5500 has one source address, so the master switches the
+ * chip's IP and MAC to the VIP and the virtual MAC (00:00:5E:00:01:<vrid>)
+ * and switches back when it becomes backup. Because the MAC moves with
+ * the address, client ARP caches stay valid across a failover; the
+ * broadcast advert sent immediately on takeover comes from the virtual
+ * MAC, so switches relearn its port within the takeover itself. This
+ * stands in for a gratuitous ARP, which the W5500 cannot send from a UDP
+ * socket.
+ *
+ * Requires static addressing: while master the unit is reachable only on
+ * the VIP, and a DHCP renewal would overwrite the address.
+ *
+ * Not combined with symmetric peering (NTPPeer.h): peering is keyed on
+ * unit addresses, but the master has none while it holds the VIP. The
+ * backup's polls would go unanswered (each one an ARP timeout) and the
+ * master's would arrive from the VIP, an unconfigured source. The sketch
+ * disables peering whenever failover is enabled.
+ *
+ * Host test: test/host/failover_test.cpp runs two units on a simulated
+ * bridge (election, takeover gap, preemption, split brain).
+ *
+ * Dependencies: GPS.h, NTP.h, Ethernet
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef FAILOVER_H
+#define FAILOVER_H
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include "GPS.h"
+#include "NTP.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define FAILOVER_PORT 9125                   // Advertisement UDP port
+#define FAILOVER_ADVERT_MS 100               // Master advertisement interval
+#define FAILOVER_DOWN_INTERVALS 3            // Missed adverts before takeover
+#define FAILOVER_PREEMPT_MARGIN 10           // Priority lead needed to preempt
+#define FAILOVER_PREEMPT_HOLD_MS 3000        // ...sustained this long
+#define FAILOVER_DEFAULT_VRID 1              // Virtual router ID
+
+// Priorities
+#define FAILOVER_PRIORITY_GPS 200            // Base while GPS-disciplined
+#define FAILOVER_PRIORITY_HOLDOVER 100       // Following a peer
+#define FAILOVER_PRIORITY_DOWN 1             // Not serving time
+
+// Wire format
+#define FAILOVER_MAGIC 0x56495041            // "VIPA"
+#define FAILOVER_VERSION 1
+#define FAILOVER_ADVERT_LEN 20
+#define FAILOVER_FLAG_SERVING 0x01
+#define FAILOVER_FLAG_GPS 0x02
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Failover State
+ */
+enum class FailoverState : uint8_t {
+    DISABLED = 0,
+    BACKUP,                                  // Own address, watching the master
+    MASTER                                   // Owns the VIP
+};
+
+/**
+ * Failover Configuration
+ */
+struct FailoverConfig {
+    bool enabled;
+    IPAddress virtualIP;                     // Shared address clients use
+    uint8_t vrid;                            // Virtual router ID (1-255), same on both units
+};
+
+/**
+ * Other Unit as Last Heard
+ */
+struct FailoverPeer {
+    uint32_t unitIP;                         // Its own address (IPAddress order), 0 = never heard
+    uint8_t priority;
+    uint8_t stratum;
+    uint8_t flags;                           // FAILOVER_FLAG_*
+    uint32_t rootDispersionMicros;
+    uint32_t lastAdvertMillis;
+};
+
+/**
+ * Failover Statistics
+ */
+struct FailoverStats {
+    uint32_t advertsSent;
+    uint32_t advertsReceived;
+    uint32_t advertsRejected;                // Bad magic/version/VRID
+    uint32_t takeovers;                      // Became master
+    uint32_t releases;                       // Gave up the VIP
+    uint32_t lastGapMillis;                  // Last advert heard -> takeover
+    uint32_t lastTransitionMillis;
+};
+
+// ============================================================================
+// FAILOVER CLASS
+// ============================================================================
+
+class Failover {
+public:
+    /**
+     * Start as backup
+     * Records the unit's own address and MAC from the W5500
+     * @param gps GPS instance (for priority)
+     * @param ntp NTP instance (for serving state)
+     * @param config Failover configuration
+     */
+    void begin(GPS& gps, NTP& ntp, const FailoverConfig& config);
+
+    /**
+     * Release the VIP and stop
+     */
+    void end();
+
+    /**
+     * Main processing - call every loop
+     * Sends and receives adverts, runs the election
+     */
+    void process();
+
+    FailoverState getState() const { return state; }
+    uint8_t getPriority() const { return priority; }
+    const FailoverConfig& getConfig() const { return config; }
+    const FailoverPeer& getPeer() const { return peer; }
+    const FailoverStats& getStats() const { return stats; }
+    IPAddress getUnitIP() const { return IPAddress(unitIP); }
+
+    /**
+     * Get state name for export
+     */
+    static const char* stateString(FailoverState state);
+
+    /**
+     * Set optional logging callback
+     * @param callback Function pointer: void logFunc(String message)
+     */
+    void setLogCallback(void (*callback)(String));
+
+private:
+    // ========================================================================
+    // INTERNAL STATE
+    // ========================================================================
+
+    GPS* gpsRef = nullptr;                   // GPS instance reference
+    NTP* ntpRef = nullptr;                   // NTP instance reference
+    FailoverConfig config = {};
+    FailoverState state = FailoverState::DISABLED;
+    EthernetUDP udp;
+
+    uint32_t unitIP = 0;                     // Own address (restored as backup)
+    uint8_t unitMAC[6];                      // Own MAC
+    uint8_t priority = FAILOVER_PRIORITY_DOWN;
+
+    uint32_t lastAdvertSent = 0;             // Master: last advert
+    uint32_t masterDownMillis = 0;           // Backup: when the master counts as gone
+    uint32_t preemptSince = 0;               // Backup: lead held since (0 = none)
+
+    FailoverPeer peer = {};
+    FailoverStats stats = {};
+
+    void (*logCallback)(String) = nullptr;   // Optional logging
+
+    // ========================================================================
+    // INTERNAL METHODS
+    // ========================================================================
+
+    uint8_t computePriority() const;
+    uint32_t masterDownInterval() const;
+    void receiveAdverts();
+    void handleAdvert(const uint8_t* packet, uint32_t now);
+    void sendAdvert();
+    void becomeMaster(uint32_t now);
+    void becomeBackup(uint32_t now);
+    bool outranks(uint8_t prio, uint32_t ip) const;
+    void log(const String& message);
+};
+
+// ============================================================================
+// IMPLEMENTATION
+// ============================================================================
+
+void Failover::begin(GPS& gps, NTP& ntp, const FailoverConfig& cfg) {
+    end();
+
+    gpsRef = &gps;
+    ntpRef = &ntp;
+    config = cfg;
+    if (!config.enabled || (uint32_t)config.virtualIP == 0 || config.vrid == 0) {
+        return;
+    }
+
+    unitIP = (uint32_t)Ethernet.localIP();
+    Ethernet.MACAddress(unitMAC);
+    memset(&peer, 0, sizeof(peer));
+    udp.begin(FAILOVER_PORT);
+
+    // Wait a full down interval before claiming the VIP, so a running
+    // master is heard first
+    state = FailoverState::BACKUP;
+    priority = computePriority();
+    masterDownMillis = millis() + masterDownInterval();
+    preemptSince = 0;
+    log("Failover: backup for " + config.virtualIP.toString() + " (VRID " + String(config.vrid) + ")");
+}
+
+void Failover::end() {
+    if (state == FailoverState::DISABLED) {
+        return;
+    }
+    if (state == FailoverState::MASTER) {
+        becomeBackup(millis());
+    }
+    udp.stop();
+    state = FailoverState::DISABLED;
+}
+
+void Failover::process() {
+    if (state == FailoverState::DISABLED) {
+        return;
+    }
+
+    uint32_t now = millis();
+    priority = computePriority();
+    receiveAdverts();
+
+    if (state == FailoverState::MASTER) {
+        if (now - lastAdvertSent >= FAILOVER_ADVERT_MS) {
+            sendAdvert();
+        }
+        return;
+    }
+
+    // Backup: master silent for the down interval
+    if ((int32_t)(now - masterDownMillis) >= 0) {
+        stats.lastGapMillis = peer.lastAdvertMillis ? now - peer.lastAdvertMillis : 0;
+        becomeMaster(now);
+        return;
+    }
+
+    // Backup: preempt a master that is not serving at once, a less healthy
+    // one only after the lead has held
+    if (peer.lastAdvertMillis == 0) {
+        return;
+    }
+    if (priority > FAILOVER_PRIORITY_DOWN && !(peer.flags & FAILOVER_FLAG_SERVING)) {
+        stats.lastGapMillis = 0;
+        becomeMaster(now);
+    } else if (priority >= (uint16_t)peer.priority + FAILOVER_PREEMPT_MARGIN) {
+        if (preemptSince == 0) {
+            preemptSince = now;
+        } else if (now - preemptSince >= FAILOVER_PREEMPT_HOLD_MS) {
+            stats.lastGapMillis = 0;
+            becomeMaster(now);
+        }
+    } else {
+        preemptSince = 0;
+    }
+}
+
+uint8_t Failover::computePriority() const {
+    if (!ntpRef->isServing()) {
+        return FAILOVER_PRIORITY_DOWN;
+    }
+    if (ntpRef->isFollowingPeer()) {
+        return FAILOVER_PRIORITY_HOLDOVER;
+    }
+
+    const GPSData& gpsData = gpsRef->getData();
+    int score = FAILOVER_PRIORITY_GPS + 4 * min(gpsData.satellites, 12) - gpsData.hdopX100 / (GPS_DOP_SCALE / 2);
+    return (uint8_t)constrain(score, FAILOVER_PRIORITY_HOLDOVER + 1, 255);
+}
+
+uint32_t Failover::masterDownInterval() const {
+    // Skew: the healthier backup times out first (RFC 5798 section 6.1)
+    uint32_t skew = (uint32_t)(256 - priority) * FAILOVER_ADVERT_MS / 256;
+    return FAILOVER_DOWN_INTERVALS * FAILOVER_ADVERT_MS + skew;
+}
+
+void Failover::receiveAdverts() {
+    uint8_t packet[FAILOVER_ADVERT_LEN];
+    int size;
+    while ((size = udp.parsePacket()) > 0) {
+        int bytesRead = udp.read(packet, sizeof(packet));
+        if (size != FAILOVER_ADVERT_LEN || bytesRead != FAILOVER_ADVERT_LEN) {
+            stats.advertsRejected++;
+            continue;
+        }
+        handleAdvert(packet, millis());
+    }
+}
+
+void Failover::handleAdvert(const uint8_t* p, uint32_t now) {
+    uint32_t magic = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    if (magic != FAILOVER_MAGIC || p[4] != FAILOVER_VERSION || p[5] != config.vrid) {
+        stats.advertsRejected++;
+        return;
+    }
+
+    uint32_t fromIP;
+    memcpy(&fromIP, p + 16, 4);              // IPAddress stores octets in order
+    if (fromIP == unitIP) {
+        return;
+    }
+
+    stats.advertsReceived++;
+    peer.unitIP = fromIP;
+    peer.priority = p[6];
+    peer.stratum = p[8];
+    peer.flags = p[9];
+    peer.rootDispersionMicros = ((uint32_t)p[12] << 24) | ((uint32_t)p[13] << 16) |
+                                ((uint32_t)p[14] << 8) | p[15];
+    peer.lastAdvertMillis = now;
+
+    if (state == FailoverState::BACKUP) {
+        masterDownMillis = now + masterDownInterval();
+    } else if (state == FailoverState::MASTER && outranks(peer.priority, fromIP)) {
+        log("Failover: " + IPAddress(fromIP).toString() + " outranks us (" +
+            String(peer.priority) + " vs " + String(priority) + ")");
+        becomeBackup(now);
+    }
+}
+
+bool Failover::outranks(uint8_t prio, uint32_t ip) const {
+    if (prio != priority) {
+        return prio > priority;
+    }
+    // Tie: higher unit address wins (compare in network order)
+    IPAddress a(ip), b(unitIP);
+    for (uint8_t i = 0; i < 4; i++) {
+        if (a[i] != b[i]) {
+            return a[i] > b[i];
+        }
+    }
+    return false;
+}
+
+void Failover::sendAdvert() {
+    float rootDelay, rootDispersion;
+    ntpRef->getRootDelayDispersion(rootDelay, rootDispersion);
+    uint32_t dispersionMicros = (uint32_t)(rootDispersion * 1000000.0f);
+
+    uint8_t p[FAILOVER_ADVERT_LEN];
+    p[0] = (FAILOVER_MAGIC >> 24) & 0xFF;
+    p[1] = (FAILOVER_MAGIC >> 16) & 0xFF;
+    p[2] = (FAILOVER_MAGIC >> 8) & 0xFF;
+    p[3] = FAILOVER_MAGIC & 0xFF;
+    p[4] = FAILOVER_VERSION;
+    p[5] = config.vrid;
+    p[6] = priority;
+    p[7] = (uint8_t)state;
+    p[8] = ntpRef->isServing() ? ntpRef->getConfig().stratum + (ntpRef->isFollowingPeer() ? 1 : 0) : 16;
+    p[9] = (ntpRef->isServing() ? FAILOVER_FLAG_SERVING : 0) |
+           (ntpRef->isServing() && !ntpRef->isFollowingPeer() ? FAILOVER_FLAG_GPS : 0);
+    p[10] = 0;
+    p[11] = 0;
+    p[12] = dispersionMicros >> 24;
+    p[13] = dispersionMicros >> 16;
+    p[14] = dispersionMicros >> 8;
+    p[15] = dispersionMicros & 0xFF;
+    memcpy(p + 16, &unitIP, 4);
+
+    udp.beginPacket(IPAddress(255, 255, 255, 255), FAILOVER_PORT);
+    udp.write(p, sizeof(p));
+    udp.endPacket();
+
+    lastAdvertSent = millis();
+    stats.advertsSent++;
+}
+
+void Failover::becomeMaster(uint32_t now) {
+    uint8_t virtualMAC[6] = {0x00, 0x00, 0x5E, 0x00, 0x01, config.vrid};
+    Ethernet.setMACAddress(virtualMAC);
+    Ethernet.setLocalIP(config.virtualIP);
+
+    state = FailoverState::MASTER;
+    preemptSince = 0;
+    stats.takeovers++;
+    stats.lastTransitionMillis = now;
+
+    // First frame from the virtual MAC: switches relearn its port now
+    sendAdvert();
+    log("Failover: master for " + config.virtualIP.toString() +
+        " (priority " + String(priority) + ", gap " + String(stats.lastGapMillis) + " ms)");
+}
+
+void Failover::becomeBackup(uint32_t now) {
+    Ethernet.setMACAddress(unitMAC);
+    Ethernet.setLocalIP(IPAddress(unitIP));
+
+    state = FailoverState::BACKUP;
+    preemptSince = 0;
+    masterDownMillis = now + masterDownInterval();
+    stats.releases++;
+    stats.lastTransitionMillis = now;
+    log("Failover: backup, released " + config.virtualIP.toString());
+}
+
+const char* Failover::stateString(FailoverState state) {
+    switch (state) {
+        case FailoverState::DISABLED: return "disabled";
+        case FailoverState::BACKUP:   return "backup";
+        case FailoverState::MASTER:   return "master";
+        default:                      return "unknown";
+    }
+}
+
+void Failover::setLogCallback(void (*callback)(String)) {
+    logCallback = callback;
+}
+
+void Failover::log(const String& message) {
+    if (logCallback != nullptr) {
+        logCallback(message);
+    }
+}
+
+#endif // FAILOVER_H
@@ -0,0 +1,340 @@
+/*
+ * ============================================================================
+ * GNSSOptimizer.h - Adaptive Constellation and Sentence-Rate Control
+ * ============================================================================
+ *
+ * At boot the receiver is set to all five systems with GSV every epoch.
+ * That is far more satellite-view text than timing needs: GSV/GSA
+ * dominate the UART and the deferred parser, while RMC/GGA carry the
+ * time. This optimizer trims the output as long as timing quality stays
+ * on target.
+ *
+ * Levels (one step per window, only after a window on target):
+ *   FULL         all systems, GSV every epoch (boot configuration)
+ *   GSV_REDUCED  all systems, GSV every GNSS_OPT_GSV_DIVISOR epochs
+ *   TRIMMED      GSV reduced, plus systems that contributed nothing to
+ *                the fix at this site turned off (PMTK353). GPS is kept
+ *
+ * Timing quality target: 3D fix with at least GNSS_OPT_MIN_SATELLITES in
+ * use and HDOP at most GNSS_OPT_MAX_HDOP_X100. Being off target for
+ * GNSS_OPT_BREACH_MS steps back one level and blocks stepping up for
+ * GNSS_OPT_HOLDOFF_MS. TRIMMED returns to GSV_REDUCED every
+ * GNSS_OPT_RESURVEY_MS so the dropped systems are measured again.
+ *
+ * A system's contribution is the mean number of its satellites in use
+ * (from GSA) over a window with every system enabled.
+ *
+ * Reported: bytes and GSV/GSA lines per epoch at FULL (the baseline) and
+ * at the current level, plus UART utilization for both.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef GNSS_OPTIMIZER_H
+#define GNSS_OPTIMIZER_H
+
+#include <Arduino.h>
+#include "GPS.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define GNSS_OPT_WINDOW_MS 120000            // Observation window per decision
+#define GNSS_OPT_MIN_EPOCHS 60               // Epochs needed in a window
+#define GNSS_OPT_OFF_TARGET_PER_20 1         // Window on target if <= 1 epoch in 20 misses
+#define GNSS_OPT_SETTLE_EPOCHS 2             // Epochs ignored after a reconfiguration
+#define GNSS_OPT_GSV_DIVISOR 5               // GSV every Nth epoch when reduced
+#define GNSS_OPT_GSV_MAX_PERIOD_S 10         // GSV at least this often (satellites age out at 30 s)
+#define GNSS_OPT_MIN_SATELLITES 8            // Target: satellites in use
+#define GNSS_OPT_MAX_HDOP_X100 200           // Target: HDOP (x100)
+#define GNSS_OPT_USE_THRESHOLD_X100 50       // Mean satellites in use (x100) to count as contributing
+#define GNSS_OPT_BREACH_MS 30000             // Off target this long -> step back
+#define GNSS_OPT_HOLDOFF_MS 3600000          // No step up for an hour after a step back
+#define GNSS_OPT_RESURVEY_MS 21600000        // Re-measure dropped systems every 6 hours
+#define GNSS_OPT_EWMA_WEIGHT 0.1f            // Per-epoch byte/line smoothing
+#define GNSS_OPT_SYSTEMS 5                   // GPS, GLONASS, Galileo, BeiDou, QZSS
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Output Level
+ */
+enum class GNSSOptLevel : uint8_t {
+    FULL = 0,                                // All systems, GSV every epoch
+    GSV_REDUCED,                             // All systems, GSV every Nth epoch
+    TRIMMED                                  // GSV reduced, idle systems off
+};
+
+/**
+ * Optimizer State
+ */
+struct GNSSOptimizerState {
+    bool enabled;
+    GNSSOptLevel level;
+    uint8_t constellationMask;               // Systems on (bit 0 = GPS)
+    uint8_t gsvDivisor;                      // GSV every N epochs
+    uint32_t levelSinceMillis;               // Current level entered
+    bool holdoff;                            // Stepping up blocked
+    uint32_t holdoffSinceMillis;
+    bool onTarget;                           // Last epoch met the timing target
+    uint32_t offTargetSinceMillis;           // First epoch of the current miss (0 = on target)
+    uint32_t epochs;                         // Epochs seen at this level
+    uint32_t stepsUp;
+    uint32_t stepsBack;                      // Off target, stepped back
+    uint32_t resurveys;                      // TRIMMED -> GSV_REDUCED to re-measure
+    float fullBytesPerEpoch;                 // Baseline (FULL level)
+    float fullDeferredPerEpoch;
+    float bytesPerEpoch;                     // Current level
+    float deferredPerEpoch;
+    uint16_t useX100[GNSS_OPT_SYSTEMS];      // Mean satellites in use per system (x100)
+};
+
+// ============================================================================
+// GNSS OPTIMIZER CLASS
+// ============================================================================
+
+class GNSSOptimizer {
+public:
+    /**
+     * Attach to the GPS (receiver starts at FULL)
+     */
+    void begin(GPS& gps) {
+        gpsRef = &gps;
+        memset(&state, 0, sizeof(state));
+        state.enabled = true;
+        state.level = GNSSOptLevel::FULL;
+        state.constellationMask = GPS_CONSTELLATIONS_ALL;
+        state.gsvDivisor = 1;
+        state.levelSinceMillis = millis();
+        lastAnchors = gps.getSentenceStats().anchors;
+        settleEpochs = GNSS_OPT_SETTLE_EPOCHS;
+        resetWindow(state.levelSinceMillis);
+    }
+
+    /**
+     * Enable or disable; disabling restores the FULL configuration
+     */
+    void setEnabled(bool enabled) {
+        if (!gpsRef || enabled == state.enabled) return;
+        state.enabled = enabled;
+        if (!enabled) {
+            applyLevel(GNSSOptLevel::FULL, GPS_CONSTELLATIONS_ALL, millis());
+        }
+        log(String("GNSS optimizer ") + (enabled ? "enabled" : "disabled"));
+    }
+
+    /**
+     * Run once per loop; acts once per GPS epoch
+     */
+    void process(uint32_t nowMillis) {
+        if (!gpsRef || !state.enabled) return;
+
+        const GPSSentenceStats& stats = gpsRef->getSentenceStats();
+        if (stats.anchors == lastAnchors) return;
+        lastAnchors = stats.anchors;
+
+        state.epochs++;
+        if (settleEpochs > 0) {
+            settleEpochs--;                  // Output still switching over
+            return;
+        }
+
+        updateLoad(stats);
+        updateTarget(nowMillis);
+        sampleUse();
+
+        // Off target too long: undo the last step
+        if (state.offTargetSinceMillis != 0 && state.level != GNSSOptLevel::FULL &&
+            nowMillis - state.offTargetSinceMillis >= GNSS_OPT_BREACH_MS) {
+            stepBack(nowMillis);
+            return;
+        }
+
+        // Periodically bring the dropped systems back to measure them again
+        if (state.level == GNSSOptLevel::TRIMMED &&
+            nowMillis - state.levelSinceMillis >= GNSS_OPT_RESURVEY_MS) {
+            state.resurveys++;
+            log("GNSS optimizer: re-surveying dropped systems");
+            applyLevel(GNSSOptLevel::GSV_REDUCED, GPS_CONSTELLATIONS_ALL, nowMillis);
+            return;
+        }
+
+        if (nowMillis - windowStartMillis >= GNSS_OPT_WINDOW_MS &&
+            windowEpochs >= GNSS_OPT_MIN_EPOCHS) {
+            evaluateWindow(nowMillis);
+        }
+    }
+
+    /**
+     * UART utilization for a bytes-per-epoch figure
+     * @return Percent of the link (10 bits per byte)
+     */
+    float uartPercent(float bytesPerEpoch) const {
+        uint32_t baud = gpsRef ? gpsRef->getBaudRate() : 0;
+        if (baud == 0) return 0.0f;
+        return 100.0f * bytesPerEpoch * 10.0f * max(gpsRef->getConfig().updateRate, (uint8_t)1) / baud;
+    }
+
+    static const char* levelName(GNSSOptLevel level) {
+        switch (level) {
+            case GNSSOptLevel::FULL: return "full";
+            case GNSSOptLevel::GSV_REDUCED: return "gsv_reduced";
+            case GNSSOptLevel::TRIMMED: return "trimmed";
+        }
+        return "unknown";
+    }
+
+    const GNSSOptimizerState& getState() const { return state; }
+
+    void setLogCallback(void (*callback)(String)) { logCallback = callback; }
+
+private:
+    GPS* gpsRef = nullptr;
+    GNSSOptimizerState state = {};
+    uint32_t lastAnchors = 0;
+    uint8_t settleEpochs = 0;
+
+    // Current window
+    uint32_t windowStartMillis = 0;
+    uint32_t windowEpochs = 0;
+    uint32_t windowOffTarget = 0;
+    uint32_t useSum[GNSS_OPT_SYSTEMS] = {};
+
+    void (*logCallback)(String) = nullptr;
+
+    void updateLoad(const GPSSentenceStats& stats) {
+        if (state.bytesPerEpoch == 0) {
+            state.bytesPerEpoch = stats.lastEpochBytes;
+            state.deferredPerEpoch = stats.lastEpochDeferred;
+        } else {
+            state.bytesPerEpoch += GNSS_OPT_EWMA_WEIGHT * (stats.lastEpochBytes - state.bytesPerEpoch);
+            state.deferredPerEpoch += GNSS_OPT_EWMA_WEIGHT * (stats.lastEpochDeferred - state.deferredPerEpoch);
+        }
+        if (state.level == GNSSOptLevel::FULL) {
+            state.fullBytesPerEpoch = state.bytesPerEpoch;
+            state.fullDeferredPerEpoch = state.deferredPerEpoch;
+        }
+    }
+
+    void updateTarget(uint32_t nowMillis) {
+        const GPSData& data = gpsRef->getData();
+        state.onTarget = data.timeValid && data.fixMode == 3 &&
+                         data.satellites >= GNSS_OPT_MIN_SATELLITES &&
+                         data.hdopX100 > 0 && data.hdopX100 <= GNSS_OPT_MAX_HDOP_X100;
+        if (state.onTarget) {
+            state.offTargetSinceMillis = 0;
+        } else {
+            windowOffTarget++;
+            if (state.offTargetSinceMillis == 0) {
+                state.offTargetSinceMillis = nowMillis | 1;   // Never 0 while off target
+            }
+        }
+    }
+
+    void sampleUse() {
+        const SatelliteTracking& sats = gpsRef->getSatellites();
+        useSum[0] += sats.gpsCount;
+        useSum[1] += sats.glonassCount;
+        useSum[2] += sats.galileoCount;
+        useSum[3] += sats.beidouCount;
+        useSum[4] += sats.qzssCount;
+        windowEpochs++;
+    }
+
+    void evaluateWindow(uint32_t nowMillis) {
+        // Contributions are only meaningful with every system enabled
+        if (state.constellationMask == GPS_CONSTELLATIONS_ALL) {
+            for (uint8_t i = 0; i < GNSS_OPT_SYSTEMS; i++) {
+                state.useX100[i] = useSum[i] * 100 / windowEpochs;
+            }
+        }
+
+        bool windowOnTarget = windowOffTarget * 20 <= windowEpochs * GNSS_OPT_OFF_TARGET_PER_20;
+        if (state.holdoff && nowMillis - state.holdoffSinceMillis >= GNSS_OPT_HOLDOFF_MS) {
+            state.holdoff = false;
+        }
+
+        if (windowOnTarget && !state.holdoff) {
+            if (state.level == GNSSOptLevel::FULL) {
+                state.stepsUp++;
+                applyLevel(GNSSOptLevel::GSV_REDUCED, GPS_CONSTELLATIONS_ALL, nowMillis);
+                return;
+            }
+            if (state.level == GNSSOptLevel::GSV_REDUCED) {
+                uint8_t mask = contributingMask();
+                if (mask != GPS_CONSTELLATIONS_ALL) {
+                    state.stepsUp++;
+                    applyLevel(GNSSOptLevel::TRIMMED, mask, nowMillis);
+                    return;
+                }
+            }
+        }
+        resetWindow(nowMillis);
+    }
+
+    // GPS always; other systems if they averaged enough satellites in use
+    uint8_t contributingMask() const {
+        uint8_t mask = 0x01;
+        for (uint8_t i = 1; i < GNSS_OPT_SYSTEMS; i++) {
+            if (state.useX100[i] >= GNSS_OPT_USE_THRESHOLD_X100) {
+                mask |= 1 << i;
+            }
+        }
+        return mask;
+    }
+
+    void stepBack(uint32_t nowMillis) {
+        state.stepsBack++;
+        state.holdoff = true;
+        state.holdoffSinceMillis = nowMillis;
+        log("GNSS optimizer: timing quality below target, stepping back");
+
+        if (state.level == GNSSOptLevel::TRIMMED) {
+            applyLevel(GNSSOptLevel::GSV_REDUCED, GPS_CONSTELLATIONS_ALL, nowMillis);
+        } else {
+            applyLevel(GNSSOptLevel::FULL, GPS_CONSTELLATIONS_ALL, nowMillis);
+        }
+    }
+
+    void applyLevel(GNSSOptLevel level, uint8_t mask, uint32_t nowMillis) {
+        uint8_t divisor = 1;
+        if (level != GNSSOptLevel::FULL) {
+            // Keep GSV frequent enough that tracked satellites don't age out
+            uint16_t maxDivisor = max(gpsRef->getConfig().updateRate, (uint8_t)1) * GNSS_OPT_GSV_MAX_PERIOD_S;
+            divisor = min((uint16_t)GNSS_OPT_GSV_DIVISOR, maxDivisor);
+        }
+        gpsRef->configureOutput(mask, divisor);
+
+        state.level = level;
+        state.constellationMask = gpsRef->getConfig().constellationMask;
+        state.gsvDivisor = gpsRef->getConfig().gsvDivisor;
+        state.levelSinceMillis = nowMillis;
+        state.epochs = 0;
+        state.offTargetSinceMillis = 0;
+        state.bytesPerEpoch = 0;
+        state.deferredPerEpoch = 0;
+        settleEpochs = GNSS_OPT_SETTLE_EPOCHS;
+        resetWindow(nowMillis);
+
+        log("GNSS optimizer: " + String(levelName(level)) + " (systems 0x" +
+            String(state.constellationMask, HEX) + ", GSV every " + String(state.gsvDivisor) + ")");
+    }
+
+    void resetWindow(uint32_t nowMillis) {
+        windowStartMillis = nowMillis;
+        windowEpochs = 0;
+        windowOffTarget = 0;
+        memset(useSum, 0, sizeof(useSum));
+    }
+
+    void log(const String& message) {
+        if (logCallback) logCallback(message);
+    }
+};
+
+#endif // GNSS_OPTIMIZER_H
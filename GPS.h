@@ -13,9 +13,16 @@
  * - Historical data buffering (10 minutes)
  * - Event logging with 50-event circular buffer
  * - PDOP/HDOP/VDOP tracking
+ * - Fixed-point position and quality (1e-7 deg, mm, DOP x100); decimal
+ *   only at the API boundary
  * - 2D/3D fix mode detection
  * - Staleness detection and watchdog
- * - PMTK configuration for MTK-based modules
+ * - Two-class sentence scheduling: timing/fix sentences handled on
+ *   arrival, GSV/GSA queued and parsed under a per-call time budget
+ * - GSV/GSA split and checksummed by the word-at-a-time NMEAScan kernels
+ * - PMTK configuration for MTK-based modules; constellations and GSV
+ *   rate can be changed at runtime (see GNSSOptimizer.h)
+ * - Bytes and deferred sentences per epoch (UART and parse load)
  * 
  * Compatible Modules: AT6558, AT6668 (MTK-based with PMTK commands)
  * 
@@ -33,6 +40,8 @@
 #include <Arduino.h>
 #include <TinyGPS++.h>
 #include <HardwareSerial.h>
+#include "Timebase.h"
+#include "NMEAScan.h"
 
 // ============================================================================
 // CONFIGURATION CONSTANTS
@@ -43,10 +52,20 @@
 #define HISTORY_BUFFER_SIZE 60         // 10 minutes at 10-second intervals
 #define MAX_EVENTS 50                  // Event log capacity
 #define GPS_BUFFER_MAX 120             // Max NMEA sentence length (safety)
+#define GPS_DEFERRED_LINES 16          // Queued GSV/GSA sentences (one multi-GNSS epoch)
+#define GPS_DEFERRED_BUDGET_US 300     // Deferred parsing time per process() call
+
+// Receiver output
+#define GPS_CONSTELLATIONS_ALL 0x1F    // PMTK353 systems, bit 0 = GPS .. bit 4 = QZSS
+
+// Fixed-point scales
+#define GPS_COORD_SCALE 10000000L      // Coordinates in 1e-7 degrees
+#define GPS_DOP_SCALE 100              // DOP values x100
 
 // Timeouts and Thresholds
 #define GPS_DATA_TIMEOUT 10000         // GPS data staleness (ms)
 #define GPS_HEARTBEAT_TIMEOUT 10000    // GPS module watchdog (ms)
+#define GPS_BURST_GAP_MS 100           // Serial gap that separates NMEA epochs (ms)
 #define EVENT_COOLDOWN 60000           // Event spam prevention (ms)
 #define HISTORY_INTERVAL 10000         // Historical data recording interval (ms)
 
@@ -91,6 +110,8 @@ struct GPSConfig {
     bool configurationComplete;        // Auto-detection complete
     uint32_t lastConfigCheck;          // Last configuration check time
     uint8_t updateRate;                // Configured update rate (Hz)
+    uint8_t constellationMask;         // Systems enabled on the receiver (bit 0 = GPS)
+    uint8_t gsvDivisor;                // GSV output every N epochs
 };
 
 /**
@@ -108,6 +129,7 @@ struct GPSData {
     uint8_t month;                     // Month (1-12)
     uint16_t year;                     // Year (4 digits)
     uint32_t unixTime;                 // Unix timestamp (seconds)
+    uint64_t timeAnchorMicros;         // Timebase at '$' of the sentence carrying this time
     
     //
     uint32_t lockAcquiredTime;         // Millis when lock was acquired
@@ -116,17 +138,17 @@ struct GPSData {
 
     // Position Information
     bool valid;                        // GPS position fix is valid
-    double latitude;                   // Latitude in degrees
-    double longitude;                  // Longitude in degrees
-    double altitude;                   // Altitude in meters
-    double speed;                      // Speed in km/h
-    double course;                     // Course in degrees
+    int32_t latitudeE7;                // Latitude (1e-7 degrees)
+    int32_t longitudeE7;               // Longitude (1e-7 degrees)
+    int32_t altitudeMM;                // Altitude (millimeters)
+    uint32_t speedKmhX100;             // Speed (km/h x100)
+    uint16_t courseX100;               // Course (degrees x100)
     
     // Signal Quality
     int satellites;                    // Satellites in use
-    double hdop;                       // Horizontal dilution of precision
-    double pdop;                       // Position dilution of precision
-    double vdop;                       // Vertical dilution of precision
+    uint16_t hdopX100;                 // Horizontal dilution of precision x100
+    uint16_t pdopX100;                 // Position dilution of precision x100
+    uint16_t vdopX100;                 // Vertical dilution of precision x100
     uint8_t fixQuality;                // GPS fix quality (0-3)
     uint8_t fixMode;                   // Fix mode: 1=No fix, 2=2D, 3=3D
     
@@ -179,8 +201,8 @@ struct SatelliteTracking {
 struct HistoricalDataPoint {
     uint32_t timestamp;                // Millisecond timestamp
     uint8_t satelliteCount;
-    float hdop;
-    float pdop;
+    uint16_t hdopX100;
+    uint16_t pdopX100;
     uint8_t fixQuality;
     uint8_t fixMode;
     float avgSNR;
@@ -242,18 +264,40 @@ struct SystemHealth {
  */
 struct AlertThresholds {
     uint8_t minSatellites = 4;         // Minimum satellites for warning
-    float maxHDOP = 5.0;               // Maximum HDOP for warning
-    float maxPDOP = 8.0;               // Maximum PDOP for warning
+    uint16_t maxHDOPX100 = 500;        // Maximum HDOP for warning (x100)
+    uint16_t maxPDOPX100 = 800;        // Maximum PDOP for warning (x100)
     uint32_t maxFixAge = 60000;        // Max age of fix (ms) before alert
     uint32_t minUptime = 300000;       // Ignore alerts for first 5 min
     float minAvgSNR = 25.0;            // Minimum average SNR
 };
 
+/**
+ * Sentence Scheduling Statistics
+ * Anchor backlog = bytes already waiting in the UART when the '$' of a
+ * time-carrying sentence was read; each byte is time the anchor is late
+ */
+struct GPSSentenceStats {
+    uint32_t immediate;                // Timing/fix sentences (handled on arrival)
+    uint32_t deferred;                 // GSV/GSA queued
+    uint32_t deferredParsed;           // ...parsed from the queue
+    uint32_t deferredDropped;          // ...dropped, queue full
+    uint32_t checksumErrors;           // ...rejected, bad or missing checksum
+    uint16_t peakQueued;               // Highest queue depth
+    uint32_t anchors;                  // Time anchors taken
+    uint16_t lastAnchorBacklog;        // Bytes waiting at the last anchor
+    uint16_t peakAnchorBacklog;        // Worst anchor backlog (bytes)
+    uint32_t lastAnchorLagMicros;      // Last backlog as UART time
+    uint32_t peakAnchorLagMicros;      // Worst backlog as UART time
+    uint16_t lastEpochBytes;           // UART bytes between the last two anchors
+    uint8_t lastEpochDeferred;         // GSV/GSA lines in that epoch
+};
+
 /**
  * Watchdog State
  */
 struct WatchdogState {
     uint32_t lastCharReceived;         // Last character from GPS
+    uint32_t burstStart;               // First character of current NMEA burst
     uint32_t lastEventTime[12];        // Last time each event type fired
     bool unresponsive;                 // GPS module unresponsive flag
 };
@@ -289,6 +333,15 @@ public:
      */
     void setLogCallback(void (*callback)(String));
     
+    /**
+     * Change receiver output at runtime (PMTK353 / PMTK314)
+     * Only settings that differ from the current ones are sent, and
+     * satellite tracking restarts when the constellation set changes
+     * @param constellationMask Systems to enable, bit 0 = GPS (always kept)
+     * @param gsvDivisor Output GSV every N epochs (1 = every epoch)
+     */
+    void configureOutput(uint8_t constellationMask, uint8_t gsvDivisor);
+    
     // ========================================================================
     // DATA ACCESSORS
     // ========================================================================
@@ -322,6 +375,15 @@ public:
     // Get configuration
     const GPSConfig& getConfig() const { return config; }
     
+    // Get NMEA burst timing (for scheduling idle periods between epochs)
+    uint32_t getLastCharMillis() const { return watchdog.lastCharReceived; }
+    uint32_t getBurstStartMillis() const { return watchdog.burstStart; }
+    
+    // Get sentence scheduling statistics
+    const GPSSentenceStats& getSentenceStats() const { return sentenceStats; }
+    uint8_t getDeferredQueued() const { return deferredCount; }
+    uint32_t getBaudRate() const { return serial ? serial->baudRate() : 0; }
+    
     // ========================================================================
     // QUERY HELPERS
     // ========================================================================
@@ -364,6 +426,14 @@ public:
      */
     static const char* getConstellationName(uint8_t id);
     
+    /**
+     * Format a fixed-point value as decimal text
+     * @param value Scaled value (e.g. latitudeE7)
+     * @param decimals Digits after the point (the scale's exponent, 0-7)
+     * @return e.g. formatFixed(-123456789, 7) -> "-12.3456789"
+     */
+    static String formatFixed(int32_t value, uint8_t decimals);
+    
     /**
      * Get constellation color for visualization
      * @param id Constellation ID
@@ -393,8 +463,20 @@ private:
     AlertThresholds thresholds;
     WatchdogState watchdog;
     
-    String gpsBuffer;                  // NMEA sentence buffer
-    bool gpsLineReady;                 // Complete sentence flag
+    alignas(4) char lineBuffer[NMEA_SCAN_SIZE(GPS_BUFFER_MAX + 1)]; // NMEA sentence being assembled
+    uint8_t lineLength;                // Characters in lineBuffer
+    uint64_t sentenceStartMicros;      // Timebase at last '$'
+    uint16_t sentenceBacklog;          // UART bytes waiting at last '$'
+    
+    // Deferred GSV/GSA sentences (raw lines, parsed under a time budget)
+    alignas(4) char deferredLines[GPS_DEFERRED_LINES][NMEA_SCAN_SIZE(GPS_BUFFER_MAX + 1)];
+    uint8_t deferredLengths[GPS_DEFERRED_LINES];
+    uint8_t deferredHead;              // Oldest queued line
+    uint8_t deferredCount;             // Lines queued
+    GPSSentenceStats sentenceStats;
+    uint32_t lastTimeValue;            // Last TinyGPS++ time seen (hhmmsscc)
+    uint16_t epochBytes;               // UART bytes since the last anchor
+    uint32_t epochDeferredStart;       // sentenceStats.deferred at the last anchor
     
     void (*logCallback)(String) = nullptr;  // Optional logging
     
@@ -404,20 +486,25 @@ private:
     
     // Initialization
     void sendPMTKCommand(const char* command);
+    void sendPMTK(const char* body);
+    void sendConstellations(uint8_t mask);
+    void sendSentenceRates(uint8_t gsvDivisor);
     void configureGPSModule();
     uint32_t autoDetectBaudRate(uint8_t rxPin, uint8_t txPin);
     
     // NMEA Parsing
-    void parseNMEASentence(const String& sentence);
-    void parseGSVSentence(const char* sentence, uint8_t constellation);
-    void parseGPGSVSentence(const char* sentence);
-    void parseGLGSVSentence(const char* sentence);
-    void parseGAGSVSentence(const char* sentence);
-    void parseGBGSVSentence(const char* sentence);
-    void parseGNGSVSentence(const char* sentence);
-    void markSatellitesInUse(const char* sentence, uint8_t constellation);
-    void parseGPGSASentence(const char* sentence);
-    void parseGNGSASentence(const char* sentence);
+    void completeLine();
+    void processDeferredSentences();
+    void parseNMEASentence(const char* sentence, uint8_t length);
+    void parseGSVSentence(const NMEAFields& fields, uint8_t constellation);
+    void parseGPGSVSentence(const NMEAFields& fields);
+    void parseGLGSVSentence(const NMEAFields& fields);
+    void parseGAGSVSentence(const NMEAFields& fields);
+    void parseGBGSVSentence(const NMEAFields& fields);
+    void parseGNGSVSentence(const NMEAFields& fields);
+    void markSatellitesInUse(const NMEAFields& fields, uint8_t constellation);
+    void parseGPGSASentence(const NMEAFields& fields);
+    void parseGNGSASentence(const NMEAFields& fields);
     
     // Data Updates
     void updateGPSData();
@@ -444,6 +531,7 @@ private:
     void clearSatelliteTracking();
     void cleanupStaleSatellites();
     uint8_t detectConstellationFromPRN(int prn);
+    static int32_t rawDegreesToE7(const RawDegrees& raw);
     void log(const String& message);
 };
 
@@ -465,6 +553,8 @@ void GPS::begin(uint8_t rxPin, uint8_t txPin, uint32_t baud, uint8_t updateRate)
     config.configurationComplete = false;
     config.lastConfigCheck = millis();
     config.updateRate = updateRate;
+    config.constellationMask = GPS_CONSTELLATIONS_ALL;
+    config.gsvDivisor = 1;
     
     clearSatelliteTracking();
     
@@ -483,13 +573,21 @@ void GPS::begin(uint8_t rxPin, uint8_t txPin, uint32_t baud, uint8_t updateRate)
     health.lastCalculation = 0;
     
     watchdog.lastCharReceived = millis();
+    watchdog.burstStart = watchdog.lastCharReceived;
     watchdog.unresponsive = false;
     for (int i = 0; i < 12; i++) {
         watchdog.lastEventTime[i] = 0;
     }
     
-    gpsBuffer = "";
-    gpsLineReady = false;
+    lineLength = 0;
+    sentenceStartMicros = 0;
+    sentenceBacklog = 0;
+    lastTimeValue = 0;
+    epochBytes = 0;
+    epochDeferredStart = 0;
+    deferredHead = 0;
+    deferredCount = 0;
+    memset(&sentenceStats, 0, sizeof(sentenceStats));
     
     memset(&gpsData, 0, sizeof(GPSData));
     
@@ -587,14 +685,14 @@ void GPS::configureGPSModule() {
     // Format: $PMTK353,searchMode,gpsEnable,glonassEnable,galileoEnable,beidouEnable,qzssEnable
     // searchMode: 0=per system, 1=multiple systems
     // We want searchMode=0 to get individual GPGSV, GLGSV, GAGSV, GBGSV instead of GNGSV
-    sendPMTKCommand("$PMTK353,0,1,1,1,1,1*2B");  // Enable all, request individual sentences
+    sendConstellations(config.constellationMask);  // Enable all, request individual sentences
     delay(200);
     
     // Request specific NMEA sentences with individual constellation data
     // GGA=Fix, GSA=DOP/Active sats (per constellation), GSV=Satellites in view (per constellation)
     // PMTK314 format: GLL,RMC,VTG,GGA,GSA,GSV,...
     // We want: GLL=0, RMC=1, VTG=0, GGA=1, GSA=1, GSV=1 (GSV MUST be enabled!)
-    sendPMTKCommand("$PMTK314,0,1,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0*29");
+    sendSentenceRates(config.gsvDivisor);
     delay(100);
     
     // Set update rate
@@ -615,42 +713,115 @@ void GPS::sendPMTKCommand(const char* command) {
     serial->println(command);
 }
 
+void GPS::sendPMTK(const char* body) {
+    // Receivers drop PMTK sentences with a bad checksum, so compute it
+    uint8_t checksum = 0;
+    for (const char* p = body; *p; p++) {
+        checksum ^= (uint8_t)*p;
+    }
+    char command[96];
+    snprintf(command, sizeof(command), "$%s*%02X", body, checksum);
+    sendPMTKCommand(command);
+}
+
+void GPS::sendConstellations(uint8_t mask) {
+    // $PMTK353,searchMode,gps,glonass,galileo,beidou,qzss (searchMode 0 = per system)
+    char body[32];
+    snprintf(body, sizeof(body), "PMTK353,0,%u,%u,%u,%u,%u",
+             mask & 0x01 ? 1 : 0, mask & 0x02 ? 1 : 0, mask & 0x04 ? 1 : 0,
+             mask & 0x08 ? 1 : 0, mask & 0x10 ? 1 : 0);
+    sendPMTK(body);
+}
+
+void GPS::sendSentenceRates(uint8_t gsvDivisor) {
+    // PMTK314: GLL,RMC,VTG,GGA,GSA,GSV,... - each value is "every N fixes"
+    char body[64];
+    snprintf(body, sizeof(body), "PMTK314,0,1,0,1,1,%u,0,0,0,0,0,0,0,0,0,0,0,0,0", gsvDivisor);
+    sendPMTK(body);
+}
+
+void GPS::configureOutput(uint8_t constellationMask, uint8_t gsvDivisor) {
+    constellationMask = (constellationMask | 0x01) & GPS_CONSTELLATIONS_ALL;
+    if (gsvDivisor == 0) gsvDivisor = 1;
+    
+    if (constellationMask != config.constellationMask) {
+        config.constellationMask = constellationMask;
+        sendConstellations(constellationMask);
+        clearSatelliteTracking();    // Dropped systems would linger as tracked
+        log("GPS: Constellation mask 0x" + String(constellationMask, HEX));
+    }
+    if (gsvDivisor != config.gsvDivisor) {
+        config.gsvDivisor = gsvDivisor;
+        sendSentenceRates(gsvDivisor);
+        log("GPS: GSV every " + String(gsvDivisor) + " epoch(s)");
+    }
+}
+
 void GPS::process() {
     // Read available GPS data
     while (serial->available() > 0) {
         char c = serial->read();
+        epochBytes++;
         
-        // Update watchdog
-        watchdog.lastCharReceived = millis();
+        // Update watchdog; a gap in the stream marks the start of a new epoch
+        uint32_t now = millis();
+        if (now - watchdog.lastCharReceived > GPS_BURST_GAP_MS) {
+            watchdog.burstStart = now;
+        }
+        watchdog.lastCharReceived = now;
         if (watchdog.unresponsive) {
             watchdog.unresponsive = false;
             addEvent(EVENT_SYSTEM_BOOT, "GPS module recovered");
         }
         
-        // Feed to TinyGPS++
-        tinyGPS.encode(c);
+        // Stamp sentence start; the first byte is the closest to the epoch.
+        // Bytes still waiting behind it are how late that stamp is
+        if (c == '$') {
+            sentenceStartMicros = Timebase::micros64();
+            sentenceBacklog = serial->available();
+        }
+        
+        // Feed to TinyGPS++; anchor time to the sentence that first carried it
+        if (tinyGPS.encode(c) && tinyGPS.time.isUpdated()) {
+            uint32_t timeValue = tinyGPS.time.value();
+            if (timeValue != lastTimeValue) {
+                lastTimeValue = timeValue;
+                gpsData.timeAnchorMicros = sentenceStartMicros;
+                
+                uint32_t lagMicros = (uint32_t)((uint64_t)sentenceBacklog * 10000000ULL / max(serial->baudRate(), (uint32_t)1));
+                sentenceStats.anchors++;
+                sentenceStats.lastEpochBytes = epochBytes;
+                sentenceStats.lastEpochDeferred = sentenceStats.deferred - epochDeferredStart;
+                epochBytes = 0;
+                epochDeferredStart = sentenceStats.deferred;
+                sentenceStats.lastAnchorBacklog = sentenceBacklog;
+                sentenceStats.lastAnchorLagMicros = lagMicros;
+                if (sentenceBacklog > sentenceStats.peakAnchorBacklog) {
+                    sentenceStats.peakAnchorBacklog = sentenceBacklog;
+                    sentenceStats.peakAnchorLagMicros = lagMicros;
+                }
+            }
+        }
         
         // Build complete NMEA sentence
         if (c == '$') {
-            gpsBuffer = "$";
+            lineBuffer[0] = '$';
+            lineLength = 1;
         } else if (c == '\n') {
-            gpsLineReady = true;
-        } else if (gpsBuffer.length() < GPS_BUFFER_MAX) {
-            gpsBuffer += c;
+            completeLine();
+            lineLength = 0;
+        } else if (lineLength < GPS_BUFFER_MAX) {
+            lineBuffer[lineLength++] = c;
         } else {
             // Buffer overflow protection
-            gpsBuffer = "";
+            lineLength = 0;
             log("GPS: Buffer overflow, sentence discarded");
         }
-        
-        // Process complete sentence
-        if (gpsLineReady) {
-            gpsLineReady = false;
-            parseNMEASentence(gpsBuffer);
-            gpsBuffer = "";
-        }
     }
     
+    // Satellite view sentences, as time allows
+    processDeferredSentences();
+    
     // Update GPS data from TinyGPS++
     updateGPSData();
     
@@ -670,13 +841,65 @@ void GPS::process() {
     calculateHealth();
 }
 
-void GPS::parseNMEASentence(const String& sentence) {
+void GPS::completeLine() {
+    if (lineLength < 7 || lineBuffer[0] != '$') {
+        return;
+    }
+    lineBuffer[lineLength] = '\0';
+    
+    // Timing and fix sentences were fully handled by TinyGPS++ on arrival
+    bool satelliteView = lineBuffer[3] == 'G' && lineBuffer[4] == 'S' &&
+                         (lineBuffer[5] == 'V' || lineBuffer[5] == 'A');
+    if (!satelliteView) {
+        sentenceStats.immediate++;
+        if (!config.configurationComplete) {
+            parseNMEASentence(lineBuffer, lineLength);   // Capability detection only
+        }
+        return;
+    }
+    
+    // GSV/GSA: queue the raw line for processDeferredSentences()
+    sentenceStats.deferred++;
+    if (deferredCount >= GPS_DEFERRED_LINES) {
+        sentenceStats.deferredDropped++;
+        return;
+    }
+    uint8_t slot = (deferredHead + deferredCount) % GPS_DEFERRED_LINES;
+    memcpy(deferredLines[slot], lineBuffer, lineLength + 1);
+    deferredLengths[slot] = lineLength;
+    deferredCount++;
+    if (deferredCount > sentenceStats.peakQueued) {
+        sentenceStats.peakQueued = deferredCount;
+    }
+}
+
+void GPS::processDeferredSentences() {
+    // At least one line per call so the queue always drains
+    uint64_t start = Timebase::micros64();
+    while (deferredCount > 0) {
+        parseNMEASentence(deferredLines[deferredHead], deferredLengths[deferredHead]);
+        deferredHead = (deferredHead + 1) % GPS_DEFERRED_LINES;
+        deferredCount--;
+        sentenceStats.deferredParsed++;
+        
+        if (Timebase::micros64() - start >= GPS_DEFERRED_BUDGET_US) {
+            break;
+        }
+    }
+}
+
+void GPS::parseNMEASentence(const char* sentence, uint8_t length) {
+    NMEAFields fields;
+    NMEAScan::scan(sentence, length, fields);
+    const char* address = NMEAScan::field(fields, 0);
+    bool fullAddress = NMEAScan::fieldLength(fields, 0) == 5;
+    
     // Detect GPS module capabilities
     if (!config.configurationComplete) {
-        if (sentence.indexOf("GPGSV") >= 0 || sentence.indexOf("GNGSV") >= 0) {
+        if (fullAddress && (memcmp(address, "GPGSV", 5) == 0 || memcmp(address, "GNGSV", 5) == 0)) {
             config.gpgsvEnabled = true;
         }
-        if (sentence.indexOf("GPGSA") >= 0 || sentence.indexOf("GNGSA") >= 0) {
+        if (fullAddress && (memcmp(address, "GPGSA", 5) == 0 || memcmp(address, "GNGSA", 5) == 0)) {
             config.gpgsaEnabled = true;
         }
         
@@ -687,77 +910,64 @@ void GPS::parseNMEASentence(const String& sentence) {
         }
     }
     
+    // Only GSV/GSA are parsed here; drop them if the checksum fails
+    if (!fullAddress || address[2] != 'G' || address[3] != 'S' ||
+        (address[4] != 'V' && address[4] != 'A')) {
+        return;
+    }
+    if (!fields.checksumValid) {
+        sentenceStats.checksumErrors++;
+        return;
+    }
+    
     // Route to appropriate parser
-    if (sentence.indexOf("GPGSV") >= 0) {
-        parseGPGSVSentence(sentence.c_str());
+    if (memcmp(address, "GPGSV", 5) == 0) {
+        parseGPGSVSentence(fields);
         gpsData.lastValidSentence = "GPGSV";
     }
-    else if (sentence.indexOf("GLGSV") >= 0) {
-        parseGLGSVSentence(sentence.c_str());
+    else if (memcmp(address, "GLGSV", 5) == 0) {
+        parseGLGSVSentence(fields);
         gpsData.lastValidSentence = "GLGSV";
     }
-    else if (sentence.indexOf("GAGSV") >= 0) {
-        parseGAGSVSentence(sentence.c_str());
+    else if (memcmp(address, "GAGSV", 5) == 0) {
+        parseGAGSVSentence(fields);
         gpsData.lastValidSentence = "GAGSV";
     }
-    else if (sentence.indexOf("GBGSV") >= 0) {
-        parseGBGSVSentence(sentence.c_str());
+    else if (memcmp(address, "GBGSV", 5) == 0) {
+        parseGBGSVSentence(fields);
         gpsData.lastValidSentence = "GBGSV";
     }
-    else if (sentence.indexOf("GNGSV") >= 0) {
-        parseGNGSVSentence(sentence.c_str());
+    else if (memcmp(address, "GNGSV", 5) == 0) {
+        parseGNGSVSentence(fields);
         gpsData.lastValidSentence = "GNGSV";
     }
-    else if (sentence.indexOf("GPGSA") >= 0) {
-        parseGPGSASentence(sentence.c_str());
+    else if (memcmp(address, "GPGSA", 5) == 0) {
+        parseGPGSASentence(fields);
         gpsData.lastValidSentence = "GPGSA";
     }
-    else if (sentence.indexOf("GNGSA") >= 0) {
-        parseGNGSASentence(sentence.c_str());
+    else if (memcmp(address, "GNGSA", 5) == 0) {
+        parseGNGSASentence(fields);
         gpsData.lastValidSentence = "GNGSA";
     }
 }
 
-void GPS::parseGSVSentence(const char* sentence, uint8_t constellationType) {
-    char buffer[128];
-    strncpy(buffer, sentence, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
-    
-    char* token = strtok(buffer, ",");
-    if (!token) return;
-    
-    token = strtok(NULL, ",");
-    if (!token) return;
-    int totalMessages = atoi(token);
-    
-    token = strtok(NULL, ",");
-    if (!token) return;
-    int messageNumber = atoi(token);
-    
-    token = strtok(NULL, ",");
-    if (!token) return;
+void GPS::parseGSVSentence(const NMEAFields& fields, uint8_t constellationType) {
+    // $xxGSV,totalMsgs,msgNum,totalSats,{prn,elev,az,snr}x4[,signalId]*cs
+    if (fields.count < 4) return;
     
     // Don't reset tracked flags here - GSA sentences may arrive at any time
     // Instead, we'll age out old satellites separately
     
-    // Parse up to 4 satellites
+    // Parse up to 4 satellites; empty fields read as 0 and keep their place
     for (int satIndex = 0; satIndex < 4; satIndex++) {
-        token = strtok(NULL, ",");
-        if (!token || strlen(token) == 0) break;
-        int prn = atoi(token);
+        uint8_t base = 4 + satIndex * 4;
+        if (base + 3 >= fields.count || NMEAScan::fieldLength(fields, base) == 0) break;
+        int prn = NMEAScan::fieldInt(fields, base);
         if (prn == 0) break;
         
-        token = strtok(NULL, ",");
-        if (!token) break;
-        int elevation = (strlen(token) > 0) ? atoi(token) : 0;
-        
-        token = strtok(NULL, ",");
-        if (!token) break;
-        int azimuth = (strlen(token) > 0) ? atoi(token) : 0;
-        
-        token = strtok(NULL, ",*");
-        if (!token) break;
-        int snr = (strlen(token) > 0) ? atoi(token) : 0;
+        int elevation = NMEAScan::fieldInt(fields, base + 1);
+        int azimuth = NMEAScan::fieldInt(fields, base + 2);
+        int snr = NMEAScan::fieldInt(fields, base + 3);
         
         // Find existing satellite by PRN only (ignore constellation)
         int slotIndex = -1;
@@ -797,74 +1007,49 @@ void GPS::parseGSVSentence(const char* sentence, uint8_t constellationType) {
     satTracking.lastUpdate = millis();
 }
 
-void GPS::parseGPGSVSentence(const char* sentence) {
-    parseGSVSentence(sentence, 1);  // GPS
+void GPS::parseGPGSVSentence(const NMEAFields& fields) {
+    parseGSVSentence(fields, 1);  // GPS
 }
 
-void GPS::parseGLGSVSentence(const char* sentence) {
-    parseGSVSentence(sentence, 2);  // GLONASS
+void GPS::parseGLGSVSentence(const NMEAFields& fields) {
+    parseGSVSentence(fields, 2);  // GLONASS
 }
 
-void GPS::parseGAGSVSentence(const char* sentence) {
-    parseGSVSentence(sentence, 3);  // Galileo
+void GPS::parseGAGSVSentence(const NMEAFields& fields) {
+    parseGSVSentence(fields, 3);  // Galileo
 }
 
-void GPS::parseGBGSVSentence(const char* sentence) {
-    parseGSVSentence(sentence, 4);  // BeiDou
+void GPS::parseGBGSVSentence(const NMEAFields& fields) {
+    parseGSVSentence(fields, 4);  // BeiDou
 }
 
-void GPS::parseGNGSVSentence(const char* sentence) {
-    // Parse and detect constellation from PRN
-    char buffer[128];
-    strncpy(buffer, sentence, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
-    
-    char* token = strtok(buffer, ",");
-    if (!token) return;
-    
-    // Skip to PRN fields
-    token = strtok(NULL, ",");  // Total messages
-    token = strtok(NULL, ",");  // Message number
-    token = strtok(NULL, ",");  // Total satellites
-    
-    // Get first PRN to detect constellation
-    token = strtok(NULL, ",");
-    if (token && strlen(token) > 0) {
-        int prn = atoi(token);
+void GPS::parseGNGSVSentence(const NMEAFields& fields) {
+    // Detect constellation from the first PRN (field 4)
+    if (NMEAScan::fieldLength(fields, 4) > 0) {
+        int prn = NMEAScan::fieldInt(fields, 4);
         uint8_t constellation = detectConstellationFromPRN(prn);
-        parseGSVSentence(sentence, constellation);
+        parseGSVSentence(fields, constellation);
     }
 }
 
-void GPS::markSatellitesInUse(const char* sentence, uint8_t constellationType) {
-    char buffer[128];
-    strncpy(buffer, sentence, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
+void GPS::markSatellitesInUse(const NMEAFields& fields, uint8_t constellationType) {
+    // $xxGSA,mode,fixType,prn1..prn12,PDOP,HDOP,VDOP[,systemId]*cs
+    if (fields.count < 3) return;
     
-    char* token = strtok(buffer, ",");
-    if (!token) return;
+    gpsData.fixMode = NMEAScan::fieldInt(fields, 2);  // 1=No fix, 2=2D, 3=3D
     
-    token = strtok(NULL, ",");  // Mode
-    token = strtok(NULL, ",");  // Fix type
-    if (token) {
-        gpsData.fixMode = atoi(token);  // 1=No fix, 2=2D, 3=3D
-        
-        // Log once per constellation change (not time-based)
-        static uint8_t lastLoggedConstellation = 0;
-        static uint32_t lastFixLog = 0;
-        if (constellationType != lastLoggedConstellation || millis() - lastFixLog > 30000) {
-            lastLoggedConstellation = constellationType;
-            lastFixLog = millis();
-        }
+    // Log once per constellation change (not time-based)
+    static uint8_t lastLoggedConstellation = 0;
+    static uint32_t lastFixLog = 0;
+    if (constellationType != lastLoggedConstellation || millis() - lastFixLog > 30000) {
+        lastLoggedConstellation = constellationType;
+        lastFixLog = millis();
     }
     
     // Parse up to 12 satellite PRNs from GSA
     int foundCount = 0;
-    for (int i = 0; i < 12; i++) {
-        token = strtok(NULL, ",*");
-        if (!token || strlen(token) == 0) continue;
-        
-        int prn = atoi(token);
+    for (uint8_t i = 3; i < 15 && i < fields.count; i++) {
+        int prn = NMEAScan::fieldInt(fields, i);
         if (prn == 0) continue;
         
         // Match by PRN only and UPDATE constellation from GNGSA
@@ -896,20 +1081,17 @@ void GPS::markSatellitesInUse(const char* sentence, uint8_t constellationType) {
         }
     }
     
-    // Parse PDOP, HDOP, VDOP if available
-    token = strtok(NULL, ",*");  // PDOP
-    if (token && strlen(token) > 0) {
-        gpsData.pdop = atof(token);
+    // Parse PDOP, HDOP, VDOP if available, straight to x100
+    if (NMEAScan::fieldLength(fields, 15) > 0) {
+        gpsData.pdopX100 = NMEAScan::fieldDecimal(fields, 15, 2);
     }
     
-    token = strtok(NULL, ",*");  // HDOP
-    if (token && strlen(token) > 0) {
-        gpsData.hdop = atof(token);
+    if (NMEAScan::fieldLength(fields, 16) > 0) {
+        gpsData.hdopX100 = NMEAScan::fieldDecimal(fields, 16, 2);
     }
     
-    token = strtok(NULL, ",*");  // VDOP
-    if (token && strlen(token) > 0) {
-        gpsData.vdop = atof(token);
+    if (NMEAScan::fieldLength(fields, 17) > 0) {
+        gpsData.vdopX100 = NMEAScan::fieldDecimal(fields, 17, 2);
     }
     
     // Log satellite marking once per constellation change (not time-based)
@@ -921,32 +1103,15 @@ void GPS::markSatellitesInUse(const char* sentence, uint8_t constellationType) {
     }
 }
 
-void GPS::parseGPGSASentence(const char* sentence) {
-    markSatellitesInUse(sentence, 1);  // GPS
+void GPS::parseGPGSASentence(const NMEAFields& fields) {
+    markSatellitesInUse(fields, 1);  // GPS
 }
 
-void GPS::parseGNGSASentence(const char* sentence) {
+void GPS::parseGNGSASentence(const NMEAFields& fields) {
     // GNGSA format: $GNGSA,mode,fixType,sat1,...,sat12,PDOP,HDOP,VDOP,systemID*checksum
     // System ID is the LAST field before the asterisk
-    
-    char buffer[128];
-    strncpy(buffer, sentence, sizeof(buffer) - 1);
-    buffer[sizeof(buffer) - 1] = '\0';
-    
-    // Find the system ID by locating the last comma before the asterisk
-    char* asterisk = strchr(buffer, '*');
-    if (!asterisk) return;
-    
-    // Walk backwards from asterisk to find the last comma
-    char* lastComma = asterisk - 1;
-    while (lastComma > buffer && *lastComma != ',') {
-        lastComma--;
-    }
-    
-    if (*lastComma != ',') return;
-    
-    // System ID is between lastComma and asterisk
-    int systemId = atoi(lastComma + 1);
+    if (fields.star == 0 || fields.count < 2) return;
+    int systemId = NMEAScan::fieldInt(fields, fields.count - 1);
     
     // Validate system ID (1-6)
     if (systemId < 1 || systemId > 6) {
@@ -964,7 +1129,7 @@ void GPS::parseGNGSASentence(const char* sentence) {
     }
     
     // Now mark satellites as in use (will match by PRN only)
-    markSatellitesInUse(sentence, constellationType);
+    markSatellitesInUse(fields, constellationType);
 }
 
 void GPS::updateGPSData() {
@@ -1033,8 +1198,8 @@ void GPS::updateGPSData() {
     if (tinyGPS.location.isValid()) {
         bool wasInvalid = !gpsData.valid;
         gpsData.valid = true;
-        gpsData.latitude = tinyGPS.location.lat();
-        gpsData.longitude = tinyGPS.location.lng();
+        gpsData.latitudeE7 = rawDegreesToE7(tinyGPS.location.rawLat());
+        gpsData.longitudeE7 = rawDegreesToE7(tinyGPS.location.rawLng());
         gpsData.lastUpdateMillis = millis();
         
         if (wasInvalid && shouldFireEvent(EVENT_GPS_FIX_ACQUIRED)) {
@@ -1047,15 +1212,16 @@ void GPS::updateGPSData() {
         gpsData.valid = false;
     }
     
-    // Update altitude, speed, course
+    // Update altitude, speed, course from TinyGPS++'s raw integers
+    // (cm, knots x100, degrees x100) - no double conversions
     if (tinyGPS.altitude.isValid()) {
-        gpsData.altitude = tinyGPS.altitude.meters();
+        gpsData.altitudeMM = tinyGPS.altitude.value() * 10;
     }
     if (tinyGPS.speed.isValid()) {
-        gpsData.speed = tinyGPS.speed.kmph();
+        gpsData.speedKmhX100 = ((uint32_t)tinyGPS.speed.value() * 1852 + 500) / 1000;
     }
     if (tinyGPS.course.isValid()) {
-        gpsData.course = tinyGPS.course.deg();
+        gpsData.courseX100 = tinyGPS.course.value();
     }
     
     // USE MANUAL SATELLITE COUNT from GSA parsing instead of TinyGPS++
@@ -1084,19 +1250,21 @@ void GPS::updateGPSData() {
     }
     
     if (tinyGPS.hdop.isValid()) {
-        gpsData.hdop = tinyGPS.hdop.hdop();
+        gpsData.hdopX100 = tinyGPS.hdop.value();
         
-        if (gpsData.hdop > thresholds.maxHDOP && shouldFireEvent(EVENT_HIGH_HDOP)) {
+        if (gpsData.hdopX100 > thresholds.maxHDOPX100 && shouldFireEvent(EVENT_HIGH_HDOP)) {
             char msg[64];
-            snprintf(msg, sizeof(msg), "High HDOP: %.1f", gpsData.hdop);
+            snprintf(msg, sizeof(msg), "High HDOP: %u.%02u",
+                     gpsData.hdopX100 / GPS_DOP_SCALE, gpsData.hdopX100 % GPS_DOP_SCALE);
             addEvent(EVENT_HIGH_HDOP, msg);
         }
     }
     
     // Check PDOP threshold
-    if (gpsData.pdop > thresholds.maxPDOP && shouldFireEvent(EVENT_HIGH_PDOP)) {
+    if (gpsData.pdopX100 > thresholds.maxPDOPX100 && shouldFireEvent(EVENT_HIGH_PDOP)) {
         char msg[64];
-        snprintf(msg, sizeof(msg), "High PDOP: %.1f", gpsData.pdop);
+        snprintf(msg, sizeof(msg), "High PDOP: %u.%02u",
+                 gpsData.pdopX100 / GPS_DOP_SCALE, gpsData.pdopX100 % GPS_DOP_SCALE);
         addEvent(EVENT_HIGH_PDOP, msg);
     }
     
@@ -1112,9 +1280,9 @@ void GPS::updateGPSData() {
 void GPS::updateFixQuality() {
     if (!gpsData.valid && !gpsData.timeValid) {
         gpsData.fixQuality = 0;  // No fix
-    } else if (gpsData.valid && gpsData.hdop <= 2.0 && gpsData.satellites >= 8 && gpsData.fixMode == 3) {
+    } else if (gpsData.valid && gpsData.hdopX100 <= 200 && gpsData.satellites >= 8 && gpsData.fixMode == 3) {
         gpsData.fixQuality = 3;  // Excellent 3D fix
-    } else if (gpsData.valid && gpsData.hdop <= 5.0 && gpsData.satellites >= 6) {
+    } else if (gpsData.valid && gpsData.hdopX100 <= 500 && gpsData.satellites >= 6) {
         gpsData.fixQuality = 2;  // Good fix
     } else if (gpsData.valid && gpsData.satellites >= 4) {
         gpsData.fixQuality = 1;  // Basic fix
@@ -1177,8 +1345,8 @@ void GPS::addHistoricalPoint() {
     HistoricalDataPoint& point = history.points[history.head];
     point.timestamp = millis();
     point.satelliteCount = gpsData.satellites;
-    point.hdop = gpsData.hdop;
-    point.pdop = gpsData.pdop;
+    point.hdopX100 = gpsData.hdopX100;
+    point.pdopX100 = gpsData.pdopX100;
     point.fixQuality = gpsData.fixQuality;
     point.fixMode = gpsData.fixMode;
     point.hasValidFix = gpsData.valid;
@@ -1255,13 +1423,13 @@ uint8_t GPS::calculateSatelliteScore() {
 }
 
 uint8_t GPS::calculateHDOPScore() {
-    double hdop = gpsData.hdop;
+    uint16_t hdop = gpsData.hdopX100;
     if (hdop == 0) return 0;
-    if (hdop <= 1.0) return 100;
-    if (hdop <= 2.0) return 80;
-    if (hdop <= 5.0) return 60;
-    if (hdop <= 10.0) return 40;
-    if (hdop <= 20.0) return 20;
+    if (hdop <= 100) return 100;
+    if (hdop <= 200) return 80;
+    if (hdop <= 500) return 60;
+    if (hdop <= 1000) return 40;
+    if (hdop <= 2000) return 20;
     return 10;
 }
 
@@ -1332,17 +1500,17 @@ void GPS::updateAlerts() {
         return;
     }
     
-    if (gpsData.hdop > thresholds.maxHDOP) {
+    if (gpsData.hdopX100 > thresholds.maxHDOPX100) {
         health.warningAlert = true;
         snprintf(health.alertMessage, sizeof(health.alertMessage), 
-                 "High HDOP: %.1f", gpsData.hdop);
+                 "High HDOP: %u.%02u", gpsData.hdopX100 / GPS_DOP_SCALE, gpsData.hdopX100 % GPS_DOP_SCALE);
         return;
     }
     
-    if (gpsData.pdop > thresholds.maxPDOP) {
+    if (gpsData.pdopX100 > thresholds.maxPDOPX100) {
         health.warningAlert = true;
         snprintf(health.alertMessage, sizeof(health.alertMessage), 
-                 "High PDOP: %.1f", gpsData.pdop);
+                 "High PDOP: %u.%02u", gpsData.pdopX100 / GPS_DOP_SCALE, gpsData.pdopX100 % GPS_DOP_SCALE);
         return;
     }
     
@@ -1478,6 +1646,28 @@ const char* GPS::getConstellationName(uint8_t id) {
     }
 }
 
+String GPS::formatFixed(int32_t value, uint8_t decimals) {
+    static const uint32_t scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+    if (decimals > 7) decimals = 7;
+    
+    uint32_t magnitude = value < 0 ? (uint32_t)(-(int64_t)value) : (uint32_t)value;
+    char buffer[16];
+    if (decimals == 0) {
+        snprintf(buffer, sizeof(buffer), "%s%lu", value < 0 ? "-" : "", (unsigned long)magnitude);
+    } else {
+        snprintf(buffer, sizeof(buffer), "%s%lu.%0*lu", value < 0 ? "-" : "",
+                 (unsigned long)(magnitude / scale[decimals]), decimals,
+                 (unsigned long)(magnitude % scale[decimals]));
+    }
+    return String(buffer);
+}
+
+int32_t GPS::rawDegreesToE7(const RawDegrees& raw) {
+    // billionths of a degree -> 1e-7, rounded; 180 degrees still fits int32
+    int32_t value = raw.deg * GPS_COORD_SCALE + (raw.billionths + 50) / 100;
+    return raw.negative ? -value : value;
+}
+
 const char* GPS::getConstellationColor(uint8_t id) {
     switch(id) {
         case 1: return "#3b82f6";      // GPS - Blue
@@ -1498,8 +1688,15 @@ void GPS::reset() {
     eventLog.head = 0;
     eventLog.count = 0;
     memset(&gpsData, 0, sizeof(GPSData));
-    gpsBuffer = "";
-    gpsLineReady = false;
+    lineLength = 0;
+    sentenceStartMicros = 0;
+    sentenceBacklog = 0;
+    lastTimeValue = 0;
+    epochBytes = 0;
+    epochDeferredStart = 0;
+    deferredHead = 0;
+    deferredCount = 0;
+    memset(&sentenceStats, 0, sizeof(sentenceStats));
 }
 
 void GPS::log(const String& message) {
@@ -36,25 +36,42 @@
 // LIBRARY INCLUDES
 // ============================================================================
 
+// Build Profile (must come first - selects compiled-in subsystems)
+#include "BuildConfig.h"
+
 // Hardware
 #include "M5Atom.h"
 
 // GPS and NTP Libraries
 #include "GPS.h"                   // Comprehensive GPS library
+#include "GNSSOptimizer.h"         // Adaptive constellation / GSV rate control
 #include "NTP.h"                   // Comprehensive NTP server library
+#include "NTPSocket.h"             // Pipelined UDP socket for NTP
+#include "BlackBox.h"              // Crash/stall recorder (RTC memory)
+#include "PowerManager.h"          // CPU clock scaling and light sleep
+#include "Failover.h"              // Virtual IP shared with the paired unit
+#if FEATURE_OTA
+#include "OTA.h"                   // Streaming firmware update
+#endif
 #include "web_api.h"               // API utility functions
 
 // Network Libraries - Atom library handles Ethernet/SPI initialization
 #include "Atom.h"                  // Atom network client with web server
+#if FEATURE_MQTT
 #include "MQTT.h"                  // MQTT client library
+#endif
 #include <EthernetUdp.h>           // UDP protocol for NTP server
 
 // Data Storage and Parsing
 #include <EEPROM.h>                // Configuration storage
+#if FEATURE_WEB_API
 #include <ArduinoJson.h>           // JSON parsing for API responses
+#endif
 
 // Network Services
+#if FEATURE_MDNS
 #include <ESPmDNS.h>               // Bonjour/mDNS service discovery
+#endif
 
 // ============================================================================
 // HARDWARE PIN DEFINITIONS
@@ -75,7 +92,7 @@
 // ============================================================================
 
 #define EEPROM_SIZE 512            // EEPROM size for configuration storage
-#define CONFIG_VERSION 1           // Configuration version identifier
+#define CONFIG_VERSION 6           // Configuration version identifier
 
 // ============================================================================
 // GLOBAL CONSTANTS
@@ -129,12 +146,30 @@ struct DeviceConfig {
     bool ntpDiscoveryEnabled;                  // Enable NTP discovery
     uint16_t ntpDiscoveryPort;                 // Discovery service port
     uint16_t ntpDiscoveryInterval;             // Discovery interval (seconds)
+    bool ntpPeeringEnabled;                    // Symmetric peering with a paired unit
+    IPAddress ntpPeerIP;                       // Peer unit address
+    bool ntpTelemetryEnabled;                  // Per-request export to a collector
+    IPAddress ntpTelemetryCollector;           // Collector address
+    uint16_t ntpTelemetryPort;                 // Collector UDP port
+    bool failoverEnabled;                      // Share a virtual IP with the paired unit
+    IPAddress failoverVIP;                     // Virtual IP clients use
+    uint8_t failoverVRID;                      // Virtual router ID (same on both units)
+    
+    // Access Control
+    char aclRules[160];                        // Restrict list (see ACL.h)
+    
+    // Power Management
+    bool powerSaveEnabled;                     // CPU clock scaling + light sleep
+    uint16_t ntpLatencyBoundUs;                // Max NTP receive->transmit (us)
 } config;
 
+static_assert(sizeof(DeviceConfig) <= EEPROM_SIZE, "DeviceConfig does not fit in EEPROM");
+
 // Network and System State instances (structs defined in web_api.h)
 NetworkState networkState;
 SystemMetrics metrics;
 
+#if FEATURE_MQTT
 /**
  * MQTT State
  * MQTT connection and publishing state
@@ -145,6 +180,7 @@ struct MQTTState {
     uint32_t reconnectCount;                   // Reconnection attempts
     uint32_t lastReconnectAttempt;             // Last reconnect attempt time
 } mqttState;
+#endif
 
 /**
  * Rolling GPS Statistics
@@ -186,22 +222,49 @@ struct RollingStatistics {
 
 // GPS Instance
 GPS gps;                                       // GPS library instance
+GNSSOptimizer gnssOptimizer;                   // Trims receiver output while timing holds
 
 // NTP Instance
 NTP ntpServer;                                 // NTP server library instance
 
+// Black Box Instance
+BlackBox blackBox;                             // Survives resets in RTC memory
+
+// Power Manager Instance
+PowerManager powerManager;                     // Load-adaptive clock and sleep
+
+// Access Control Instance
+AccessControl accessControl;                   // Restrict list shared by NTP and web
+
+// NTP Telemetry Instance
+NTPTelemetry ntpTelemetry;                     // Per-request export (own UDP socket)
+
+// Failover Instance
+Failover failover;                             // Virtual IP election (own UDP socket)
+
+// Crystal Frequency Estimate
+ClockDrift clockDrift;                         // Persisted in NVS (drift file)
+
+#if FEATURE_OTA
+// OTA Instance
+OTA ota;                                       // Streaming firmware update
+#endif
+
 // Network Configuration (will be populated from EEPROM config in setup)
 AtomNetworkConfig atomNetworkConfig;
 
 // Network Objects
 Atom atom(atomNetworkConfig);                  // Atom network client
+#if FEATURE_MQTT
 MQTT mqttClient(atom);                         // MQTT client (uses Atom as network client)
-EthernetUDP ntpUDP;                            // UDP for NTP server
+#endif
+NTPSocket ntpUDP;                              // UDP for NTP server (pipelined SEND)
 
 // ============================================================================
 // WEB SERVER & NETWORK TRACKING
 // ============================================================================
 
+#if FEATURE_WEB_SERVER
 // Web Server Statistics
 struct WebServerStats {
     uint32_t totalRequests = 0;
@@ -209,6 +272,7 @@ struct WebServerStats {
     uint32_t requests404 = 0;
     uint32_t lastRequestTime = 0;
 } webStats;
+#endif
 
 // Network Connection Tracking
 struct NetworkTracking {
@@ -226,6 +290,9 @@ void loadConfiguration();                      // Load config from EEPROM
 void saveConfiguration();                      // Save config to EEPROM
 void setDefaultConfiguration();                // Set factory defaults
 void validateConfiguration();                  // Validate config integrity
+void applyTelemetryConfig();                   // Start/stop NTP telemetry export
+void applyFailoverConfig();                    // Start/stop virtual IP failover
+void runNMEAScanSelfTest();                    // NMEA scan parity fuzz and benchmark
 bool parseConfigField(const String& formData, const String& fieldName, char* buffer, int maxLen);
 int parseConfigInt(const String& formData, const String& fieldName);
 bool parseConfigIP(const String& formData, const String& fieldName, IPAddress& ip);
@@ -238,26 +305,33 @@ void initializeNetworkWithAtom();              // Initialize network with Atom
 void updateNetworkStateFromLibraries();        // Sync NetworkState from Atom/MQTT
 void checkConnectionHealth();                  // Monitor and recover connections
 
+#if FEATURE_MQTT
 // MQTT Functions
 void initializeMQTT();                         // Initialize MQTT client
 void connectMQTT();                            // Connect to MQTT broker
 void publishMQTTData();                        // Publish GPS/NTP data via MQTT
 void handleMQTTMessages(String& topic, String& payload);
+#endif
 
 // LED Functions
 void updateStatusLED();                        // Update status LED based on state
 void setLEDColor(uint8_t r, uint8_t g, uint8_t b);
 
 // Web Server Route Handlers
+#if FEATURE_WEB_UI
 void handleStatusPage(WebRequest& req, WebResponse& res);
 void handleConfigPage(WebRequest& req, WebResponse& res);
 void handleConfigSave(WebRequest& req, WebResponse& res);
 void handleDebugPage(WebRequest& req, WebResponse& res);
 void handleMetricsPage(WebRequest& req, WebResponse& res);
 void handleLogsPage(WebRequest& req, WebResponse& res);
+#endif
+#if FEATURE_WEB_API
 void handleAPIStatus(WebRequest& req, WebResponse& res);
 void handleAPIMetrics(WebRequest& req, WebResponse& res);
 void handleAPIGPS(WebRequest& req, WebResponse& res);
+void handleAPIGPSOptimizer(WebRequest& req, WebResponse& res);
+void handleAPIGPSScan(WebRequest& req, WebResponse& res);
 void handleAPIConfig(WebRequest& req, WebResponse& res);
 void handleAPIDiscovery(WebRequest& req, WebResponse& res);
 void handleAPIHealth(WebRequest& req, WebResponse& res);
@@ -266,7 +340,30 @@ void handleAPIHistory(WebRequest& req, WebResponse& res);
 void handleAPIRollingStats(WebRequest& req, WebResponse& res);
 void handleAPINTP(WebRequest& req, WebResponse& res);
 void handleAPIDashboard(WebRequest& req, WebResponse& res);
+void handleAPIBlackBox(WebRequest& req, WebResponse& res);
+void handleAPIPower(WebRequest& req, WebResponse& res);
+void handleAPINTPSeries(WebRequest& req, WebResponse& res);
+void handleAPINTPPeers(WebRequest& req, WebResponse& res);
+void handleAPIACL(WebRequest& req, WebResponse& res);
+void handleAPINTPClientOffsets(WebRequest& req, WebResponse& res);
+void handleAPINTPCapture(WebRequest& req, WebResponse& res);
+void handleAPINTPCapturePcap(WebRequest& req, WebResponse& res);
+void handleAPINTPTelemetry(WebRequest& req, WebResponse& res);
+void handleAPINTPPipeline(WebRequest& req, WebResponse& res);
+void handleAPINTPSocket(WebRequest& req, WebResponse& res);
+void handleAPIFailover(WebRequest& req, WebResponse& res);
+void handleAPINTPDrift(WebRequest& req, WebResponse& res);
+#endif
+#if FEATURE_WEB_SERVER
 void handle404(WebRequest& req, WebResponse& res);
+#endif
+#if FEATURE_OTA
+void handleOTAUpload(WebRequest& req, WebResponse& res);
+void serviceTimeCritical();                    // GPS/NTP work during long requests
+#endif
+#if FEATURE_OTA && FEATURE_WEB_API
+void handleAPIOTAStatus(WebRequest& req, WebResponse& res);
+#endif
 
 // Utility Functions
 void logMessage(String message);               // Log message to serial
@@ -275,15 +372,21 @@ double kmhToMph(double kmh);                   // Convert km/h to mph
 double kmhToKnots(double kmh);                 // Convert km/h to knots
 void updateRollingStatistics();                // Update rolling statistics
 void checkPerformanceAlerts();                 // Check for performance issues
+void reportBuildFootprint();                   // Log profile flash/RAM/loop time
 
+#if FEATURE_WEB_UI
 #include "web_visualization.h"     // SVG sky plot & chart generators
 #include "web_pages.h"             // Web pages
+#endif
 
 // ============================================================================
 // ARDUINO SETUP FUNCTION
 // ============================================================================
 
 void setup() {
+    // Capture previous boot's black box before anything can overwrite it
+    blackBox.begin();
+    
     // Initialize M5Atom
     M5.begin(true, false, true);  // Init serial, I2C, display
     
@@ -295,6 +398,11 @@ void setup() {
     logMessage("GPS NTP Server v" + String(FIRMWARE_VERSION));
     logMessage("==============================================");
     
+    if (blackBox.previousCrashed()) {
+        logMessage("WARNING: Previous boot ended abnormally");
+    }
+    logMessage("Black box: " + blackBox.getPreviousSummary());
+    
     // Initialize EEPROM
     EEPROM.begin(EEPROM_SIZE);
     
@@ -307,6 +415,8 @@ void setup() {
     // Initialize GPS with callback and configuration
     gps.setLogCallback(logMessage);
     gps.begin(GPS_RX_PIN, GPS_TX_PIN, GPS_BAUD, config.gpsUpdateRate);
+    gnssOptimizer.setLogCallback(logMessage);
+    gnssOptimizer.begin(gps);
     
     logMessage("GPS initialized on pins RX:" + String(GPS_RX_PIN) + " TX:" + String(GPS_TX_PIN));
     
@@ -322,13 +432,30 @@ void setup() {
     atomNetworkConfig.gateway = config.gateway;
     atomNetworkConfig.subnet = config.subnet;
     atomNetworkConfig.dns = config.dns;
-    atomNetworkConfig.enableWebServer = true;
+    atomNetworkConfig.enableWebServer = FEATURE_WEB_SERVER;
     atomNetworkConfig.webServerPort = 80;
     atomNetworkConfig.enableDiagnostics = true;
+    
+    // Compile access control list (shared by NTP and the web server)
+    if (!accessControl.compile(config.aclRules)) {
+        logMessage("ACL: " + accessControl.getError() + " - using defaults");
+        accessControl.clear();
+    }
+    atom.setAccessControl(&accessControl);
+    ntpServer.setAccessControl(&accessControl);
 
     // Initialize Network with Atom Library
     initializeNetworkWithAtom();
     
+    // Timestamp source cost (also used by GPS time anchors)
+    uint32_t readCost = Timebase::benchmark();
+    logMessage("Timebase: " + String(Timebase::sourceName()) + ", " +
+               String(readCost) + " ns/read");
+    
+#if DEBUG_NMEA_SELFTEST
+    runNMEAScanSelfTest();
+#endif
+    
     // Initialize NTP Server
     if (config.ntpEnabled) {
         NTPConfig ntpConfig = NTP::getDefaultConfig();
@@ -339,39 +466,80 @@ void setup() {
         ntpConfig.autoBroadcast = true;
         ntpConfig.rateLimitEnabled = true;
         ntpConfig.perClientMinInterval = 1000;      // 1 second minimum
-        ntpConfig.globalMaxRequestsPerSec = 1000;   // 1000 req/sec global limit
+        ntpConfig.globalMaxRequestsPerSec = 1000;   // Ceiling; actual limit calibrated
+        ntpConfig.adaptiveCapacity = true;          // from measured loop headroom
         ntpConfig.maxClients = 50;
         ntpConfig.stratum = 1;
         strcpy(ntpConfig.referenceID, "GPS");
         ntpConfig.minSatellites = 4;
-        ntpConfig.maxHDOP = 10.0;
+        ntpConfig.maxHDOPX100 = 1000;
         ntpConfig.maxFixAge = 5000;
+        ntpConfig.peeringEnabled = config.ntpPeeringEnabled;
+        ntpConfig.peerIPs[0] = (uint32_t)config.ntpPeerIP;
+        
+        ntpUDP.setPipelined(true, 1);               // SEND overlaps the next receive
+        ntpUDP.setNeighborCache(true);              // Skip ARP for known next hops
         
+        // Start from the stored crystal frequency instead of re-learning it
+        if (clockDrift.begin()) {
+            logMessage("Drift file: " + String(clockDrift.getState().ppm, 3) + " ppm +/- " +
+                       String(clockDrift.getState().sigmaPPM, 3));
+        } else {
+            logMessage("Drift file: none, learning crystal frequency from GPS");
+        }
+        ntpServer.setDrift(&clockDrift);
         ntpServer.setLogCallback(logMessage);
         ntpServer.begin(gps, ntpUDP, ntpConfig);
         
         networkState.ntpServerRunning = true;
         logMessage("NTP Server initialized and started");
+        
+        applyTelemetryConfig();
+        
+        failover.setLogCallback(logMessage);
+        applyFailoverConfig();
     } else {
         networkState.ntpServerRunning = false;
         logMessage("NTP Server disabled in configuration");
     }
     
+#if FEATURE_OTA
+    // Initialize OTA (confirms or rolls back a freshly updated image)
+    ota.setLogCallback(logMessage);
+    ota.setYieldCallback(serviceTimeCritical);
+    ota.begin();
+#endif
+    
+    // Initialize Power Manager (after NTP - uses its latency histogram)
+    PowerConfig powerConfig = PowerManager::getDefaultConfig();
+    powerConfig.enabled = config.powerSaveEnabled;
+    powerConfig.latencyBoundMicros = config.ntpLatencyBoundUs;
+    powerManager.setLogCallback(logMessage);
+    powerManager.begin(gps, ntpServer, powerConfig);
+    
+#if FEATURE_MQTT
     // Initialize MQTT if enabled
     if (config.mqttEnabled) {
         initializeMQTT();
     }
+#endif
     
+#if FEATURE_MDNS
     // Setup mDNS
     if (MDNS.begin(config.deviceName)) {
+#if FEATURE_WEB_SERVER
         MDNS.addService("http", "tcp", 80);
+#endif
         MDNS.addService("ntp", "udp", 123);
         logMessage("mDNS responder started: " + String(config.deviceName) + ".local");
     }
+#endif
     
+#if FEATURE_WEB_SERVER
     // Register Web Server Routes
     logMessage("Registering web server routes...");
     
+#if FEATURE_WEB_UI
     // Main pages
     atom.addGETRoute("/", handleStatusPage);
     atom.addGETRoute("/config", handleConfigPage);
@@ -379,12 +547,18 @@ void setup() {
     atom.addGETRoute("/debug", handleDebugPage);
     atom.addGETRoute("/metrics", handleMetricsPage);
     atom.addGETRoute("/logs", handleLogsPage);
+#endif
     
+#if FEATURE_WEB_API
     // API endpoints
     atom.addGETRoute("/api/dashboard", handleAPIDashboard);
     atom.addGETRoute("/api/status", handleAPIStatus);
     atom.addGETRoute("/api/metrics", handleAPIMetrics);
     atom.addGETRoute("/api/gps", handleAPIGPS);
+    atom.addGETRoute("/api/gps/optimizer", handleAPIGPSOptimizer);
+    atom.addPOSTRoute("/api/gps/optimizer", handleAPIGPSOptimizer);
+    atom.addGETRoute("/api/gps/scan", handleAPIGPSScan);
+    atom.addPOSTRoute("/api/gps/scan", handleAPIGPSScan);
     atom.addGETRoute("/api/ntp", handleAPINTP);
     atom.addGETRoute("/api/config", handleAPIConfig);
     atom.addGETRoute("/api/discovery", handleAPIDiscovery);
@@ -392,12 +566,46 @@ void setup() {
     atom.addGETRoute("/api/events", handleAPIEvents);
     atom.addGETRoute("/api/history", handleAPIHistory);
     atom.addGETRoute("/api/metrics/rolling", handleAPIRollingStats);
+    atom.addGETRoute("/api/blackbox", handleAPIBlackBox);
+    atom.addGETRoute("/api/power", handleAPIPower);
+    atom.addGETRoute("/api/ntp/series", handleAPINTPSeries);
+    atom.addGETRoute("/api/ntp/peers", handleAPINTPPeers);
+    atom.addGETRoute("/api/acl", handleAPIACL);
+    atom.addGETRoute("/api/ntp/clients/offsets", handleAPINTPClientOffsets);
+    atom.addGETRoute("/api/ntp/capture", handleAPINTPCapture);
+    atom.addPOSTRoute("/api/ntp/capture", handleAPINTPCapture);
+    atom.addGETRoute("/api/ntp/capture.pcap", handleAPINTPCapturePcap);
+    atom.addGETRoute("/api/ntp/telemetry", handleAPINTPTelemetry);
+    atom.addGETRoute("/api/ntp/pipeline", handleAPINTPPipeline);
+    atom.addGETRoute("/api/ntp/socket", handleAPINTPSocket);
+    atom.addPOSTRoute("/api/ntp/socket", handleAPINTPSocket);
+    atom.addGETRoute("/api/failover", handleAPIFailover);
+    atom.addGETRoute("/api/ntp/drift", handleAPINTPDrift);
+    atom.addPOSTRoute("/api/ntp/drift", handleAPINTPDrift);
+#endif
+    
+    // Record each route before its handler runs
+    atom.onRequest([](const String& method, const String& path) {
+        blackBox.recordRoute(path);
+    });
+    
+#if FEATURE_OTA
+    // Firmware update (body streamed to flash, not buffered)
+    atom.addStreamingRoute("/api/ota", handleOTAUpload, "POST");
+#if FEATURE_WEB_API
+    atom.addGETRoute("/api/ota/status", handleAPIOTAStatus);
+#endif
+#endif
     
     // 404 handler
     atom.set404Handler(handle404);
     
     networkState.webServerRunning = true;
     logMessage("Web server routes registered");
+#else
+    networkState.webServerRunning = false;
+    logMessage("Web server excluded by build profile");
+#endif
     
     // Initialize LED
     if (config.statusLedEnabled) {
@@ -412,6 +620,10 @@ void setup() {
     metrics.freeHeapMin = metrics.freeHeap;
     metrics.loopTime = 0;
     metrics.peakLoopTime = 0;
+    metrics.averageLoopTime = 0;
+    metrics.sketchSize = ESP.getSketchSize();
+    metrics.freeSketchSpace = ESP.getFreeSketchSpace();
+    metrics.heapSize = ESP.getHeapSize();
     
     // Initialize rolling statistics
     rollingStats.lastReset24h = millis();
@@ -419,12 +631,16 @@ void setup() {
     rollingStats.lastReset7d = millis();
 
     // Initialize web server and network tracking
+#if FEATURE_WEB_SERVER
     webStats.totalRequests = 0;
     webStats.requestsServed = 0;
     webStats.requests404 = 0;
+#endif
     networkTracking.connectionStartTime = millis();
     networkTracking.totalReconnections = 0;
     
+    reportBuildFootprint();
+    
     logMessage("==============================================");
     logMessage("Setup complete - entering main loop");
     logMessage("==============================================");
@@ -442,18 +658,32 @@ void loop() {
     M5.update();
     
     // Process GPS - single call handles everything
+    blackBox.setStage(BlackBoxStage::GPS);
     gps.process();
+    gnssOptimizer.process(millis());
     
     // Process NTP - single call handles everything
     if (config.ntpEnabled) {
+        blackBox.setStage(BlackBoxStage::NTP);
+        uint32_t servedBefore = ntpServer.getMetrics().validResponses;
         ntpServer.process();
+        if (ntpServer.getMetrics().validResponses != servedBefore) {
+            blackBox.recordNtpClient(ntpServer.getMetrics().lastClientIP);
+        }
+        failover.process();
+        clockDrift.process(millis());
     }
     
+#if FEATURE_WEB_SERVER
     // Handle Web Server Requests
+    blackBox.setStage(BlackBoxStage::WEB);
     atom.handleWebClients();
+#endif
     
+#if FEATURE_MQTT
     // Handle MQTT if enabled
     if (config.mqttEnabled) {
+        blackBox.setStage(BlackBoxStage::MQTT);
         if (!mqttClient.connect()) {
             connectMQTT();
         }
@@ -465,8 +695,19 @@ void loop() {
             mqttState.lastPublish = millis();
         }
     }
+#endif
     
     // Update Status LED
+    blackBox.setStage(BlackBoxStage::HOUSEKEEPING);
+#if FEATURE_OTA
+    // A new image is confirmed only once it actually serves time (with NTP
+    // off: once it parses fresh GPS data); otherwise it rolls back
+    const GPSData& otaGPS = gps.getData();
+    bool gpsParsing = otaGPS.lastUpdateMillis != 0 &&
+                      millis() - otaGPS.lastUpdateMillis < GPS_HEARTBEAT_TIMEOUT;
+    ota.process(networkState.ethernetConnected &&
+                (config.ntpEnabled ? ntpServer.isServing() : gpsParsing));
+#endif
     if (config.statusLedEnabled) {
         updateStatusLED();
     }
@@ -489,6 +730,7 @@ void loop() {
     static unsigned long lastStatsUpdate = 0;
     if (millis() - lastStatsUpdate > 3600000) {
         updateRollingStatistics();
+        reportBuildFootprint();
         lastStatsUpdate = millis();
     }
     
@@ -506,14 +748,28 @@ void loop() {
         metrics.peakLoopTime = loopTime;
     }
     
-    // Small delay to prevent overwhelming the CPU
-    delay(1);
+    // Smoothed loop time (1/16 weight, integer only)
+    if (metrics.averageLoopTime == 0) {
+        metrics.averageLoopTime = loopTime;
+    } else {
+        metrics.averageLoopTime = metrics.averageLoopTime - (metrics.averageLoopTime >> 4) + (loopTime >> 4);
+    }
+    
+    blackBox.recordLoop(loopTime);
+    
+    // Idle until next iteration - light sleep or delay(1) depending on load
+    powerManager.update(loopTime);
+    uint32_t slept = powerManager.idle();
+    
+    // NTP capacity: the full pass including delay(1), light sleep excluded
+    ntpServer.recordLoopPeriod(micros() - loopStart - slept);
 }
 
 // ============================================================================
 // WEB SERVER ROUTE HANDLERS - NOW USING web_api.h UTILITIES
 // ============================================================================
 
+#if FEATURE_WEB_UI
 void handleStatusPage(WebRequest& req, WebResponse& res) {
     logMessage("Status page requested");
     String html = generateModernStatusHTML();
@@ -567,6 +823,42 @@ void handleConfigSave(WebRequest& req, WebResponse& res) {
     config.ntpEnabled = isCheckboxChecked(formData, "ntpEnabled");
     config.ntpBroadcastEnabled = isCheckboxChecked(formData, "ntpBroadcastEnabled");
     config.ntpBroadcastInterval = parseConfigInt(formData, "ntpBroadcastInterval");
+    config.ntpPeeringEnabled = isCheckboxChecked(formData, "ntpPeeringEnabled");
+    parseConfigIP(formData, "ntpPeerIP", config.ntpPeerIP);
+    config.ntpTelemetryEnabled = isCheckboxChecked(formData, "ntpTelemetryEnabled");
+    parseConfigIP(formData, "ntpTelemetryCollector", config.ntpTelemetryCollector);
+    config.ntpTelemetryPort = parseConfigInt(formData, "ntpTelemetryPort");
+    config.failoverEnabled = isCheckboxChecked(formData, "failoverEnabled");
+    parseConfigIP(formData, "failoverVIP", config.failoverVIP);
+    config.failoverVRID = parseConfigInt(formData, "failoverVRID");
+    
+    // Access control: keep the previous list if the new one does not compile
+    char previousRules[sizeof(config.aclRules)];
+    memcpy(previousRules, config.aclRules, sizeof(previousRules));
+    parseConfigField(formData, "aclRules", config.aclRules, sizeof(config.aclRules));
+    if (!accessControl.compile(config.aclRules)) {
+        logMessage("ACL: " + accessControl.getError() + " - keeping previous rules");
+        memcpy(config.aclRules, previousRules, sizeof(previousRules));
+    }
+    
+    // Power settings
+    config.powerSaveEnabled = isCheckboxChecked(formData, "powerSaveEnabled");
+    config.ntpLatencyBoundUs = parseConfigInt(formData, "ntpLatencyBoundUs");
+    validateConfiguration();
+    
+    PowerConfig powerConfig = powerManager.getConfig();
+    powerConfig.enabled = config.powerSaveEnabled;
+    powerConfig.latencyBoundMicros = config.ntpLatencyBoundUs;
+    powerManager.updateConfig(powerConfig);
+    
+    if (networkState.ntpServerRunning) {
+        NTPConfig ntpConfig = ntpServer.getConfig();
+        ntpConfig.peeringEnabled = config.ntpPeeringEnabled;
+        ntpConfig.peerIPs[0] = (uint32_t)config.ntpPeerIP;
+        ntpServer.updateConfig(ntpConfig);
+        applyTelemetryConfig();
+        applyFailoverConfig();
+    }
     
     // Save to EEPROM
     saveConfiguration();
@@ -602,12 +894,112 @@ void handleLogsPage(WebRequest& req, WebResponse& res) {
     logMessage("Logs page requested");
     res.send(200, "text/html", "<html><body><h1>Logs</h1><p>Not implemented yet</p></body></html>");
 }
+#endif // FEATURE_WEB_UI
 
+#if FEATURE_WEB_API
 void handleAPIDashboard(WebRequest& req, WebResponse& res) {
     String json = web_api::generateDashboardJSON(gps, ntpServer, networkState, metrics);
     res.send(200, "application/json", json);
 }
 
+void handleAPIBlackBox(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateBlackBoxJSON(blackBox);
+    res.send(200, "application/json", json);
+}
+
+void handleAPIPower(WebRequest& req, WebResponse& res) {
+    String json = web_api::generatePowerJSON(powerManager, ntpServer);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPSeries(WebRequest& req, WebResponse& res) {
+    // ?resolution=minute for 24 h at 1 min, default 10 min at 1 s
+    bool perMinute = req.getParam("resolution") == "minute";
+    const GPSData& gpsData = gps.getData();
+    uint32_t endUnix = gpsData.timeValid ? gpsData.unixTime : 0;
+    web_api::streamNTPTrafficSeriesJSON(ntpServer, perMinute, endUnix, res);
+}
+
+void handleAPINTPPeers(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateNTPPeersJSON(ntpServer);
+    res.send(200, "application/json", json);
+}
+
+void handleAPIACL(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateACLJSON(accessControl, config.aclRules);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPClientOffsets(WebRequest& req, WebResponse& res) {
+    // ?min_us=<n> lists only clients at least that far off
+    float minOffset = req.hasParam("min_us") ? req.getParam("min_us").toFloat() : 0;
+    web_api::streamNTPClientOffsetsJSON(ntpServer, minOffset, res);
+}
+
+void handleAPINTPCapture(WebRequest& req, WebResponse& res) {
+    // POST ?enable=1 allocates the capture ring, ?enable=0 frees it
+    if (req.isPOST() && req.hasParam("enable")) {
+        if (!ntpServer.setCaptureEnabled(req.getParam("enable") == "1")) {
+            res.send(503, "application/json", "{\"error\":\"Insufficient memory\"}");
+            return;
+        }
+    }
+    String json = web_api::generateNTPCaptureStatusJSON(ntpServer);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPTelemetry(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateNTPTelemetryJSON(ntpTelemetry);
+    res.send(200, "application/json", json);
+}
+
+void handleAPIFailover(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateFailoverJSON(failover);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPDrift(WebRequest& req, WebResponse& res) {
+    // POST ?forget=1 erases the drift file so the next boot starts cold
+    // (compare cold_converge_s with warm_converge_s)
+    if (req.isPOST() && req.hasParam("forget") && req.getParam("forget") == "1") {
+        clockDrift.erase();
+        logMessage("Drift file erased");
+    }
+    String json = web_api::generateNTPDriftJSON(clockDrift);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPPipeline(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateNTPPipelineJSON(ntpServer);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPSocket(WebRequest& req, WebResponse& res) {
+    // POST ?pipelined=0|1&sockets=1|2 switches I/O mode for A/B comparison
+    // (compare capacity.measured_rps in /api/ntp between modes)
+    if (req.isPOST() && req.hasParam("pipelined")) {
+        uint8_t sockets = req.hasParam("sockets") ? req.getParam("sockets").toInt() : 1;
+        ntpUDP.setPipelined(req.getParam("pipelined") == "1", sockets);
+        logMessage("NTP socket: " + String(ntpUDP.isPipelined() ? "pipelined" : "blocking") +
+                   ", " + String(ntpUDP.getSocketCount()) + " socket(s)");
+    }
+    // POST ?neighbors=0|1 toggles the ARP cache (compare send_latency rows)
+    if (req.isPOST() && req.hasParam("neighbors")) {
+        ntpUDP.setNeighborCache(req.getParam("neighbors") == "1");
+        logMessage("NTP neighbor cache " + String(ntpUDP.isNeighborCacheEnabled() ? "enabled" : "disabled"));
+    }
+    String json = web_api::generateNTPSocketJSON(ntpUDP);
+    res.send(200, "application/json", json);
+}
+
+void handleAPINTPCapturePcap(WebRequest& req, WebResponse& res) {
+    // Filters: ?ip=<client>&kod=<RATE|DENY|any>
+    NTPCaptureFilter filter = web_api::parseCaptureFilter(req);
+    web_api::streamNTPCapturePcap(ntpServer, filter, (uint32_t)atom.getStatus().currentIP, res);
+}
+#endif
+
+#if FEATURE_WEB_SERVER
 void handle404(WebRequest& req, WebResponse& res) {
     logMessage("404 - Page not found: " + req.getPath());
     
@@ -623,16 +1015,57 @@ void handle404(WebRequest& req, WebResponse& res) {
     
     res.send(404, "text/html", html);
 }
+#endif // FEATURE_WEB_SERVER
+
+#if FEATURE_OTA
+void handleOTAUpload(WebRequest& req, WebResponse& res) {
+    ota.handleUpload(req, res);
+}
+
+void serviceTimeCritical() {
+    gps.process();
+    if (config.ntpEnabled) {
+        ntpServer.process();
+    }
+}
+#endif
+
+#if FEATURE_OTA && FEATURE_WEB_API
+void handleAPIOTAStatus(WebRequest& req, WebResponse& res) {
+    String json = web_api::generateOTAStatusJSON(ota);
+    res.send(200, "application/json", json);
+}
+#endif
 
 // ============================================================================
 // API ENDPOINTS - NOW USING web_api.h UTILITIES
 // ============================================================================
 
+#if FEATURE_WEB_API
+
 void handleAPIGPS(WebRequest& req, WebResponse& res) {
     String json = web_api::generateEnhancedGPSJSON(gps);
     res.send(200, "application/json", json);
 }
 
+void handleAPIGPSScan(WebRequest& req, WebResponse& res) {
+    // POST runs the parity fuzz and benchmark (blocks the loop briefly)
+    if (req.isPOST()) {
+        runNMEAScanSelfTest();
+    }
+    String json = web_api::generateNMEAScanJSON();
+    res.send(200, "application/json", json);
+}
+
+void handleAPIGPSOptimizer(WebRequest& req, WebResponse& res) {
+    // POST ?enabled=0 restores full receiver output (until reboot)
+    if (req.isPOST() && req.hasParam("enabled")) {
+        gnssOptimizer.setEnabled(req.getParam("enabled") == "1");
+    }
+    String json = web_api::generateGNSSOptimizerJSON(gnssOptimizer);
+    res.send(200, "application/json", json);
+}
+
 void handleAPIStatus(WebRequest& req, WebResponse& res) {
     String json = web_api::generateQuickStatusJSON(gps, ntpServer, networkState);
     res.send(200, "application/json", json);
@@ -732,11 +1165,14 @@ void handleAPINTP(WebRequest& req, WebResponse& res) {
     String json = web_api::generateNTPMetricsJSON(ntpServer);
     res.send(200, "application/json", json);
 }
+#endif // FEATURE_WEB_API
 
 // ============================================================================
 // MQTT FUNCTIONS
 // ============================================================================
 
+#if FEATURE_MQTT
+
 void initializeMQTT() {
     if (!config.mqttEnabled) {
         return;
@@ -790,14 +1226,14 @@ void publishMQTTData() {
     
     // Publish GPS data
     if (data.valid) {
-        mqttClient.publish(baseTopic + "/gps/latitude", String(data.latitude, 6));
-        mqttClient.publish(baseTopic + "/gps/longitude", String(data.longitude, 6));
-        mqttClient.publish(baseTopic + "/gps/altitude", String(data.altitude, 1));
+        mqttClient.publish(baseTopic + "/gps/latitude", GPS::formatFixed(data.latitudeE7, 7));
+        mqttClient.publish(baseTopic + "/gps/longitude", GPS::formatFixed(data.longitudeE7, 7));
+        mqttClient.publish(baseTopic + "/gps/altitude", GPS::formatFixed(data.altitudeMM / 100, 1));
     }
     
     mqttClient.publish(baseTopic + "/gps/satellites", String(data.satellites));
-    mqttClient.publish(baseTopic + "/gps/hdop", String(data.hdop, 2));
-    mqttClient.publish(baseTopic + "/gps/pdop", String(data.pdop, 2));
+    mqttClient.publish(baseTopic + "/gps/hdop", GPS::formatFixed(data.hdopX100, 2));
+    mqttClient.publish(baseTopic + "/gps/pdop", GPS::formatFixed(data.pdopX100, 2));
     mqttClient.publish(baseTopic + "/gps/fix", data.valid ? "true" : "false");
     mqttClient.publish(baseTopic + "/gps/fix_mode", String(data.fixMode));
     
@@ -828,6 +1264,7 @@ void publishMQTTData() {
 void handleMQTTMessages(String& topic, String& payload) {
     logMessage("MQTT message received: " + topic + " = " + payload);
 }
+#endif // FEATURE_MQTT
 
 // ============================================================================
 // NETWORK FUNCTIONS
@@ -909,7 +1346,7 @@ void updateStatusLED() {
         setLEDColor(255, 255, 0);  // Yellow - Time only, no position
     } else if (data.satellites < 4) {
         setLEDColor(255, 255, 0);  // Yellow - Low satellite count
-    } else if (data.hdop > 5.0) {
+    } else if (data.hdopX100 > 500) {
         setLEDColor(255, 255, 0);  // Yellow - Poor accuracy
     } else {
         setLEDColor(0, 255, 0);  // Green - All good
@@ -971,6 +1408,19 @@ void setDefaultConfiguration() {
     config.ntpDiscoveryEnabled = true;
     config.ntpDiscoveryPort = 5353;
     config.ntpDiscoveryInterval = 60;
+    config.ntpPeeringEnabled = false;
+    config.ntpPeerIP = IPAddress(0, 0, 0, 0);
+    config.ntpTelemetryEnabled = false;
+    config.ntpTelemetryCollector = IPAddress(0, 0, 0, 0);
+    config.ntpTelemetryPort = NTP_TELEMETRY_DEFAULT_PORT;
+    config.failoverEnabled = false;
+    config.failoverVIP = IPAddress(0, 0, 0, 0);
+    config.failoverVRID = FAILOVER_DEFAULT_VRID;
+    
+    config.aclRules[0] = '\0';                 // No rules: everyone rate limited with KoD
+    
+    config.powerSaveEnabled = false;
+    config.ntpLatencyBoundUs = 1000;
     
     logMessage("Default configuration loaded");
 }
@@ -979,6 +1429,7 @@ void validateConfiguration() {
     config.deviceName[31] = '\0';
     config.mqttBroker[63] = '\0';
     config.mqttBaseTopic[31] = '\0';
+    config.aclRules[sizeof(config.aclRules) - 1] = '\0';
     
     if (config.ledBrightness > 255) config.ledBrightness = 255;
     if (config.gpsUpdateRate != 1 && config.gpsUpdateRate != 5 && config.gpsUpdateRate != 10) {
@@ -987,6 +1438,61 @@ void validateConfiguration() {
     if (config.mqttPort == 0) config.mqttPort = 1883;
     if (config.mqttPublishInterval < 10) config.mqttPublishInterval = 10;
     if (config.ntpBroadcastInterval < 10) config.ntpBroadcastInterval = 10;
+    if (config.ntpLatencyBoundUs < 100) config.ntpLatencyBoundUs = 100;
+    if (config.ntpLatencyBoundUs > 20000) config.ntpLatencyBoundUs = 20000;
+    if ((uint32_t)config.ntpPeerIP == 0) config.ntpPeeringEnabled = false;
+    if ((uint32_t)config.ntpTelemetryCollector == 0) config.ntpTelemetryEnabled = false;
+    if (config.ntpTelemetryPort == 0) config.ntpTelemetryPort = NTP_TELEMETRY_DEFAULT_PORT;
+    if (config.failoverVRID == 0) config.failoverVRID = FAILOVER_DEFAULT_VRID;
+    if ((uint32_t)config.failoverVIP == 0 || config.useDHCP) config.failoverEnabled = false;
+    // The master answers only on the VIP, so peers can reach neither unit
+    // address reliably; failover and peering are mutually exclusive
+    if (config.failoverEnabled) config.ntpPeeringEnabled = false;
+}
+
+void applyTelemetryConfig() {
+    if (!config.ntpTelemetryEnabled) {
+        if (ntpTelemetry.isRunning()) {
+            ntpServer.setTelemetry(nullptr);
+            ntpTelemetry.end();
+            logMessage("NTP telemetry export stopped");
+        }
+        return;
+    }
+    
+    if (!ntpTelemetry.begin(config.ntpTelemetryCollector, config.ntpTelemetryPort)) {
+        ntpServer.setTelemetry(nullptr);
+        logMessage("NTP telemetry: not enough memory for the record ring");
+        return;
+    }
+    ntpServer.setTelemetry(&ntpTelemetry);
+    logMessage("NTP telemetry exporting to " + config.ntpTelemetryCollector.toString() +
+               ":" + String(config.ntpTelemetryPort));
+}
+
+void applyFailoverConfig() {
+    FailoverConfig failoverConfig;
+    failoverConfig.enabled = config.failoverEnabled;
+    failoverConfig.virtualIP = config.failoverVIP;
+    failoverConfig.vrid = config.failoverVRID;
+    
+    // Restarting releases the VIP first, so an address change takes effect
+    if (!failoverConfig.enabled) {
+        if (failover.getState() != FailoverState::DISABLED) {
+            failover.end();
+            logMessage("Failover stopped");
+        }
+        return;
+    }
+    failover.begin(gps, ntpServer, failoverConfig);
+}
+
+void runNMEAScanSelfTest() {
+    uint32_t scanFailures = NMEAScan::selfTest();
+    const NMEAScanBench& scanBench = NMEAScan::benchmark();
+    logMessage("NMEA scan: " + String(scanBench.swarCycles) + " vs " +
+               String(scanBench.referenceCycles) + " cycles per " + String(scanBench.bytes) +
+               " bytes, parity " + (scanFailures ? "FAILED (" + String(scanFailures) + ")" : String("OK")));
 }
 
 bool parseConfigField(const String& formData, const String& fieldName, char* buffer, int maxLen) {
@@ -1175,3 +1681,15 @@ void checkPerformanceAlerts() {
         logMessage("WARNING: Slow loop detected - " + String(metrics.peakLoopTime) + " us");
     }
 }
+
+void reportBuildFootprint() {
+    // Heap size reflects static RAM: subsystems excluded by the build
+    // profile leave more of the DRAM region to the heap
+    logMessage("Build profile: " + String(BUILD_PROFILE_NAME) +
+               " | Flash: " + String(metrics.sketchSize) + " bytes (" +
+               String(metrics.freeSketchSpace) + " free)" +
+               " | Heap: " + String(metrics.heapSize) + " bytes total, " +
+               String(ESP.getFreeHeap()) + " free" +
+               " | Loop: " + String(metrics.averageLoopTime) + " us avg, " +
+               String(metrics.peakLoopTime) + " us peak");
+}
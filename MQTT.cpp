@@ -11,6 +11,8 @@
 
 #include "MQTT.h"
 
+#if FEATURE_MQTT
+
 // ============================================================================
 // Enhanced MQTTConfig Validation Methods - HARDENING + SUBSCRIPTIONS (unchanged)
 // ============================================================================
@@ -2818,3 +2820,5 @@ void MQTT::onSubscriptionChange(MQTTSubscriptionCallback callback) { _subscripti
 // ============================================================================
 // End of MQTT Enhanced Implementation with Two-Phase Constructor Support
 // ============================================================================
+
+#endif // FEATURE_MQTT
@@ -35,6 +35,10 @@
 #ifndef MQTT_H
 #define MQTT_H
 
+#include "BuildConfig.h"
+
+#if FEATURE_MQTT
+
 #include <Arduino.h>
 #include <PubSubClient.h>
 #include <Client.h>
@@ -683,4 +687,6 @@ private:
     void _notifySubscriptionChange(const String& topicFilter, bool subscribed, bool success);
 };
 
+#endif // FEATURE_MQTT
+
 #endif // MQTT_H
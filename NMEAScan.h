@@ -0,0 +1,524 @@
+/*
+ * ============================================================================
+ * NMEAScan.h - Word-at-a-time NMEA Scanning and Field Parsing
+ * ============================================================================
+ *
+ * Shared kernels for the NMEA sentences parsed outside TinyGPS++. They
+ * work on 32-bit words (SWAR: SIMD within a register), four bytes per
+ * step on the Xtensa core:
+ *
+ * - scan(): one pass locates every ',' and the '*', finds CR/LF, and
+ *   XORs the checksum a word at a time. Fields are then addressed by
+ *   index, with no strtok copy and no strlen per field
+ * - parseInt() / parseDecimal(): fixed-width digit runs (up to 8) are
+ *   converted with two multiplies per word instead of a loop per digit
+ *
+ * Byte matching uses the carry-free form of the zero-byte test, so every
+ * matching byte is flagged exactly (the classic haszero() trick can flag
+ * a 0x01 byte sitting above a real match).
+ *
+ * Buffer contract: the line must start on a 4-byte boundary and be
+ * readable up to the next multiple of 4 past its length. Size buffers
+ * with NMEA_SCAN_SIZE() and declare them alignas(4). Bytes past the
+ * length are masked off, so their contents do not matter.
+ *
+ * Each kernel has a byte-at-a-time reference. selfTest() fuzzes the
+ * kernels against it and benchmark() times both paths. Both run on the
+ * host (test/host/nmea_scan_test.cpp) and, on demand, on the device;
+ * neither runs in a production boot.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NMEA_SCAN_H
+#define NMEA_SCAN_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NMEA_MAX_FIELDS 24                   // Address field + 23 data fields
+#define NMEA_SCAN_SIZE(n) (((n) + 3) & ~3)   // Buffer bytes for n chars, word padded
+#ifndef NMEA_SCAN_FUZZ_CASES
+#define NMEA_SCAN_FUZZ_CASES 2000            // selfTest() iterations
+#endif
+#ifndef NMEA_SCAN_BENCH_ROUNDS
+#define NMEA_SCAN_BENCH_ROUNDS 200           // benchmark() passes over the samples
+#endif
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Field Layout of One Sentence
+ * Field 0 is the address ("GPGSV"), field i ends at delim[i]
+ */
+struct NMEAFields {
+    const char* line;                        // Scanned sentence
+    uint8_t count;                           // Fields found
+    uint8_t delim[NMEA_MAX_FIELDS];          // Offset of the ',' '*' or line end closing each field
+    uint8_t star;                            // Offset of '*', 0 if none
+    uint8_t end;                             // Offset of CR/LF, or the length
+    uint8_t checksum;                        // XOR of the bytes between '$' and '*'
+    bool checksumValid;                      // Matches the hex digits after '*'
+};
+
+/**
+ * Benchmark and Parity Results
+ */
+struct NMEAScanBench {
+    uint32_t bytes;                          // Sentence bytes per pass
+    uint32_t swarCycles;                     // Cycles per pass, word kernels
+    uint32_t referenceCycles;                // Cycles per pass, strtok/atoi path
+    uint32_t fuzzCases;                      // Parity cases run
+    uint32_t fuzzFailures;                   // Kernel disagreed with the reference
+};
+
+// ============================================================================
+// NMEA SCAN CLASS
+// ============================================================================
+
+class NMEAScan {
+public:
+    /**
+     * Locate fields, checksum and line end in one pass
+     * @param line Sentence starting with '$', word aligned and padded
+     * @param length Characters in line
+     * @param fields Receives the layout
+     */
+    static void scan(const char* line, uint8_t length, NMEAFields& fields) {
+        beginFields(line, length, fields);
+
+        uint32_t sum = 0;
+        bool body = true;
+        for (uint8_t offset = 0; offset < length; offset += 4) {
+            uint32_t word = loadWord(line + offset) & lowBytes(length - offset);
+            uint32_t eol = matchMask(word, '\r') | matchMask(word, '\n');
+
+            if (body) {
+                uint32_t stop = matchMask(word, '*') | eol;
+                uint32_t commas = matchMask(word, ',');
+                if (!stop) {
+                    sum ^= word;
+                    addDelimiters(fields, commas, offset);
+                    continue;
+                }
+
+                // Stop byte (first '*', CR or LF) ends the body in this word
+                uint8_t at = __builtin_ctz(stop) >> 3;
+                uint32_t before = lowBytes(at);
+                sum ^= word & before;
+                addDelimiters(fields, commas & before, offset);
+                closeField(fields, offset + at);
+                body = false;
+
+                if (line[offset + at] != '*') {
+                    fields.end = offset + at;
+                    break;
+                }
+                fields.star = offset + at;
+                eol &= ~lowBytes(at + 1);
+            }
+
+            // After '*': only the line end is left to find
+            if (eol) {
+                fields.end = offset + (__builtin_ctz(eol) >> 3);
+                break;
+            }
+        }
+        if (body) {
+            closeField(fields, length);
+        }
+
+        sum ^= sum >> 16;
+        sum ^= sum >> 8;
+        finishChecksum(fields, length, (uint8_t)sum);
+    }
+
+    /**
+     * Byte-at-a-time scan(), the parity reference
+     */
+    static void scanReference(const char* line, uint8_t length, NMEAFields& fields) {
+        beginFields(line, length, fields);
+
+        uint8_t sum = 0;
+        uint8_t i = 0;
+        for (; i < length; i++) {
+            char c = line[i];
+            if (c == '*' || c == '\r' || c == '\n') break;
+            if (c == ',' && fields.count < NMEA_MAX_FIELDS - 1) {
+                fields.delim[fields.count++] = i;
+            }
+            sum ^= (uint8_t)c;
+        }
+        closeField(fields, i);
+
+        if (i < length && line[i] == '*') {
+            fields.star = i;
+            for (i++; i < length; i++) {
+                if (line[i] == '\r' || line[i] == '\n') break;
+            }
+        }
+        fields.end = i;
+        finishChecksum(fields, length, sum);
+    }
+
+    /**
+     * First character of a field
+     */
+    static const char* field(const NMEAFields& fields, uint8_t index) {
+        return fields.line + fieldStart(fields, index);
+    }
+
+    /**
+     * Characters in a field (0 if empty or missing)
+     */
+    static uint8_t fieldLength(const NMEAFields& fields, uint8_t index) {
+        if (index >= fields.count) return 0;
+        return fields.delim[index] - fieldStart(fields, index);
+    }
+
+    /**
+     * Integer value of a field, atoi() semantics (0 if empty or missing)
+     */
+    static int32_t fieldInt(const NMEAFields& fields, uint8_t index) {
+        return parseInt(field(fields, index), fieldLength(fields, index));
+    }
+
+    /**
+     * Decimal value of a field scaled by 10^decimals (0 if empty or missing)
+     */
+    static int32_t fieldDecimal(const NMEAFields& fields, uint8_t index, uint8_t decimals) {
+        return parseDecimal(field(fields, index), fieldLength(fields, index), decimals);
+    }
+
+    /**
+     * Parse a run of digits, atoi() semantics
+     * Pure digit runs of up to 8 characters take the word path; anything
+     * else (sign, stray characters, longer runs) falls back to the reference
+     * @param text First character; must lie inside a scan-contract buffer
+     * @param length Characters in the run
+     */
+    static int32_t parseInt(const char* text, uint8_t length) {
+        if (length == 0 || length > 8) {
+            return parseIntReference(text, length);
+        }
+
+        uint8_t high = length > 4 ? length - 4 : 0;
+        uint32_t value;
+        if (!parseDigits(text + high, length - high, value)) {
+            return parseIntReference(text, length);
+        }
+        if (high) {
+            uint32_t top;
+            if (!parseDigits(text, high, top)) {
+                return parseIntReference(text, length);
+            }
+            value += top * 10000;
+        }
+        return (int32_t)value;
+    }
+
+    /**
+     * Byte-at-a-time parseInt(), the parity reference
+     * Runs too long for 32 bits wrap instead of overflowing
+     */
+    static int32_t parseIntReference(const char* text, uint8_t length) {
+        uint8_t i = 0;
+        bool negative = false;
+        if (i < length && (text[i] == '-' || text[i] == '+')) {
+            negative = text[i] == '-';
+            i++;
+        }
+        uint32_t value = 0;
+        for (; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+            value = value * 10 + (text[i] - '0');
+        }
+        return (int32_t)(negative ? 0u - value : value);
+    }
+
+    /**
+     * Parse "123.45" as a scaled integer
+     * Extra fraction digits are truncated, missing ones read as zero
+     * @param decimals Fraction digits kept (0-4)
+     */
+    static int32_t parseDecimal(const char* text, uint8_t length, uint8_t decimals) {
+        static const int32_t scale[] = { 1, 10, 100, 1000, 10000 };
+        if (decimals > 4) decimals = 4;
+
+        bool negative = length > 0 && text[0] == '-';
+        if (negative) {
+            text++;
+            length--;
+        }
+
+        uint8_t dot = 0;
+        while (dot < length && text[dot] != '.') dot++;
+
+        int32_t value = parseInt(text, dot) * scale[decimals];
+        if (dot < length && decimals > 0) {
+            const char* fraction = text + dot + 1;
+            uint8_t available = length - dot - 1;
+            uint8_t digits = 0;
+            while (digits < decimals && digits < available &&
+                   fraction[digits] >= '0' && fraction[digits] <= '9') {
+                digits++;
+            }
+            value += parseInt(fraction, digits) * scale[decimals - digits];
+        }
+        return negative ? -value : value;
+    }
+
+    // ========================================================================
+    // VERIFICATION
+    // ========================================================================
+
+    /**
+     * Fuzz the word kernels against the byte references
+     * Mutates sample sentences with delimiter-heavy noise and compares
+     * every field, the checksum and parsed integers
+     * @return Cases that disagreed (0 = parity)
+     */
+    static uint32_t selfTest() {
+        alignas(4) char line[NMEA_SCAN_SIZE(128)];
+        uint32_t failures = 0;
+
+        for (uint32_t n = 0; n < NMEA_SCAN_FUZZ_CASES; n++) {
+            const char* sample = samples()[n % sampleCount()];
+            uint8_t length = strlen(sample);
+            memcpy(line, sample, length);
+
+            // Random bytes beyond the length check the masking
+            for (uint8_t i = length; i < sizeof(line); i++) {
+                line[i] = fuzzChar();
+            }
+            uint8_t mutations = esp_random() % 6;
+            for (uint8_t m = 0; m < mutations; m++) {
+                line[1 + esp_random() % (length - 1)] = fuzzChar();
+            }
+            length -= esp_random() % 8;
+
+            NMEAFields fast, reference;
+            scan(line, length, fast);
+            scanReference(line, length, reference);
+            if (!sameFields(fast, reference)) {
+                failures++;
+                continue;
+            }
+            for (uint8_t f = 0; f < fast.count; f++) {
+                uint8_t len = fieldLength(fast, f);
+                if (parseInt(field(fast, f), len) != parseIntReference(field(fast, f), len)) {
+                    failures++;
+                    break;
+                }
+            }
+        }
+
+        bench().fuzzCases = NMEA_SCAN_FUZZ_CASES;
+        bench().fuzzFailures = failures;
+        return failures;
+    }
+
+    /**
+     * Time the word kernels against the strtok/atoi path they replaced
+     * Both paths split every field and convert it to an integer
+     * @return Results (also kept for getBenchmark())
+     */
+    static const NMEAScanBench& benchmark() {
+        alignas(4) char line[NMEA_SCAN_SIZE(128)];
+        volatile int32_t sink = 0;
+        uint32_t bytes = 0;
+        uint32_t swarCycles = 0;
+        uint32_t referenceCycles = 0;
+
+        for (uint8_t s = 0; s < sampleCount(); s++) {
+            uint8_t length = strlen(samples()[s]);
+            memcpy(line, samples()[s], length + 1);
+            bytes += length;
+
+            uint32_t start = ESP.getCycleCount();
+            for (uint16_t r = 0; r < NMEA_SCAN_BENCH_ROUNDS; r++) {
+                NMEAFields fields;
+                scan(line, length, fields);
+                int32_t total = fields.checksumValid;
+                for (uint8_t f = 1; f < fields.count; f++) {
+                    total += fieldInt(fields, f);
+                }
+                sink = sink + total;
+            }
+            swarCycles += ESP.getCycleCount() - start;
+
+            start = ESP.getCycleCount();
+            for (uint16_t r = 0; r < NMEA_SCAN_BENCH_ROUNDS; r++) {
+                sink = sink + strtokPath(line);
+            }
+            referenceCycles += ESP.getCycleCount() - start;
+        }
+        (void)sink;
+
+        bench().bytes = bytes;
+        bench().swarCycles = swarCycles / NMEA_SCAN_BENCH_ROUNDS;
+        bench().referenceCycles = referenceCycles / NMEA_SCAN_BENCH_ROUNDS;
+        return bench();
+    }
+
+    /**
+     * Get last benchmark and self-test results (zeros if not run)
+     */
+    static const NMEAScanBench& getBenchmark() {
+        return bench();
+    }
+
+private:
+    // Aligned 32-bit load; the buffer contract makes this legal
+    static inline uint32_t loadWord(const char* p) {
+        uint32_t word;
+        memcpy(&word, __builtin_assume_aligned(p, 4), 4);
+        return word;
+    }
+
+    // Low n bytes set (n >= 4: all)
+    static inline uint32_t lowBytes(uint8_t n) {
+        return n >= 4 ? 0xFFFFFFFFu : (1u << (n * 8)) - 1;
+    }
+
+    // 0x80 in every byte of word equal to c, exact per byte
+    static inline uint32_t matchMask(uint32_t word, uint8_t c) {
+        uint32_t v = word ^ (0x01010101u * c);
+        return ~(((v & 0x7F7F7F7Fu) + 0x7F7F7F7Fu) | v | 0x7F7F7F7Fu);
+    }
+
+    // Fetch 1-4 unaligned bytes with aligned loads, little-endian, rest zero
+    static inline uint32_t loadBytes(const char* p, uint8_t length) {
+        uintptr_t address = (uintptr_t)p;
+        const char* base = (const char*)(address & ~(uintptr_t)3);
+        uint8_t shift = (address & 3) * 8;
+
+        uint32_t word = loadWord(base) >> shift;
+        if (shift + length * 8 > 32) {
+            word |= loadWord(base + 4) << (32 - shift);
+        }
+        return word & lowBytes(length);
+    }
+
+    // 1-4 ASCII digits, most significant first, to binary
+    static inline bool parseDigits(const char* p, uint8_t length, uint32_t& value) {
+        uint32_t valid = lowBytes(length);
+        uint32_t zeros = 0x30303030u & valid;
+        uint32_t word = loadBytes(p, length);
+
+        // High nibble 3 and no carry out of the low nibble when adding 6
+        if ((word & 0xF0F0F0F0u) != zeros ||
+            ((word + 0x06060606u) & 0xF0F0F0F0u) != zeros) {
+            return false;
+        }
+
+        // Left-pad with zero digits, then combine pairs, then pairs of pairs
+        word = (word - zeros) << ((4 - length) * 8);
+        word = (word * 10 + (word >> 8)) & 0x00FF00FFu;
+        value = (word * 100 + (word >> 16)) & 0xFFFFu;
+        return true;
+    }
+
+    static void beginFields(const char* line, uint8_t length, NMEAFields& fields) {
+        fields.line = line;
+        fields.count = 0;
+        fields.star = 0;
+        fields.end = length;
+        fields.checksum = 0;
+        fields.checksumValid = false;
+    }
+
+    // Record the commas flagged in mask; the last slot is kept for closeField()
+    static inline void addDelimiters(NMEAFields& fields, uint32_t mask, uint8_t offset) {
+        while (mask && fields.count < NMEA_MAX_FIELDS - 1) {
+            fields.delim[fields.count++] = offset + (__builtin_ctz(mask) >> 3);
+            mask &= mask - 1;
+        }
+    }
+
+    static inline void closeField(NMEAFields& fields, uint8_t offset) {
+        fields.delim[fields.count++] = offset;
+    }
+
+    // sum covers the whole body including the leading '$', which is not summed
+    static void finishChecksum(NMEAFields& fields, uint8_t length, uint8_t sum) {
+        fields.checksum = sum ^ (uint8_t)fields.line[0];
+        if (fields.star == 0 || fields.star + 2 >= length) return;
+
+        int8_t high = hexValue(fields.line[fields.star + 1]);
+        int8_t low = hexValue(fields.line[fields.star + 2]);
+        fields.checksumValid = high >= 0 && low >= 0 &&
+                               (uint8_t)((high << 4) | low) == fields.checksum;
+    }
+
+    static int8_t hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    static inline uint8_t fieldStart(const NMEAFields& fields, uint8_t index) {
+        if (index == 0) return 1;            // Skip '$'
+        if (index > fields.count) index = fields.count;
+        return fields.delim[index - 1] + 1;
+    }
+
+    static bool sameFields(const NMEAFields& a, const NMEAFields& b) {
+        return a.count == b.count && a.star == b.star && a.end == b.end &&
+               a.checksum == b.checksum && a.checksumValid == b.checksumValid &&
+               memcmp(a.delim, b.delim, a.count) == 0;
+    }
+
+    // The pre-kernel parse: copy, strtok, atoi per field, byte checksum
+    static int32_t strtokPath(const char* sentence) {
+        char buffer[128];
+        strncpy(buffer, sentence, sizeof(buffer) - 1);
+        buffer[sizeof(buffer) - 1] = '\0';
+
+        uint8_t sum = 0;
+        const char* p = sentence + 1;
+        while (*p && *p != '*') sum ^= (uint8_t)*p++;
+
+        int32_t total = sum;
+        char* token = strtok(buffer, ",");
+        while ((token = strtok(NULL, ",*")) != NULL) {
+            total += atoi(token);
+        }
+        return total;
+    }
+
+    static char fuzzChar() {
+        static const char alphabet[] = ",,,**\r\n0123456789.-+AZ$ ";
+        return alphabet[esp_random() % (sizeof(alphabet) - 1)];
+    }
+
+    static const char* const* samples() {
+        static const char* const lines[] = {
+            "$GPGSV,3,1,12,01,45,123,40,02,12,045,35,05,67,270,42,07,,,28*40\r",
+            "$GLGSV,2,1,07,65,32,045,38,66,71,310,41,72,,,,81,12,140,30*51\r",
+            "$GNGSA,A,3,01,02,05,07,09,13,,,,,,,1.85,0.98,1.57,1*05\r",
+            "$GNGSA,A,3,65,66,81,,,,,,,,,,1.85,0.98,1.57,2*06\r",
+            "$GNRMC,123519.00,A,4807.038,N,01131.000,E,0.02,,230394,,,A*5C\r",
+            "$GNGGA,123519.00,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*77\r"
+        };
+        return lines;
+    }
+
+    static uint8_t sampleCount() {
+        return 6;
+    }
+
+    static NMEAScanBench& bench() {
+        static NMEAScanBench results = {};
+        return results;
+    }
+};
+
+#endif // NMEA_SCAN_H
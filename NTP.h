@@ -9,18 +9,25 @@
  * Features:
  * - RFC 5905 compliant NTP v4 server
  * - Stratum 1 GPS-disciplined time source
- * - Per-client and global rate limiting
+ * - Per-client and global rate limiting (global limit self-calibrating)
  * - Kiss-o'-Death packet support
  * - Broadcast mode for local network
  * - Comprehensive packet validation
  * - Extended metrics and diagnostics
  * - Client poll interval tracking
  * - Root delay/dispersion based on GPS quality
- * - Microsecond timestamp precision
+ * - Microsecond timestamp precision on a 64-bit timebase (no micros() wrap)
+ * - Extension field aware request parsing (RFC 7822)
+ * - Symmetric peering (modes 1/2) with stratum 2 holdover from a peer
+ * - ntpd-style restrict lists (ignore, noserve, limited, kod) via ACL.h
+ * - Optional per-request telemetry export to a UDP collector
+ * - Request pipeline specialized at compile time per feature set
+ * - Response statistics folded off the hot path via a lock-free ring
+ * - Crystal frequency correction from a persisted drift estimate
  * 
  * Compatible with: GPS.h library, ESP32, Arduino framework
  * 
- * Dependencies: GPS.h, EthernetUdp.h
+ * Dependencies: GPS.h, EthernetUdp.h, NTPSocket.h
  * 
  * Author: Matthew R. Christensen
  * Version: 1.0
@@ -32,8 +39,20 @@
 #define NTP_H
 
 #include <Arduino.h>
+#include <new>
 #include "GPS.h"
+#include "NTPTimeSeries.h"
+#include "NTPCapture.h"
+#include "NTPTelemetry.h"
+#include "NTPStatsRing.h"
+#include "ClockDrift.h"
+#include "NTPExtensions.h"
+#include "NTPPeer.h"
+#include "ACL.h"
+#include "Timebase.h"
+#include "NTPSocket.h"
 
+#include <Ethernet.h>
 #include <EthernetUdp.h>
 
 // ============================================================================
@@ -54,9 +73,45 @@
 #define NTP_CLIENT_TIMEOUT 3600000           // Client entry timeout (1 hour)
 #define NTP_BROADCAST_MIN_INTERVAL 10        // Minimum broadcast interval (seconds)
 
+// Capacity Calibration (adaptive global limit)
+#define NTP_CAPACITY_WINDOW_MS 1000          // Calibration window
+#define NTP_CAPACITY_EWMA_WEIGHT 0.0625f     // Weight of newest loop/cost sample
+#define NTP_CAPACITY_HEADROOM_PERCENT 70     // Limit = this share of measured capacity
+#define NTP_CAPACITY_MIN_RPS 50              // Adaptive limit floor
+#define NTP_CAPACITY_HYSTERESIS_PERCENT 10   // Ignore smaller target changes
+#define NTP_CAPACITY_STEP_UP_PERCENT 10      // Max raise per window (lowering is immediate)
+
+// Off-Path Statistics
+#define NTP_STATS_FOLD_BATCH 8               // Records folded on a busy pass
+
+// Admission Control (reputation under overload)
+#define NTP_ADMISSION_RESERVE_PERCENT 25     // Global budget kept for trusted clients
+#define NTP_REPUTATION_TRUSTED 64            // Score admitted from the reserve
+#define NTP_REPUTATION_GAIN 8                // Per well-spaced request
+#define NTP_REPUTATION_PENALTY 64            // Per too-frequent request
+
+// Duplicate / Replay Detection
+#define NTP_DUPLICATE_WINDOW_MS 5000         // Same transmit timestamp within this = retransmit
+#define NTP_DUPLICATE_FREE_ANSWERS 2         // Retransmits answered per reply before the limiter is charged
+
+// Passive Client Offset Estimation
+#define NTP_OFFSET_EWMA_WEIGHT 0.25f         // Weight of newest sample
+#define NTP_OFFSET_RESTART_US 128000.0f      // Restart average on larger jumps
+#define NTP_OFFSET_MAX_DELAY_US 10000000     // Discard samples above 10 s delay
+
+// Latency Histogram
+#define NTP_LATENCY_BUCKETS 12               // Receive->transmit buckets (32us << n)
+#define NTP_LATENCY_BUCKET_BASE 32           // Upper bound of first bucket (us)
+
+// Request Pipeline Features (one specialization per combination)
+#define NTP_PIPE_RATE_LIMIT 0x01             // Per-client rate limiting
+#define NTP_PIPE_ACL 0x02                    // Restrict list with rules
+#define NTP_PIPE_RECORD 0x04                 // Capture ring or telemetry export
+#define NTP_PIPE_VARIANTS 8
+
 // Quality Thresholds
 #define NTP_MIN_SATELLITES 4                 // Minimum satellites to serve
-#define NTP_MAX_HDOP 10.0                    // Maximum HDOP to serve
+#define NTP_MAX_HDOP_X100 1000               // Maximum HDOP to serve (x100)
 #define NTP_MAX_FIX_AGE 5000                 // Maximum GPS fix age (ms)
 
 // ============================================================================
@@ -74,7 +129,8 @@ struct NTPConfig {
     // Rate Limiting
     bool rateLimitEnabled;                   // Enable per-client rate limiting
     uint32_t perClientMinInterval;           // Min ms between client requests
-    uint32_t globalMaxRequestsPerSec;        // Max requests/sec globally
+    uint32_t globalMaxRequestsPerSec;        // Max requests/sec globally (ceiling when adaptive)
+    bool adaptiveCapacity;                   // Calibrate global limit from measured headroom
     uint16_t maxClients;                     // Maximum tracked clients
     
     // Broadcast Mode
@@ -82,14 +138,21 @@ struct NTPConfig {
     uint16_t broadcastInterval;              // Broadcast interval (seconds)
     bool autoBroadcast;                      // Auto-broadcast in process()
     
+    // Duplicate Handling
+    bool answerDuplicates;                   // Resend cached reply (false = drop)
+    
     // Server Identity
     uint8_t stratum;                         // NTP stratum (normally 1)
     char referenceID[5];                     // Reference ID (e.g., "GPS")
     
     // Quality Thresholds
     uint8_t minSatellites;                   // Min satellites to respond
-    float maxHDOP;                           // Max HDOP to respond
+    uint16_t maxHDOPX100;                    // Max HDOP to respond (x100)
     uint32_t maxFixAge;                      // Max GPS fix age to respond (ms)
+    
+    // Symmetric Peering (holdover from a peer unit)
+    bool peeringEnabled;                     // Exchange mode 1/2 packets with peers
+    uint32_t peerIPs[NTP_MAX_PEERS];         // Peer IPv4 addresses (0 = unused)
 };
 
 /**
@@ -106,6 +169,27 @@ struct NTPClient {
     bool aggressive;                         // Flagged as aggressive
     bool rateLimited;                        // Currently rate limited
     uint8_t version;                         // NTP version used
+    
+    // Reputation for admission under overload (0 = unknown)
+    uint8_t reputation;                      // Rises with well-spaced polls, falls when too frequent
+    uint32_t reputationMillis;               // Last reputation update
+    
+    // Passive offset estimation (client clock minus server clock)
+    uint64_t lastClientXmt;                  // T1 of previous request
+    uint64_t lastServerRx;                   // T2 of previous request
+    uint64_t lastServerTx;                   // T3 of previous response
+    float offsetMicros;                      // Averaged offset
+    float delayMicros;                       // Averaged round-trip delay
+    float jitterMicros;                      // Averaged |sample - average|
+    float lastOffsetMicros;                  // Most recent offset sample
+    uint16_t offsetSamples;                  // Samples in the average
+    
+    // Duplicate detection (last answered request)
+    uint32_t lastResponseMillis;             // When the cached response was sent
+    bool responseCached;                     // cachedResponse holds a reply to lastClientXmt
+    uint8_t cachedResponse[NTP_PACKET_SIZE]; // Reply to resend for retransmits
+    uint16_t duplicates;                     // Retransmits seen from this client
+    uint8_t freeRetransmits;                 // Retransmits of the last reply answered uncharged
 };
 
 /**
@@ -120,8 +204,24 @@ struct NTPMetrics {
     uint32_t rateLimitedRequests;            // Rate limited (dropped)
     uint32_t kodSent;                        // Kiss-o'-Death packets sent
     uint32_t noGPSDropped;                   // Dropped due to no GPS fix
+    uint32_t aclIgnored;                     // Dropped by 'ignore' / 'noserve'
+    uint32_t aclDenied;                      // DENY KoD sent by 'noserve kod'
+    uint32_t admissionShed;                  // Overload: untrusted source shed
+    uint32_t reserveAdmitted;                // Overload: trusted client admitted from reserve
+    
+    // Duplicates and Replays
+    uint32_t duplicateRequests;              // Retransmits of an answered request
+    uint32_t duplicatesAnswered;             // ...answered from the response cache
+    uint32_t duplicatesCharged;              // ...past the free allowance, rate limited normally
+    uint32_t replayedRequests;               // Old transmit timestamp seen again later
+    uint32_t bogusOrigin;                    // Origin not matching our last transmit
     uint32_t poorQualityDropped;             // Dropped due to poor GPS quality
     
+    // Extension Fields (RFC 7822)
+    uint32_t extensionRequests;              // Requests longer than the header
+    uint32_t malformedExtensions;            // Dropped: bad extension field
+    uint32_t extensionFieldCounts[EF_COUNTERS]; // Fields seen, by type
+    
     // Broadcast
     uint32_t broadcastsSent;                 // Broadcast packets sent
     
@@ -130,8 +230,13 @@ struct NTPMetrics {
     uint32_t peakResponseTime;               // Peak response time (ms)
     uint32_t lastRequestTime;                // Last request timestamp
     
+    // Receive->Transmit Latency
+    uint32_t latencyHistogram[NTP_LATENCY_BUCKETS]; // Count per bucket (last = overflow)
+    uint32_t peakLatencyMicros;              // Peak receive->transmit (us)
+    
     // Client Statistics
     uint32_t uniqueClients;                  // Count of unique clients
+    uint32_t lastClientIP;                   // Last client served (IPv4)
     uint8_t clientVersions[5];               // Count by version (v1-v4, other)
     uint32_t requestsByStratum[17];          // Requests by client stratum
     
@@ -141,6 +246,38 @@ struct NTPMetrics {
     uint32_t lastServingStopTime;            // When we last stopped serving
 };
 
+/**
+ * Request Pipeline Statistics (one per specialization)
+ */
+struct NTPPipelineStats {
+    uint32_t packets;                        // Requests handled by this variant
+    uint64_t totalMicros;                    // Sum of receive -> pipeline exit
+    uint32_t peakMicros;                     // Slowest request
+};
+
+/**
+ * Capacity Calibration State
+ * One request is handled per loop pass, so the sustainable rate is one
+ * request per loop period (including the idle delay, excluding light
+ * sleep, which only happens with no packet waiting) measured while
+ * requests are being served
+ */
+struct NTPCapacity {
+    float costMicros;                        // Average service cost per request
+    float periodMicros;                      // Average loop period per request (sleep excluded)
+    uint32_t measuredRps;                    // Sustainable rate (1e6 / period)
+    uint32_t servedRps;                      // Requests handled last window
+    uint32_t limitRps;                       // Current global admission limit
+    uint32_t adjustments;                    // Limit changes
+    
+    // Window accumulators
+    uint32_t windowStart;                    // millis() at window start
+    uint32_t windowRequests;
+    uint64_t windowServiceMicros;
+    uint16_t loopRequests;                   // Requests handled since the last recordLoopPeriod()
+    bool requestLastPass;                    // Previous pass handled a request
+};
+
 /**
  * Global Rate Limiting
  * Protect against DDoS attacks
@@ -178,6 +315,12 @@ public:
      */
     void begin(GPS& gps, EthernetUDP& udp, const NTPConfig& config);
     
+    /**
+     * Initialize on a pipelined socket
+     * Sends reserve a free socket before the transmit timestamp is taken
+     */
+    void begin(GPS& gps, NTPSocket& udp, const NTPConfig& config);
+    
     /**
      * Initialize with default configuration
      */
@@ -201,6 +344,12 @@ public:
      */
     void updateConfig(const NTPConfig& config);
     
+    /**
+     * Get current configuration
+     * @return Reference to configuration
+     */
+    const NTPConfig& getConfig() const { return config; }
+    
     /**
      * Update rate limit settings
      * @param perClientMs Minimum ms between requests per client
@@ -214,12 +363,167 @@ public:
      */
     const NTPMetrics& getMetrics() const { return metrics; }
     
+    /**
+     * Get root delay and dispersion as currently advertised
+     * @param rootDelay Output (seconds)
+     * @param rootDispersion Output (seconds)
+     */
+    void getRootDelayDispersion(float& rootDelay, float& rootDispersion) const {
+        calculateRootDelayDispersion(rootDelay, rootDispersion);
+    }
+    
+    /**
+     * Get response statistics queue (depth, drops)
+     */
+    const NTPStatsRing& getStatsRing() const { return statsRing; }
+    
+    /**
+     * Get capacity calibration state (measured capacity and current limit)
+     */
+    const NTPCapacity& getCapacity() const { return capacity; }
+    
+    /**
+     * Report the period of one main loop pass, light sleep excluded
+     * Includes the mandatory idle (delay(1)), which bounds the request
+     * rate as much as processing does. Capacity is calibrated from passes
+     * that handled requests; without these reports the adaptive limit
+     * stays at the configured ceiling
+     * @param periodMicros Loop start to loop end, minus time in light sleep
+     */
+    void recordLoopPeriod(uint32_t periodMicros);
+    
+    /**
+     * Get per-second / per-minute traffic time series
+     * @return Reference to time series
+     */
+    const NTPTimeSeries& getTimeSeries() const { return timeSeries; }
+    
+    /**
+     * Get tracked client table
+     * @return Array of getClientCount() entries
+     */
+    const NTPClient* getClients() const { return clients; }
+    
+    /**
+     * Get number of tracked clients
+     */
+    int getClientCount() const { return clientCount; }
+    
+    /**
+     * Enable or disable packet capture
+     * The capture ring is allocated on enable and freed on disable
+     * @param enabled Capture state
+     * @return True if capture is now in the requested state
+     */
+    bool setCaptureEnabled(bool enabled);
+    
+    /**
+     * Get packet capture ring
+     * @return Capture ring or nullptr when capture is disabled
+     */
+    const NTPCapture* getCapture() const { return capture; }
+    
+    /**
+     * Get wall-clock anchor for exporting captured timebase stamps
+     * @param clock Output anchor (nowUnix 0 if GPS time unknown)
+     */
+    void getCaptureClock(NTPCaptureClock& clock) const;
+    
+    /**
+     * Get UDP port the server listens on
+     */
+    uint16_t getPort() const { return config.port; }
+    
+    /**
+     * Get receive->transmit latency percentile from a histogram
+     * @param histogram Bucket counts (NTPMetrics::latencyHistogram or a delta)
+     * @param percentile Percentile (1-100)
+     * @return Upper bound of the bucket holding the percentile (us), 0 if empty
+     */
+    static uint32_t getLatencyPercentile(const uint32_t* histogram, uint8_t percentile);
+    
+    /**
+     * Get upper bound of a latency histogram bucket
+     * @param bucket Bucket index
+     * @return Upper bound (us); UINT32_MAX for the overflow bucket
+     */
+    static uint32_t getLatencyBucketBound(uint8_t bucket);
+    
+    /**
+     * Add local clock error to reported root dispersion
+     * Used by the power manager to account for time kept across light sleep
+     * @param seconds Additional dispersion (seconds)
+     */
+    void setExtraDispersion(float seconds) { extraDispersion = seconds; }
+    
+    /**
+     * Set access control list
+     * Without one, every client is rate limited with KoD (ACL_DEFAULT_FLAGS)
+     * @param acl Compiled restrict list (must outlive the server), or nullptr
+     */
+    void setAccessControl(const AccessControl* acl) { accessControl = acl; selectPipeline(); }
+    
+    /**
+     * Set per-request telemetry exporter
+     * Records are queued on the packet path and shipped from process()
+     * @param exporter Running exporter (must outlive the server), or nullptr
+     */
+    void setTelemetry(NTPTelemetry* exporter) { telemetry = exporter; selectPipeline(); }
+    
+    /**
+     * Set crystal frequency estimator
+     * Fed with each GPS anchor from process(); its estimate corrects the
+     * Timebase time extrapolated from the anchor
+     * @param estimator Estimator (must outlive the server), or nullptr
+     */
+    void setDrift(ClockDrift* estimator) { drift = estimator; }
+    
+    /**
+     * Get active request pipeline specialization
+     * @return Feature mask (NTP_PIPE_*) of the running variant
+     */
+    uint8_t getPipelineVariant() const { return pipelineVariant; }
+    
+    /**
+     * Get cost statistics for one pipeline specialization
+     * @param variant Feature mask (0 to NTP_PIPE_VARIANTS - 1)
+     */
+    const NTPPipelineStats& getPipelineStats(uint8_t variant) const { return pipelineStats[variant]; }
+    
+    /**
+     * Get feature names of a pipeline specialization (e.g. "ratelimit+acl")
+     */
+    static String pipelineFeatureString(uint8_t variant);
+    
     /**
      * Check if NTP server is currently serving
-     * @return True if GPS quality is sufficient to serve NTP
+     * @return True if GPS quality is sufficient or a peer is followed
      */
     bool isServing() const;
     
+    /**
+     * Get peer associations
+     * @return Array of NTP_MAX_PEERS entries (ip 0 = unused)
+     */
+    const NTPPeer* getPeers() const { return peers; }
+    
+    /**
+     * Get selected peer
+     * @return Index into getPeers(), -1 if none
+     */
+    int8_t getSystemPeer() const { return sysPeer; }
+    
+    /**
+     * Get holdover discipline state
+     * @return Holdover state (active while serving from a peer)
+     */
+    const NTPHoldover& getHoldover() const { return holdover; }
+    
+    /**
+     * Check if time is currently taken from a peer instead of GPS
+     */
+    bool isFollowingPeer() const { return holdover.active; }
+    
     /**
      * Get human-readable status string
      * @return Status description
@@ -256,17 +560,46 @@ private:
     
     GPS* gpsRef;                             // GPS instance reference
     EthernetUDP* udpRef;                     // UDP socket reference
+    NTPSocket* socketRef = nullptr;          // Same socket when pipelined (NTPSocket)
     NTPConfig config;                        // Current configuration
     
     NTPMetrics metrics;                      // Server metrics
+    NTPTimeSeries timeSeries;                // Traffic history (fixed memory)
     GlobalRateLimit globalRateLimit;         // Global rate limiter
     
     NTPClient* clients;                      // Dynamic client array
     int clientCount;                         // Current client count
     
-    byte packetBuffer[NTP_PACKET_SIZE];      // Packet buffer
+    byte packetBuffer[NTP_MAX_PACKET_SIZE];  // Request buffer (header + extensions)
+    byte responseBuffer[NTP_MAX_PACKET_SIZE]; // Response buffer (keeps request intact)
+    uint16_t requestLength = 0;              // Length of request in packetBuffer
+    uint16_t responseLength = 0;             // Length of reply in responseBuffer
+    NTPCapture* capture = nullptr;           // Optional capture ring
     uint32_t lastBroadcast;                  // Last broadcast time
     uint32_t lastCleanup;                    // Last cleanup time
+    float extraDispersion = 0;               // Local clock error (seconds)
+    const AccessControl* accessControl = nullptr; // Restrict list (optional)
+    NTPTelemetry* telemetry = nullptr;       // Per-request export (optional)
+    ClockDrift* drift = nullptr;             // Crystal frequency estimate (optional)
+    uint64_t lastDriftAnchor = 0;            // Anchor last fed to the estimator
+    
+    // Request pipeline specialized for the active features
+    typedef void (NTP::*RequestPipeline)(IPAddress, int, uint64_t);
+    RequestPipeline requestPipeline = nullptr;
+    uint8_t pipelineVariant = 0;
+    NTPPipelineStats pipelineStats[NTP_PIPE_VARIANTS] = {};
+    
+    NTPCapacity capacity = {};                // Adaptive global limit
+    
+    // Response statistics, folded into metrics off the hot path
+    NTPStatsRing statsRing;
+    uint32_t admittedInterval = NTP_STATS_NO_INTERVAL; // Set by the per-client limiter
+    bool retransmit = false;                 // Request repeats the last answered one
+    bool retransmitFree = false;             // ...and is within the free allowance
+    
+    NTPPeer peers[NTP_MAX_PEERS];            // Peer associations
+    int8_t sysPeer = -1;                     // Selected peer (-1 = none)
+    NTPHoldover holdover;                    // Local clock correction from peer
     
     void (*logCallback)(String) = nullptr;   // Optional logging
     
@@ -276,32 +609,71 @@ private:
     
     // Request Handling
     void handleNTPRequests();
+    template <uint8_t Features>
+    void processRequest(IPAddress clientIP, int clientPort, uint64_t receiveTimeMicros);
+    void selectPipeline();
+    void calibrateCapacity();
+    void foldStats(uint16_t maxRecords);
     bool validateNTPRequest(const byte* packet);
     void sendNTPResponse(IPAddress clientIP, int port, const byte* request, 
-                        uint32_t receiveTimeMicros);
+                        uint64_t receiveTimeMicros);
     void buildNTPPacket(byte* packet, const byte* request, 
-                       uint32_t receiveTimeMicros, uint32_t transmitTimeMicros);
+                       uint64_t receiveTimeMicros, uint64_t transmitTimeMicros);
+    
+    /**
+     * Wait for a free socket before a transmit timestamp is taken
+     * A pipelined send can otherwise block in beginPacket() behind the
+     * previous SEND (up to an ARP timeout) after T3 was stamped
+     */
+    void acquireSocket() { if (socketRef) socketRef->acquire(); }
+    
+    // Extension Fields
+    bool parseExtensionFields();
+    uint16_t appendEchoedFields(byte* response);
     
     // Kiss-o'-Death
     void sendKissOfDeath(IPAddress clientIP, int port, const char* kissCode);
     
+    // Symmetric Peering
+    void initPeers();
+    void processPeers();
+    void sendPeerPacket(NTPPeer& peer);
+    void handlePeerPacket(IPAddress peerIP, uint64_t receiveTimeMicros);
+    void disciplineHoldover(NTPPeer& peer, int64_t offsetMicros);
+    
+    // Capture and telemetry
+    void recordExchange(IPAddress clientIP, int port, uint64_t rxMicros,
+                        NTPCaptureVerdict verdict, const char* kod);
+    template <uint8_t Features>
+    void recordExchangeIf(IPAddress clientIP, int port, uint64_t rxMicros,
+                          NTPCaptureVerdict verdict, const char* kod);
+    
     // Rate Limiting
-    bool checkGlobalRateLimit();
+    bool checkGlobalRateLimit(IPAddress clientIP);
     bool checkClientRateLimit(IPAddress clientIP, uint8_t pollInterval);
+    NTPClient* findClient(IPAddress clientIP);
     NTPClient* findOrCreateClient(IPAddress clientIP);
-    void updateClientStats(NTPClient* client, uint8_t pollInterval);
+    void initClient(NTPClient* client, IPAddress clientIP);
+    void updateClientOffset(NTPClient* client);
+    template <uint8_t Features>
+    bool handleDuplicateRequest(IPAddress clientIP, int port, uint64_t receiveTimeMicros);
+    void cacheClientResponse(NTPClient* client);
+    void updateClientStats(NTPClient* client, uint8_t pollInterval, uint32_t intervalMillis);
+    void updateReputation(NTPClient* client, uint32_t now);
     
     // GPS Quality Checks
     bool isGPSQualitySufficient() const;
+    bool hasTimeSource() const;
     void calculateRootDelayDispersion(float& rootDelay, float& rootDispersion) const;
     
     // Timestamp Conversion
     NTPTimestamp gpsTimeToNTP() const;
-    NTPTimestamp microsToNTP(uint32_t micros) const;
-    uint32_t getCurrentMicros() const;
+    NTPTimestamp microsToNTP(uint64_t timebaseMicros) const;
     
     // Packet Building Helpers
     void writeNTPTimestamp(byte* packet, int offset, const NTPTimestamp& ts);
+    static uint64_t readNTPTimestamp64(const byte* packet, int offset);
+    static uint64_t toNTP64(const NTPTimestamp& ts);
     uint8_t extractPollInterval(const byte* packet);
     uint8_t extractVersion(const byte* packet);
     uint8_t extractStratum(const byte* packet);
@@ -323,19 +695,27 @@ NTPConfig NTP::getDefaultConfig() {
     config.rateLimitEnabled = true;
     config.perClientMinInterval = NTP_DEFAULT_CLIENT_INTERVAL;
     config.globalMaxRequestsPerSec = NTP_DEFAULT_GLOBAL_RATE;
+    config.adaptiveCapacity = true;
     config.maxClients = NTP_DEFAULT_MAX_CLIENTS;
     
     config.broadcastEnabled = false;
     config.broadcastInterval = 64;
     config.autoBroadcast = true;
     
+    config.answerDuplicates = true;
+    
     config.stratum = 1;
     strcpy(config.referenceID, "GPS");
     
     config.minSatellites = NTP_MIN_SATELLITES;
-    config.maxHDOP = NTP_MAX_HDOP;
+    config.maxHDOPX100 = NTP_MAX_HDOP_X100;
     config.maxFixAge = NTP_MAX_FIX_AGE;
     
+    config.peeringEnabled = false;
+    for (uint8_t i = 0; i < NTP_MAX_PEERS; i++) {
+        config.peerIPs[i] = 0;
+    }
+    
     return config;
 }
 
@@ -352,6 +732,18 @@ void NTP::begin(GPS& gps, EthernetUDP& udp, const NTPConfig& cfg) {
     
     // Initialize metrics
     memset(&metrics, 0, sizeof(NTPMetrics));
+    timeSeries.begin();
+    
+    // Initialize peer associations
+    initPeers();
+    
+    // Pick the request pipeline for the configured features
+    selectPipeline();
+    
+    // Start at the configured ceiling until the first calibration
+    memset(&capacity, 0, sizeof(capacity));
+    capacity.limitRps = config.globalMaxRequestsPerSec;
+    capacity.windowStart = millis();
     
     // Initialize global rate limiter
     globalRateLimit.requestsThisSecond = 0;
@@ -373,6 +765,11 @@ void NTP::begin(GPS& gps, EthernetUDP& udp, const NTPConfig& cfg) {
         ", Reference ID: " + String(config.referenceID));
 }
 
+void NTP::begin(GPS& gps, NTPSocket& udp, const NTPConfig& cfg) {
+    socketRef = &udp;
+    begin(gps, static_cast<EthernetUDP&>(udp), cfg);
+}
+
 void NTP::begin(GPS& gps, EthernetUDP& udp) {
     begin(gps, udp, getDefaultConfig());
 }
@@ -380,9 +777,41 @@ void NTP::begin(GPS& gps, EthernetUDP& udp) {
 void NTP::process() {
     if (!config.enabled) return;
     
+    capacity.requestLastPass = false;
+    
     // Handle incoming NTP requests
     handleNTPRequests();
     
+    // Fold queued response statistics: everything on an idle pass, a small
+    // batch on a busy one only once the ring is half full
+    if (!capacity.requestLastPass) {
+        foldStats(NTP_STATS_RING_SIZE);
+    } else if (statsRing.depth() >= NTP_STATS_RING_SIZE / 2) {
+        foldStats(NTP_STATS_FOLD_BATCH);
+    }
+    calibrateCapacity();
+    timeSeries.tick();
+    
+    // Feed each new GPS anchor to the frequency estimator
+    if (drift) {
+        const GPSData& gpsData = gpsRef->getData();
+        if (gpsData.timeAnchorMicros != lastDriftAnchor && isGPSQualitySufficient()) {
+            lastDriftAnchor = gpsData.timeAnchorMicros;
+            uint64_t gpsMicros = (uint64_t)gpsData.unixTime * 1000000ULL + gpsData.centisecond * 10000ULL;
+            drift->update(gpsMicros, gpsData.timeAnchorMicros, millis());
+        }
+    }
+    
+    // Symmetric peering and holdover
+    processPeers();
+    
+    // Ship queued telemetry (one datagram per pass)
+    if (telemetry && telemetry->shouldShip(millis())) {
+        NTPCaptureClock clock;
+        getCaptureClock(clock);
+        telemetry->ship(clock);
+    }
+    
     // Auto-broadcast if enabled
     if (config.broadcastEnabled && config.autoBroadcast) {
         if (millis() - lastBroadcast > (config.broadcastInterval * 1000)) {
@@ -403,50 +832,144 @@ void NTP::process() {
 void NTP::handleNTPRequests() {
     int packetSize = udpRef->parsePacket();
     
-    if (packetSize != NTP_PACKET_SIZE) {
+    // Header plus optional extension fields; anything else is not NTP
+    if (packetSize < NTP_PACKET_SIZE || packetSize > NTP_MAX_PACKET_SIZE) {
         if (packetSize > 0) {
             metrics.invalidRequests++;
+            timeSeries.record(SERIES_REQUESTS);
+            timeSeries.record(SERIES_DROPS);
         }
         return;
     }
+    timeSeries.record(SERIES_REQUESTS);
     
     // CRITICAL: Capture receive time immediately for accuracy
-    uint32_t receiveTimeMicros = micros();
+    uint64_t receiveTimeMicros = Timebase::micros64();
     
     IPAddress clientIP = udpRef->remoteIP();
     int clientPort = udpRef->remotePort();
     
     // Read packet
-    udpRef->read(packetBuffer, NTP_PACKET_SIZE);
+    int bytesRead = udpRef->read(packetBuffer, packetSize);
+    requestLength = bytesRead > 0 ? bytesRead : 0;
+    
+    // Run the pipeline specialized for the active feature set
+    (this->*requestPipeline)(clientIP, clientPort, receiveTimeMicros);
+    
+    // Per-variant cost: receive -> pipeline exit
+    NTPPipelineStats& stats = pipelineStats[pipelineVariant];
+    uint32_t elapsed = (uint32_t)(Timebase::micros64() - receiveTimeMicros);
+    stats.packets++;
+    stats.totalMicros += elapsed;
+    if (elapsed > stats.peakMicros) {
+        stats.peakMicros = elapsed;
+    }
     
-    // Check global rate limit first (DDoS protection)
-    if (!checkGlobalRateLimit()) {
+    capacity.windowRequests++;
+    capacity.windowServiceMicros += elapsed;
+    capacity.requestLastPass = true;
+    if (capacity.loopRequests < UINT16_MAX) capacity.loopRequests++;
+}
+
+void NTP::recordLoopPeriod(uint32_t periodMicros) {
+    // Only passes that handled a request show what a loaded loop costs.
+    // The idle delay counts (the next packet waits for it); light sleep
+    // does not (entered only with no packet waiting)
+    if (capacity.loopRequests > 0) {
+        float period = (float)periodMicros / capacity.loopRequests;
+        if (capacity.periodMicros == 0) {
+            capacity.periodMicros = period;
+        } else {
+            capacity.periodMicros += NTP_CAPACITY_EWMA_WEIGHT * (period - capacity.periodMicros);
+        }
+    }
+    capacity.loopRequests = 0;
+}
+
+template <uint8_t Features>
+void NTP::processRequest(IPAddress clientIP, int clientPort, uint64_t receiveTimeMicros) {
+    // Without an ACL every source gets the defaults; the constant folds the
+    // ignore/noserve branches away
+    uint8_t restrictFlags = (Features & NTP_PIPE_ACL) ? accessControl->lookup(clientIP) : ACL_DEFAULT_FLAGS;
+    
+    // Restrict: ignore drops everything from this source, before it can
+    // use up the global budget
+    if (restrictFlags & ACL_IGNORE) {
+        metrics.aclIgnored++;
+        timeSeries.record(SERIES_DROPS);
+        recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
+        return;
+    }
+    
+    // Global rate limit (DDoS protection, reputation-aware)
+    if (!checkGlobalRateLimit(clientIP)) {
         metrics.rateLimitedRequests++;
         globalRateLimit.droppedThisSecond++;
+        timeSeries.record(SERIES_DROPS);
+        recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
+        return;
+    }
+    
+    // Symmetric active/passive packets go to the peer association
+    uint8_t mode = packetBuffer[0] & 0x07;
+    if ((mode == 1 || mode == 2) && requestLength >= NTP_PACKET_SIZE) {
+        handlePeerPacket(clientIP, receiveTimeMicros);
         return;
     }
     
-    // Validate packet format
-    if (!validateNTPRequest(packetBuffer)) {
+    // Validate packet format and any extension fields
+    if (!validateNTPRequest(packetBuffer) || !parseExtensionFields()) {
         metrics.invalidRequests++;
+        timeSeries.record(SERIES_DROPS);
+        recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
         return;
     }
     
-    // Check GPS quality
-    if (!isGPSQualitySufficient()) {
+    // Restrict: noserve drops time requests, or denies them with 'kod'
+    if (restrictFlags & ACL_NOSERVE) {
+        if (restrictFlags & ACL_KOD) {
+            metrics.aclDenied++;
+            sendKissOfDeath(clientIP, clientPort, "DENY");
+            recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::KOD, "DENY");
+        } else {
+            metrics.aclIgnored++;
+            timeSeries.record(SERIES_DROPS);
+            recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
+        }
+        return;
+    }
+    
+    // Retransmits of an answered request skip rate limiting
+    retransmit = false;
+    retransmitFree = false;
+    if (handleDuplicateRequest<Features>(clientIP, clientPort, receiveTimeMicros)) {
+        return;
+    }
+    
+    // Check GPS quality (or a peer to follow)
+    if (!hasTimeSource()) {
         metrics.noGPSDropped++;
         // Send Kiss-o'-Death to inform client
         sendKissOfDeath(clientIP, clientPort, "DENY");
+        recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::KOD, "DENY");
         return;
     }
     
     // Extract poll interval for rate limiting
     uint8_t pollInterval = extractPollInterval(packetBuffer);
     
-    // Check per-client rate limit
-    if (config.rateLimitEnabled && !checkClientRateLimit(clientIP, pollInterval)) {
+    // Check per-client rate limit ('limited' sources only; KoD with 'kod')
+    admittedInterval = NTP_STATS_NO_INTERVAL;
+    if ((Features & NTP_PIPE_RATE_LIMIT) && (restrictFlags & ACL_LIMITED) && !retransmitFree &&
+        !checkClientRateLimit(clientIP, pollInterval)) {
         metrics.rateLimitedRequests++;
-        sendKissOfDeath(clientIP, clientPort, "RATE");
+        if (restrictFlags & ACL_KOD) {
+            sendKissOfDeath(clientIP, clientPort, "RATE");
+            recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::KOD, "RATE");
+        } else {
+            timeSeries.record(SERIES_DROPS);
+            recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
+        }
         return;
     }
     
@@ -454,38 +977,87 @@ void NTP::handleNTPRequests() {
     uint32_t requestStart = millis();
     
     // Send NTP response
-    uint32_t transmitTimeMicros = micros();
     sendNTPResponse(clientIP, clientPort, packetBuffer, receiveTimeMicros);
     
-    // Update metrics
+    uint32_t latencyMicros = (uint32_t)(Timebase::micros64() - receiveTimeMicros);
+    
+    // Counters read by the loop right after process() stay inline
     metrics.totalRequests++;
     metrics.validResponses++;
     metrics.lastRequestTime = millis();
+    timeSeries.record(SERIES_RESPONSES);
+    recordExchangeIf<Features>(clientIP, clientPort, receiveTimeMicros, NTPCaptureVerdict::RESPONDED, nullptr);
     
-    uint32_t responseTime = millis() - requestStart;
-    if (responseTime > metrics.peakResponseTime) {
-        metrics.peakResponseTime = responseTime;
+    // Passive client offset estimate from the previous exchange
+    NTPClient* client = findOrCreateClient(clientIP);
+    if (client) {
+        if (!(Features & NTP_PIPE_RATE_LIMIT) || !(restrictFlags & ACL_LIMITED)) {
+            client->lastRequest = millis();   // Otherwise set by the rate limiter
+        }
+        updateReputation(client, millis());
+        updateClientOffset(client);
+        cacheClientResponse(client);
     }
-    
-    if (metrics.averageResponseTime == 0) {
-        metrics.averageResponseTime = responseTime;
-    } else {
-        metrics.averageResponseTime = (metrics.averageResponseTime * 0.9) + (responseTime * 0.1);
+    metrics.lastClientIP = (uint32_t)clientIP;
+    
+    // Everything else is folded later (foldStats)
+    NTPStatsRecord record;
+    record.clientIP = (uint32_t)clientIP;
+    record.latencyMicros = latencyMicros;
+    record.serviceMillis = millis() - requestStart;
+    record.intervalMillis = admittedInterval;
+    record.version = extractVersion(packetBuffer);
+    record.stratum = extractStratum(packetBuffer);
+    record.pollInterval = pollInterval;
+    record.reserved = 0;
+    statsRing.push(record);
+}
+
+template <uint8_t Features>
+inline void NTP::recordExchangeIf(IPAddress clientIP, int port, uint64_t rxMicros,
+                                  NTPCaptureVerdict verdict, const char* kod) {
+    if (Features & NTP_PIPE_RECORD) {
+        recordExchange(clientIP, port, rxMicros, verdict, kod);
     }
-    
-    // Update client version statistics
-    uint8_t version = extractVersion(packetBuffer);
-    if (version >= 1 && version <= 4) {
-        metrics.clientVersions[version - 1]++;
-    } else {
-        metrics.clientVersions[4]++;  // "other"
+}
+
+void NTP::selectPipeline() {
+    // One instantiation per feature combination, indexed by feature mask
+    static const RequestPipeline pipelines[NTP_PIPE_VARIANTS] = {
+        &NTP::processRequest<0>, &NTP::processRequest<1>,
+        &NTP::processRequest<2>, &NTP::processRequest<3>,
+        &NTP::processRequest<4>, &NTP::processRequest<5>,
+        &NTP::processRequest<6>, &NTP::processRequest<7>
+    };
+    
+    uint8_t features = 0;
+    if (config.rateLimitEnabled) {
+        features |= NTP_PIPE_RATE_LIMIT;
+    }
+    if (accessControl && accessControl->getRuleCount() > 0) {
+        features |= NTP_PIPE_ACL;
+    }
+    if (capture || telemetry) {
+        features |= NTP_PIPE_RECORD;
     }
     
-    // Update stratum statistics
-    uint8_t clientStratum = extractStratum(packetBuffer);
-    if (clientStratum <= 16) {
-        metrics.requestsByStratum[clientStratum]++;
+    if (features != pipelineVariant || requestPipeline == nullptr) {
+        pipelineVariant = features;
+        requestPipeline = pipelines[features];
+        log("NTP: Request pipeline " + pipelineFeatureString(features));
+    }
+}
+
+String NTP::pipelineFeatureString(uint8_t variant) {
+    String out;
+    if (variant & NTP_PIPE_RATE_LIMIT) out += "ratelimit+";
+    if (variant & NTP_PIPE_ACL)        out += "acl+";
+    if (variant & NTP_PIPE_RECORD)     out += "record+";
+    if (out.length() == 0) {
+        return "base";
     }
+    out.remove(out.length() - 1);
+    return out;
 }
 
 bool NTP::validateNTPRequest(const byte* packet) {
@@ -525,22 +1097,87 @@ bool NTP::validateNTPRequest(const byte* packet) {
     return true;
 }
 
+bool NTP::parseExtensionFields() {
+    if (requestLength == NTP_PACKET_SIZE) {
+        return true;
+    }
+    if (requestLength < NTP_PACKET_SIZE) {
+        return false;                        // Short read
+    }
+    
+    metrics.extensionRequests++;
+    
+    NTPExtensionWalker walker(packetBuffer, requestLength);
+    NTPExtensionField ef;
+    while (walker.next(ef)) {
+        metrics.extensionFieldCounts[NTPExtensionWalker::counterFor(ef.type)]++;
+    }
+    
+    if (walker.isMalformed()) {
+        metrics.malformedExtensions++;
+        return false;
+    }
+    
+    if (walker.hasMAC()) {
+        metrics.extensionFieldCounts[EF_COUNT_MAC]++;
+    }
+    
+    // Extension fields exist only in NTPv4 (a bare MAC is valid in v3)
+    if (extractVersion(packetBuffer) != 4 && requestLength - NTP_PACKET_SIZE != NTP_MAC_MD5_SIZE &&
+        requestLength - NTP_PACKET_SIZE != NTP_MAC_SHA1_SIZE) {
+        metrics.malformedExtensions++;
+        return false;
+    }
+    
+    return true;
+}
+
+uint16_t NTP::appendEchoedFields(byte* response) {
+    uint16_t length = NTP_PACKET_SIZE;
+    if (requestLength == NTP_PACKET_SIZE) {
+        return length;
+    }
+    
+    // Echo the Unique Identifier so the client can match the reply.
+    // Other fields are not implemented and are left out, which clients
+    // treat as "not supported". The reply is never longer than the
+    // request, so extension fields cannot be used for amplification.
+    NTPExtensionWalker walker(packetBuffer, requestLength);
+    NTPExtensionField ef;
+    while (walker.next(ef)) {
+        if (ef.type == NTP_EF_UNIQUE_ID) {
+            memcpy(response + length, ef.field, ef.length);
+            length += ef.length;
+        }
+    }
+    
+    // Unknown key: answer with a crypto-NAK (key ID 0, no digest)
+    if (walker.hasMAC()) {
+        memset(response + length, 0, 4);
+        length += 4;
+    }
+    
+    return length;
+}
+
 void NTP::sendNTPResponse(IPAddress clientIP, int port, const byte* request, 
-                         uint32_t receiveTimeMicros) {
-    // Capture transmit time
-    uint32_t transmitTimeMicros = micros();
+                         uint64_t receiveTimeMicros) {
+    // Capture transmit time once the socket can take the packet
+    acquireSocket();
+    uint64_t transmitTimeMicros = Timebase::micros64();
     
     // Build response packet
-    buildNTPPacket(packetBuffer, request, receiveTimeMicros, transmitTimeMicros);
+    buildNTPPacket(responseBuffer, request, receiveTimeMicros, transmitTimeMicros);
+    responseLength = appendEchoedFields(responseBuffer);
     
     // Send response
     udpRef->beginPacket(clientIP, port);
-    udpRef->write(packetBuffer, NTP_PACKET_SIZE);
+    udpRef->write(responseBuffer, responseLength);
     udpRef->endPacket();
 }
 
 void NTP::buildNTPPacket(byte* packet, const byte* request, 
-                        uint32_t receiveTimeMicros, uint32_t transmitTimeMicros) {
+                        uint64_t receiveTimeMicros, uint64_t transmitTimeMicros) {
     const GPSData& gpsData = gpsRef->getData();
     
     // Clear packet
@@ -550,7 +1187,9 @@ void NTP::buildNTPPacket(byte* packet, const byte* request,
     uint8_t leapIndicator = 0;  // 0 = no warning (we'll add leap second support later)
     
     // Set leap indicator to alarm if GPS quality is marginal
-    if (!gpsData.timeValid || gpsData.updateAge > 2000) {
+    if (holdover.active) {
+        leapIndicator = peers[sysPeer].leap;
+    } else if (!gpsData.timeValid || gpsData.updateAge > 2000) {
         leapIndicator = 3;  // Alarm condition (clock not synchronized)
     }
     
@@ -559,8 +1198,8 @@ void NTP::buildNTPPacket(byte* packet, const byte* request,
     
     packet[0] = (leapIndicator << 6) | (version << 3) | mode;
     
-    // Byte 1: Stratum
-    packet[1] = config.stratum;
+    // Byte 1: Stratum (one below the peer while in holdover)
+    packet[1] = holdover.active ? peers[sysPeer].stratum + 1 : config.stratum;
     
     // Byte 2: Poll interval (echo client's poll or use 6 = 64 seconds)
     packet[2] = extractPollInterval(request);
@@ -585,18 +1224,26 @@ void NTP::buildNTPPacket(byte* packet, const byte* request,
     packet[10] = (rootDispersion >> 8) & 0xFF;
     packet[11] = rootDispersion & 0xFF;
     
-    // Bytes 12-15: Reference ID (e.g., "GPS\0")
-    memcpy(&packet[12], config.referenceID, 4);
-    
-    // Bytes 16-23: Reference Timestamp (when we last synced to GPS)
-    // Use GPS lock acquisition time
-    uint32_t lockTime = gpsData.lockAcquiredTime;
-    uint16_t lockFraction = gpsData.lockAcquiredFraction;
-    
-    uint32_t refSeconds = gpsData.unixTime + NTP_EPOCH_OFFSET;
-    uint32_t refFraction = ((uint64_t)lockFraction * 4294967296ULL) / 100ULL;
+    // Bytes 12-15: Reference ID (e.g., "GPS\0", or the peer's IPv4 in holdover)
+    if (holdover.active) {
+        memcpy(&packet[12], &peers[sysPeer].ip, 4);
+    } else {
+        memcpy(&packet[12], config.referenceID, 4);
+    }
     
-    writeNTPTimestamp(packet, 16, {refSeconds, refFraction});
+    // Bytes 16-23: Reference Timestamp (when we last synced to GPS or peer)
+    if (holdover.active) {
+        writeNTPTimestamp(packet, 16, microsToNTP(holdover.lastUpdateMicros));
+    } else {
+        // Use GPS lock acquisition time
+        uint32_t lockTime = gpsData.lockAcquiredTime;
+        uint16_t lockFraction = gpsData.lockAcquiredFraction;
+        
+        uint32_t refSeconds = gpsData.unixTime + NTP_EPOCH_OFFSET;
+        uint32_t refFraction = ((uint64_t)lockFraction * 4294967296ULL) / 100ULL;
+        
+        writeNTPTimestamp(packet, 16, {refSeconds, refFraction});
+    }
     
     // Bytes 24-31: Originate Timestamp (copy from client's transmit timestamp)
     // CRITICAL FIX #1: Copy client's transmit time to our originate
@@ -623,7 +1270,8 @@ void NTP::sendBroadcast() {
     request[0] = 0x23;  // Version 4, Mode 3 (client) - for building
     request[2] = 6;     // Poll interval
     
-    uint32_t now = micros();
+    acquireSocket();
+    uint64_t now = Timebase::micros64();
     buildNTPPacket(packetBuffer, request, now, now);
     
     // Change mode to 5 (broadcast)
@@ -645,29 +1293,85 @@ void NTP::sendBroadcast() {
 }
 
 void NTP::sendKissOfDeath(IPAddress clientIP, int port, const char* kissCode) {
-    memset(packetBuffer, 0, NTP_PACKET_SIZE);
+    memset(responseBuffer, 0, NTP_PACKET_SIZE);
     
     // Leap = 3 (alarm), Version = 4, Mode = 4 (server)
-    packetBuffer[0] = 0xDC;  // 11 011 100
+    responseBuffer[0] = 0xDC;  // 11 011 100
     
     // Stratum = 0 (Kiss-o'-Death)
-    packetBuffer[1] = 0;
+    responseBuffer[1] = 0;
     
     // Reference ID = Kiss code (4 ASCII chars)
-    memcpy(&packetBuffer[12], kissCode, 4);
+    memcpy(&responseBuffer[12], kissCode, 4);
     
     // All timestamps zero (already cleared by memset)
     
+    responseLength = appendEchoedFields(responseBuffer);
+    
+    acquireSocket();
     udpRef->beginPacket(clientIP, port);
-    udpRef->write(packetBuffer, NTP_PACKET_SIZE);
+    udpRef->write(responseBuffer, responseLength);
     udpRef->endPacket();
     
     metrics.kodSent++;
+    timeSeries.record(SERIES_KOD);
     
     log("NTP: Kiss-o'-Death sent to " + clientIP.toString() + " (Code: " + String(kissCode) + ")");
 }
 
-bool NTP::checkGlobalRateLimit() {
+void NTP::calibrateCapacity() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - capacity.windowStart;
+    if (elapsed < NTP_CAPACITY_WINDOW_MS) {
+        return;
+    }
+    
+    if (capacity.windowRequests > 0) {
+        float cost = (float)capacity.windowServiceMicros / capacity.windowRequests;
+        if (capacity.costMicros == 0) {
+            capacity.costMicros = cost;
+        } else {
+            capacity.costMicros += NTP_CAPACITY_EWMA_WEIGHT * (cost - capacity.costMicros);
+        }
+    }
+    capacity.servedRps = (capacity.windowRequests * 1000UL) / elapsed;
+    if (capacity.periodMicros > 0) {
+        capacity.measuredRps = (uint32_t)(1000000.0f / capacity.periodMicros);
+    }
+    capacity.windowStart = now;
+    capacity.windowRequests = 0;
+    capacity.windowServiceMicros = 0;
+    
+    uint32_t ceiling = config.globalMaxRequestsPerSec;
+    if (!config.adaptiveCapacity || capacity.measuredRps == 0) {
+        capacity.limitRps = ceiling;
+        return;
+    }
+    
+    uint32_t target = (capacity.measuredRps * NTP_CAPACITY_HEADROOM_PERCENT) / 100;
+    target = constrain(target, (uint32_t)NTP_CAPACITY_MIN_RPS, max(ceiling, (uint32_t)NTP_CAPACITY_MIN_RPS));
+    uint32_t limit = min(capacity.limitRps, ceiling);
+    
+    // Lower immediately, but only on evidence from a loaded window
+    // (a few samples from a near-idle loop are not representative)
+    uint32_t lowerBound = (limit * (100 - NTP_CAPACITY_HYSTERESIS_PERCENT)) / 100;
+    uint32_t upperBound = (limit * (100 + NTP_CAPACITY_HYSTERESIS_PERCENT)) / 100;
+    if (target < lowerBound && capacity.servedRps * 2 >= capacity.measuredRps) {
+        limit = target;
+    } else if (target > upperBound) {
+        uint32_t step = max((uint32_t)1, (limit * NTP_CAPACITY_STEP_UP_PERCENT) / 100);
+        limit = min(target, limit + step);
+    }
+    
+    if (limit != capacity.limitRps) {
+        capacity.adjustments++;
+        log("NTP: Capacity " + String(capacity.measuredRps) + " req/s measured, limit " +
+            String(capacity.limitRps) + " -> " + String(limit));
+        capacity.limitRps = limit;
+    }
+}
+
+bool NTP::checkGlobalRateLimit(IPAddress clientIP) {
     uint32_t now = millis();
     
     // Reset counter every second
@@ -681,11 +1385,27 @@ bool NTP::checkGlobalRateLimit() {
         globalRateLimit.lastSecondReset = now;
     }
     
-    // Check limit
-    if (globalRateLimit.requestsThisSecond >= config.globalMaxRequestsPerSec) {
+    // Below the reserve everyone is admitted
+    uint32_t budget = config.adaptiveCapacity ? capacity.limitRps : config.globalMaxRequestsPerSec;
+    uint32_t openBudget = budget - (budget * NTP_ADMISSION_RESERVE_PERCENT) / 100;
+    if (globalRateLimit.requestsThisSecond < openBudget) {
+        globalRateLimit.requestsThisSecond++;
+        return true;
+    }
+    
+    if (globalRateLimit.requestsThisSecond >= budget) {
+        return false;
+    }
+    
+    // Overloaded: the reserve is only for clients with established good
+    // history, so a flood from new or spoofed sources cannot lock them out
+    NTPClient* client = findClient(clientIP);
+    if (!client || client->aggressive || client->reputation < NTP_REPUTATION_TRUSTED) {
+        metrics.admissionShed++;
         return false;
     }
     
+    metrics.reserveAdmitted++;
     globalRateLimit.requestsThisSecond++;
     return true;
 }
@@ -701,6 +1421,7 @@ bool NTP::checkClientRateLimit(IPAddress clientIP, uint8_t pollInterval) {
     if (timeSinceLastRequest < config.perClientMinInterval) {
         client->rateLimited = true;
         client->aggressiveCount++;
+        updateReputation(client, now);
         
         if (client->aggressiveCount > NTP_AGGRESSIVE_THRESHOLD) {
             client->aggressive = true;
@@ -709,8 +1430,8 @@ bool NTP::checkClientRateLimit(IPAddress clientIP, uint8_t pollInterval) {
         return false;
     }
     
-    // Update client stats
-    updateClientStats(client, pollInterval);
+    // Client stats are folded off the hot path with this interval
+    admittedInterval = now - client->lastRequest;
     
     client->lastRequest = now;
     client->rateLimited = false;
@@ -718,65 +1439,276 @@ bool NTP::checkClientRateLimit(IPAddress clientIP, uint8_t pollInterval) {
     return true;
 }
 
-NTPClient* NTP::findOrCreateClient(IPAddress clientIP) {
-    // Find existing client
+NTPClient* NTP::findClient(IPAddress clientIP) {
     for (int i = 0; i < clientCount; i++) {
         if (clients[i].ip == clientIP) {
             return &clients[i];
         }
     }
+    return nullptr;
+}
+
+NTPClient* NTP::findOrCreateClient(IPAddress clientIP) {
+    // Find existing client
+    NTPClient* existing = findClient(clientIP);
+    if (existing) {
+        return existing;
+    }
     
     // Find empty slot or oldest entry
     if (clientCount < config.maxClients) {
         // Use new slot
         NTPClient* client = &clients[clientCount++];
-        client->ip = clientIP;
-        client->requestCount = 0;
-        client->lastRequest = 0;
-        client->aggressiveCount = 0;
-        client->aggressive = false;
-        client->rateLimited = false;
-        client->averageInterval = 0;
+        initClient(client, clientIP);
         metrics.uniqueClients = clientCount;
         return client;
     } else {
-        // Replace oldest entry
-        uint32_t oldestTime = clients[0].lastRequest;
-        int oldestIndex = 0;
+        // Replace the least reputable entry, oldest first among equals,
+        // so churn from new sources does not evict established clients
+        int evictIndex = 0;
         
         for (int i = 1; i < config.maxClients; i++) {
-            if (clients[i].lastRequest < oldestTime) {
-                oldestTime = clients[i].lastRequest;
-                oldestIndex = i;
+            const NTPClient& c = clients[i];
+            const NTPClient& victim = clients[evictIndex];
+            if (c.reputation < victim.reputation ||
+                (c.reputation == victim.reputation && c.lastRequest < victim.lastRequest)) {
+                evictIndex = i;
             }
         }
         
-        NTPClient* client = &clients[oldestIndex];
-        client->ip = clientIP;
-        client->requestCount = 0;
-        client->lastRequest = 0;
-        client->aggressiveCount = 0;
-        client->aggressive = false;
-        client->rateLimited = false;
-        client->averageInterval = 0;
+        NTPClient* client = &clients[evictIndex];
+        initClient(client, clientIP);
         return client;
     }
 }
 
-void NTP::updateClientStats(NTPClient* client, uint8_t pollInterval) {
+void NTP::initClient(NTPClient* client, IPAddress clientIP) {
+    client->ip = clientIP;
+    client->requestCount = 0;
+    client->lastRequest = 0;
+    client->aggressiveCount = 0;
+    client->aggressive = false;
+    client->rateLimited = false;
+    client->averageInterval = 0;
+    client->reputation = 0;
+    client->reputationMillis = 0;
+    
+    client->lastClientXmt = 0;
+    client->lastServerRx = 0;
+    client->lastServerTx = 0;
+    client->offsetMicros = 0;
+    client->delayMicros = 0;
+    client->jitterMicros = 0;
+    client->lastOffsetMicros = 0;
+    client->offsetSamples = 0;
+    
+    client->lastResponseMillis = 0;
+    client->responseCached = false;
+    client->duplicates = 0;
+    client->freeRetransmits = 0;
+}
+
+template <uint8_t Features>
+bool NTP::handleDuplicateRequest(IPAddress clientIP, int port, uint64_t receiveTimeMicros) {
+    NTPClient* client = findClient(clientIP);
+    if (!client || client->lastClientXmt == 0) {
+        return false;
+    }
+    
+    uint64_t transmit = readNTPTimestamp64(packetBuffer, 40);
+    uint64_t origin = readNTPTimestamp64(packetBuffer, 24);
+    
+    // Origin must be zero (first/stateless request) or our last transmit
+    if (origin != 0 && client->lastServerTx != 0 && origin != client->lastServerTx) {
+        metrics.bogusOrigin++;
+    }
+    
+    if (transmit == 0 || transmit != client->lastClientXmt) {
+        return false;
+    }
+    
+    // Same transmit timestamp long after the answer: replay, serve normally
+    if (millis() - client->lastResponseMillis > NTP_DUPLICATE_WINDOW_MS) {
+        metrics.replayedRequests++;
+        return false;
+    }
+    
+    // Retransmit: the first few are answered (from cache, or rebuilt) or
+    // dropped without charging the rate limiter; any more are ordinary
+    // requests, so a repeated packet cannot bypass 'limited'
+    metrics.duplicateRequests++;
+    if (client->duplicates < UINT16_MAX) client->duplicates++;
+    retransmit = true;
+    
+    if (client->freeRetransmits >= NTP_DUPLICATE_FREE_ANSWERS) {
+        metrics.duplicatesCharged++;
+        return false;
+    }
+    client->freeRetransmits++;
+    
+    // Extension field replies are not cached: rebuild through the normal path
+    if (config.answerDuplicates && !client->responseCached) {
+        retransmitFree = true;
+        return false;
+    }
+    
+    if (config.answerDuplicates) {
+        memcpy(responseBuffer, client->cachedResponse, NTP_PACKET_SIZE);
+        responseLength = NTP_PACKET_SIZE;
+        acquireSocket();
+        udpRef->beginPacket(clientIP, port);
+        udpRef->write(responseBuffer, responseLength);
+        udpRef->endPacket();
+        
+        metrics.duplicatesAnswered++;
+        timeSeries.record(SERIES_RESPONSES);
+        recordExchangeIf<Features>(clientIP, port, receiveTimeMicros, NTPCaptureVerdict::RESPONDED, nullptr);
+    } else {
+        timeSeries.record(SERIES_DROPS);
+        recordExchangeIf<Features>(clientIP, port, receiveTimeMicros, NTPCaptureVerdict::DROPPED, nullptr);
+    }
+    return true;
+}
+
+void NTP::cacheClientResponse(NTPClient* client) {
+    // Only plain 48-byte replies are cached; extension field replies are
+    // rebuilt when retransmitted (handleDuplicateRequest)
+    client->responseCached = (responseLength == NTP_PACKET_SIZE);
+    if (client->responseCached) {
+        memcpy(client->cachedResponse, responseBuffer, NTP_PACKET_SIZE);
+    }
+    
+    // A rebuilt retransmit neither restarts the duplicate window nor
+    // renews the free allowance, so repeats cannot slide it forever
+    if (!retransmit) {
+        client->lastResponseMillis = millis();
+        client->freeRetransmits = 0;
+    }
+}
+
+void NTP::updateClientOffset(NTPClient* client) {
+    // Full-state clients (ntpd, RFC 5905) echo our previous transmit
+    // timestamp as origin and their receive time of it as receive, which
+    // completes the four timestamps of the previous exchange. SNTP clients
+    // and clients that randomize their transmit timestamp leave these zero
+    // and yield no sample.
+    uint64_t origin = readNTPTimestamp64(packetBuffer, 24);
+    uint64_t clientRx = readNTPTimestamp64(packetBuffer, 32);
+    
+    if (client->lastServerTx != 0 && origin == client->lastServerTx && clientRx != 0) {
+        uint64_t t1 = client->lastClientXmt;
+        uint64_t t2 = client->lastServerRx;
+        uint64_t t3 = client->lastServerTx;
+        uint64_t t4 = clientRx;
+        
+        // Client-side view: offset = client - server
+        int64_t offset = (NTPPeerLogic::diffMicros(t1, t2) + NTPPeerLogic::diffMicros(t4, t3)) / 2;
+        int64_t delay = NTPPeerLogic::diffMicros(t4, t1) - NTPPeerLogic::diffMicros(t3, t2);
+        
+        if (delay >= 0 && delay < NTP_OFFSET_MAX_DELAY_US) {
+            float sample = (float)offset;
+            float deviation = fabsf(sample - client->offsetMicros);
+            
+            if (client->offsetSamples == 0 || deviation > NTP_OFFSET_RESTART_US) {
+                client->offsetMicros = sample;
+                client->delayMicros = (float)delay;
+                client->jitterMicros = 0;
+                client->offsetSamples = 1;
+            } else {
+                client->offsetMicros += NTP_OFFSET_EWMA_WEIGHT * (sample - client->offsetMicros);
+                client->delayMicros += NTP_OFFSET_EWMA_WEIGHT * ((float)delay - client->delayMicros);
+                client->jitterMicros += NTP_OFFSET_EWMA_WEIGHT * (deviation - client->jitterMicros);
+                if (client->offsetSamples < UINT16_MAX) client->offsetSamples++;
+            }
+            client->lastOffsetMicros = sample;
+        }
+    }
+    
+    // Keep this exchange for the client's next request
+    client->lastClientXmt = readNTPTimestamp64(packetBuffer, 40);
+    client->lastServerRx = readNTPTimestamp64(responseBuffer, 32);
+    client->lastServerTx = readNTPTimestamp64(responseBuffer, 40);
+}
+
+void NTP::updateClientStats(NTPClient* client, uint8_t pollInterval, uint32_t intervalMillis) {
     client->requestCount++;
     client->lastPollInterval = pollInterval;
     
     // Calculate average interval
-    uint32_t now = millis();
     if (client->averageInterval == 0) {
-        client->averageInterval = now - client->lastRequest;
+        client->averageInterval = intervalMillis;
     } else {
-        uint32_t thisInterval = now - client->lastRequest;
-        client->averageInterval = (client->averageInterval * 3 + thisInterval) / 4;
+        client->averageInterval = (client->averageInterval * 3 + intervalMillis) / 4;
     }
 }
 
+void NTP::foldStats(uint16_t maxRecords) {
+    NTPStatsRecord record;
+    
+    for (uint16_t n = 0; n < maxRecords && statsRing.pop(record); n++) {
+        // Receive->transmit latency histogram
+        uint8_t bucket = 0;
+        while (bucket < NTP_LATENCY_BUCKETS - 1 && record.latencyMicros >= getLatencyBucketBound(bucket)) {
+            bucket++;
+        }
+        metrics.latencyHistogram[bucket]++;
+        if (record.latencyMicros > metrics.peakLatencyMicros) {
+            metrics.peakLatencyMicros = record.latencyMicros;
+        }
+        
+        if (record.serviceMillis > metrics.peakResponseTime) {
+            metrics.peakResponseTime = record.serviceMillis;
+        }
+        
+        if (metrics.averageResponseTime == 0) {
+            metrics.averageResponseTime = record.serviceMillis;
+        } else {
+            metrics.averageResponseTime = (metrics.averageResponseTime * 0.9) + (record.serviceMillis * 0.1);
+        }
+        
+        // Update client version statistics
+        if (record.version >= 1 && record.version <= 4) {
+            metrics.clientVersions[record.version - 1]++;
+        } else {
+            metrics.clientVersions[4]++;  // "other"
+        }
+        
+        // Update stratum statistics
+        if (record.stratum <= 16) {
+            metrics.requestsByStratum[record.stratum]++;
+        }
+        
+        // Client may have been evicted since; its stats go with it
+        if (record.intervalMillis != NTP_STATS_NO_INTERVAL) {
+            NTPClient* client = findClient(IPAddress(record.clientIP));
+            if (client) {
+                updateClientStats(client, record.pollInterval, record.intervalMillis);
+            }
+        }
+    }
+}
+
+void NTP::updateReputation(NTPClient* client, uint32_t now) {
+    uint32_t interval = now - client->reputationMillis;
+    bool seenBefore = client->reputationMillis != 0;
+    client->reputationMillis = now;
+    if (!seenBefore) {
+        return;                              // First request: still unknown
+    }
+    
+    if (interval < config.perClientMinInterval) {
+        client->reputation = client->reputation > NTP_REPUTATION_PENALTY ?
+                             client->reputation - NTP_REPUTATION_PENALTY : 0;
+    } else if (!client->aggressive) {
+        client->reputation = client->reputation < 255 - NTP_REPUTATION_GAIN ?
+                             client->reputation + NTP_REPUTATION_GAIN : 255;
+    }
+}
+
+bool NTP::hasTimeSource() const {
+    return isGPSQualitySufficient() || holdover.active;
+}
+
 bool NTP::isGPSQualitySufficient() const {
     const GPSData& gpsData = gpsRef->getData();
     
@@ -787,7 +1719,7 @@ bool NTP::isGPSQualitySufficient() const {
     if (gpsData.satellites < config.minSatellites) return false;
     
     // Check HDOP
-    if (gpsData.hdop > config.maxHDOP) return false;
+    if (gpsData.hdopX100 > config.maxHDOPX100) return false;
     
     // Check fix age
     if (gpsData.updateAge > config.maxFixAge) return false;
@@ -798,17 +1730,28 @@ bool NTP::isGPSQualitySufficient() const {
 void NTP::calculateRootDelayDispersion(float& rootDelay, float& rootDispersion) const {
     const GPSData& gpsData = gpsRef->getData();
     
+    // Holdover: peer's root values plus the path to the peer
+    if (holdover.active) {
+        const NTPPeer& peer = peers[sysPeer];
+        rootDelay = (peer.rootDelayMicros + peer.delayMicros) / 1000000.0;
+        uint32_t ageSeconds = (millis() - peer.updateMillis) / 1000;
+        rootDispersion = (peer.rootDispersionMicros + peer.jitterMicros +
+                          ageSeconds * NTP_PEER_PHI_PPM) / 1000000.0 + extraDispersion;
+        if (rootDispersion > 1.0) rootDispersion = 1.0;
+        return;
+    }
+    
     // Conservative root delay based on PDOP
-    if (gpsData.pdop < 2.0) {
+    if (gpsData.pdopX100 < 200) {
         rootDelay = 0.001;  // 1ms
-    } else if (gpsData.pdop < 5.0) {
+    } else if (gpsData.pdopX100 < 500) {
         rootDelay = 0.005;  // 5ms
     } else {
         rootDelay = 0.010;  // 10ms
     }
     
-    // Root dispersion: fix age + HDOP contribution
-    rootDispersion = (gpsData.updateAge / 1000.0) + (gpsData.hdop * 0.001);
+    // Root dispersion: fix age + HDOP contribution + local clock error
+    rootDispersion = (gpsData.updateAge / 1000.0) + (gpsData.hdopX100 * 0.00001f) + extraDispersion;
     
     // Cap at reasonable value
     if (rootDispersion > 1.0) rootDispersion = 1.0;
@@ -827,36 +1770,42 @@ NTPTimestamp NTP::gpsTimeToNTP() const {
     return ts;
 }
 
-NTPTimestamp NTP::microsToNTP(uint32_t currentMicros) const {
+NTPTimestamp NTP::microsToNTP(uint64_t timebaseMicros) const {
     const GPSData& gpsData = gpsRef->getData();
     
     // Get GPS time as base
     NTPTimestamp ts = gpsTimeToNTP();
     
-    // Calculate elapsed time since last GPS update
-    static uint32_t lastGPSUpdateMicros = 0;
-    static uint32_t gpsUpdateMillis = 0;
-    
-    // Update reference when GPS updates
-    if (gpsData.lastUpdateMillis != gpsUpdateMillis) {
-        lastGPSUpdateMicros = currentMicros;
-        gpsUpdateMillis = gpsData.lastUpdateMillis;
+    // Elapsed since the start of the sentence that carried the GPS time.
+    // Both sides are 64-bit timebase values, so the difference is exact
+    // regardless of how long ago the anchor was taken.
+    uint64_t elapsedMicros = 0;
+    if (gpsData.timeAnchorMicros != 0 && timebaseMicros > gpsData.timeAnchorMicros) {
+        elapsedMicros = timebaseMicros - gpsData.timeAnchorMicros;
     }
     
-    // Calculate microseconds elapsed since GPS update
-    uint32_t elapsedMicros = currentMicros - lastGPSUpdateMicros;
+    // Remove what the crystal gained or lost since the anchor
+    if (drift) {
+        elapsedMicros = (uint64_t)((int64_t)elapsedMicros - drift->correctionMicros(elapsedMicros));
+    }
     
     // Add elapsed time to GPS timestamp
-    // Convert microseconds to NTP fraction
-    uint64_t microsFraction = ((uint64_t)elapsedMicros * 4294967296ULL) / 1000000ULL;
-    
-    // Add to base fraction (with overflow handling)
-    uint64_t newFraction = (uint64_t)ts.fraction + microsFraction;
-    if (newFraction > 0xFFFFFFFFULL) {
-        ts.seconds += (newFraction >> 32);
-        ts.fraction = newFraction & 0xFFFFFFFFULL;
-    } else {
-        ts.fraction = newFraction;
+    uint64_t stamp = toNTP64(ts);
+    stamp += (elapsedMicros / 1000000ULL) << 32;
+    stamp += ((elapsedMicros % 1000000ULL) * 4294967296ULL) / 1000000ULL;
+    ts.seconds = stamp >> 32;
+    ts.fraction = stamp & 0xFFFFFFFFULL;
+    
+    // Holdover: apply the correction disciplined to the peer
+    if (holdover.active) {
+        int64_t correction = NTPPeerLogic::correctionAt(holdover, timebaseMicros);
+        int64_t correctionSeconds = correction / 1000000LL;
+        int64_t correctionMicros = correction % 1000000LL;
+        uint64_t t = toNTP64(ts);
+        t += (uint64_t)correctionSeconds << 32;
+        t += (uint64_t)((correctionMicros * 4294967296LL) / 1000000LL);
+        ts.seconds = t >> 32;
+        ts.fraction = t & 0xFFFFFFFFULL;
     }
     
     return ts;
@@ -873,6 +1822,201 @@ void NTP::writeNTPTimestamp(byte* packet, int offset, const NTPTimestamp& ts) {
     packet[offset + 7] = ts.fraction & 0xFF;
 }
 
+uint64_t NTP::readNTPTimestamp64(const byte* packet, int offset) {
+    uint64_t ts = 0;
+    for (int i = 0; i < 8; i++) {
+        ts = (ts << 8) | packet[offset + i];
+    }
+    return ts;
+}
+
+uint64_t NTP::toNTP64(const NTPTimestamp& ts) {
+    return ((uint64_t)ts.seconds << 32) | ts.fraction;
+}
+
+// ============================================================================
+// SYMMETRIC PEERING
+// ============================================================================
+
+void NTP::initPeers() {
+    for (uint8_t i = 0; i < NTP_MAX_PEERS; i++) {
+        peers[i].ip = config.peeringEnabled ? config.peerIPs[i] : 0;
+        NTPPeerLogic::reset(peers[i]);
+        
+        // Stagger first polls so paired units do not transmit in lockstep
+        peers[i].lastPollMillis = millis() - (esp_random() % (1000UL << NTP_PEER_POLL));
+    }
+    sysPeer = -1;
+    memset(&holdover, 0, sizeof(holdover));
+    
+    if (config.peeringEnabled) {
+        for (uint8_t i = 0; i < NTP_MAX_PEERS; i++) {
+            if (peers[i].ip != 0) {
+                log("NTP: Symmetric peer " + IPAddress(peers[i].ip).toString());
+            }
+        }
+    }
+}
+
+void NTP::processPeers() {
+    if (!config.peeringEnabled) {
+        return;
+    }
+    
+    // Poll each peer; the reach register shifts once per poll
+    for (uint8_t i = 0; i < NTP_MAX_PEERS; i++) {
+        NTPPeer& peer = peers[i];
+        if (peer.ip == 0) continue;
+        
+        if (millis() - peer.lastPollMillis >= (1000UL << NTP_PEER_POLL)) {
+            peer.lastPollMillis = millis();
+            NTPPeerLogic::shiftReach(peer);
+            sendPeerPacket(peer);
+        }
+    }
+    
+    // Clock selection
+    sysPeer = NTPPeerLogic::select(peers, NTP_MAX_PEERS, (uint32_t)Ethernet.localIP(), millis());
+    
+    // Follow the peer only while our own receiver cannot serve
+    bool follow = sysPeer >= 0 && !isGPSQualitySufficient();
+    
+    if (follow && !holdover.active) {
+        memset(&holdover, 0, sizeof(holdover));
+        holdover.active = true;
+        holdover.anchorMicros = Timebase::micros64();
+        
+        int64_t offset = peers[sysPeer].offsetMicros;
+        disciplineHoldover(peers[sysPeer], offset);
+        
+        log("NTP: GPS unavailable, holdover from peer " + IPAddress(peers[sysPeer].ip).toString() +
+            " (offset " + String((int32_t)(offset / 1000)) + " ms)");
+    } else if (!follow && holdover.active) {
+        holdover.active = false;
+        log(sysPeer >= 0 ? "NTP: GPS recovered, leaving peer holdover" : "NTP: Peer lost, leaving holdover");
+    }
+}
+
+void NTP::sendPeerPacket(NTPPeer& peer) {
+    byte packet[NTP_PACKET_SIZE];
+    byte request[NTP_PACKET_SIZE];
+    
+    // Origin = peer's last transmit timestamp; build as a v4 reply to it
+    memset(request, 0, NTP_PACKET_SIZE);
+    request[0] = 0x23;
+    request[2] = NTP_PEER_POLL;
+    for (int i = 0; i < 8; i++) {
+        request[40 + i] = (peer.org >> (56 - 8 * i)) & 0xFF;
+    }
+    
+    uint64_t nowMicros = Timebase::micros64();
+    buildNTPPacket(packet, request, nowMicros, nowMicros);
+    
+    // Symmetric active; unsynchronized when we have nothing to offer
+    uint8_t leap = packet[0] >> 6;
+    if (!hasTimeSource()) {
+        leap = 3;
+        packet[1] = 16;
+    }
+    packet[0] = (leap << 6) | (4 << 3) | 1;
+    
+    // Receive = when the peer's last packet arrived
+    for (int i = 0; i < 8; i++) {
+        packet[32 + i] = (peer.rec >> (56 - 8 * i)) & 0xFF;
+    }
+    
+    // Transmit timestamp last, as close to the send as possible
+    acquireSocket();
+    NTPTimestamp transmitTime = microsToNTP(Timebase::micros64());
+    writeNTPTimestamp(packet, 40, transmitTime);
+    peer.xmt = toNTP64(transmitTime);
+    
+    udpRef->beginPacket(IPAddress(peer.ip), config.port);
+    udpRef->write(packet, NTP_PACKET_SIZE);
+    udpRef->endPacket();
+    peer.sent++;
+}
+
+void NTP::handlePeerPacket(IPAddress peerIP, uint64_t receiveTimeMicros) {
+    // Only configured peers; no ephemeral associations
+    NTPPeer* peer = nullptr;
+    for (uint8_t i = 0; config.peeringEnabled && i < NTP_MAX_PEERS; i++) {
+        if (peers[i].ip != 0 && peers[i].ip == (uint32_t)peerIP) {
+            peer = &peers[i];
+            break;
+        }
+    }
+    if (!peer) {
+        metrics.invalidRequests++;
+        timeSeries.record(SERIES_DROPS);
+        return;
+    }
+    
+    uint64_t t1 = readNTPTimestamp64(packetBuffer, 24);   // Our transmit (echoed)
+    uint64_t t2 = readNTPTimestamp64(packetBuffer, 32);   // Peer receive
+    uint64_t t3 = readNTPTimestamp64(packetBuffer, 40);   // Peer transmit
+    uint64_t t4 = toNTP64(microsToNTP(receiveTimeMicros));
+    
+    // Duplicate or replayed packet
+    if (t3 == 0 || t3 == peer->org) {
+        peer->duplicates++;
+        return;
+    }
+    
+    peer->received++;
+    peer->mode = packetBuffer[0] & 0x07;
+    peer->leap = packetBuffer[0] >> 6;
+    peer->stratum = packetBuffer[1];
+    memcpy(&peer->refID, &packetBuffer[12], 4);
+    
+    // Root delay/dispersion are 16.16 fixed-point seconds
+    uint32_t rootDelay = readNTPTimestamp64(packetBuffer, 4) >> 32;
+    uint32_t rootDispersion = readNTPTimestamp64(packetBuffer, 8) >> 32;
+    peer->rootDelayMicros = ((uint64_t)rootDelay * 1000000ULL) >> 16;
+    peer->rootDispersionMicros = ((uint64_t)rootDispersion * 1000000ULL) >> 16;
+    
+    // Remember for our next transmit
+    bool bogus = (t1 != peer->xmt) || t1 == 0 || t2 == 0;
+    peer->org = t3;
+    peer->rec = t4;
+    
+    // Origin must match our last transmit, otherwise the sample is not ours
+    if (bogus) {
+        peer->bogus++;
+        return;
+    }
+    
+    // Unsynchronized peer: reachable, but its clock is not worth a sample
+    // (it would outlive the peer's recovery in the filter)
+    if (peer->leap == 3 || peer->stratum == 0 || peer->stratum >= 16) {
+        peer->reach |= 1;
+        return;
+    }
+    
+    int64_t offset, delay;
+    NTPPeerLogic::onWire(t1, t2, t3, t4, offset, delay);
+    NTPPeerLogic::addSample(*peer, offset, delay, millis());
+    
+    // Discipline holdover only when the filter picked this new sample
+    if (holdover.active && peer == &peers[sysPeer] && peer->offsetMicros == offset &&
+        peer->delayMicros == delay) {
+        disciplineHoldover(*peer, offset);
+    }
+}
+
+void NTP::disciplineHoldover(NTPPeer& peer, int64_t offsetMicros) {
+    uint64_t now = Timebase::micros64();
+    int64_t before = NTPPeerLogic::correctionAt(holdover, now);
+    NTPPeerLogic::discipline(holdover, offsetMicros, now);
+    int64_t applied = NTPPeerLogic::correctionAt(holdover, now) - before;
+    
+    // Keep stored samples relative to the corrected clock
+    for (uint8_t s = 0; s < NTP_PEER_FILTER_STAGES; s++) {
+        peer.samples[s].offsetMicros -= applied;
+    }
+    peer.offsetMicros -= applied;
+}
+
 uint8_t NTP::extractPollInterval(const byte* packet) {
     // Poll interval is in log2 seconds
     uint8_t poll = packet[2];
@@ -914,11 +2058,11 @@ void NTP::cleanupStaleClients() {
 
 void NTP::updateMetricsState() {
     bool wasServing = metrics.currentlyServing;
-    metrics.currentlyServing = isGPSQualitySufficient();
+    metrics.currentlyServing = hasTimeSource();
     
     if (metrics.currentlyServing && !wasServing) {
         metrics.servingStartTime = millis();
-        log("NTP: Now serving (GPS quality sufficient)");
+        log(holdover.active ? "NTP: Now serving (peer holdover)" : "NTP: Now serving (GPS quality sufficient)");
     } else if (!metrics.currentlyServing && wasServing) {
         metrics.lastServingStopTime = millis();
         log("NTP: Stopped serving (GPS quality insufficient)");
@@ -926,7 +2070,13 @@ void NTP::updateMetricsState() {
 }
 
 void NTP::updateConfig(const NTPConfig& cfg) {
+    bool peersChanged = cfg.peeringEnabled != config.peeringEnabled ||
+                        memcmp(cfg.peerIPs, config.peerIPs, sizeof(config.peerIPs)) != 0;
     config = cfg;
+    if (peersChanged) {
+        initPeers();
+    }
+    selectPipeline();
     log("NTP: Configuration updated");
 }
 
@@ -946,6 +2096,11 @@ String NTP::getStatusString() const {
         return "Disabled";
     }
     
+    if (holdover.active) {
+        return "Holdover - Stratum " + String(peers[sysPeer].stratum + 1) +
+               " via peer " + IPAddress(peers[sysPeer].ip).toString();
+    }
+    
     if (!isGPSQualitySufficient()) {
         const GPSData& gpsData = gpsRef->getData();
         
@@ -955,8 +2110,8 @@ String NTP::getStatusString() const {
         if (gpsData.satellites < config.minSatellites) {
             return "Low Satellites (" + String(gpsData.satellites) + ")";
         }
-        if (gpsData.hdop > config.maxHDOP) {
-            return "High HDOP (" + String(gpsData.hdop, 1) + ")";
+        if (gpsData.hdopX100 > config.maxHDOPX100) {
+            return "High HDOP (" + GPS::formatFixed(gpsData.hdopX100, 2) + ")";
         }
         if (gpsData.updateAge > config.maxFixAge) {
             return "Stale GPS Fix";
@@ -973,6 +2128,87 @@ void NTP::resetMetrics() {
     log("NTP: Metrics reset");
 }
 
+bool NTP::setCaptureEnabled(bool enabled) {
+    if (enabled && !capture) {
+        capture = new (std::nothrow) NTPCapture();
+        if (!capture) {
+            log("NTP: Not enough memory for packet capture");
+            return false;
+        }
+        capture->clear();
+        log("NTP: Packet capture enabled (" + String(NTP_CAPTURE_ENTRIES) + " exchanges)");
+    } else if (!enabled && capture) {
+        delete capture;
+        capture = nullptr;
+        log("NTP: Packet capture disabled");
+    }
+    selectPipeline();
+    return true;
+}
+
+void NTP::recordExchange(IPAddress clientIP, int port, uint64_t rxMicros,
+                         NTPCaptureVerdict verdict, const char* kod) {
+    if (!capture && !telemetry) {
+        return;
+    }
+    uint64_t txMicros = Timebase::micros64();
+    
+    if (capture) {
+        bool replied = (verdict != NTPCaptureVerdict::DROPPED);
+        capture->record((uint32_t)clientIP, port, packetBuffer, requestLength,
+                        replied ? responseBuffer : nullptr, responseLength,
+                        rxMicros, txMicros, verdict, kod);
+    }
+    if (telemetry) {
+        telemetry->append((uint32_t)clientIP, packetBuffer, requestLength > NTP_HEADER_SIZE,
+                          rxMicros, txMicros, verdict, kod);
+    }
+}
+
+void NTP::getCaptureClock(NTPCaptureClock& clock) const {
+    clock.nowMicros = Timebase::micros64();
+    clock.nowUnix = 0;
+    clock.nowUsec = 0;
+    
+    if (gpsRef && gpsRef->getData().timeValid) {
+        NTPTimestamp now = microsToNTP(clock.nowMicros);
+        clock.nowUnix = now.seconds - NTP_EPOCH_OFFSET;
+        clock.nowUsec = ((uint64_t)now.fraction * 1000000ULL) >> 32;
+    } else {
+        // No GPS time: uptime-based stamps still give correct spacing
+        clock.nowUnix = clock.nowMicros / 1000000UL;
+        clock.nowUsec = clock.nowMicros % 1000000UL;
+    }
+}
+
+uint32_t NTP::getLatencyBucketBound(uint8_t bucket) {
+    if (bucket >= NTP_LATENCY_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)NTP_LATENCY_BUCKET_BASE << bucket;
+}
+
+uint32_t NTP::getLatencyPercentile(const uint32_t* histogram, uint8_t percentile) {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < NTP_LATENCY_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    
+    // Rank of the requested sample, rounded up
+    uint32_t rank = ((uint64_t)total * percentile + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < NTP_LATENCY_BUCKETS; i++) {
+        seen += histogram[i];
+        if (seen >= rank) {
+            return getLatencyBucketBound(i);
+        }
+    }
+    return UINT32_MAX;
+}
+
 void NTP::setLogCallback(void (*callback)(String)) {
     logCallback = callback;
 }
@@ -0,0 +1,281 @@
+/*
+ * ============================================================================
+ * NTPCapture.h - NTP Packet Capture Ring with pcap Export
+ * ============================================================================
+ *
+ * Records the last NTP_CAPTURE_ENTRIES request/response pairs so a client's
+ * "bad time" complaint can be checked against exactly what it sent and what
+ * was answered, without a network tap.
+ *
+ * Features:
+ * - Fixed ring, allocated only while capture is enabled
+ * - Hot path cost: two 48-byte copies and a few stores per packet
+ * - Records answered requests, Kiss-o'-Death replies and silent drops
+ * - Exports as standard pcap (LINKTYPE_RAW): IPv4/UDP headers are
+ *   synthesized around the stored payloads, one record at a time, so the
+ *   download is streamed straight from the ring without staging
+ * - Filters by client IP and by KoD code
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_CAPTURE_H
+#define NTP_CAPTURE_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_CAPTURE_ENTRIES 64               // Request/response pairs kept
+#define NTP_CAPTURE_PAYLOAD 48               // Stored bytes per packet
+
+// pcap format
+#define PCAP_MAGIC 0xA1B2C3D4                // Microsecond timestamps
+#define PCAP_LINKTYPE_RAW 101                // Raw IPv4, no link header
+#define PCAP_GLOBAL_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+#define PCAP_IPV4_HEADER_LEN 20
+#define PCAP_UDP_HEADER_LEN 8
+#define PCAP_MAX_RECORD_LEN (PCAP_RECORD_HEADER_LEN + PCAP_IPV4_HEADER_LEN + PCAP_UDP_HEADER_LEN + NTP_CAPTURE_PAYLOAD)
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * What Happened to a Captured Request
+ */
+enum class NTPCaptureVerdict : uint8_t {
+    RESPONDED = 0,                           // Time response sent
+    KOD,                                     // Kiss-o'-Death sent (see kod code)
+    DROPPED                                  // No reply sent
+};
+
+/**
+ * One Captured Exchange
+ */
+struct NTPCaptureEntry {
+    uint32_t clientIP;                       // Client IPv4 (IPAddress order)
+    uint16_t clientPort;                     // Client UDP port
+    uint16_t requestLen;                     // Original request length
+    uint16_t responseLen;                    // Original response length (0 = none)
+    uint64_t rxMicros;                       // Timebase at receive
+    uint64_t txMicros;                       // Timebase at transmit
+    NTPCaptureVerdict verdict;               // Outcome
+    char kod[4];                             // KoD code when verdict == KOD
+    uint8_t request[NTP_CAPTURE_PAYLOAD];    // Request payload (truncated)
+    uint8_t response[NTP_CAPTURE_PAYLOAD];   // Response payload (if sent)
+};
+
+/**
+ * Export Filter
+ */
+struct NTPCaptureFilter {
+    uint32_t clientIP;                       // 0 = any client
+    char kod[5];                             // "" = any, "*" = any KoD, else code
+};
+
+/**
+ * Time Anchor for Export
+ * Maps timebase stamps to wall time at the moment of export
+ */
+struct NTPCaptureClock {
+    uint64_t nowMicros;                      // Timebase at export
+    uint32_t nowUnix;                        // Wall time seconds at nowMicros
+    uint32_t nowUsec;                        // Wall time microseconds at nowMicros
+};
+
+// ============================================================================
+// NTP CAPTURE CLASS
+// ============================================================================
+
+class NTPCapture {
+public:
+    /**
+     * Clear the ring
+     */
+    void clear() {
+        head = 0;
+        count = 0;
+        dropped = 0;
+    }
+
+    /**
+     * Record one exchange - hot path
+     * @param clientIP Client IPv4
+     * @param clientPort Client UDP port
+     * @param request Request payload
+     * @param requestLen Request length
+     * @param response Response payload (nullptr if none sent)
+     * @param responseLen Response length
+     * @param rxMicros Receive time
+     * @param txMicros Transmit time
+     * @param verdict Outcome
+     * @param kod KoD code (4 chars) or nullptr
+     */
+    void record(uint32_t clientIP, uint16_t clientPort, const uint8_t* request, uint16_t requestLen,
+                const uint8_t* response, uint16_t responseLen, uint64_t rxMicros, uint64_t txMicros,
+                NTPCaptureVerdict verdict, const char* kod) {
+        NTPCaptureEntry& e = entries[head];
+        e.clientIP = clientIP;
+        e.clientPort = clientPort;
+        e.requestLen = requestLen;
+        e.rxMicros = rxMicros;
+        e.txMicros = txMicros;
+        e.verdict = verdict;
+        if (kod) {
+            memcpy(e.kod, kod, 4);
+        } else {
+            memset(e.kod, 0, 4);
+        }
+        memcpy(e.request, request, min((uint16_t)NTP_CAPTURE_PAYLOAD, requestLen));
+        e.responseLen = response ? responseLen : 0;
+        if (response) {
+            memcpy(e.response, response, min((uint16_t)NTP_CAPTURE_PAYLOAD, responseLen));
+        }
+
+        head = (head + 1) % NTP_CAPTURE_ENTRIES;
+        if (count < NTP_CAPTURE_ENTRIES) {
+            count++;
+        } else {
+            dropped++;
+        }
+    }
+
+    /**
+     * Get number of stored entries
+     */
+    uint16_t size() const { return count; }
+
+    /**
+     * Get entries overwritten since the ring was cleared
+     */
+    uint32_t overwritten() const { return dropped; }
+
+    /**
+     * Get entry by age order
+     * @param index 0 = oldest
+     * @return Entry reference
+     */
+    const NTPCaptureEntry& at(uint16_t index) const {
+        uint16_t oldest = (head + NTP_CAPTURE_ENTRIES - count) % NTP_CAPTURE_ENTRIES;
+        return entries[(oldest + index) % NTP_CAPTURE_ENTRIES];
+    }
+
+    /**
+     * Check entry against filter
+     */
+    static bool matches(const NTPCaptureEntry& e, const NTPCaptureFilter& filter) {
+        if (filter.clientIP != 0 && e.clientIP != filter.clientIP) {
+            return false;
+        }
+        if (filter.kod[0] != '\0') {
+            if (e.verdict != NTPCaptureVerdict::KOD) {
+                return false;
+            }
+            if (filter.kod[0] != '*' && strncmp(e.kod, filter.kod, 4) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Write pcap global header
+     * @param out Buffer of at least PCAP_GLOBAL_HEADER_LEN bytes
+     * @return Bytes written
+     */
+    static size_t formatPcapHeader(uint8_t* out) {
+        putLE32(out + 0, PCAP_MAGIC);
+        putLE16(out + 4, 2);                 // Version 2.4
+        putLE16(out + 6, 4);
+        putLE32(out + 8, 0);                 // UTC
+        putLE32(out + 12, 0);                // Timestamp accuracy
+        putLE32(out + 16, 65535);            // Snap length
+        putLE32(out + 20, PCAP_LINKTYPE_RAW);
+        return PCAP_GLOBAL_HEADER_LEN;
+    }
+
+    /**
+     * Write one pcap record (record header + IPv4 + UDP + payload)
+     * @param out Buffer of at least PCAP_MAX_RECORD_LEN bytes
+     * @param e Captured entry
+     * @param isResponse false = request (client -> server), true = response
+     * @param serverIP Local IPv4 (IPAddress order)
+     * @param serverPort Local UDP port
+     * @param clock Time anchor for wall-clock timestamps
+     * @return Bytes written
+     */
+    static size_t formatPcapRecord(uint8_t* out, const NTPCaptureEntry& e, bool isResponse,
+                                   uint32_t serverIP, uint16_t serverPort, const NTPCaptureClock& clock) {
+        // Payloads beyond NTP_CAPTURE_PAYLOAD are truncated (snaplen-style)
+        uint16_t origPayloadLen = isResponse ? e.responseLen : e.requestLen;
+        uint16_t payloadLen = min((uint16_t)NTP_CAPTURE_PAYLOAD, origPayloadLen);
+        uint16_t ipLen = PCAP_IPV4_HEADER_LEN + PCAP_UDP_HEADER_LEN + payloadLen;
+        uint16_t origIpLen = PCAP_IPV4_HEADER_LEN + PCAP_UDP_HEADER_LEN + origPayloadLen;
+
+        // Wall time = export time minus packet age
+        uint64_t age = clock.nowMicros - (isResponse ? e.txMicros : e.rxMicros);
+        uint64_t wallUs = (uint64_t)clock.nowUnix * 1000000ULL + clock.nowUsec - age;
+
+        // Record header
+        putLE32(out + 0, (uint32_t)(wallUs / 1000000ULL));
+        putLE32(out + 4, (uint32_t)(wallUs % 1000000ULL));
+        putLE32(out + 8, ipLen);
+        putLE32(out + 12, origIpLen);
+
+        // IPv4 header
+        uint8_t* ip = out + PCAP_RECORD_HEADER_LEN;
+        uint32_t src = isResponse ? serverIP : e.clientIP;
+        uint32_t dst = isResponse ? e.clientIP : serverIP;
+        ip[0] = 0x45;                        // Version 4, IHL 5
+        ip[1] = 0;
+        putBE16(ip + 2, origIpLen);
+        putBE16(ip + 4, 0);                  // Identification
+        putBE16(ip + 6, 0x4000);             // Don't fragment
+        ip[8] = 64;                          // TTL
+        ip[9] = 17;                          // UDP
+        putBE16(ip + 10, 0);
+        memcpy(ip + 12, &src, 4);            // IPAddress stores octets in order
+        memcpy(ip + 16, &dst, 4);
+        putBE16(ip + 10, ipChecksum(ip));
+
+        // UDP header (checksum optional for IPv4)
+        uint8_t* udp = ip + PCAP_IPV4_HEADER_LEN;
+        putBE16(udp + 0, isResponse ? serverPort : e.clientPort);
+        putBE16(udp + 2, isResponse ? e.clientPort : serverPort);
+        putBE16(udp + 4, PCAP_UDP_HEADER_LEN + origPayloadLen);
+        putBE16(udp + 6, 0);
+
+        memcpy(udp + PCAP_UDP_HEADER_LEN, isResponse ? e.response : e.request, payloadLen);
+
+        return PCAP_RECORD_HEADER_LEN + ipLen;
+    }
+
+private:
+    NTPCaptureEntry entries[NTP_CAPTURE_ENTRIES];
+    uint16_t head = 0;                       // Next slot to write
+    uint16_t count = 0;                      // Valid entries
+    uint32_t dropped = 0;                    // Entries overwritten
+
+    static void putLE16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+    static void putLE32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+    static void putBE16(uint8_t* p, uint16_t v) { p[0] = v >> 8; p[1] = v; }
+
+    static uint16_t ipChecksum(const uint8_t* header) {
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < PCAP_IPV4_HEADER_LEN; i += 2) {
+            sum += ((uint16_t)header[i] << 8) | header[i + 1];
+        }
+        while (sum >> 16) {
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+        return ~sum;
+    }
+};
+
+#endif // NTP_CAPTURE_H
@@ -0,0 +1,190 @@
+/*
+ * ============================================================================
+ * NTPExtensions.h - NTPv4 Extension Field Walker
+ * ============================================================================
+ *
+ * Bounded, zero-copy parser for the extension fields (RFC 7822) that may
+ * follow the 48-byte NTP header, so requests from chrony and other NTPv4
+ * clients that carry extension fields are answered instead of dropped.
+ *
+ * Layout after the header:
+ *   [ EF: type(16) | length(16) | value ... ]*  [ legacy MAC (20 or 24) ]
+ *
+ * Rules enforced:
+ * - Length covers the 4-byte EF header, is a multiple of 4, is at least
+ *   NTP_EF_MIN_LENGTH and fits inside the packet
+ * - A trailing 20 or 24 byte block is a legacy MAC (key ID + digest),
+ *   not an extension field
+ * - Unknown types are skipped; the walk never reads past the packet
+ *
+ * Fields are returned as pointers into the receive buffer (no copies).
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_EXTENSIONS_H
+#define NTP_EXTENSIONS_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_HEADER_SIZE 48                   // Fixed NTP header
+#define NTP_MAX_PACKET_SIZE 512              // Largest request accepted
+#define NTP_EF_HEADER_SIZE 4                 // Type + length
+#define NTP_EF_MIN_LENGTH 16                 // RFC 7822 minimum field length
+#define NTP_MAC_MD5_SIZE 20                  // Key ID + 128-bit digest
+#define NTP_MAC_SHA1_SIZE 24                 // Key ID + 160-bit digest
+
+// Known extension field types
+#define NTP_EF_UNIQUE_ID 0x0104              // RFC 8915 Unique Identifier
+#define NTP_EF_NTS_COOKIE 0x0204             // RFC 8915 NTS Cookie
+#define NTP_EF_NTS_COOKIE_PLACEHOLDER 0x0304 // RFC 8915 Cookie Placeholder
+#define NTP_EF_NTS_AUTH 0x0404               // RFC 8915 Authenticator
+#define NTP_EF_CHRONY_MONO_ROOT 0xF323       // chrony experimental mono root
+#define NTP_EF_CHRONY_NET_CORRECTION 0xF324  // chrony experimental PTP correction
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Counter Index per Extension Field Type
+ */
+enum NTPExtensionCounter : uint8_t {
+    EF_COUNT_UNIQUE_ID = 0,
+    EF_COUNT_NTS_COOKIE,
+    EF_COUNT_NTS_PLACEHOLDER,
+    EF_COUNT_NTS_AUTH,
+    EF_COUNT_CHRONY_MONO_ROOT,
+    EF_COUNT_CHRONY_NET_CORRECTION,
+    EF_COUNT_MAC,                            // Legacy symmetric-key MAC
+    EF_COUNT_OTHER,                          // Unrecognized type
+    EF_COUNTERS
+};
+
+/**
+ * One Extension Field (view into the packet)
+ */
+struct NTPExtensionField {
+    uint16_t type;                           // Field type
+    uint16_t length;                         // Total length incl. 4-byte header
+    const uint8_t* field;                    // Start of field (type word)
+};
+
+// ============================================================================
+// EXTENSION FIELD WALKER
+// ============================================================================
+
+class NTPExtensionWalker {
+public:
+    /**
+     * Start a walk over the bytes following the NTP header
+     * @param packet Full packet (header included)
+     * @param length Packet length
+     */
+    NTPExtensionWalker(const uint8_t* packet, uint16_t length)
+        : data(packet), end(length), pos(NTP_HEADER_SIZE), error(false), mac(false) {
+        if (length < NTP_HEADER_SIZE) {
+            end = NTP_HEADER_SIZE;
+            error = true;
+        }
+    }
+
+    /**
+     * Advance to the next extension field
+     * @param ef Output field view
+     * @return True if a field was returned; false at end or on error
+     */
+    bool next(NTPExtensionField& ef) {
+        if (error || pos >= end) {
+            return false;
+        }
+
+        uint16_t remaining = end - pos;
+
+        // A trailing legacy MAC is not an extension field
+        if (remaining == NTP_MAC_MD5_SIZE || remaining == NTP_MAC_SHA1_SIZE) {
+            mac = true;
+            pos = end;
+            return false;
+        }
+
+        if (remaining < NTP_EF_MIN_LENGTH) {
+            error = true;
+            return false;
+        }
+
+        uint16_t type = ((uint16_t)data[pos] << 8) | data[pos + 1];
+        uint16_t length = ((uint16_t)data[pos + 2] << 8) | data[pos + 3];
+
+        if (length < NTP_EF_MIN_LENGTH || (length & 0x03) != 0 || length > remaining) {
+            error = true;
+            return false;
+        }
+
+        ef.type = type;
+        ef.length = length;
+        ef.field = data + pos;
+        pos += length;
+        return true;
+    }
+
+    /**
+     * Walk the remaining fields to validate the whole packet
+     * @return True if every field is well formed
+     */
+    bool validate() {
+        NTPExtensionField ef;
+        while (next(ef)) {
+        }
+        return !error;
+    }
+
+    bool isMalformed() const { return error; }
+    bool hasMAC() const { return mac; }
+
+    /**
+     * Map a field type to its counter index
+     */
+    static NTPExtensionCounter counterFor(uint16_t type) {
+        switch (type) {
+            case NTP_EF_UNIQUE_ID:              return EF_COUNT_UNIQUE_ID;
+            case NTP_EF_NTS_COOKIE:             return EF_COUNT_NTS_COOKIE;
+            case NTP_EF_NTS_COOKIE_PLACEHOLDER: return EF_COUNT_NTS_PLACEHOLDER;
+            case NTP_EF_NTS_AUTH:               return EF_COUNT_NTS_AUTH;
+            case NTP_EF_CHRONY_MONO_ROOT:       return EF_COUNT_CHRONY_MONO_ROOT;
+            case NTP_EF_CHRONY_NET_CORRECTION:  return EF_COUNT_CHRONY_NET_CORRECTION;
+            default:                            return EF_COUNT_OTHER;
+        }
+    }
+
+    /**
+     * Get counter name for export
+     */
+    static const char* counterName(uint8_t counter) {
+        switch (counter) {
+            case EF_COUNT_UNIQUE_ID:             return "unique_id";
+            case EF_COUNT_NTS_COOKIE:            return "nts_cookie";
+            case EF_COUNT_NTS_PLACEHOLDER:       return "nts_cookie_placeholder";
+            case EF_COUNT_NTS_AUTH:              return "nts_authenticator";
+            case EF_COUNT_CHRONY_MONO_ROOT:      return "chrony_mono_root";
+            case EF_COUNT_CHRONY_NET_CORRECTION: return "chrony_net_correction";
+            case EF_COUNT_MAC:                   return "legacy_mac";
+            default:                             return "other";
+        }
+    }
+
+private:
+    const uint8_t* data;
+    uint16_t end;
+    uint16_t pos;
+    bool error;
+    bool mac;
+};
+
+#endif // NTP_EXTENSIONS_H
@@ -0,0 +1,212 @@
+/*
+ * ============================================================================
+ * NTPNeighbors.h - Software Neighbor (ARP) Cache for NTP Replies
+ * ============================================================================
+ *
+ * The W5500 resolves the destination MAC of a UDP socket by ARP whenever
+ * the destination IP changes, and it keeps no ARP table across sends.
+ * Replies alternate between clients, so nearly every SEND pays an ARP
+ * round trip (milliseconds, and the full retry timeout if the host has
+ * gone away).
+ *
+ * This cache is fed by the chip's own ARP activity: after a normal SEND
+ * completes, Sn_DHAR holds the MAC the chip resolved. Later replies to the
+ * same next hop write that MAC back into Sn_DHAR and use SEND_MAC, which
+ * skips ARP entirely.
+ *
+ * Entries are keyed by next hop, not by client: every off-subnet client
+ * shares the gateway's entry, so one ARP exchange covers all of them.
+ *
+ * SEND_MAC cannot tell us that a MAC is stale (the frame just goes to the
+ * old address), so entries expire after NTP_NEIGHBOR_TTL_MS and are then
+ * re-learned through one normal SEND.
+ *
+ * Packet I/O lives in NTPSocket.h; this file has no I/O.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_NEIGHBORS_H
+#define NTP_NEIGHBORS_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_NEIGHBOR_ENTRIES 16              // Next hops cached
+#define NTP_NEIGHBOR_TTL_MS 300000           // Re-learn after 5 minutes
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * One Cached Next Hop
+ */
+struct NTPNeighbor {
+    uint32_t ip;                             // Next-hop IPv4 (IPAddress order), 0 = unused
+    uint8_t mac[6];                          // Resolved MAC
+    uint32_t learnedMillis;                  // When the chip resolved it
+    uint32_t lastUsedMillis;                 // For replacement
+    uint32_t hits;                           // Replies sent without ARP
+};
+
+/**
+ * Cache Statistics
+ */
+struct NTPNeighborStats {
+    uint32_t hits;                           // Next hop found
+    uint32_t misses;                         // Not cached, ARP needed
+    uint32_t expired;                        // Found but past TTL
+    uint32_t learned;                        // Entries added or refreshed
+    uint32_t evicted;                        // Live entries replaced
+};
+
+// ============================================================================
+// NEIGHBOR CACHE CLASS
+// ============================================================================
+
+class NTPNeighborCache {
+public:
+    /**
+     * Set the local network used to pick the next hop
+     * Flushes the cache if the network changed
+     */
+    void setNetwork(uint32_t localIP, uint32_t subnetMask, uint32_t gatewayIP) {
+        if (localIP != local || subnetMask != mask || gatewayIP != gateway) {
+            flush();
+        }
+        local = localIP;
+        mask = subnetMask;
+        gateway = gatewayIP;
+    }
+
+    /**
+     * Next hop for a destination: itself on-subnet, else the gateway
+     * @return Next-hop IPv4, 0 if not cacheable (broadcast, multicast,
+     *         or off-subnet with no gateway)
+     */
+    uint32_t nextHop(uint32_t destIP) const {
+        // IPAddress order: first octet is the low byte
+        if (destIP == 0xFFFFFFFF || (destIP & 0xF0) == 0xE0 ||
+            (mask != 0 && (destIP & ~mask) == ~mask)) {
+            return 0;
+        }
+        if (mask == 0 || (destIP & mask) == (local & mask)) {
+            return destIP;
+        }
+        return gateway;
+    }
+
+    /**
+     * Look up the MAC for a destination - hot path
+     * @param destIP Destination IPv4 (IPAddress order)
+     * @param mac Receives the MAC on a hit
+     * @return True on a fresh hit
+     */
+    bool lookup(uint32_t destIP, uint8_t* mac, uint32_t nowMillis) {
+        uint32_t hop = nextHop(destIP);
+        if (hop != 0) {
+            for (uint8_t i = 0; i < NTP_NEIGHBOR_ENTRIES; i++) {
+                NTPNeighbor& n = entries[i];
+                if (n.ip != hop) continue;
+
+                if (nowMillis - n.learnedMillis >= NTP_NEIGHBOR_TTL_MS) {
+                    n.ip = 0;
+                    stats.expired++;
+                    break;
+                }
+                memcpy(mac, n.mac, 6);
+                n.lastUsedMillis = nowMillis;
+                n.hits++;
+                stats.hits++;
+                return true;
+            }
+        }
+        stats.misses++;
+        return false;
+    }
+
+    /**
+     * Record the MAC the chip resolved for a destination
+     * Replaces the least recently used entry when full
+     */
+    void learn(uint32_t destIP, const uint8_t* mac, uint32_t nowMillis) {
+        uint32_t hop = nextHop(destIP);
+        if (hop == 0 || !isUnicast(mac)) {
+            return;
+        }
+
+        int8_t slot = -1;
+        for (uint8_t i = 0; i < NTP_NEIGHBOR_ENTRIES; i++) {
+            if (entries[i].ip == hop) {
+                slot = i;
+                break;
+            }
+            if (slot < 0 && entries[i].ip == 0) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            slot = 0;
+            for (uint8_t i = 1; i < NTP_NEIGHBOR_ENTRIES; i++) {
+                if ((int32_t)(entries[i].lastUsedMillis - entries[slot].lastUsedMillis) < 0) {
+                    slot = i;
+                }
+            }
+            stats.evicted++;
+        }
+
+        NTPNeighbor& n = entries[slot];
+        if (n.ip != hop) {
+            n.hits = 0;
+        }
+        n.ip = hop;
+        memcpy(n.mac, mac, 6);
+        n.learnedMillis = nowMillis;
+        n.lastUsedMillis = nowMillis;
+        stats.learned++;
+    }
+
+    /**
+     * Forget every entry
+     */
+    void flush() {
+        memset(entries, 0, sizeof(entries));
+    }
+
+    const NTPNeighbor& at(uint8_t index) const { return entries[index]; }
+    const NTPNeighborStats& getStats() const { return stats; }
+
+    /**
+     * Count live entries
+     */
+    uint8_t size() const {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < NTP_NEIGHBOR_ENTRIES; i++) {
+            if (entries[i].ip != 0) n++;
+        }
+        return n;
+    }
+
+private:
+    NTPNeighbor entries[NTP_NEIGHBOR_ENTRIES] = {};
+    uint32_t local = 0;
+    uint32_t mask = 0;
+    uint32_t gateway = 0;
+    NTPNeighborStats stats = {};
+
+    // Reject all-zero (ARP never completed) and multicast/broadcast MACs
+    static bool isUnicast(const uint8_t* mac) {
+        if (mac[0] & 0x01) {
+            return false;
+        }
+        return (mac[0] | mac[1] | mac[2] | mac[3] | mac[4] | mac[5]) != 0;
+    }
+};
+
+#endif // NTP_NEIGHBORS_H
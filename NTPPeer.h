@@ -0,0 +1,327 @@
+/*
+ * ============================================================================
+ * NTPPeer.h - Symmetric Peering State, Clock Filter and Selection
+ * ============================================================================
+ *
+ * Units deployed in pairs exchange NTP symmetric active/passive packets
+ * (modes 1/2, RFC 5905) so that a unit that loses its GPS receiver can keep
+ * serving, disciplined to its peer at stratum 2, until the receiver
+ * recovers.
+ *
+ * This file holds the protocol-independent parts, with no I/O:
+ * - Per-peer on-wire state (org/rec/xmt) and peer-reported variables
+ * - Reachability register and an 8-stage minimum-delay clock filter
+ * - Root distance and clock selection (reachable, synchronized, no loop,
+ *   lowest stratum, then lowest root distance)
+ * - Holdover discipline: phase and frequency correction of the local clock
+ *
+ * Packet I/O and the decision to follow a peer live in NTP.h. Peers are
+ * addressed by unit IP, so peering is not used with virtual IP failover
+ * (Failover.h), where the master has no unit IP.
+ *
+ * All offsets are int64 microseconds so they stay exact across the ~126
+ * year gap between an unset clock (epoch 1900) and real time.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_PEER_H
+#define NTP_PEER_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_MAX_PEERS 2                      // Configured peers
+#define NTP_PEER_POLL 4                      // Poll exponent (2^4 = 16 s)
+#define NTP_PEER_FILTER_STAGES 8             // Clock filter depth
+#define NTP_PEER_MAX_DISTANCE_US 1500000     // Max root distance to select (1.5 s)
+#define NTP_PEER_STEP_US 128000              // Step instead of slew above 128 ms
+#define NTP_PEER_MAX_FREQ_PPM 500.0f         // Frequency correction clamp
+#define NTP_PEER_PHI_PPM 15                  // Dispersion growth rate (15 us/s)
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Peer Selection State
+ */
+enum class NTPPeerState : uint8_t {
+    UNREACHABLE = 0,                         // No valid packet in last 8 polls
+    REJECTED,                                // Reachable but not usable
+    CANDIDATE,                               // Usable, not selected
+    SYSPEER                                  // Selected time source
+};
+
+/**
+ * One Clock Filter Sample
+ */
+struct NTPPeerSample {
+    int64_t offsetMicros;                    // Measured offset (peer - local)
+    int64_t delayMicros;                     // Round-trip delay
+    uint32_t takenMillis;                    // When measured
+    bool valid;
+};
+
+/**
+ * Peer Association
+ */
+struct NTPPeer {
+    uint32_t ip;                             // Peer IPv4 (IPAddress order), 0 = unused
+
+    // On-wire state (64-bit NTP timestamps, 32.32)
+    uint64_t org;                            // Peer transmit time of last packet received
+    uint64_t rec;                            // Local receive time of last packet received
+    uint64_t xmt;                            // Local transmit time of last packet sent
+
+    // Peer-reported variables
+    uint8_t leap;                            // Leap indicator (3 = unsynchronized)
+    uint8_t stratum;                         // Peer stratum
+    uint8_t mode;                            // Last mode received (1 or 2)
+    uint32_t refID;                          // Peer reference ID (raw, network order)
+    uint32_t rootDelayMicros;                // Peer root delay
+    uint32_t rootDispersionMicros;           // Peer root dispersion
+
+    // Clock filter
+    NTPPeerSample samples[NTP_PEER_FILTER_STAGES];
+    uint8_t nextSample;
+    int64_t offsetMicros;                    // Filtered offset
+    int64_t delayMicros;                     // Filtered delay
+    uint32_t jitterMicros;                   // RMS offset spread in filter
+    uint32_t updateMillis;                   // When the filtered sample was taken
+
+    // Reachability and selection
+    uint8_t reach;                           // Shift register, bit 0 = last poll
+    uint32_t lastPollMillis;                 // Last poll sent
+    NTPPeerState state;
+
+    // Counters
+    uint32_t sent;
+    uint32_t received;
+    uint32_t duplicates;                     // Transmit timestamp already seen
+    uint32_t bogus;                          // Origin did not match our transmit
+};
+
+/**
+ * Holdover Discipline
+ * Correction added to the local clock while following a peer
+ */
+struct NTPHoldover {
+    bool active;                             // Following a peer
+    int64_t phaseMicros;                     // Correction at anchorMicros
+    float freqPPM;                           // Correction rate
+    uint64_t anchorMicros;                   // Timebase when phase was set
+    uint64_t lastUpdateMicros;               // Previous discipline update
+    uint32_t steps;                          // Phase steps taken
+};
+
+// ============================================================================
+// PEER LOGIC
+// ============================================================================
+
+class NTPPeerLogic {
+public:
+    /**
+     * Reset a peer association (keeps the address)
+     */
+    static void reset(NTPPeer& peer) {
+        uint32_t ip = peer.ip;
+        memset(&peer, 0, sizeof(NTPPeer));
+        peer.ip = ip;
+        peer.stratum = 16;
+        peer.leap = 3;
+    }
+
+    /**
+     * Convert a 64-bit NTP timestamp to microseconds
+     */
+    static int64_t toMicros(uint64_t ts) {
+        return (int64_t)(ts >> 32) * 1000000LL + (int64_t)(((ts & 0xFFFFFFFFULL) * 1000000ULL) >> 32);
+    }
+
+    /**
+     * Difference a - b of two NTP timestamps in microseconds
+     */
+    static int64_t diffMicros(uint64_t a, uint64_t b) {
+        return toMicros(a) - toMicros(b);
+    }
+
+    /**
+     * Compute offset/delay from the four on-wire timestamps
+     * @param t1 Local transmit (peer's origin)
+     * @param t2 Peer receive
+     * @param t3 Peer transmit
+     * @param t4 Local receive
+     */
+    static void onWire(uint64_t t1, uint64_t t2, uint64_t t3, uint64_t t4,
+                       int64_t& offsetMicros, int64_t& delayMicros) {
+        offsetMicros = (diffMicros(t2, t1) + diffMicros(t3, t4)) / 2;
+        delayMicros = diffMicros(t4, t1) - diffMicros(t3, t2);
+        if (delayMicros < 0) {
+            delayMicros = 0;
+        }
+    }
+
+    /**
+     * Shift the reachability register at each poll
+     * Clears the filter when the peer becomes unreachable
+     */
+    static void shiftReach(NTPPeer& peer) {
+        peer.reach <<= 1;
+        if (peer.reach == 0) {
+            for (uint8_t i = 0; i < NTP_PEER_FILTER_STAGES; i++) {
+                peer.samples[i].valid = false;
+            }
+        }
+    }
+
+    /**
+     * Add a sample and pick the minimum-delay sample as the peer estimate
+     */
+    static void addSample(NTPPeer& peer, int64_t offsetMicros, int64_t delayMicros, uint32_t nowMillis) {
+        NTPPeerSample& s = peer.samples[peer.nextSample];
+        s.offsetMicros = offsetMicros;
+        s.delayMicros = delayMicros;
+        s.takenMillis = nowMillis;
+        s.valid = true;
+        peer.nextSample = (peer.nextSample + 1) % NTP_PEER_FILTER_STAGES;
+        peer.reach |= 1;
+
+        // Minimum delay sample has the least queuing error
+        int8_t best = -1;
+        for (uint8_t i = 0; i < NTP_PEER_FILTER_STAGES; i++) {
+            if (!peer.samples[i].valid) continue;
+            if (best < 0 || peer.samples[i].delayMicros < peer.samples[best].delayMicros) {
+                best = i;
+            }
+        }
+
+        peer.offsetMicros = peer.samples[best].offsetMicros;
+        peer.delayMicros = peer.samples[best].delayMicros;
+        peer.updateMillis = peer.samples[best].takenMillis;
+
+        // Jitter: RMS of offset differences from the selected sample
+        float sum = 0;
+        uint8_t n = 0;
+        for (uint8_t i = 0; i < NTP_PEER_FILTER_STAGES; i++) {
+            if (!peer.samples[i].valid || i == best) continue;
+            float d = (float)(peer.samples[i].offsetMicros - peer.offsetMicros);
+            sum += d * d;
+            n++;
+        }
+        peer.jitterMicros = n > 0 ? (uint32_t)sqrtf(sum / n) : 0;
+    }
+
+    /**
+     * Root distance: half the total delay plus all dispersion
+     */
+    static uint32_t rootDistanceMicros(const NTPPeer& peer, uint32_t nowMillis) {
+        uint32_t ageSeconds = (nowMillis - peer.updateMillis) / 1000;
+        uint64_t distance = ((uint64_t)peer.rootDelayMicros + (uint64_t)peer.delayMicros) / 2
+                          + peer.rootDispersionMicros
+                          + peer.jitterMicros
+                          + (uint64_t)ageSeconds * NTP_PEER_PHI_PPM;
+        return distance > UINT32_MAX ? UINT32_MAX : (uint32_t)distance;
+    }
+
+    /**
+     * Select the system peer
+     * @param peers Peer array
+     * @param count Number of peers
+     * @param localIP Own IPv4, used to detect a peer synchronized to us
+     * @param nowMillis Current millis()
+     * @return Index of the selected peer, -1 if none is usable
+     */
+    static int8_t select(NTPPeer* peers, uint8_t count, uint32_t localIP, uint32_t nowMillis) {
+        int8_t best = -1;
+
+        for (uint8_t i = 0; i < count; i++) {
+            NTPPeer& p = peers[i];
+            if (p.ip == 0) continue;
+
+            if (p.reach == 0) {
+                p.state = NTPPeerState::UNREACHABLE;
+                continue;
+            }
+
+            bool usable = p.leap != 3
+                       && p.stratum >= 1 && p.stratum < 15
+                       && p.refID != localIP
+                       && p.updateMillis != 0
+                       && rootDistanceMicros(p, nowMillis) < NTP_PEER_MAX_DISTANCE_US;
+            if (!usable) {
+                p.state = NTPPeerState::REJECTED;
+                continue;
+            }
+
+            p.state = NTPPeerState::CANDIDATE;
+            if (best < 0 || p.stratum < peers[best].stratum ||
+                (p.stratum == peers[best].stratum &&
+                 rootDistanceMicros(p, nowMillis) < rootDistanceMicros(peers[best], nowMillis))) {
+                best = i;
+            }
+        }
+
+        if (best >= 0) {
+            peers[best].state = NTPPeerState::SYSPEER;
+        }
+        return best;
+    }
+
+    /**
+     * Current holdover correction
+     */
+    static int64_t correctionAt(const NTPHoldover& h, uint64_t nowMicros) {
+        if (!h.active) {
+            return 0;
+        }
+        int64_t elapsed = (int64_t)(nowMicros - h.anchorMicros);
+        return h.phaseMicros + (int64_t)((double)h.freqPPM * elapsed / 1000000.0);
+    }
+
+    /**
+     * Discipline the holdover correction with a new peer offset
+     * Large offsets step; small ones slew half the phase and nudge frequency
+     * @param offsetMicros Peer offset measured against the corrected clock
+     */
+    static void discipline(NTPHoldover& h, int64_t offsetMicros, uint64_t nowMicros) {
+        int64_t current = correctionAt(h, nowMicros);
+
+        if (offsetMicros > NTP_PEER_STEP_US || offsetMicros < -NTP_PEER_STEP_US) {
+            h.phaseMicros = current + offsetMicros;
+            h.freqPPM = 0;
+            h.steps++;
+        } else {
+            h.phaseMicros = current + offsetMicros / 2;
+
+            uint64_t interval = nowMicros - h.lastUpdateMicros;
+            if (h.lastUpdateMicros != 0 && interval > 1000000) {
+                h.freqPPM += 0.25f * (float)offsetMicros * 1000000.0f / (float)interval;
+                h.freqPPM = constrain(h.freqPPM, -NTP_PEER_MAX_FREQ_PPM, NTP_PEER_MAX_FREQ_PPM);
+            }
+        }
+
+        h.anchorMicros = nowMicros;
+        h.lastUpdateMicros = nowMicros;
+    }
+
+    /**
+     * Get selection state name for export
+     */
+    static const char* stateString(NTPPeerState state) {
+        switch (state) {
+            case NTPPeerState::UNREACHABLE: return "unreachable";
+            case NTPPeerState::REJECTED:    return "rejected";
+            case NTPPeerState::CANDIDATE:   return "candidate";
+            case NTPPeerState::SYSPEER:     return "syspeer";
+            default:                        return "unknown";
+        }
+    }
+};
+
+#endif // NTP_PEER_H
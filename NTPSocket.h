@@ -0,0 +1,404 @@
+/*
+ * ============================================================================
+ * NTPSocket.h - Pipelined UDP Socket for the NTP Server (W5500)
+ * ============================================================================
+ *
+ * Drop-in EthernetUDP whose endPacket() issues the W5500 SEND command and
+ * returns immediately instead of spinning until SEND_OK. The loop goes
+ * straight back to reading and validating the next request while the
+ * chip transmits, and completion is collected later from the socket
+ * interrupt register.
+ *
+ * Why: a blocking SEND includes ARP resolution for a destination not in
+ * the W5500's cache, which can take milliseconds (or the full retry
+ * timeout for a host that has gone away). With one request handled per
+ * loop pass, that wait caps the sustainable request rate.
+ *
+ * Modes:
+ * - Blocking (pipelined off): identical to EthernetUDP
+ * - Pipelined, one socket: SEND overlaps the next receive; the next
+ *   beginPacket() waits only if the previous SEND is still running
+ *   (acquire() does that wait up front, before a timestamp is taken)
+ * - Pipelined, two sockets: a second socket bound to the same port takes
+ *   the next response while the first is still sending (e.g. stuck in
+ *   ARP). Packets the chip delivers to the second socket are read too.
+ *
+ * Neighbor cache (either mode): replies to a next hop whose MAC the chip
+ * resolved recently are sent with SEND_MAC, skipping ARP (NTPNeighbors.h).
+ *
+ * SEND completion times are kept as a histogram, split by whether the
+ * reply needed ARP. In blocking mode they are exact; in pipelined mode
+ * completion is seen at the next poll, so they are an upper bound.
+ *
+ * The Ethernet library keeps the socket index in EthernetUDP::sockindex
+ * (protected), which is why the sockets are subclasses.
+ *
+ * Dependencies: Ethernet (EthernetUdp.h, utility/w5100.h), Timebase.h,
+ *               NTPNeighbors.h
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_SOCKET_H
+#define NTP_SOCKET_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ethernet.h>
+#include <EthernetUdp.h>
+#include <utility/w5100.h>
+#include "Timebase.h"
+#include "NTPNeighbors.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_SOCKET_MAX 2                     // Sockets bound to the NTP port
+#define NTP_SOCKET_HIST_BUCKETS 5            // SEND latency histogram buckets
+
+// Histogram bucket upper bounds (us); the last bucket is open-ended
+#define NTP_SOCKET_HIST_BOUNDS {100, 500, 2000, 10000}
+
+// Histogram rows
+#define NTP_SOCKET_HIST_ARP 0                // Normal SEND (chip resolved MAC)
+#define NTP_SOCKET_HIST_CACHED 1             // SEND_MAC with cached MAC
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Socket Statistics
+ */
+struct NTPSocketStats {
+    uint32_t sends;                          // SEND commands issued
+    uint32_t sendTimeouts;                   // SEND ended in TIMEOUT (ARP failed)
+    uint32_t sendWaits;                      // acquire()/beginPacket() waited for a SEND
+    uint32_t waitMicros;                     // Total time spent in those waits
+    uint32_t peakSendMicros;                 // Longest SEND -> SEND_OK observed
+    uint32_t altReceived;                    // Requests read from the second socket
+    uint32_t sendLatency[2][NTP_SOCKET_HIST_BUCKETS]; // SEND -> completion, by row
+};
+
+// ============================================================================
+// NTP SOCKET CLASS
+// ============================================================================
+
+class NTPSocket : public EthernetUDP {
+public:
+    /**
+     * Enable or disable pipelined sends
+     * Waits for any SEND in flight before switching
+     * @param enabled Pipelined (asynchronous) SEND
+     * @param sockets Sockets bound to the port (1 or 2)
+     */
+    void setPipelined(bool enabled, uint8_t sockets) {
+        drain();
+        acquired = false;
+        pipelined = enabled;
+        sockets = constrain(sockets, 1, NTP_SOCKET_MAX);
+        socketCount = enabled ? sockets : 1;
+
+        if (socketCount > 1 && !altOpen && localPort() != 0) {
+            altOpen = alt.begin(localPort()) != 0;
+            if (!altOpen) {
+                socketCount = 1;
+            }
+        } else if (socketCount == 1 && altOpen) {
+            alt.stop();
+            altOpen = false;
+        }
+    }
+
+    /**
+     * Enable or disable the neighbor (ARP) cache
+     * Waits for any SEND in flight; disabling forgets every entry
+     */
+    void setNeighborCache(bool enabled) {
+        drain();
+        neighborsEnabled = enabled;
+        if (!enabled) {
+            neighbors.flush();
+        }
+    }
+
+    bool isNeighborCacheEnabled() const { return neighborsEnabled; }
+    const NTPNeighborCache& getNeighbors() const { return neighbors; }
+
+    /**
+     * Get histogram bucket upper bound (us), 0 for the open last bucket
+     */
+    static uint32_t histogramBound(uint8_t bucket) {
+        static const uint32_t bounds[NTP_SOCKET_HIST_BUCKETS - 1] = NTP_SOCKET_HIST_BOUNDS;
+        return bucket < NTP_SOCKET_HIST_BUCKETS - 1 ? bounds[bucket] : 0;
+    }
+
+    bool isPipelined() const { return pipelined; }
+    uint8_t getSocketCount() const { return socketCount; }
+    const NTPSocketStats& getStats() const { return stats; }
+
+    /**
+     * Average wait in beginPacket() (us), 0 if none
+     */
+    uint32_t getAverageWaitMicros() const {
+        return stats.sendWaits ? stats.waitMicros / stats.sendWaits : 0;
+    }
+
+    // ========================================================================
+    // EthernetUDP overrides
+    // ========================================================================
+
+    uint8_t begin(uint16_t port) override {
+        refreshNetwork();
+        uint8_t ok = EthernetUDP::begin(port);
+        if (ok && socketCount > 1) {
+            altOpen = alt.begin(port) != 0;
+            if (!altOpen) {
+                socketCount = 1;
+            }
+        }
+        return ok;
+    }
+
+    void stop() override {
+        drain();
+        if (altOpen) {
+            alt.stop();
+            altOpen = false;
+        }
+        EthernetUDP::stop();
+    }
+
+    int parsePacket() override {
+        collect();
+
+        rxFromAlt = false;
+        int size = EthernetUDP::parsePacket();
+        if (size <= 0 && altOpen) {
+            size = alt.parsePacket();
+            if (size > 0) {
+                rxFromAlt = true;
+                stats.altReceived++;
+            }
+        }
+        return size;
+    }
+
+    int available() override { return rxFromAlt ? alt.available() : EthernetUDP::available(); }
+    int read() override { return rxFromAlt ? alt.read() : EthernetUDP::read(); }
+    int read(unsigned char* buffer, size_t len) override {
+        return rxFromAlt ? alt.read(buffer, len) : EthernetUDP::read(buffer, len);
+    }
+    int peek() override { return rxFromAlt ? alt.peek() : EthernetUDP::peek(); }
+    IPAddress remoteIP() override { return rxFromAlt ? alt.remoteIP() : EthernetUDP::remoteIP(); }
+    uint16_t remotePort() override { return rxFromAlt ? alt.remotePort() : EthernetUDP::remotePort(); }
+
+    int beginPacket(IPAddress ip, uint16_t port) override {
+        txIP = (uint32_t)ip;
+        if (!pipelined) {
+            txAlt = false;
+            return EthernetUDP::beginPacket(ip, port);
+        }
+
+        // Slot chosen by acquire() is still free: nothing can have used it since
+        if (!acquired) {
+            acquire();
+        }
+        acquired = false;
+        return txAlt ? alt.beginPacket(ip, port) : EthernetUDP::beginPacket(ip, port);
+    }
+
+    size_t write(uint8_t byte) override {
+        return txAlt ? alt.write(byte) : EthernetUDP::write(byte);
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return txAlt ? alt.write(buffer, size) : EthernetUDP::write(buffer, size);
+    }
+
+    int endPacket() override {
+        if (!pipelined && !neighborsEnabled) {
+            return EthernetUDP::endPacket();
+        }
+
+        uint8_t slot = txAlt ? 1 : 0;
+        startSend(slot);
+        if (!pipelined) {
+            return complete(slot) ? 1 : 0;
+        }
+
+        // Pipelined: return now, completion is collected later
+        return 1;
+    }
+
+    /**
+     * Wait until a socket is free for the next send, without sending
+     * Call before stamping a transmit timestamp: the following
+     * beginPacket() then never blocks, so the wait for a previous
+     * SEND (possibly a full ARP timeout) is not inside the timestamp
+     */
+    void acquire() {
+        if (!pipelined || acquired) {
+            return;
+        }
+
+        collect();
+
+        // Prefer an idle socket; otherwise wait for the oldest SEND
+        if (!busy[0]) {
+            txAlt = false;
+        } else if (socketCount > 1 && !busy[1]) {
+            txAlt = true;
+        } else {
+            txAlt = socketCount > 1 && sendStart[1] < sendStart[0];
+            waitFor(txAlt ? 1 : 0);
+        }
+        acquired = true;
+    }
+
+    /**
+     * Collect finished SENDs without blocking
+     * Called from parsePacket(), so once per loop pass
+     */
+    void collect() {
+        for (uint8_t slot = 0; slot < NTP_SOCKET_MAX; slot++) {
+            if (busy[slot]) {
+                poll(slot);
+            }
+        }
+    }
+
+    /**
+     * Wait for every SEND in flight
+     */
+    void drain() {
+        for (uint8_t slot = 0; slot < NTP_SOCKET_MAX; slot++) {
+            if (busy[slot]) {
+                waitFor(slot);
+            }
+        }
+    }
+
+private:
+    // Second socket: exposes the Ethernet library's socket index
+    class AltSocket : public EthernetUDP {
+    public:
+        uint8_t index() const { return sockindex; }
+    };
+
+    AltSocket alt;
+    bool altOpen = false;
+    bool pipelined = false;
+    uint8_t socketCount = 1;
+    bool rxFromAlt = false;                  // Current receive came from alt
+    bool txAlt = false;                      // Current send goes to alt
+    bool acquired = false;                   // acquire() reserved the txAlt slot
+    bool busy[NTP_SOCKET_MAX] = {false, false};
+    bool cachedSend[NTP_SOCKET_MAX] = {false, false}; // Sent with SEND_MAC
+    bool timedOut[NTP_SOCKET_MAX] = {false, false};   // Last SEND ended in TIMEOUT
+    uint32_t sendIP[NTP_SOCKET_MAX] = {0, 0};
+    uint64_t sendStart[NTP_SOCKET_MAX] = {0, 0};
+    uint32_t txIP = 0;                       // Destination of the current send
+    NTPSocketStats stats = {};
+
+    bool neighborsEnabled = false;
+    NTPNeighborCache neighbors;
+
+    uint8_t socketIndex(uint8_t slot) const {
+        return slot == 0 ? sockindex : alt.index();
+    }
+
+    void refreshNetwork() {
+        neighbors.setNetwork((uint32_t)Ethernet.localIP(), (uint32_t)Ethernet.subnetMask(),
+                             (uint32_t)Ethernet.gatewayIP());
+    }
+
+    // Issue SEND, or SEND_MAC when the next hop's MAC is cached
+    void startSend(uint8_t slot) {
+        uint8_t s = socketIndex(slot);
+        uint8_t mac[6];
+        bool cached = neighborsEnabled && neighbors.lookup(txIP, mac, millis());
+
+        SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+        if (cached) {
+            W5100.writeSnDHAR(s, mac);
+            W5100.execCmdSn(s, Sock_SEND_MAC);
+        } else {
+            W5100.execCmdSn(s, Sock_SEND);
+        }
+        SPI.endTransaction();
+
+        busy[slot] = true;
+        cachedSend[slot] = cached;
+        sendIP[slot] = txIP;
+        sendStart[slot] = Timebase::micros64();
+        stats.sends++;
+    }
+
+    // Check one SEND; returns true when it has finished
+    bool poll(uint8_t slot) {
+        uint8_t s = socketIndex(slot);
+        uint8_t mac[6];
+        bool learn = false;
+
+        SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+        uint8_t ir = W5100.readSnIR(s);
+        if (ir & (SnIR::SEND_OK | SnIR::TIMEOUT)) {
+            W5100.writeSnIR(s, SnIR::SEND_OK | SnIR::TIMEOUT);
+            // After a normal SEND, Sn_DHAR holds the MAC the chip resolved
+            learn = neighborsEnabled && !cachedSend[slot] && (ir & SnIR::SEND_OK);
+            if (learn) {
+                W5100.readSnDHAR(s, mac);
+            }
+        }
+        SPI.endTransaction();
+
+        if (!(ir & (SnIR::SEND_OK | SnIR::TIMEOUT))) {
+            return false;
+        }
+
+        timedOut[slot] = (ir & SnIR::TIMEOUT) != 0;
+        if (timedOut[slot]) {
+            stats.sendTimeouts++;
+        }
+        if (learn) {
+            refreshNetwork();                // Miss path only; picks up DHCP changes
+            neighbors.learn(sendIP[slot], mac, millis());
+        }
+
+        uint32_t took = (uint32_t)(Timebase::micros64() - sendStart[slot]);
+        if (took > stats.peakSendMicros) {
+            stats.peakSendMicros = took;
+        }
+        uint8_t bucket = 0;
+        while (bucket < NTP_SOCKET_HIST_BUCKETS - 1 && took >= histogramBound(bucket)) {
+            bucket++;
+        }
+        stats.sendLatency[cachedSend[slot] ? NTP_SOCKET_HIST_CACHED : NTP_SOCKET_HIST_ARP][bucket]++;
+
+        busy[slot] = false;
+        return true;
+    }
+
+    // Block until a SEND finishes; returns false on TIMEOUT
+    // (same semantics as EthernetUDP::endPacket)
+    bool complete(uint8_t slot) {
+        while (!poll(slot)) {
+            yield();
+        }
+        return !timedOut[slot];
+    }
+
+    // Wait for a SEND that is in the way of the next one
+    void waitFor(uint8_t slot) {
+        uint64_t start = Timebase::micros64();
+        complete(slot);
+        stats.sendWaits++;
+        stats.waitMicros += (uint32_t)(Timebase::micros64() - start);
+    }
+};
+
+#endif // NTP_SOCKET_H
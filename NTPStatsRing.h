@@ -0,0 +1,129 @@
+/*
+ * ============================================================================
+ * NTPStatsRing.h - Lock-free Statistics Queue for the NTP Response Path
+ * ============================================================================
+ *
+ * The response path pushes one fixed-size record per answered request
+ * into a single-producer/single-consumer ring. An aggregation step folds
+ * the records into metrics, histograms and per-client statistics when the
+ * loop has time, so the float averages and table lookups no longer sit
+ * between one client's reply and the next client's receive.
+ *
+ * Features:
+ * - Push never blocks: a full ring drops the record and counts it
+ * - Power-of-two ring, indices free-running (no modulo, no full/empty flag)
+ * - Acquire/release on the indices, so producer and consumer may run on
+ *   different cores; today both run in the loop task
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_STATS_RING_H
+#define NTP_STATS_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_STATS_RING_SIZE 64               // Records (power of two)
+#define NTP_STATS_NO_INTERVAL 0xFFFFFFFF     // Record carries no client interval
+
+static_assert((NTP_STATS_RING_SIZE & (NTP_STATS_RING_SIZE - 1)) == 0,
+              "NTP_STATS_RING_SIZE must be a power of two");
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * One Answered Request (20 bytes)
+ */
+struct NTPStatsRecord {
+    uint32_t clientIP;                       // Client IPv4 (IPAddress order)
+    uint32_t latencyMicros;                  // Receive -> transmit
+    uint32_t serviceMillis;                  // Response path duration
+    uint32_t intervalMillis;                 // Since client's previous request, or NTP_STATS_NO_INTERVAL
+    uint8_t version;                         // Request NTP version
+    uint8_t stratum;                         // Request stratum
+    uint8_t pollInterval;                    // Request poll exponent
+    uint8_t reserved;
+};
+
+/**
+ * Queue Statistics
+ */
+struct NTPStatsRingStats {
+    uint32_t pushed;                         // Records queued
+    uint32_t dropped;                        // Ring full, record lost
+    uint32_t folded;                         // Records aggregated
+    uint16_t peakDepth;                      // Highest fill level seen
+};
+
+// ============================================================================
+// STATS RING CLASS
+// ============================================================================
+
+class NTPStatsRing {
+public:
+    /**
+     * Queue a record - producer, hot path
+     * @return False if the ring was full (record dropped)
+     */
+    bool push(const NTPStatsRecord& record) {
+        uint32_t head = headIndex.load(std::memory_order_relaxed);
+        uint32_t tail = tailIndex.load(std::memory_order_acquire);
+        uint32_t depth = head - tail;
+        if (depth >= NTP_STATS_RING_SIZE) {
+            stats.dropped++;
+            return false;
+        }
+
+        records[head & (NTP_STATS_RING_SIZE - 1)] = record;
+        headIndex.store(head + 1, std::memory_order_release);
+
+        stats.pushed++;
+        if (depth + 1 > stats.peakDepth) {
+            stats.peakDepth = depth + 1;
+        }
+        return true;
+    }
+
+    /**
+     * Take the oldest record - consumer
+     * @return False if the ring is empty
+     */
+    bool pop(NTPStatsRecord& record) {
+        uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+        uint32_t head = headIndex.load(std::memory_order_acquire);
+        if (tail == head) {
+            return false;
+        }
+
+        record = records[tail & (NTP_STATS_RING_SIZE - 1)];
+        tailIndex.store(tail + 1, std::memory_order_release);
+        stats.folded++;
+        return true;
+    }
+
+    /**
+     * Records waiting to be folded
+     */
+    uint16_t depth() const {
+        return headIndex.load(std::memory_order_acquire) - tailIndex.load(std::memory_order_acquire);
+    }
+
+    const NTPStatsRingStats& getStats() const { return stats; }
+
+private:
+    NTPStatsRecord records[NTP_STATS_RING_SIZE];
+    std::atomic<uint32_t> headIndex{0};      // Next slot to write (producer)
+    std::atomic<uint32_t> tailIndex{0};      // Next slot to read (consumer)
+    NTPStatsRingStats stats = {};            // pushed/dropped: producer; folded: consumer
+};
+
+#endif // NTP_STATS_RING_H
@@ -0,0 +1,304 @@
+/*
+ * ============================================================================
+ * NTPTelemetry.h - Per-Request NTP Telemetry Export
+ * ============================================================================
+ *
+ * Ships one compact binary record per NTP request to a UDP collector, so
+ * capacity planning across many units can work from individual requests
+ * instead of the aggregate counters in NTPMetrics.
+ *
+ * Features:
+ * - Hot path is a single append to a fixed ring (no I/O, no allocation)
+ * - Records are batched into MTU-sized datagrams and shipped from
+ *   process(), at most one datagram per call
+ * - A partial batch is flushed after NTP_TELEMETRY_FLUSH_MS
+ * - Loss is counted (ring full, send failure) and carried in every
+ *   datagram header, together with a sequence number
+ * - Ring is allocated only while the exporter is running
+ *
+ * Wire format (all fields big-endian):
+ *
+ *   Datagram header, 24 bytes
+ *     0  magic           "NTPT"
+ *     4  version         u8   (1)
+ *     5  record length   u8   (16)
+ *     6  record count    u16
+ *     8  sequence        u32  (+1 per datagram; gaps = lost datagrams)
+ *    12  export seconds  u32  (Unix time; seconds since boot before GPS time)
+ *    16  export usec     u32
+ *    20  lost records    u32  (cumulative, never sent)
+ *
+ *   Record, 16 bytes
+ *     0  client IPv4     4 bytes
+ *     4  age             u32  (receive -> export, microseconds)
+ *     8  latency         u16  (receive -> transmit, microseconds, saturating)
+ *    10  LI/VN/mode      u8   (first byte of the request)
+ *    11  poll            i8   (request poll exponent)
+ *    12  outcome         u8   (0 responded, 1 KoD, 2 dropped)
+ *    13  KoD code        u8   (0 none, 1 RATE, 2 DENY, 3 RSTR, 255 other)
+ *    14  flags           u8   (bit 0 = request carried extension fields)
+ *    15  reserved        u8
+ *
+ * Receive wall time = export time - age. Any UDP listener can stand in
+ * for a collector during testing, e.g. `nc -ul 9123 | xxd`.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_TELEMETRY_H
+#define NTP_TELEMETRY_H
+
+#include <Arduino.h>
+#include <new>
+#include <EthernetUdp.h>
+#include "NTPCapture.h"
+#include "Timebase.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_TELEMETRY_RING 256               // Records buffered between shipments
+#define NTP_TELEMETRY_FLUSH_MS 1000          // Max age of a partial batch
+#define NTP_TELEMETRY_DEFAULT_PORT 9123      // Collector UDP port
+#define NTP_TELEMETRY_LOCAL_PORT 9124        // Local source port
+
+// Wire format
+#define NTP_TELEMETRY_MAGIC 0x4E545054       // "NTPT"
+#define NTP_TELEMETRY_VERSION 1
+#define NTP_TELEMETRY_HEADER_LEN 24
+#define NTP_TELEMETRY_RECORD_LEN 16
+#define NTP_TELEMETRY_MAX_DATAGRAM 1472      // 1500 MTU - IPv4 - UDP
+#define NTP_TELEMETRY_BATCH ((NTP_TELEMETRY_MAX_DATAGRAM - NTP_TELEMETRY_HEADER_LEN) / NTP_TELEMETRY_RECORD_LEN)
+
+// KoD codes on the wire
+#define NTP_TELEMETRY_KOD_NONE 0
+#define NTP_TELEMETRY_KOD_RATE 1
+#define NTP_TELEMETRY_KOD_DENY 2
+#define NTP_TELEMETRY_KOD_RSTR 3
+#define NTP_TELEMETRY_KOD_OTHER 255
+
+// Record flags
+#define NTP_TELEMETRY_FLAG_EXTENSIONS 0x01
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * One Buffered Request Record
+ */
+struct NTPTelemetryRecord {
+    uint64_t rxMicros;                       // Timebase at receive
+    uint32_t clientIP;                       // Client IPv4 (IPAddress order)
+    uint16_t latencyMicros;                  // Receive -> transmit (saturating)
+    uint8_t livnmode;                        // Request LI/VN/mode byte
+    int8_t poll;                             // Request poll exponent
+    uint8_t outcome;                         // NTPCaptureVerdict value
+    uint8_t kodCode;                         // NTP_TELEMETRY_KOD_*
+    uint8_t flags;                           // NTP_TELEMETRY_FLAG_*
+};
+
+/**
+ * Exporter Statistics
+ */
+struct NTPTelemetryStats {
+    uint32_t recordsQueued;                  // Appended to the ring
+    uint32_t recordsSent;                    // Shipped in a datagram
+    uint32_t recordsLost;                    // Ring full or send failed
+    uint32_t datagramsSent;
+    uint32_t sendFailures;
+};
+
+// ============================================================================
+// NTP TELEMETRY CLASS
+// ============================================================================
+
+class NTPTelemetry {
+public:
+    ~NTPTelemetry() {
+        end();
+    }
+
+    /**
+     * Start exporting
+     * Allocates the ring and opens the local UDP socket
+     * @param collectorIP Collector address
+     * @param collectorPort Collector UDP port
+     * @return True if running
+     */
+    bool begin(IPAddress collectorIP, uint16_t collectorPort) {
+        collector = collectorIP;
+        port = collectorPort;
+
+        if (!ring) {
+            ring = new (std::nothrow) NTPTelemetryRecord[NTP_TELEMETRY_RING];
+            if (!ring) {
+                return false;
+            }
+            udp.begin(NTP_TELEMETRY_LOCAL_PORT);
+        }
+        head = 0;
+        count = 0;
+        memset(&stats, 0, sizeof(stats));
+        sequence = 0;
+        return true;
+    }
+
+    /**
+     * Stop exporting and free the ring (pending records are discarded)
+     */
+    void end() {
+        if (ring) {
+            delete[] ring;
+            ring = nullptr;
+            udp.stop();
+        }
+        count = 0;
+    }
+
+    bool isRunning() const { return ring != nullptr; }
+
+    /**
+     * Queue one request record - hot path
+     * @param clientIP Client IPv4 (IPAddress order)
+     * @param request Request packet (at least 48 bytes)
+     * @param extensions Request carried extension fields
+     * @param rxMicros Receive time (Timebase)
+     * @param txMicros Transmit time (Timebase)
+     * @param outcome NTPCaptureVerdict value
+     * @param kod KoD code (4 chars) or nullptr
+     */
+    void append(uint32_t clientIP, const uint8_t* request, bool extensions,
+                uint64_t rxMicros, uint64_t txMicros, NTPCaptureVerdict outcome, const char* kod) {
+        if (!ring) {
+            return;
+        }
+        if (count >= NTP_TELEMETRY_RING) {
+            stats.recordsLost++;
+            return;
+        }
+
+        NTPTelemetryRecord& r = ring[(head + count) % NTP_TELEMETRY_RING];
+        uint64_t latency = txMicros - rxMicros;
+        r.rxMicros = rxMicros;
+        r.clientIP = clientIP;
+        r.latencyMicros = latency > 0xFFFF ? 0xFFFF : (uint16_t)latency;
+        r.livnmode = request[0];
+        r.poll = (int8_t)request[2];
+        r.outcome = (uint8_t)outcome;
+        r.kodCode = kodCodeFor(kod);
+        r.flags = extensions ? NTP_TELEMETRY_FLAG_EXTENSIONS : 0;
+
+        if (count == 0) {
+            batchStartMillis = millis();
+        }
+        count++;
+        stats.recordsQueued++;
+    }
+
+    /**
+     * Check whether a datagram is due (full batch or flush timeout)
+     */
+    bool shouldShip(uint32_t nowMillis) const {
+        if (!ring || count == 0) {
+            return false;
+        }
+        return count >= NTP_TELEMETRY_BATCH || nowMillis - batchStartMillis >= NTP_TELEMETRY_FLUSH_MS;
+    }
+
+    /**
+     * Ship one datagram of up to NTP_TELEMETRY_BATCH records
+     * @param clock Wall-clock anchor for the export time
+     */
+    void ship(const NTPCaptureClock& clock) {
+        uint16_t batch = min((uint16_t)NTP_TELEMETRY_BATCH, count);
+        if (!ring || batch == 0) {
+            return;
+        }
+
+        uint8_t datagram[NTP_TELEMETRY_MAX_DATAGRAM];
+        putBE32(datagram + 0, NTP_TELEMETRY_MAGIC);
+        datagram[4] = NTP_TELEMETRY_VERSION;
+        datagram[5] = NTP_TELEMETRY_RECORD_LEN;
+        putBE16(datagram + 6, batch);
+        putBE32(datagram + 8, sequence);
+        putBE32(datagram + 12, clock.nowUnix);
+        putBE32(datagram + 16, clock.nowUsec);
+        putBE32(datagram + 20, stats.recordsLost);
+
+        uint8_t* out = datagram + NTP_TELEMETRY_HEADER_LEN;
+        for (uint16_t i = 0; i < batch; i++) {
+            const NTPTelemetryRecord& r = ring[(head + i) % NTP_TELEMETRY_RING];
+            uint64_t age = clock.nowMicros - r.rxMicros;
+            memcpy(out, &r.clientIP, 4);     // IPAddress stores octets in order
+            putBE32(out + 4, age > UINT32_MAX ? UINT32_MAX : (uint32_t)age);
+            putBE16(out + 8, r.latencyMicros);
+            out[10] = r.livnmode;
+            out[11] = (uint8_t)r.poll;
+            out[12] = r.outcome;
+            out[13] = r.kodCode;
+            out[14] = r.flags;
+            out[15] = 0;
+            out += NTP_TELEMETRY_RECORD_LEN;
+        }
+
+        // Records leave the ring whether or not the send succeeds
+        head = (head + batch) % NTP_TELEMETRY_RING;
+        count -= batch;
+        sequence++;
+
+        // Leftover records keep their age: the flush timer restarts from
+        // the oldest one's arrival, not from now
+        if (count > 0) {
+            uint64_t oldestAge = clock.nowMicros - ring[head].rxMicros;
+            batchStartMillis = millis() - (uint32_t)(oldestAge / 1000);
+        }
+
+        bool sent = udp.beginPacket(collector, port)
+                 && udp.write(datagram, out - datagram) == (size_t)(out - datagram)
+                 && udp.endPacket();
+        if (sent) {
+            stats.datagramsSent++;
+            stats.recordsSent += batch;
+        } else {
+            stats.sendFailures++;
+            stats.recordsLost += batch;
+        }
+    }
+
+    uint16_t pending() const { return count; }
+    const NTPTelemetryStats& getStats() const { return stats; }
+    IPAddress getCollector() const { return collector; }
+    uint16_t getCollectorPort() const { return port; }
+
+    /**
+     * Map a 4-character KoD code to its wire value
+     */
+    static uint8_t kodCodeFor(const char* kod) {
+        if (!kod || kod[0] == '\0')       return NTP_TELEMETRY_KOD_NONE;
+        if (strncmp(kod, "RATE", 4) == 0) return NTP_TELEMETRY_KOD_RATE;
+        if (strncmp(kod, "DENY", 4) == 0) return NTP_TELEMETRY_KOD_DENY;
+        if (strncmp(kod, "RSTR", 4) == 0) return NTP_TELEMETRY_KOD_RSTR;
+        return NTP_TELEMETRY_KOD_OTHER;
+    }
+
+private:
+    EthernetUDP udp;
+    IPAddress collector;
+    uint16_t port = NTP_TELEMETRY_DEFAULT_PORT;
+
+    NTPTelemetryRecord* ring = nullptr;
+    uint16_t head = 0;                       // Oldest pending record
+    uint16_t count = 0;                      // Pending records
+    uint32_t batchStartMillis = 0;           // When the oldest pending record arrived
+    uint32_t sequence = 0;                   // Next datagram sequence number
+    NTPTelemetryStats stats = {};
+
+    static void putBE16(uint8_t* p, uint16_t v) { p[0] = v >> 8; p[1] = v; }
+    static void putBE32(uint8_t* p, uint32_t v) { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+};
+
+#endif // NTP_TELEMETRY_H
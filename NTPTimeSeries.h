@@ -0,0 +1,165 @@
+/*
+ * ============================================================================
+ * NTPTimeSeries.h - Fixed-Memory NTP Traffic Time Series
+ * ============================================================================
+ *
+ * Per-interval request/response/drop/KoD counts for charting load patterns
+ * (diurnal load, top-of-the-hour cron herds, post-outage bursts) and for
+ * capacity planning.
+ *
+ * Two rings, both statically sized:
+ * - Last 10 minutes at 1 second resolution   (600 bins)
+ * - Last 24 hours at 1 minute resolution     (1440 bins)
+ *
+ * Recording is O(1): one millis() read, a compare, and two saturating
+ * 16-bit increments. Bins skipped while idle are zeroed lazily when the
+ * ring next advances (bounded by the ring length).
+ *
+ * Memory: (600 + 1440) bins x 4 counters x 2 bytes = ~16 KB
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef NTP_TIME_SERIES_H
+#define NTP_TIME_SERIES_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define NTP_SERIES_SECONDS 600               // 10 minutes at 1 s
+#define NTP_SERIES_MINUTES 1440              // 24 hours at 1 min
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Counter Index
+ */
+enum NTPSeriesCounter : uint8_t {
+    SERIES_REQUESTS = 0,                     // Packets received
+    SERIES_RESPONSES,                        // Time responses sent
+    SERIES_DROPS,                            // Received but not answered
+    SERIES_KOD,                              // Kiss-o'-Death sent
+    SERIES_COUNTERS
+};
+
+/**
+ * One Time Bin
+ * Counters saturate at 65535
+ */
+struct NTPSeriesBin {
+    uint16_t counts[SERIES_COUNTERS];
+};
+
+/**
+ * Ring of Time Bins
+ */
+template <uint16_t SIZE>
+struct NTPSeriesRing {
+    NTPSeriesBin bins[SIZE];
+    uint16_t head;                           // Index of current (newest) bin
+    uint32_t headPeriod;                     // Period number of current bin
+
+    void reset(uint32_t period) {
+        memset(bins, 0, sizeof(bins));
+        head = 0;
+        headPeriod = period;
+    }
+
+    // Move head forward to 'period', zeroing every bin passed over
+    void advance(uint32_t period) {
+        uint32_t steps = period - headPeriod;
+        if (steps == 0) {
+            return;
+        }
+        if (steps > SIZE) {
+            steps = SIZE;
+        }
+        for (uint32_t i = 0; i < steps; i++) {
+            head = (head + 1) % SIZE;
+            memset(&bins[head], 0, sizeof(NTPSeriesBin));
+        }
+        headPeriod = period;
+    }
+
+    void increment(NTPSeriesCounter counter) {
+        uint16_t& c = bins[head].counts[counter];
+        if (c != UINT16_MAX) {
+            c++;
+        }
+    }
+
+    // Bin 'age' periods before the current one (0 = current)
+    const NTPSeriesBin& ago(uint16_t age) const {
+        return bins[(head + SIZE - (age % SIZE)) % SIZE];
+    }
+};
+
+// ============================================================================
+// TIME SERIES CLASS
+// ============================================================================
+
+class NTPTimeSeries {
+public:
+    /**
+     * Clear both rings and anchor them to the current time
+     */
+    void begin() {
+        uint32_t now = millis() / 1000;
+        seconds.reset(now);
+        minutes.reset(now / 60);
+    }
+
+    /**
+     * Count one event in the current second and minute - hot path
+     * @param counter Counter to increment
+     */
+    void record(NTPSeriesCounter counter) {
+        tick();
+        seconds.increment(counter);
+        minutes.increment(counter);
+    }
+
+    /**
+     * Advance rings to the current time without counting
+     * Call periodically so idle periods read as zero
+     */
+    void tick() {
+        uint32_t now = millis() / 1000;
+        if (now != seconds.headPeriod) {
+            seconds.advance(now);
+            minutes.advance(now / 60);
+        }
+    }
+
+    // Ring access (oldest = ago(SIZE - 1), newest = ago(0))
+    const NTPSeriesRing<NTP_SERIES_SECONDS>& getSeconds() const { return seconds; }
+    const NTPSeriesRing<NTP_SERIES_MINUTES>& getMinutes() const { return minutes; }
+
+    /**
+     * Get counter name for export
+     * @param counter Counter index
+     * @return Short name
+     */
+    static const char* counterName(uint8_t counter) {
+        switch (counter) {
+            case SERIES_REQUESTS:  return "requests";
+            case SERIES_RESPONSES: return "responses";
+            case SERIES_DROPS:     return "drops";
+            case SERIES_KOD:       return "kod";
+            default:               return "unknown";
+        }
+    }
+
+private:
+    NTPSeriesRing<NTP_SERIES_SECONDS> seconds;
+    NTPSeriesRing<NTP_SERIES_MINUTES> minutes;
+};
+
+#endif // NTP_TIME_SERIES_H
@@ -0,0 +1,422 @@
+/*
+ * ============================================================================
+ * OTA.h - Streaming Firmware Update for ESP32
+ * ============================================================================
+ *
+ * Receives a firmware image over HTTP and writes it straight to the
+ * inactive app partition as it arrives - the image is never buffered in
+ * RAM, so its size is not limited by ATOM_MAX_REQUEST_SIZE.
+ *
+ * Features:
+ * - Streaming write to the inactive OTA partition (Update library)
+ * - Incremental SHA-256 over the received image, checked against the
+ *   X-Firmware-SHA256 request header before the partition is activated
+ * - Bounded RAM: one fixed chunk buffer
+ * - Cooperative yielding between chunks so GPS/NTP keep being serviced
+ * - A/B rollback: a new image must be healthy by OTA_CONFIRM_TIMEOUT_MS
+ *   and stay healthy for OTA_CONFIRM_DELAY_MS, otherwise the previous
+ *   image is restored
+ *   (requires a bootloader built with app rollback enabled)
+ * - Progress metrics for /api/ota/status
+ *
+ * Usage:
+ *   curl -X POST --data-binary @firmware.bin \
+ *        -H "X-Firmware-SHA256: $(sha256sum firmware.bin | cut -d' ' -f1)" \
+ *        http://<device>/api/ota
+ *
+ * The endpoint has the same trust model as /config/save: anyone who can
+ * reach the web server can upload. Restrict access at the network level.
+ *
+ * Note: flash sector erases (~45 ms each) still block the CPU; NTP
+ * requests arriving during an erase are answered after it completes.
+ *
+ * Dependencies: Atom.h (streaming routes), Update.h, mbedtls, esp_ota_ops.h
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef OTA_H
+#define OTA_H
+
+#include <Arduino.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include "Atom.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define OTA_CHUNK_SIZE 1460                  // Receive buffer (one TCP segment)
+#define OTA_IDLE_TIMEOUT_MS 15000            // Abort if no data for this long
+#define OTA_CONFIRM_DELAY_MS 60000           // Healthy this long before confirming
+#define OTA_CONFIRM_TIMEOUT_MS 300000        // Roll back if not healthy by then
+#define OTA_REBOOT_DELAY_MS 1000             // Let the response flush first
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * OTA State
+ */
+enum class OTAState : uint8_t {
+    IDLE = 0,                                // No update in progress
+    RECEIVING,                               // Writing image to flash
+    REBOOTING,                               // Image accepted, restart pending
+    FAILED,                                  // Last update failed
+    PENDING_VERIFY,                          // New image running, not yet confirmed
+    CONFIRMED                                // New image confirmed after update
+};
+
+/**
+ * OTA Progress
+ */
+struct OTAProgress {
+    OTAState state;                          // Current state
+    uint32_t imageSize;                      // Expected image size (bytes)
+    uint32_t received;                       // Bytes written so far
+    uint32_t startTime;                      // Upload start (ms)
+    uint32_t durationMs;                     // Upload duration (ms)
+    uint32_t chunks;                         // Chunks written
+    uint32_t yields;                         // Yield callbacks while receiving
+    uint32_t peakChunkMicros;                // Slowest chunk write (us)
+    char sha256[65];                         // Hex digest of last image
+    char error[64];                          // Last error message
+
+    // Lifetime
+    uint32_t updatesSucceeded;               // Accepted images this boot
+    uint32_t updatesFailed;                  // Rejected images this boot
+    bool rollbackSupported;                  // Bootloader supports rollback
+    char runningPartition[17];               // Label of running partition
+};
+
+// ============================================================================
+// OTA CLASS
+// ============================================================================
+
+class OTA {
+public:
+    // ========================================================================
+    // PUBLIC API
+    // ========================================================================
+
+    /**
+     * Initialize - checks whether the running image awaits confirmation
+     */
+    void begin();
+
+    /**
+     * Periodic processing - call in main loop()
+     * Confirms or rolls back a pending image and performs deferred reboot
+     * @param healthy True when the application considers itself healthy
+     */
+    void process(bool healthy);
+
+    /**
+     * Streaming upload handler - register with Atom::addStreamingRoute()
+     * @param req Request (body not yet read)
+     * @param res Response
+     */
+    void handleUpload(WebRequest& req, WebResponse& res);
+
+    /**
+     * Set callback run between chunks while receiving
+     * @param callback Function that services time-critical work
+     */
+    void setYieldCallback(void (*callback)()) { yieldCallback = callback; }
+
+    /**
+     * Get progress and status
+     * @return Reference to progress structure
+     */
+    const OTAProgress& getProgress() const { return progress; }
+
+    /**
+     * Get state name
+     * @param state OTA state
+     * @return Human-readable state
+     */
+    static const char* stateString(OTAState state);
+
+    /**
+     * Set optional logging callback
+     * @param callback Function pointer: void logFunc(String message)
+     */
+    void setLogCallback(void (*callback)(String));
+
+private:
+    // ========================================================================
+    // INTERNAL STATE
+    // ========================================================================
+
+    OTAProgress progress;                    // Progress and status
+    uint8_t chunkBuffer[OTA_CHUNK_SIZE];     // Single receive buffer
+    uint32_t rebootAt = 0;                   // Deferred reboot time (ms)
+    uint32_t healthySince = 0;               // When health was first seen (ms)
+
+    void (*yieldCallback)() = nullptr;       // Cooperative yield
+    void (*logCallback)(String) = nullptr;   // Optional logging
+
+    // ========================================================================
+    // INTERNAL METHODS
+    // ========================================================================
+
+    void fail(WebResponse& res, int code, const String& message);
+    static bool parseHexDigest(const String& hex, uint8_t* digest);
+    void log(const String& message);
+};
+
+// ============================================================================
+// IMPLEMENTATION
+// ============================================================================
+
+// Keep the new image in PENDING_VERIFY at boot; OTA::process() confirms it
+// once the application is healthy (weak default in the core confirms it
+// immediately)
+extern "C" bool verifyRollbackLater() {
+    return true;
+}
+
+void OTA::begin() {
+    memset(&progress, 0, sizeof(progress));
+    progress.state = OTAState::IDLE;
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (running) {
+        strncpy(progress.runningPartition, running->label, sizeof(progress.runningPartition) - 1);
+    }
+
+#ifdef CONFIG_APP_ROLLBACK_ENABLE
+    progress.rollbackSupported = true;
+    esp_ota_img_states_t otaState;
+    if (running && esp_ota_get_state_partition(running, &otaState) == ESP_OK &&
+        otaState == ESP_OTA_IMG_PENDING_VERIFY) {
+        progress.state = OTAState::PENDING_VERIFY;
+        log("OTA: New image on " + String(progress.runningPartition) + " awaiting confirmation");
+    }
+#endif
+}
+
+void OTA::process(bool healthy) {
+    uint32_t now = millis();
+
+    if (progress.state == OTAState::REBOOTING && now - rebootAt >= OTA_REBOOT_DELAY_MS) {
+        log("OTA: Rebooting into new image");
+        delay(100);
+        ESP.restart();
+    }
+
+#ifdef CONFIG_APP_ROLLBACK_ENABLE
+    if (progress.state != OTAState::PENDING_VERIFY) {
+        return;
+    }
+
+    if (!healthy) {
+        healthySince = 0;
+    } else if (healthySince == 0) {
+        healthySince = now;
+    }
+
+    if (healthySince != 0 && now - healthySince >= OTA_CONFIRM_DELAY_MS) {
+        esp_ota_mark_app_valid_cancel_rollback();
+        progress.state = OTAState::CONFIRMED;
+        log("OTA: New image confirmed");
+    } else if (healthySince == 0 && now >= OTA_CONFIRM_TIMEOUT_MS) {
+        // Healthy by the deadline is enough; the confirm delay may run past it
+        log("OTA: New image not healthy - rolling back");
+        delay(100);
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+#else
+    (void)healthy;
+#endif
+}
+
+void OTA::handleUpload(WebRequest& req, WebResponse& res) {
+    if (progress.state == OTAState::RECEIVING || progress.state == OTAState::REBOOTING) {
+        res.send(409, "application/json", "{\"error\":\"Update already in progress\"}");
+        return;
+    }
+#ifdef CONFIG_APP_ROLLBACK_ENABLE
+    if (progress.state == OTAState::PENDING_VERIFY) {
+        res.send(409, "application/json", "{\"error\":\"Running image not yet confirmed\"}");
+        return;
+    }
+#endif
+
+    uint8_t expected[32];
+    if (!parseHexDigest(req.getHeader("X-Firmware-SHA256"), expected)) {
+        fail(res, 400, "Missing or invalid X-Firmware-SHA256 header");
+        return;
+    }
+
+    long imageSize = req.getContentLength();
+    if (imageSize <= 0) {
+        fail(res, 411, "Content-Length required");
+        return;
+    }
+
+    if (!Update.begin(imageSize, U_FLASH)) {
+        fail(res, 413, "Image does not fit: " + String(Update.errorString()));
+        return;
+    }
+
+    progress.state = OTAState::RECEIVING;
+    progress.imageSize = imageSize;
+    progress.received = 0;
+    progress.chunks = 0;
+    progress.yields = 0;
+    progress.peakChunkMicros = 0;
+    progress.sha256[0] = '\0';
+    progress.error[0] = '\0';
+    progress.startTime = millis();
+    log("OTA: Receiving " + String(imageSize) + " bytes");
+
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+
+    uint32_t lastData = millis();
+    bool writeFailed = false;
+
+    while (req.getBodyRemaining() > 0) {
+        int bytesRead = req.readBodyChunk(chunkBuffer, sizeof(chunkBuffer));
+
+        if (bytesRead < 0) {
+            break;  // Connection closed early
+        }
+
+        if (bytesRead == 0) {
+            if (millis() - lastData > OTA_IDLE_TIMEOUT_MS) {
+                break;
+            }
+            // Nothing buffered yet - service GPS/NTP while waiting
+            if (yieldCallback) {
+                yieldCallback();
+                progress.yields++;
+            }
+            continue;
+        }
+
+        uint32_t chunkStart = micros();
+        mbedtls_sha256_update(&sha, chunkBuffer, bytesRead);
+        if (Update.write(chunkBuffer, bytesRead) != (size_t)bytesRead) {
+            writeFailed = true;
+            break;
+        }
+        uint32_t chunkMicros = micros() - chunkStart;
+        if (chunkMicros > progress.peakChunkMicros) {
+            progress.peakChunkMicros = chunkMicros;
+        }
+
+        progress.received += bytesRead;
+        progress.chunks++;
+        lastData = millis();
+
+        // Service GPS/NTP between chunks
+        if (yieldCallback) {
+            yieldCallback();
+            progress.yields++;
+        }
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    progress.durationMs = millis() - progress.startTime;
+
+    for (uint8_t i = 0; i < 32; i++) {
+        sprintf(&progress.sha256[i * 2], "%02x", digest[i]);
+    }
+
+    if (writeFailed) {
+        Update.abort();
+        fail(res, 500, "Flash write failed: " + String(Update.errorString()));
+        return;
+    }
+
+    if (progress.received != (uint32_t)imageSize) {
+        Update.abort();
+        fail(res, 400, "Upload incomplete: " + String(progress.received) + " of " + String(imageSize) + " bytes");
+        return;
+    }
+
+    if (memcmp(digest, expected, sizeof(digest)) != 0) {
+        Update.abort();
+        fail(res, 422, "SHA-256 mismatch");
+        return;
+    }
+
+    // Validates the image header and switches the boot partition
+    if (!Update.end(true)) {
+        fail(res, 500, "Image rejected: " + String(Update.errorString()));
+        return;
+    }
+
+    progress.state = OTAState::REBOOTING;
+    progress.updatesSucceeded++;
+    rebootAt = millis();
+    log("OTA: Image accepted (" + String(progress.received) + " bytes, " +
+        String(progress.durationMs) + " ms), rebooting");
+
+    res.send(200, "application/json",
+             "{\"status\":\"ok\",\"bytes\":" + String(progress.received) +
+             ",\"sha256\":\"" + String(progress.sha256) + "\",\"rebooting\":true}");
+}
+
+void OTA::fail(WebResponse& res, int code, const String& message) {
+    progress.state = OTAState::FAILED;
+    progress.updatesFailed++;
+    strncpy(progress.error, message.c_str(), sizeof(progress.error) - 1);
+    progress.error[sizeof(progress.error) - 1] = '\0';
+    log("OTA: " + message);
+
+    res.send(code, "application/json", "{\"error\":\"" + String(progress.error) + "\"}");
+}
+
+bool OTA::parseHexDigest(const String& hex, uint8_t* digest) {
+    if (hex.length() != 64) {
+        return false;
+    }
+    for (uint8_t i = 0; i < 32; i++) {
+        uint8_t value = 0;
+        for (uint8_t j = 0; j < 2; j++) {
+            char c = hex.charAt(i * 2 + j);
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return false;
+        }
+        digest[i] = value;
+    }
+    return true;
+}
+
+const char* OTA::stateString(OTAState state) {
+    switch (state) {
+        case OTAState::IDLE:           return "idle";
+        case OTAState::RECEIVING:      return "receiving";
+        case OTAState::REBOOTING:      return "rebooting";
+        case OTAState::FAILED:         return "failed";
+        case OTAState::PENDING_VERIFY: return "pending_verify";
+        case OTAState::CONFIRMED:      return "confirmed";
+        default:                       return "unknown";
+    }
+}
+
+void OTA::setLogCallback(void (*callback)(String)) {
+    logCallback = callback;
+}
+
+void OTA::log(const String& message) {
+    if (logCallback != nullptr) {
+        logCallback(message);
+    }
+}
+
+#endif // OTA_H
@@ -0,0 +1,543 @@
+/*
+ * ============================================================================
+ * PowerManager.h - Load-Adaptive CPU Clock and Light Sleep for ESP32
+ * ============================================================================
+ *
+ * Scales the CPU clock with measured load and replaces the idle delay(1) at
+ * the end of loop() with bounded light sleep, while keeping NTP
+ * receive->transmit latency under a configured bound.
+ *
+ * Features:
+ * - CPU clock steps 80/160/240 MHz chosen from request rate and loop
+ *   busy time, stepping up immediately and down only after sustained low
+ *   load
+ * - Light sleep only in the quiet part of the GPS epoch, never while a
+ *   W5500 socket has data waiting
+ * - Wake on timer, GPS UART activity, and optional W5500 INTn / PPS pins
+ * - W5500 INTn: when the pin is configured, the socket RECV interrupt is
+ *   unmasked (Sn_IMR, SIMR) so a packet arriving during sleep wakes the
+ *   CPU. Without a wired INTn, light sleep is timer-only and every packet
+ *   that arrives asleep waits out the sleep, so it is off by default
+ * - Latency guard: if the NTP latency histogram p99 plus the sleep length
+ *   would exceed the bound, clock goes to maximum and sleep is suspended
+ * - Time-keeping compensation for the NTP timestamp path
+ *
+ * Timing notes:
+ * - Only steps >= 80 MHz are used. The APB clock then stays at 80 MHz, so
+ *   esp_timer - and therefore the Timebase used for NTP timestamps - runs at
+ *   the same rate regardless of CPU clock. Frequency changes only alter how
+ *   long processing takes, which the latency histogram captures.
+ * - During light sleep esp_timer is advanced from the RTC slow clock, whose
+ *   error (PM_SLEEP_CLOCK_ERROR_PPM) accumulates between GPS time anchors.
+ *   The accumulated bound is added to NTP root dispersion each window.
+ * - A packet arriving while asleep waits at most one sleep period before
+ *   being timestamped, so the sleep length is part of the latency budget.
+ *
+ * Dependencies: GPS.h, NTP.h, Ethernet (utility/w5100.h), esp_sleep.h
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/uart.h>
+#include <Ethernet.h>
+#include <utility/w5100.h>
+#include "GPS.h"
+#include "NTP.h"
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define PM_FREQ_STEPS 3                      // Number of CPU clock steps
+#define PM_WINDOW_MS 1000                    // Load evaluation window (ms)
+#define PM_STEP_DOWN_WINDOWS 10              // Low-load windows before stepping down
+#define PM_GUARD_HOLD_WINDOWS 30             // Windows sleep stays off after a guard trip
+#define PM_MIN_SLEEP_US 500                  // Shorter sleeps are not worth the entry cost
+#define PM_SLEEP_MARGIN_US 200               // Latency margin kept for wake-up overhead
+#define PM_GPS_QUIET_MS 20                   // GPS line idle before sleep allowed (ms)
+#define PM_GPS_GUARD_MS 60                   // No sleep this close to next NMEA burst (ms)
+#define PM_SLEEP_CLOCK_ERROR_PPM 500         // RTC slow clock error bound (ppm)
+#define PM_GPS_UART_NUM UART_NUM_1           // GPS serial port (see GPS::begin)
+#define PM_UART_WAKE_THRESHOLD 3             // UART edges needed to wake
+
+// W5500 INTn GPIO. The ATOM PoE base does not route INTn to the Atom, so
+// it must be jumpered to a free GPIO and passed as a build flag
+// (-DPM_W5500_INT_PIN=<gpio>); light sleep defaults on only when it is.
+#ifndef PM_W5500_INT_PIN
+#define PM_W5500_INT_PIN -1                  // -1 = not wired
+#endif
+
+// W5500 interrupt registers (not wrapped by the Ethernet library)
+#define PM_W5500_SIMR 0x0018                 // Socket interrupt mask (common block)
+#define PM_W5500_SN_IMR 0x002C               // Per-socket interrupt mask
+
+// ============================================================================
+// DATA STRUCTURES
+// ============================================================================
+
+/**
+ * Power Manager Configuration
+ */
+struct PowerConfig {
+    bool enabled;                            // Enable clock scaling and sleep
+    bool lightSleepEnabled;                  // Allow light sleep when idle
+    uint32_t latencyBoundMicros;             // Max NTP receive->transmit (us)
+    uint32_t maxSleepMicros;                 // Upper limit per sleep (us)
+
+    // Load thresholds
+    uint16_t highRate;                       // Requests/s for 240 MHz
+    uint16_t midRate;                        // Requests/s for 160 MHz
+    uint8_t highBusyPercent;                 // Loop busy % for 240 MHz
+    uint8_t midBusyPercent;                  // Loop busy % for 160 MHz
+
+    // Wake sources
+    int8_t w5500IntPin;                      // W5500 INTn pin (-1 = not wired)
+    int8_t ppsPin;                           // GPS PPS pin (-1 = not wired)
+    bool uartWake;                           // Wake on GPS UART activity
+};
+
+/**
+ * Power Manager Metrics
+ */
+struct PowerMetrics {
+    uint16_t currentMhz;                     // Current CPU clock
+    uint32_t frequencyChanges;               // Clock changes since boot
+    uint32_t timeAtStepMs[PM_FREQ_STEPS];    // Time spent at each step (ms)
+
+    uint32_t sleepCount;                     // Light sleeps entered
+    uint64_t totalSleepMicros;               // Total time asleep (us)
+    uint32_t peakSleepMicros;                // Longest single sleep (us)
+    uint32_t sleepBudgetMicros;              // Current per-sleep budget (us)
+    uint32_t sleepsBlockedByGPS;             // Skipped: NMEA burst active/due
+    uint32_t sleepsBlockedBySocket;          // Skipped: socket data waiting
+
+    uint8_t busyPercent;                     // Loop busy time last window
+    uint16_t requestRate;                    // NTP requests last window
+    uint32_t windowP99Micros;                // NTP latency p99 last window (us)
+    uint32_t guardTrips;                     // Latency guard activations
+    float extraDispersion;                   // Dispersion added for sleep (s)
+};
+
+// ============================================================================
+// POWER MANAGER CLASS
+// ============================================================================
+
+class PowerManager {
+public:
+    // ========================================================================
+    // PUBLIC API
+    // ========================================================================
+
+    /**
+     * Initialize power manager and configure wake sources
+     * @param gps GPS instance (NMEA burst timing)
+     * @param ntp NTP instance (request rate, latency histogram, dispersion)
+     * @param config Power configuration
+     */
+    void begin(GPS& gps, NTP& ntp, const PowerConfig& config);
+
+    /**
+     * Account one loop iteration - call after the loop's work
+     * Re-evaluates clock step and sleep budget once per window
+     * @param busyMicros Time the loop spent working (us)
+     */
+    void update(uint32_t busyMicros);
+
+    /**
+     * Idle until the next loop - replaces delay(1)
+     * Light-sleeps when allowed, otherwise yields for 1 ms
+     * @return Time spent in light sleep (us), 0 when it only yielded
+     */
+    uint32_t idle();
+
+    /**
+     * Update configuration at runtime
+     * @param config New configuration
+     */
+    void updateConfig(const PowerConfig& config);
+
+    /**
+     * Get current metrics
+     * @return Reference to metrics structure
+     */
+    const PowerMetrics& getMetrics() const { return metrics; }
+
+    /**
+     * Get configuration
+     * @return Reference to configuration
+     */
+    const PowerConfig& getConfig() const { return config; }
+
+    /**
+     * Get CPU clock for a step index
+     * @param step Step index (0 = lowest)
+     * @return Clock in MHz
+     */
+    static uint16_t stepMhz(uint8_t step);
+
+    /**
+     * Get default configuration
+     * @return Default PowerConfig structure
+     */
+    static PowerConfig getDefaultConfig();
+
+    /**
+     * Set optional logging callback
+     * @param callback Function pointer: void logFunc(String message)
+     */
+    void setLogCallback(void (*callback)(String));
+
+private:
+    // ========================================================================
+    // INTERNAL STATE
+    // ========================================================================
+
+    GPS* gpsRef = nullptr;                   // GPS instance reference
+    NTP* ntpRef = nullptr;                   // NTP instance reference
+    PowerConfig config;                      // Current configuration
+    PowerMetrics metrics;                    // Power metrics
+
+    uint8_t currentStep;                     // Current clock step index
+    uint8_t lowWindows;                      // Consecutive windows below current step
+    uint8_t guardHold;                       // Windows left with sleep suspended
+
+    uint32_t windowStart;                    // Window start (ms)
+    uint32_t lastStepChange;                 // For time-at-step accounting (ms)
+    uint64_t windowBusyMicros;               // Busy time this window (us)
+    uint32_t windowSleepMicros;              // Sleep time this window (us)
+    uint32_t windowRequestBase;              // NTP responses at window start
+    uint32_t latencyBase[NTP_LATENCY_BUCKETS]; // Histogram at window start
+
+    void (*logCallback)(String) = nullptr;   // Optional logging
+
+    // ========================================================================
+    // INTERNAL METHODS
+    // ========================================================================
+
+    void evaluateWindow();
+    uint8_t targetStep() const;
+    void setStep(uint8_t step);
+    void configureWakeSources();
+    void configureW5500Interrupts();
+    bool gpsQuiet();
+    bool socketsIdle();
+    void log(const String& message);
+};
+
+// ============================================================================
+// IMPLEMENTATION
+// ============================================================================
+
+PowerConfig PowerManager::getDefaultConfig() {
+    PowerConfig config;
+    config.enabled = true;
+    config.lightSleepEnabled = PM_W5500_INT_PIN >= 0;
+    config.latencyBoundMicros = 1000;
+    config.maxSleepMicros = 5000;
+
+    config.highRate = 200;
+    config.midRate = 20;
+    config.highBusyPercent = 50;
+    config.midBusyPercent = 20;
+
+    config.w5500IntPin = PM_W5500_INT_PIN;
+    config.ppsPin = -1;
+    config.uartWake = true;
+    return config;
+}
+
+uint16_t PowerManager::stepMhz(uint8_t step) {
+    static const uint16_t steps[PM_FREQ_STEPS] = {80, 160, 240};
+    return steps[step < PM_FREQ_STEPS ? step : PM_FREQ_STEPS - 1];
+}
+
+void PowerManager::begin(GPS& gps, NTP& ntp, const PowerConfig& cfg) {
+    gpsRef = &gps;
+    ntpRef = &ntp;
+    config = cfg;
+
+    memset(&metrics, 0, sizeof(metrics));
+    memcpy(latencyBase, ntp.getMetrics().latencyHistogram, sizeof(latencyBase));
+    windowRequestBase = ntp.getMetrics().validResponses;
+    windowStart = millis();
+    lastStepChange = windowStart;
+    windowBusyMicros = 0;
+    windowSleepMicros = 0;
+    lowWindows = 0;
+    guardHold = 0;
+
+    // Start at full clock; load evaluation steps down from there
+    currentStep = PM_FREQ_STEPS - 1;
+    setCpuFrequencyMhz(stepMhz(currentStep));
+    metrics.currentMhz = getCpuFrequencyMhz();
+
+    configureWakeSources();
+
+    log("Power: " + String(config.enabled ? "enabled" : "disabled") +
+        ", latency bound " + String(config.latencyBoundMicros) + " us");
+}
+
+void PowerManager::updateConfig(const PowerConfig& cfg) {
+    config = cfg;
+    if (!config.enabled) {
+        setStep(PM_FREQ_STEPS - 1);
+    }
+    configureWakeSources();
+}
+
+void PowerManager::configureWakeSources() {
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+
+    configureW5500Interrupts();
+
+    bool gpioWake = false;
+    if (config.w5500IntPin >= 0) {
+        // INTn is active low while any unmasked socket interrupt is pending
+        pinMode(config.w5500IntPin, INPUT_PULLUP);
+        gpio_wakeup_enable((gpio_num_t)config.w5500IntPin, GPIO_INTR_LOW_LEVEL);
+        gpioWake = true;
+    }
+    if (config.ppsPin >= 0) {
+        gpio_wakeup_enable((gpio_num_t)config.ppsPin, GPIO_INTR_HIGH_LEVEL);
+        gpioWake = true;
+    }
+    if (gpioWake) {
+        esp_sleep_enable_gpio_wakeup();
+    }
+
+    if (config.uartWake) {
+        uart_set_wakeup_threshold(PM_GPS_UART_NUM, PM_UART_WAKE_THRESHOLD);
+        esp_sleep_enable_uart_wakeup(PM_GPS_UART_NUM);
+    }
+}
+
+void PowerManager::configureW5500Interrupts() {
+    if (W5100.getChip() != 55) {
+        return;
+    }
+
+    // SIMR resets to 0, so INTn never asserts until RECV is unmasked.
+    // RECV only: send completions are polled (NTPSocket) and would hold
+    // INTn low. socketsIdle() clears RECV before each sleep.
+    bool wired = config.w5500IntPin >= 0;
+    SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+    for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+        W5100.writeSn(s, PM_W5500_SN_IMR, wired ? SnIR::RECV : 0);
+    }
+    W5100.write(PM_W5500_SIMR, wired ? (uint8_t)((1 << MAX_SOCK_NUM) - 1) : 0);
+    SPI.endTransaction();
+}
+
+void PowerManager::update(uint32_t busyMicros) {
+    windowBusyMicros += busyMicros;
+
+    if (millis() - windowStart >= PM_WINDOW_MS) {
+        evaluateWindow();
+    }
+}
+
+void PowerManager::evaluateWindow() {
+    uint32_t now = millis();
+    uint32_t windowMs = now - windowStart;
+    const NTPMetrics& ntpMetrics = ntpRef->getMetrics();
+
+    // Load over the window
+    uint64_t windowMicros = max((uint64_t)windowMs * 1000, (uint64_t)1);
+    metrics.busyPercent = (uint8_t)min((uint64_t)100, windowBusyMicros * 100 / windowMicros);
+    metrics.requestRate = (uint16_t)min((uint32_t)65535, (ntpMetrics.validResponses - windowRequestBase) * 1000 / max(windowMs, (uint32_t)1));
+
+    // Latency over the window only
+    uint32_t delta[NTP_LATENCY_BUCKETS];
+    for (uint8_t i = 0; i < NTP_LATENCY_BUCKETS; i++) {
+        delta[i] = ntpMetrics.latencyHistogram[i] - latencyBase[i];
+        latencyBase[i] = ntpMetrics.latencyHistogram[i];
+    }
+    metrics.windowP99Micros = NTP::getLatencyPercentile(delta, 99);
+
+    // Sleep error accumulated since the last GPS anchor is bounded by
+    // one window's worth of sleep
+    metrics.extraDispersion = windowSleepMicros * (PM_SLEEP_CLOCK_ERROR_PPM * 1e-12f);
+    ntpRef->setExtraDispersion(metrics.extraDispersion);
+
+    if (!config.enabled) {
+        metrics.sleepBudgetMicros = 0;
+        setStep(PM_FREQ_STEPS - 1);
+    } else {
+        // Latency guard: a queued packet can wait one full sleep before
+        // it is timestamped, then takes p99 to answer
+        uint32_t worstCase = metrics.windowP99Micros + metrics.sleepBudgetMicros;
+        if (metrics.windowP99Micros > 0 && worstCase > config.latencyBoundMicros) {
+            metrics.guardTrips++;
+            guardHold = PM_GUARD_HOLD_WINDOWS;
+            lowWindows = 0;
+            setStep(PM_FREQ_STEPS - 1);
+            log("Power: Latency guard tripped (p99 " + String(metrics.windowP99Micros) +
+                " us + sleep " + String(metrics.sleepBudgetMicros) + " us)");
+        } else {
+            // Step up immediately, step down only after sustained low load
+            uint8_t target = targetStep();
+            if (guardHold > 0) {
+                target = PM_FREQ_STEPS - 1;
+            }
+            if (target > currentStep) {
+                lowWindows = 0;
+                setStep(target);
+            } else if (target < currentStep) {
+                if (++lowWindows >= PM_STEP_DOWN_WINDOWS) {
+                    lowWindows = 0;
+                    setStep(currentStep - 1);
+                }
+            } else {
+                lowWindows = 0;
+            }
+        }
+
+        // Sleep budget: whatever the bound leaves after processing time
+        uint32_t reserved = metrics.windowP99Micros + PM_SLEEP_MARGIN_US;
+        if (!config.lightSleepEnabled || guardHold > 0 || reserved >= config.latencyBoundMicros) {
+            metrics.sleepBudgetMicros = 0;
+        } else {
+            metrics.sleepBudgetMicros = min(config.latencyBoundMicros - reserved, config.maxSleepMicros);
+        }
+        if (guardHold > 0) {
+            guardHold--;
+        }
+    }
+
+    windowStart = now;
+    windowBusyMicros = 0;
+    windowSleepMicros = 0;
+    windowRequestBase = ntpMetrics.validResponses;
+}
+
+uint8_t PowerManager::targetStep() const {
+    if (metrics.requestRate >= config.highRate || metrics.busyPercent >= config.highBusyPercent) {
+        return 2;
+    }
+    if (metrics.requestRate >= config.midRate || metrics.busyPercent >= config.midBusyPercent) {
+        return 1;
+    }
+    return 0;
+}
+
+void PowerManager::setStep(uint8_t step) {
+    uint32_t now = millis();
+    metrics.timeAtStepMs[currentStep] += now - lastStepChange;
+    lastStepChange = now;
+
+    if (step == currentStep) {
+        return;
+    }
+
+    // APB stays at 80 MHz for all steps, so micros() keeps its rate
+    if (setCpuFrequencyMhz(stepMhz(step))) {
+        currentStep = step;
+        metrics.currentMhz = getCpuFrequencyMhz();
+        metrics.frequencyChanges++;
+    }
+}
+
+bool PowerManager::gpsQuiet() {
+    uint32_t now = millis();
+    uint32_t epochMs = 1000 / max((uint8_t)1, gpsRef->getConfig().updateRate);
+
+    // NMEA still arriving
+    if (now - gpsRef->getLastCharMillis() < PM_GPS_QUIET_MS) {
+        return false;
+    }
+
+    // Next epoch's burst is due soon; sleeping through its start would
+    // drop characters before the UART wake-up fires
+    uint32_t sinceBurst = now - gpsRef->getBurstStartMillis();
+    if (epochMs <= PM_GPS_GUARD_MS || (sinceBurst % epochMs) > epochMs - PM_GPS_GUARD_MS) {
+        return false;
+    }
+
+    return true;
+}
+
+bool PowerManager::socketsIdle() {
+    bool idle = true;
+
+    SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+    for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+        if (W5100.readSnRX_RSR(s) > 0) {
+            idle = false;
+            break;
+        }
+        // Clear RECV so INTn only reflects packets arriving while asleep
+        if (config.w5500IntPin >= 0) {
+            W5100.writeSnIR(s, SnIR::RECV);
+        }
+    }
+    SPI.endTransaction();
+
+    return idle;
+}
+
+uint32_t PowerManager::idle() {
+    uint32_t budget = metrics.sleepBudgetMicros;
+
+    if (!config.enabled || budget < PM_MIN_SLEEP_US) {
+        delay(1);
+        return 0;
+    }
+
+    if (!gpsQuiet()) {
+        metrics.sleepsBlockedByGPS++;
+        delay(1);
+        return 0;
+    }
+
+    if (!socketsIdle()) {
+        // Data already waiting - go straight back to the loop
+        metrics.sleepsBlockedBySocket++;
+        return 0;
+    }
+
+    // Never sleep past the next GPS burst
+    uint32_t epochMs = 1000 / max((uint8_t)1, gpsRef->getConfig().updateRate);
+    uint32_t intoEpoch = (millis() - gpsRef->getBurstStartMillis()) % epochMs;
+    if (intoEpoch + PM_GPS_GUARD_MS < epochMs) {
+        budget = min(budget, (epochMs - PM_GPS_GUARD_MS - intoEpoch) * 1000);
+    } else {
+        budget = 0;
+    }
+    if (budget < PM_MIN_SLEEP_US) {
+        delay(1);
+        return 0;
+    }
+
+    esp_sleep_enable_timer_wakeup(budget);
+    uint32_t sleepStart = micros();
+    esp_light_sleep_start();
+    uint32_t slept = micros() - sleepStart;
+
+    metrics.sleepCount++;
+    metrics.totalSleepMicros += slept;
+    windowSleepMicros += slept;
+    if (slept > metrics.peakSleepMicros) {
+        metrics.peakSleepMicros = slept;
+    }
+    return slept;
+}
+
+void PowerManager::setLogCallback(void (*callback)(String)) {
+    logCallback = callback;
+}
+
+void PowerManager::log(const String& message) {
+    if (logCallback != nullptr) {
+        logCallback(message);
+    }
+}
+
+#endif // POWER_MANAGER_H
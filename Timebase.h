@@ -0,0 +1,93 @@
+/*
+ * ============================================================================
+ * Timebase.h - 64-bit Monotonic Timebase for the Timing Path
+ * ============================================================================
+ *
+ * Single source of local time for NTP receive/transmit stamps, GPS epoch
+ * anchoring, peer holdover and latency statistics.
+ *
+ * Source: esp_timer (64-bit microseconds since boot, never wraps in
+ * practice). The CPU cycle counter would give sub-microsecond resolution
+ * but is unusable here: it wraps every ~18 s at 240 MHz, its rate changes
+ * whenever the power manager rescales the CPU clock, and it stops in light
+ * sleep. esp_timer is compensated across frequency changes and light sleep,
+ * and 1 us matches the precision we advertise (-20, ~1 us).
+ *
+ * Unlike 32-bit micros(), differences stay valid across any outage length,
+ * so anchors older than 71.6 minutes no longer alias.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// ============================================================================
+// CONFIGURATION CONSTANTS
+// ============================================================================
+
+#define TIMEBASE_RESOLUTION_NS 1000          // esp_timer tick
+#define TIMEBASE_BENCH_READS 1000            // Reads per benchmark run
+
+// ============================================================================
+// TIMEBASE CLASS
+// ============================================================================
+
+class Timebase {
+public:
+    /**
+     * Current time - timing path
+     * @return Microseconds since boot (monotonic, 64-bit)
+     */
+    static inline uint64_t micros64() {
+        return (uint64_t)esp_timer_get_time();
+    }
+
+    /**
+     * Measure the cost of one timebase read
+     * Runs with interrupts enabled, so the result includes typical jitter
+     * @return Average nanoseconds per read
+     */
+    static uint32_t benchmark() {
+        volatile uint64_t sink = 0;
+
+        uint64_t start = micros64();
+        for (uint16_t i = 0; i < TIMEBASE_BENCH_READS; i++) {
+            sink += micros64();
+        }
+        uint64_t elapsed = micros64() - start;
+        (void)sink;
+
+        uint32_t costNs = (uint32_t)((elapsed * 1000ULL) / TIMEBASE_BENCH_READS);
+        readCost() = costNs;
+        return costNs;
+    }
+
+    /**
+     * Get last benchmark result
+     * @return Nanoseconds per read (0 if not benchmarked)
+     */
+    static uint32_t getReadCostNanos() {
+        return readCost();
+    }
+
+    /**
+     * Get timebase source name for diagnostics
+     */
+    static const char* sourceName() {
+        return "esp_timer";
+    }
+
+private:
+    static uint32_t& readCost() {
+        static uint32_t costNs = 0;
+        return costNs;
+    }
+};
+
+#endif // TIMEBASE_H
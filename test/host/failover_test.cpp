@@ -0,0 +1,204 @@
+/*
+ * ============================================================================
+ * failover_test.cpp - Two-Unit Virtual IP Failover on a Simulated Bridge
+ * ============================================================================
+ *
+ * Runs two Failover instances (Failover.h) against the in-process bridge
+ * from shim/Ethernet.h and checks the election end to end:
+ * - Startup: the healthier unit takes the VIP, the other stays backup
+ * - Master unplugged: the backup takes over within the down interval
+ * - Link restored: the split brain resolves to the healthier unit
+ * - Master stops serving: the backup preempts at once
+ * - Recovered unit: preempts only after the lead has held
+ *
+ * GPS and NTP are replaced by stubs exposing what Failover.h reads
+ * (satellites, HDOP, serving and holdover state).
+ *
+ * Build and run: make -C test/host
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+// ============================================================================
+// GPS / NTP STUBS (the real headers are skipped by their include guards)
+// ============================================================================
+
+#define GPS_H
+#define NTP_H
+#define GPS_DOP_SCALE 100
+
+struct GPSData {
+    int satellites;
+    uint16_t hdopX100;
+};
+
+class GPS {
+public:
+    GPSData data = {10, 100};
+    const GPSData& getData() const { return data; }
+};
+
+struct NTPConfig {
+    uint8_t stratum;
+};
+
+class NTP {
+public:
+    bool serving = true;
+    bool followingPeer = false;
+    NTPConfig config = {1};
+
+    bool isServing() const { return serving; }
+    bool isFollowingPeer() const { return followingPeer; }
+    const NTPConfig& getConfig() const { return config; }
+    void getRootDelayDispersion(float& rootDelay, float& rootDispersion) const {
+        rootDelay = 0;
+        rootDispersion = 0.000010f;
+    }
+};
+
+#include "../../Failover.h"
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+#define TICK_MS 5
+
+static int failures = 0;
+
+#define CHECK(cond, what) do { \
+    if (!(cond)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, what); failures++; } \
+    else { printf("ok   %s\n", what); } \
+} while (0)
+
+struct Unit {
+    uint8_t node;
+    GPS gps;
+    NTP ntp;
+    Failover failover;
+};
+
+static HostBridge& bridge = HostBridge::instance();
+static const IPAddress vip(192, 168, 1, 123);
+static Unit units[2];
+
+static void logLine(String message) {
+    printf("     [%u ms] %s\n", millis(), message.c_str());
+}
+
+static void runFor(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += TICK_MS) {
+        hostAdvanceMillis(TICK_MS);
+        for (Unit& unit : units) {
+            bridge.select(unit.node);
+            unit.failover.process();
+        }
+    }
+}
+
+/**
+ * Run until unit becomes master; returns the time taken (ms), UINT32_MAX on timeout
+ */
+static uint32_t runUntilMaster(Unit& unit, uint32_t limitMs) {
+    uint32_t start = millis();
+    while (millis() - start < limitMs) {
+        runFor(TICK_MS);
+        if (unit.failover.getState() == FailoverState::MASTER) {
+            return millis() - start;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static int masters() {
+    int count = 0;
+    for (Unit& unit : units) {
+        count += unit.failover.getState() == FailoverState::MASTER;
+    }
+    return count;
+}
+
+static bool holdsVIP(const Unit& unit) {
+    return bridge.nodes[unit.node].ip == (uint32_t)vip;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+    Unit& a = units[0];
+    Unit& b = units[1];
+    a.node = bridge.addNode(IPAddress(192, 168, 1, 100), 0x0A);
+    b.node = bridge.addNode(IPAddress(192, 168, 1, 101), 0x0B);
+    a.gps.data.satellites = 10;              // Priority 238
+    b.gps.data.satellites = 6;               // Priority 222
+
+    FailoverConfig config;
+    config.enabled = true;
+    config.virtualIP = vip;
+    config.vrid = FAILOVER_DEFAULT_VRID;
+    for (Unit& unit : units) {
+        bridge.select(unit.node);
+        unit.failover.setLogCallback(logLine);
+        unit.failover.begin(unit.gps, unit.ntp, config);
+    }
+
+    // Startup: the healthier unit's shorter skew wins the first election
+    runFor(1000);
+    CHECK(a.failover.getState() == FailoverState::MASTER, "startup: healthier unit is master");
+    CHECK(b.failover.getState() == FailoverState::BACKUP, "startup: other unit is backup");
+    CHECK(holdsVIP(a) && !holdsVIP(b), "startup: only the master holds the VIP");
+    CHECK(b.failover.getPeer().unitIP == (uint32_t)IPAddress(192, 168, 1, 100),
+          "startup: backup knows the master's unit address");
+
+    // Master unplugged: takeover within the down interval plus skew
+    bridge.nodes[a.node].linkUp = false;
+    uint32_t takeover = runUntilMaster(b, 2000);
+    uint32_t bound = FAILOVER_DOWN_INTERVALS * FAILOVER_ADVERT_MS + FAILOVER_ADVERT_MS + TICK_MS;
+    printf("     takeover after %u ms (bound %u ms)\n", takeover, bound);
+    CHECK(takeover <= bound, "unplugged: backup takes over within the down interval");
+    CHECK(holdsVIP(b), "unplugged: new master holds the VIP");
+    uint8_t virtualMAC[6] = {0x00, 0x00, 0x5E, 0x00, 0x01, FAILOVER_DEFAULT_VRID};
+    CHECK(memcmp(bridge.nodes[b.node].mac, virtualMAC, 6) == 0, "unplugged: new master uses the virtual MAC");
+
+    // Link restored: both are master until the first adverts cross
+    bridge.nodes[a.node].linkUp = true;
+    runFor(FAILOVER_ADVERT_MS * 3);
+    CHECK(masters() == 1, "split brain: resolves to one master");
+    CHECK(a.failover.getState() == FailoverState::MASTER, "split brain: healthier unit keeps the VIP");
+    CHECK(bridge.nodes[b.node].ip == (uint32_t)IPAddress(192, 168, 1, 101),
+          "split brain: released unit is back on its own address");
+
+    // Master stops serving: preempted at once, no hold
+    a.ntp.serving = false;
+    uint32_t preempt = runUntilMaster(b, 2000);
+    CHECK(preempt <= FAILOVER_ADVERT_MS * 2, "not serving: backup preempts at once");
+    runFor(FAILOVER_ADVERT_MS);
+    CHECK(a.failover.getState() == FailoverState::BACKUP, "not serving: old master steps down");
+
+    // Recovered and healthier: preempts only after the lead has held
+    a.ntp.serving = true;
+    runFor(FAILOVER_PREEMPT_HOLD_MS / 2);
+    CHECK(b.failover.getState() == FailoverState::MASTER, "recovered: no preemption before the hold");
+    uint32_t reclaim = runUntilMaster(a, FAILOVER_PREEMPT_HOLD_MS);
+    CHECK(reclaim != UINT32_MAX, "recovered: healthier unit preempts after the hold");
+    runFor(FAILOVER_ADVERT_MS * 3);
+    CHECK(masters() == 1 && holdsVIP(a) && !holdsVIP(b), "recovered: one master, VIP moved back");
+
+    // Equal health: no flapping over a long run
+    b.gps.data.satellites = a.gps.data.satellites;
+    uint32_t takeovers = a.failover.getStats().takeovers + b.failover.getStats().takeovers;
+    runFor(10000);
+    CHECK(a.failover.getStats().takeovers + b.failover.getStats().takeovers == takeovers,
+          "equal health: VIP stays put");
+
+    printf("%s (%d failure%s)\n", failures ? "FAILED" : "PASSED", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
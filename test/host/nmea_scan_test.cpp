@@ -0,0 +1,130 @@
+/*
+ * ============================================================================
+ * nmea_scan_test.cpp - NMEAScan Parity Fuzz and Benchmark on the Host
+ * ============================================================================
+ *
+ * Runs the word kernels in NMEAScan.h against their byte references:
+ * - selfTest() with many more cases than the device run, over several
+ *   seeds (built with AddressSanitizer, this also checks that the word
+ *   loads stay inside the NMEA_SCAN_SIZE() buffer contract)
+ * - parseDecimal() against a byte-at-a-time reference on random numbers
+ * - benchmark(), in nanoseconds per pass (the shim's cycle counter)
+ *
+ * Host timings show the relative cost of the two paths, not Xtensa cycle
+ * counts; run POST /api/gps/scan on a unit for those.
+ *
+ * Build and run: make -C test/host
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#define NMEA_SCAN_FUZZ_CASES 200000
+#define NMEA_SCAN_BENCH_ROUNDS 2000
+
+#include <Arduino.h>
+#include "../../NMEAScan.h"
+
+#define FUZZ_SEEDS 8
+#define DECIMAL_CASES 200000
+
+static int failures = 0;
+
+#define CHECK(cond, what) do { \
+    if (!(cond)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, what); failures++; } \
+    else { printf("ok   %s\n", what); } \
+} while (0)
+
+/**
+ * Byte-at-a-time parseDecimal(): integer part, then up to decimals digits
+ */
+static int32_t parseDecimalReference(const char* text, uint8_t length, uint8_t decimals) {
+    if (decimals > 4) decimals = 4;
+    uint8_t i = 0;
+    bool negative = length > 0 && text[0] == '-';
+    if (negative) i++;
+
+    int32_t whole = 0;
+    for (; i < length && text[i] != '.'; i++) {
+        if (text[i] < '0' || text[i] > '9') {
+            // Stray character: the integer part stops at the first non-digit
+            while (i < length && text[i] != '.') i++;
+            break;
+        }
+        whole = whole * 10 + (text[i] - '0');
+    }
+
+    int32_t fraction = 0;
+    uint8_t digits = 0;
+    if (i < length && text[i] == '.') {
+        for (i++; digits < decimals && i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+            fraction = fraction * 10 + (text[i] - '0');
+            digits++;
+        }
+    }
+    for (; digits < decimals; digits++) {
+        fraction *= 10;
+    }
+    for (uint8_t d = 0; d < decimals; d++) {
+        whole *= 10;
+    }
+    int32_t value = whole + fraction;
+    return negative ? -value : value;
+}
+
+static uint32_t fuzzDecimals() {
+    alignas(4) char text[NMEA_SCAN_SIZE(16)];
+    uint32_t mismatches = 0;
+
+    for (uint32_t n = 0; n < DECIMAL_CASES; n++) {
+        // [-]<0-5 digits>[.<0-6 digits>], as in NMEA coordinates and DOPs
+        uint8_t length = 0;
+        if (esp_random() % 4 == 0) text[length++] = '-';
+        uint8_t whole = esp_random() % 6;
+        for (uint8_t i = 0; i < whole; i++) text[length++] = '0' + esp_random() % 10;
+        if (esp_random() % 4 != 0) {
+            text[length++] = '.';
+            uint8_t fraction = esp_random() % 7;
+            for (uint8_t i = 0; i < fraction; i++) text[length++] = '0' + esp_random() % 10;
+        }
+        for (uint8_t i = length; i < sizeof(text); i++) {
+            text[i] = (char)esp_random();
+        }
+
+        uint8_t decimals = esp_random() % 5;
+        int32_t fast = NMEAScan::parseDecimal(text, length, decimals);
+        int32_t reference = parseDecimalReference(text, length, decimals);
+        if (fast != reference) {
+            if (mismatches < 5) {
+                printf("     \"%.*s\" decimals %u: %d vs %d\n", length, text, decimals, fast, reference);
+            }
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+int main() {
+    uint32_t scanFailures = 0;
+    for (uint32_t seed = 1; seed <= FUZZ_SEEDS; seed++) {
+        hostSeedRandom(seed);
+        scanFailures += NMEAScan::selfTest();
+    }
+    printf("     scan parity: %u cases, %u failures\n",
+           (unsigned)(NMEA_SCAN_FUZZ_CASES * FUZZ_SEEDS), (unsigned)scanFailures);
+    CHECK(scanFailures == 0, "scan/parseInt match the byte references");
+
+    uint32_t decimalFailures = fuzzDecimals();
+    printf("     parseDecimal: %u cases, %u failures\n", (unsigned)DECIMAL_CASES, (unsigned)decimalFailures);
+    CHECK(decimalFailures == 0, "parseDecimal matches the byte reference");
+
+    const NMEAScanBench& bench = NMEAScan::benchmark();
+    printf("     benchmark: %u bytes, word kernels %u ns, strtok/atoi %u ns (%.2fx)\n",
+           (unsigned)bench.bytes, (unsigned)bench.swarCycles, (unsigned)bench.referenceCycles,
+           bench.swarCycles ? (double)bench.referenceCycles / bench.swarCycles : 0.0);
+    CHECK(bench.bytes > 0 && bench.swarCycles > 0, "benchmark ran");
+
+    printf("%s (%d failure%s)\n", failures ? "FAILED" : "PASSED", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * ============================================================================
+ * peer_test.cpp - Two-Unit Symmetric Peering and Holdover
+ * ============================================================================
+ *
+ * Runs NTPPeerLogic (NTPPeer.h) for two units that peer with each other,
+ * each losing GPS in turn, and checks selection end to end:
+ * - Both on GPS: each sees the other as a stratum 1 candidate
+ * - A loses GPS: A follows B, serves stratum 2 and tracks B's clock
+ * - Loop: B rejects A while A's reference ID is B's own address
+ * - Both lose GPS: B advertises leap 3 / stratum 16, A drops it and
+ *   leaves holdover; neither unit follows the other
+ * - A recovers: B now follows A at stratum 2
+ * - B recovers: both back on GPS at stratum 1
+ *
+ * NTPPeer.h has no I/O; the harness stands in for NTP.h's peer glue
+ * (processPeers, sendPeerPacket, handlePeerPacket, disciplineHoldover)
+ * and swaps packets directly with a jittered one-way delay.
+ *
+ * Build and run: make -C test/host
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#include <Arduino.h>
+#include "../../NTPPeer.h"
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+#define TICK_MS 100
+#define POLL_MS (1000UL << NTP_PEER_POLL)
+#define NTP_ERA_SECONDS 3900000000ULL        // Clock readings start in 2023
+#define ONE_WAY_MICROS 200                   // Path delay, plus up to 100 us jitter
+#define GPS_REFID 0x00535047                 // "GPS\0" as stored by memcpy
+
+static int failures = 0;
+
+#define CHECK(cond, what) do { \
+    if (!(cond)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, what); failures++; } \
+    else { printf("ok   %s\n", what); } \
+} while (0)
+
+/**
+ * What a unit puts in its packets (server view, as buildNTPPacket)
+ */
+struct Advert {
+    uint8_t leap;
+    uint8_t stratum;
+    uint32_t refID;
+    uint32_t rootDelayMicros;
+    uint32_t rootDispersionMicros;
+};
+
+/**
+ * Symmetric mode packet, reduced to the fields the peer logic reads
+ */
+struct PeerPacket {
+    Advert advert;
+    uint64_t org;
+    uint64_t rec;
+    uint64_t xmt;
+};
+
+struct Unit {
+    const char* name;
+    uint32_t ip;
+    bool gps;
+    uint64_t lossMicros;                     // When GPS was lost
+    float driftPPM;                          // Free-running drift after loss
+    NTPPeer peers[NTP_MAX_PEERS];
+    int8_t sysPeer;
+    NTPHoldover holdover;
+};
+
+static Unit units[2];
+
+static uint64_t toNTP64(int64_t micros) {
+    uint64_t seconds = (uint64_t)(micros / 1000000) + NTP_ERA_SECONDS;
+    uint64_t fraction = ((uint64_t)(micros % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+/**
+ * Unit clock at a true time: exact on GPS, free running without it,
+ * plus the holdover correction (Timebase stands in for true time)
+ */
+static int64_t clockMicros(const Unit& unit, uint64_t trueMicros) {
+    int64_t clock = (int64_t)trueMicros;
+    if (!unit.gps) {
+        clock += (int64_t)(unit.driftPPM * (double)(trueMicros - unit.lossMicros) / 1000000.0);
+    }
+    return clock + NTPPeerLogic::correctionAt(unit.holdover, trueMicros);
+}
+
+static int64_t errorMicros(const Unit& unit) {
+    return clockMicros(unit, hostMicros()) - (int64_t)hostMicros();
+}
+
+static Unit& unitAt(uint32_t ip) {
+    return units[0].ip == ip ? units[0] : units[1];
+}
+
+static bool hasTimeSource(const Unit& unit) {
+    return unit.gps || unit.holdover.active;
+}
+
+static Advert served(const Unit& unit) {
+    Advert advert = {0, 1, GPS_REFID, 1000, 10};
+    if (unit.holdover.active) {
+        const NTPPeer& peer = unit.peers[unit.sysPeer];
+        advert.leap = peer.leap;
+        advert.stratum = peer.stratum + 1;
+        advert.refID = peer.ip;
+        advert.rootDelayMicros = peer.rootDelayMicros + (uint32_t)peer.delayMicros;
+        advert.rootDispersionMicros = peer.rootDispersionMicros + peer.jitterMicros;
+    } else if (!unit.gps) {
+        advert.leap = 3;
+    }
+    return advert;
+}
+
+static void disciplineHoldover(Unit& unit, NTPPeer& peer, int64_t offsetMicros) {
+    uint64_t now = hostMicros();
+    int64_t before = NTPPeerLogic::correctionAt(unit.holdover, now);
+    NTPPeerLogic::discipline(unit.holdover, offsetMicros, now);
+    int64_t applied = NTPPeerLogic::correctionAt(unit.holdover, now) - before;
+
+    for (uint8_t s = 0; s < NTP_PEER_FILTER_STAGES; s++) {
+        peer.samples[s].offsetMicros -= applied;
+    }
+    peer.offsetMicros -= applied;
+}
+
+static void receive(Unit& unit, uint32_t fromIP, const PeerPacket& packet, uint64_t arrivalMicros) {
+    NTPPeer* peer = nullptr;
+    for (NTPPeer& p : unit.peers) {
+        if (p.ip != 0 && p.ip == fromIP) peer = &p;
+    }
+    if (!peer) {
+        return;
+    }
+
+    uint64_t t1 = packet.org;
+    uint64_t t2 = packet.rec;
+    uint64_t t3 = packet.xmt;
+    uint64_t t4 = toNTP64(clockMicros(unit, arrivalMicros));
+    if (t3 == 0 || t3 == peer->org) {
+        peer->duplicates++;
+        return;
+    }
+
+    peer->received++;
+    peer->mode = 1;
+    peer->leap = packet.advert.leap;
+    peer->stratum = packet.advert.stratum;
+    peer->refID = packet.advert.refID;
+    peer->rootDelayMicros = packet.advert.rootDelayMicros;
+    peer->rootDispersionMicros = packet.advert.rootDispersionMicros;
+
+    bool bogus = (t1 != peer->xmt) || t1 == 0 || t2 == 0;
+    peer->org = t3;
+    peer->rec = t4;
+    if (bogus) {
+        peer->bogus++;
+        return;
+    }
+    if (peer->leap == 3 || peer->stratum == 0 || peer->stratum >= 16) {
+        peer->reach |= 1;
+        return;
+    }
+
+    int64_t offset, delay;
+    NTPPeerLogic::onWire(t1, t2, t3, t4, offset, delay);
+    NTPPeerLogic::addSample(*peer, offset, delay, millis());
+
+    if (unit.holdover.active && peer == &unit.peers[unit.sysPeer] &&
+        peer->offsetMicros == offset && peer->delayMicros == delay) {
+        disciplineHoldover(unit, *peer, offset);
+    }
+}
+
+static void sendPeerPacket(Unit& unit, NTPPeer& peer) {
+    PeerPacket packet;
+    packet.advert = served(unit);
+    if (!hasTimeSource(unit)) {
+        packet.advert.leap = 3;
+        packet.advert.stratum = 16;
+    }
+    packet.org = peer.org;
+    packet.rec = peer.rec;
+
+    uint64_t now = hostMicros();
+    packet.xmt = toNTP64(clockMicros(unit, now));
+    peer.xmt = packet.xmt;
+    peer.sent++;
+
+    uint64_t arrival = now + ONE_WAY_MICROS + hostRandom()() % 100;
+    receive(unitAt(peer.ip), unit.ip, packet, arrival);
+}
+
+static void processPeers(Unit& unit) {
+    for (NTPPeer& peer : unit.peers) {
+        if (peer.ip == 0) continue;
+        if (millis() - peer.lastPollMillis >= POLL_MS) {
+            peer.lastPollMillis = millis();
+            NTPPeerLogic::shiftReach(peer);
+            sendPeerPacket(unit, peer);
+        }
+    }
+
+    unit.sysPeer = NTPPeerLogic::select(unit.peers, NTP_MAX_PEERS, unit.ip, millis());
+    bool follow = unit.sysPeer >= 0 && !unit.gps;
+
+    if (follow && !unit.holdover.active) {
+        memset(&unit.holdover, 0, sizeof(unit.holdover));
+        unit.holdover.active = true;
+        unit.holdover.anchorMicros = hostMicros();
+        disciplineHoldover(unit, unit.peers[unit.sysPeer], unit.peers[unit.sysPeer].offsetMicros);
+        printf("     [%u ms] %s: holdover from peer\n", millis(), unit.name);
+    } else if (!follow && unit.holdover.active) {
+        unit.holdover.active = false;
+        printf("     [%u ms] %s: leaving holdover (%s)\n", millis(), unit.name,
+               unit.sysPeer >= 0 ? "GPS recovered" : "peer lost");
+    }
+}
+
+static void runFor(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += TICK_MS) {
+        hostAdvanceMillis(TICK_MS);
+        for (Unit& unit : units) {
+            processPeers(unit);
+        }
+    }
+}
+
+static void loseGPS(Unit& unit, float driftPPM) {
+    unit.gps = false;
+    unit.lossMicros = hostMicros();
+    unit.driftPPM = driftPPM;
+}
+
+static NTPPeerState stateOfPeer(const Unit& unit) {
+    return unit.peers[0].state;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+    Unit& a = units[0];
+    Unit& b = units[1];
+    a.name = "A";
+    b.name = "B";
+    a.ip = (uint32_t)IPAddress(192, 168, 1, 100);
+    b.ip = (uint32_t)IPAddress(192, 168, 1, 101);
+    for (Unit& unit : units) {
+        unit.gps = true;
+        unit.sysPeer = -1;
+        memset(&unit.holdover, 0, sizeof(unit.holdover));
+        for (NTPPeer& peer : unit.peers) {
+            peer.ip = 0;
+            NTPPeerLogic::reset(peer);
+        }
+        unit.peers[0].ip = (&unit == &a) ? b.ip : a.ip;
+    }
+
+    // Both on GPS: the peer is selectable but not followed
+    runFor(POLL_MS * 4);
+    CHECK(a.peers[0].reach != 0 && b.peers[0].reach != 0, "both on GPS: peers reachable");
+    CHECK(stateOfPeer(a) == NTPPeerState::SYSPEER && stateOfPeer(b) == NTPPeerState::SYSPEER,
+          "both on GPS: each selects the other");
+    CHECK(!a.holdover.active && !b.holdover.active, "both on GPS: no holdover");
+    CHECK(a.peers[0].bogus + b.peers[0].bogus == 1, "both on GPS: only the opening packet has no origin");
+
+    // A loses GPS: follows B at stratum 2 and converges on B's clock
+    loseGPS(a, 20.0f);
+    runFor(TICK_MS);
+    CHECK(a.holdover.active && a.sysPeer == 0, "A lost GPS: follows B");
+    Advert advert = served(a);
+    CHECK(advert.stratum == 2 && advert.leap == 0 && advert.refID == b.ip,
+          "A lost GPS: serves stratum 2, reference ID is B");
+    runFor(POLL_MS * 40);
+    int64_t error = errorMicros(a);
+    printf("     A holdover error after %u s: %d us\n", (unsigned)(POLL_MS * 40 / 1000), (int)error);
+    CHECK(error > -2000 && error < 2000, "A lost GPS: holdover keeps A within 2 ms (free running: 13 ms)");
+    CHECK(a.holdover.steps == 0, "A lost GPS: drift corrected by slewing, no step");
+
+    // Loop: A is synchronized to B, so B must not select A
+    CHECK(b.peers[0].refID == b.ip && stateOfPeer(b) == NTPPeerState::REJECTED,
+          "loop: B rejects A (reference ID is B)");
+
+    // Both lose GPS: B has no source and A's time comes from B
+    loseGPS(b, -20.0f);
+    runFor(TICK_MS);
+    CHECK(!b.holdover.active && b.sysPeer < 0, "both lost: B does not follow A (loop)");
+    runFor(POLL_MS + TICK_MS);
+    CHECK(a.peers[0].leap == 3 && a.peers[0].stratum == 16, "both lost: B advertises leap 3, stratum 16");
+    CHECK(stateOfPeer(a) == NTPPeerState::REJECTED && !a.holdover.active,
+          "both lost: A rejects B and leaves holdover");
+    runFor(POLL_MS + TICK_MS);
+    CHECK(served(a).leap == 3 && served(b).leap == 3, "both lost: both serve unsynchronized");
+    CHECK(!a.holdover.active && !b.holdover.active, "both lost: no holdover either way");
+
+    // A recovers: B follows A in turn
+    a.gps = true;
+    runFor(POLL_MS + TICK_MS);
+    CHECK(b.holdover.active && b.sysPeer == 0, "A recovered: B follows A");
+    advert = served(b);
+    CHECK(advert.stratum == 2 && advert.leap == 0 && advert.refID == a.ip,
+          "A recovered: B serves stratum 2, reference ID is A");
+    CHECK(!a.holdover.active && served(a).stratum == 1, "A recovered: A serves stratum 1 from GPS");
+    runFor(POLL_MS + TICK_MS);
+    CHECK(stateOfPeer(a) == NTPPeerState::REJECTED, "A recovered: A rejects B (loop)");
+    runFor(POLL_MS * 40);
+    error = errorMicros(b);
+    printf("     B holdover error after %u s: %d us\n", (unsigned)(POLL_MS * 40 / 1000), (int)error);
+    CHECK(error > -2000 && error < 2000, "A recovered: holdover keeps B within 2 ms");
+
+    // B recovers: both back on GPS
+    b.gps = true;
+    runFor(TICK_MS);
+    CHECK(!b.holdover.active, "B recovered: leaves holdover at once");
+    runFor(POLL_MS * 2);
+    advert = served(b);
+    CHECK(advert.stratum == 1 && advert.leap == 0 && advert.refID == GPS_REFID,
+          "B recovered: serves stratum 1 from GPS");
+    CHECK(stateOfPeer(a) == NTPPeerState::SYSPEER && stateOfPeer(b) == NTPPeerState::SYSPEER,
+          "B recovered: each selects the other again");
+    CHECK(!a.holdover.active && !b.holdover.active, "B recovered: no holdover");
+
+    printf("%s (%d failure%s)\n", failures ? "FAILED" : "PASSED", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
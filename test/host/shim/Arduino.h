@@ -0,0 +1,132 @@
+/*
+ * ============================================================================
+ * Arduino.h - Minimal Arduino Core for Host Builds
+ * ============================================================================
+ *
+ * Just enough of the Arduino/ESP32 core for the device-independent
+ * headers to compile and run on the build machine:
+ * - String (std::string with the Arduino constructors)
+ * - IPAddress (octets stored in order, as on the device)
+ * - millis()/micros() driven by the test through hostAdvanceMillis()
+ * - min/max/constrain, and math.h as the Arduino core includes it
+ * - esp_random() (seeded, repeatable) and ESP.getCycleCount(), which
+ *   counts nanoseconds here rather than CPU cycles
+ *
+ * Not a general emulation; extend it only as far as a test needs.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+typedef uint8_t byte;
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+inline uint64_t& hostMicros() {
+    static uint64_t now = 1000000;           // Start past zero, like a booted device
+    return now;
+}
+
+inline void hostAdvanceMillis(uint32_t ms) { hostMicros() += (uint64_t)ms * 1000; }
+inline uint32_t millis() { return (uint32_t)(hostMicros() / 1000); }
+inline uint32_t micros() { return (uint32_t)hostMicros(); }
+inline void delay(uint32_t ms) { hostAdvanceMillis(ms); }
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// As in the ESP32 core: std::min/max, constrain as a macro
+using std::min;
+using std::max;
+
+#ifndef constrain
+#define constrain(x, lo, hi) ((x) < (lo) ? (lo) : ((x) > (hi) ? (hi) : (x)))
+#endif
+
+// ============================================================================
+// ESP32
+// ============================================================================
+
+inline std::mt19937& hostRandom() {
+    static std::mt19937 generator(0x4E4D4541);
+    return generator;
+}
+
+inline void hostSeedRandom(uint32_t seed) { hostRandom().seed(seed); }
+inline uint32_t esp_random() { return (uint32_t)hostRandom()(); }
+
+struct EspClass {
+    uint32_t getCycleCount() {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+static EspClass ESP __attribute__((unused));   // Not every test times anything
+
+// ============================================================================
+// STRING
+// ============================================================================
+
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    String(int v) : std::string(std::to_string(v)) {}
+    String(unsigned int v) : std::string(std::to_string(v)) {}
+    String(long v) : std::string(std::to_string(v)) {}
+    String(unsigned long v) : std::string(std::to_string(v)) {}
+};
+
+// ============================================================================
+// IP ADDRESS
+// ============================================================================
+
+class IPAddress {
+public:
+    IPAddress() { address.dword = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+        address.bytes[0] = a;
+        address.bytes[1] = b;
+        address.bytes[2] = c;
+        address.bytes[3] = d;
+    }
+    IPAddress(uint32_t dword) { address.dword = dword; }
+
+    operator uint32_t() const { return address.dword; }
+    uint8_t operator[](int index) const { return address.bytes[index]; }
+    bool operator==(const IPAddress& other) const { return address.dword == other.address.dword; }
+
+    String toString() const {
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u",
+                 address.bytes[0], address.bytes[1], address.bytes[2], address.bytes[3]);
+        return String(buffer);
+    }
+
+private:
+    union {
+        uint8_t bytes[4];
+        uint32_t dword;
+    } address;
+};
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,100 @@
+/*
+ * ============================================================================
+ * Ethernet.h - Simulated W5500 Network for Host Builds
+ * ============================================================================
+ *
+ * Several simulated units share one in-process bridge. Each unit has its
+ * own address, MAC and link state; the global Ethernet object and every
+ * EthernetUDP socket act on behalf of the unit selected with
+ * HostBridge::select(), so a test runs one unit's loop at a time:
+ *
+ *   bridge.select(0); unitA.process();
+ *   bridge.select(1); unitB.process();
+ *
+ * Datagrams are delivered at once: broadcast to every other unit with a
+ * socket on the port, unicast to the unit that currently holds the
+ * destination address. A unit whose link is down neither sends nor
+ * receives.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef HOST_ETHERNET_H
+#define HOST_ETHERNET_H
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+
+#define HOST_MAX_NODES 4
+
+// ============================================================================
+// BRIDGE
+// ============================================================================
+
+struct HostDatagram {
+    uint32_t fromIP;
+    uint16_t fromPort;
+    std::vector<uint8_t> data;
+};
+
+struct HostNode {
+    uint32_t ip;
+    uint8_t mac[6];
+    bool linkUp;
+};
+
+class EthernetUDP;
+
+class HostBridge {
+public:
+    HostNode nodes[HOST_MAX_NODES] = {};
+    uint8_t current = 0;
+    std::vector<EthernetUDP*> sockets;
+
+    static HostBridge& instance() {
+        static HostBridge bridge;
+        return bridge;
+    }
+
+    /**
+     * Add a unit with its own address; returns its index
+     */
+    uint8_t addNode(IPAddress ip, uint8_t lastMacByte) {
+        uint8_t index = nodeCount++;
+        nodes[index].ip = (uint32_t)ip;
+        uint8_t mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, lastMacByte};
+        memcpy(nodes[index].mac, mac, 6);
+        nodes[index].linkUp = true;
+        return index;
+    }
+
+    void select(uint8_t index) { current = index; }
+    HostNode& node() { return nodes[current]; }
+
+    inline void deliver(uint8_t from, uint32_t toIP, uint16_t toPort,
+                        uint16_t fromPort, const std::vector<uint8_t>& data);
+
+private:
+    uint8_t nodeCount = 0;
+};
+
+// ============================================================================
+// ETHERNET
+// ============================================================================
+
+class EthernetClass {
+public:
+    IPAddress localIP() { return IPAddress(HostBridge::instance().node().ip); }
+    void setLocalIP(const IPAddress ip) { HostBridge::instance().node().ip = (uint32_t)ip; }
+    void MACAddress(uint8_t* mac) { memcpy(mac, HostBridge::instance().node().mac, 6); }
+    void setMACAddress(const uint8_t* mac) { memcpy(HostBridge::instance().node().mac, mac, 6); }
+};
+
+static EthernetClass Ethernet __attribute__((unused));   // Not every test changes addresses
+
+#include "EthernetUdp.h"
+
+#endif // HOST_ETHERNET_H
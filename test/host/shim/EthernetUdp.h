@@ -0,0 +1,120 @@
+/*
+ * ============================================================================
+ * EthernetUdp.h - Simulated UDP Socket for Host Builds
+ * ============================================================================
+ *
+ * EthernetUDP on the simulated bridge (Ethernet.h). A socket belongs to
+ * the unit that was selected when begin() was called.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef HOST_ETHERNET_UDP_H
+#define HOST_ETHERNET_UDP_H
+
+#include "Ethernet.h"
+#include <algorithm>
+
+class EthernetUDP {
+public:
+    virtual ~EthernetUDP() { stop(); }
+
+    virtual uint8_t begin(uint16_t port) {
+        HostBridge& bridge = HostBridge::instance();
+        stop();
+        owner = bridge.current;
+        localPortNumber = port;
+        bridge.sockets.push_back(this);
+        return 1;
+    }
+
+    virtual void stop() {
+        std::vector<EthernetUDP*>& sockets = HostBridge::instance().sockets;
+        sockets.erase(std::remove(sockets.begin(), sockets.end(), this), sockets.end());
+        localPortNumber = 0;
+        queue.clear();
+    }
+
+    virtual int beginPacket(IPAddress ip, uint16_t port) {
+        txIP = (uint32_t)ip;
+        txPort = port;
+        txData.clear();
+        return 1;
+    }
+
+    virtual size_t write(uint8_t b) {
+        txData.push_back(b);
+        return 1;
+    }
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        txData.insert(txData.end(), buffer, buffer + size);
+        return size;
+    }
+
+    virtual int endPacket() {
+        HostBridge::instance().deliver(owner, txIP, txPort, localPortNumber, txData);
+        return 1;
+    }
+
+    virtual int parsePacket() {
+        if (queue.empty()) {
+            return 0;
+        }
+        rx = queue.front();
+        queue.pop_front();
+        rxOffset = 0;
+        return (int)rx.data.size();
+    }
+
+    virtual int available() { return (int)(rx.data.size() - rxOffset); }
+
+    virtual int read() {
+        return rxOffset < rx.data.size() ? rx.data[rxOffset++] : -1;
+    }
+
+    virtual int read(unsigned char* buffer, size_t len) {
+        size_t n = std::min(len, rx.data.size() - rxOffset);
+        memcpy(buffer, rx.data.data() + rxOffset, n);
+        rxOffset += n;
+        return (int)n;
+    }
+
+    virtual int peek() { return rxOffset < rx.data.size() ? rx.data[rxOffset] : -1; }
+    virtual IPAddress remoteIP() { return IPAddress(rx.fromIP); }
+    virtual uint16_t remotePort() { return rx.fromPort; }
+    uint16_t localPort() const { return localPortNumber; }
+
+    // Bridge side
+    uint8_t owner = 0;
+    std::deque<HostDatagram> queue;
+
+private:
+    uint16_t localPortNumber = 0;
+    uint32_t txIP = 0;
+    uint16_t txPort = 0;
+    std::vector<uint8_t> txData;
+    HostDatagram rx;
+    size_t rxOffset = 0;
+};
+
+void HostBridge::deliver(uint8_t from, uint32_t toIP, uint16_t toPort,
+                         uint16_t fromPort, const std::vector<uint8_t>& data) {
+    if (!nodes[from].linkUp) {
+        return;
+    }
+    bool broadcast = toIP == (uint32_t)IPAddress(255, 255, 255, 255);
+    for (EthernetUDP* socket : sockets) {
+        HostNode& target = nodes[socket->owner];
+        if (socket->owner == from || !target.linkUp || socket->localPort() != toPort) {
+            continue;
+        }
+        if (broadcast || target.ip == toIP) {
+            socket->queue.push_back(HostDatagram{nodes[from].ip, fromPort, data});
+        }
+    }
+}
+
+#endif // HOST_ETHERNET_UDP_H
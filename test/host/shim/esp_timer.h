@@ -0,0 +1,21 @@
+/*
+ * ============================================================================
+ * esp_timer.h - Host esp_timer for Timebase.h
+ * ============================================================================
+ *
+ * esp_timer_get_time() follows the simulated clock in Arduino.h, so
+ * Timebase::micros64() and micros() agree as they do on the device.
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <Arduino.h>
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMicros(); }
+
+#endif // HOST_ESP_TIMER_H
@@ -0,0 +1,260 @@
+/*
+ * ============================================================================
+ * telemetry_test.cpp - NTP Telemetry Datagrams Decoded at a Collector
+ * ============================================================================
+ *
+ * Runs NTPTelemetry (NTPTelemetry.h) on one unit of the simulated bridge
+ * from shim/Ethernet.h, with a plain UDP socket on a second unit as the
+ * collector, and decodes every datagram against the documented format:
+ * - Header: magic, version, record length, count, export time
+ * - Records: client, age, latency, request byte, poll, outcome, KoD, flags
+ * - Flush: a partial batch ships once its oldest record is 1 s old
+ * - Batch: a full batch ships at once; the leftover keeps its age
+ * - Sequence: +1 per datagram, a lost datagram shows as a gap
+ * - Loss: a full ring counts the overflow in every later header
+ *
+ * Build and run: make -C test/host
+ *
+ * Author: Matthew R. Christensen
+ * License: MIT
+ * ============================================================================
+ */
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include "../../NTPTelemetry.h"
+
+// ============================================================================
+// HARNESS
+// ============================================================================
+
+#define TICK_MS 10
+#define EXPORT_UNIX_BASE 1700000000UL
+#define LATENCY_MICROS 150
+
+static int failures = 0;
+
+#define CHECK(cond, what) do { \
+    if (!(cond)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, what); failures++; } \
+    else { printf("ok   %s\n", what); } \
+} while (0)
+
+struct DecodedRecord {
+    uint32_t clientIP;
+    uint32_t ageMicros;
+    uint16_t latencyMicros;
+    uint8_t livnmode;
+    int8_t poll;
+    uint8_t outcome;
+    uint8_t kodCode;
+    uint8_t flags;
+};
+
+struct Datagram {
+    bool valid;                              // Header and length check out
+    uint32_t sequence;
+    uint32_t exportUnix;
+    uint32_t exportUsec;
+    uint32_t lost;
+    std::vector<DecodedRecord> records;
+};
+
+static HostBridge& bridge = HostBridge::instance();
+static uint8_t unitNode;
+static uint8_t collectorNode;
+static NTPTelemetry telemetry;
+static EthernetUDP collector;
+static uint32_t nextSequence = 0;            // Collector's expected sequence
+static uint32_t sequenceGaps = 0;
+
+static uint16_t getBE16(const uint8_t* p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t getBE32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static NTPCaptureClock captureClock() {
+    NTPCaptureClock clock;
+    clock.nowMicros = Timebase::micros64();
+    clock.nowUnix = EXPORT_UNIX_BASE + (uint32_t)(clock.nowMicros / 1000000);
+    clock.nowUsec = (uint32_t)(clock.nowMicros % 1000000);
+    return clock;
+}
+
+static Datagram decode(const std::vector<uint8_t>& data) {
+    Datagram d = {};
+    if (data.size() < NTP_TELEMETRY_HEADER_LEN || getBE32(&data[0]) != NTP_TELEMETRY_MAGIC ||
+        data[4] != NTP_TELEMETRY_VERSION || data[5] != NTP_TELEMETRY_RECORD_LEN) {
+        return d;
+    }
+    uint16_t count = getBE16(&data[6]);
+    if (data.size() != NTP_TELEMETRY_HEADER_LEN + (size_t)count * NTP_TELEMETRY_RECORD_LEN) {
+        return d;
+    }
+
+    d.valid = true;
+    d.sequence = getBE32(&data[8]);
+    d.exportUnix = getBE32(&data[12]);
+    d.exportUsec = getBE32(&data[16]);
+    d.lost = getBE32(&data[20]);
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t* p = &data[NTP_TELEMETRY_HEADER_LEN + i * NTP_TELEMETRY_RECORD_LEN];
+        DecodedRecord r;
+        memcpy(&r.clientIP, p, 4);
+        r.ageMicros = getBE32(p + 4);
+        r.latencyMicros = getBE16(p + 8);
+        r.livnmode = p[10];
+        r.poll = (int8_t)p[11];
+        r.outcome = p[12];
+        r.kodCode = p[13];
+        r.flags = p[14];
+        d.records.push_back(r);
+    }
+    return d;
+}
+
+/**
+ * Read every datagram waiting at the collector, tracking sequence gaps
+ */
+static std::vector<Datagram> receive() {
+    std::vector<Datagram> datagrams;
+    int size;
+    while ((size = collector.parsePacket()) > 0) {
+        std::vector<uint8_t> data(size);
+        collector.read(data.data(), data.size());
+        Datagram d = decode(data);
+        if (d.valid) {
+            sequenceGaps += d.sequence - nextSequence;
+            nextSequence = d.sequence + 1;
+        }
+        datagrams.push_back(d);
+    }
+    return datagrams;
+}
+
+static void process() {
+    bridge.select(unitNode);
+    if (telemetry.shouldShip(millis())) {
+        telemetry.ship(captureClock());
+    }
+}
+
+static void runFor(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += TICK_MS) {
+        hostAdvanceMillis(TICK_MS);
+        process();
+    }
+}
+
+/**
+ * Queue requests from 10.0.0.<first>.. as NTP.h does after each reply
+ */
+static void append(uint16_t n, uint8_t first = 1, NTPCaptureVerdict outcome = NTPCaptureVerdict::RESPONDED,
+                   const char* kod = nullptr, bool extensions = false) {
+    uint8_t request[48] = {0x23, 0, 6};
+    for (uint16_t i = 0; i < n; i++) {
+        uint64_t rx = Timebase::micros64();
+        telemetry.append((uint32_t)IPAddress(10, 0, 0, (uint8_t)(first + i)), request, extensions,
+                         rx, rx + LATENCY_MICROS, outcome, kod);
+    }
+}
+
+static uint32_t oldestAge(const Datagram& d) {
+    uint32_t age = 0;
+    for (const DecodedRecord& r : d.records) {
+        age = max(age, r.ageMicros);
+    }
+    return age;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+    unitNode = bridge.addNode(IPAddress(10, 0, 1, 10), 0x10);
+    collectorNode = bridge.addNode(IPAddress(10, 0, 1, 20), 0x20);
+    bridge.select(collectorNode);
+    collector.begin(NTP_TELEMETRY_DEFAULT_PORT);
+    bridge.select(unitNode);
+    CHECK(telemetry.begin(IPAddress(10, 0, 1, 20), NTP_TELEMETRY_DEFAULT_PORT), "exporter starts");
+
+    // Flush: a partial batch waits for its oldest record to be 1 s old
+    append(1, 1);
+    append(1, 2, NTPCaptureVerdict::KOD, "RATE");
+    append(1, 3, NTPCaptureVerdict::DROPPED, nullptr, true);
+    runFor(NTP_TELEMETRY_FLUSH_MS - 2 * TICK_MS);
+    CHECK(receive().empty() && telemetry.pending() == 3, "flush: nothing ships before 1 s");
+    runFor(2 * TICK_MS);
+    std::vector<Datagram> got = receive();
+    CHECK(got.size() == 1 && got[0].valid, "flush: one datagram at 1 s, header valid");
+    if (got.size() == 1 && got[0].records.size() == 3) {
+        const Datagram& d = got[0];
+        CHECK(d.sequence == 0 && d.lost == 0, "flush: sequence 0, nothing lost");
+        CHECK(d.exportUnix == EXPORT_UNIX_BASE + millis() / 1000 && d.exportUsec == (millis() % 1000) * 1000,
+              "flush: export time is the capture clock");
+        CHECK(d.records[0].clientIP == (uint32_t)IPAddress(10, 0, 0, 1) &&
+              d.records[2].clientIP == (uint32_t)IPAddress(10, 0, 0, 3), "flush: clients in arrival order");
+        CHECK(d.records[0].ageMicros == NTP_TELEMETRY_FLUSH_MS * 1000, "flush: age is receive -> export");
+        CHECK(d.records[0].latencyMicros == LATENCY_MICROS && d.records[0].livnmode == 0x23 &&
+              d.records[0].poll == 6, "flush: latency and request fields");
+        CHECK(d.records[0].outcome == 0 && d.records[0].kodCode == NTP_TELEMETRY_KOD_NONE,
+              "flush: responded record");
+        CHECK(d.records[1].outcome == 1 && d.records[1].kodCode == NTP_TELEMETRY_KOD_RATE,
+              "flush: KoD RATE record");
+        CHECK(d.records[2].outcome == 2 && d.records[2].flags == NTP_TELEMETRY_FLAG_EXTENSIONS,
+              "flush: dropped record with extension flag");
+    } else {
+        CHECK(false, "flush: three records decoded");
+    }
+
+    // Batch: a full batch ships at once; the leftover keeps its age
+    append(NTP_TELEMETRY_BATCH + 10);
+    hostAdvanceMillis(700);                  // Loop stalled before shipping
+    process();
+    got = receive();
+    CHECK(got.size() == 1 && got[0].records.size() == NTP_TELEMETRY_BATCH && got[0].sequence == 1,
+          "batch: full datagram ships on the next pass");
+    runFor(NTP_TELEMETRY_FLUSH_MS - 700 - 2 * TICK_MS);
+    CHECK(receive().empty() && telemetry.pending() == 10, "batch: leftover waits for its own 1 s");
+    runFor(2 * TICK_MS);
+    got = receive();
+    uint32_t age = got.size() == 1 ? oldestAge(got[0]) : 0;
+    printf("     leftover shipped %u records at age %u ms\n",
+           got.size() == 1 ? (unsigned)got[0].records.size() : 0, (unsigned)(age / 1000));
+    CHECK(got.size() == 1 && got[0].records.size() == 10 && age == NTP_TELEMETRY_FLUSH_MS * 1000,
+          "batch: leftover flushed when its oldest record is 1 s old");
+
+    // Sequence: a datagram lost on the wire leaves a gap
+    bridge.nodes[collectorNode].linkUp = false;
+    append(1);
+    runFor(NTP_TELEMETRY_FLUSH_MS);
+    bridge.nodes[collectorNode].linkUp = true;
+    append(1);
+    runFor(NTP_TELEMETRY_FLUSH_MS);
+    got = receive();
+    CHECK(got.size() == 1 && got[0].sequence == 4, "sequence: next datagram after the lost one");
+    CHECK(sequenceGaps == 1, "sequence: collector sees one gap");
+
+    // Loss: overflow past the ring is counted in every later header
+    append(NTP_TELEMETRY_RING + 5);
+    CHECK(telemetry.getStats().recordsLost == 5, "ring full: overflow counted");
+    runFor(NTP_TELEMETRY_FLUSH_MS);
+    got = receive();
+    uint32_t records = 0;
+    bool lostInHeaders = !got.empty();
+    for (const Datagram& d : got) {
+        records += d.records.size();
+        lostInHeaders = lostInHeaders && d.valid && d.lost == 5;
+    }
+    printf("     ring drained in %u datagrams, %u records\n", (unsigned)got.size(), (unsigned)records);
+    CHECK(records == NTP_TELEMETRY_RING, "ring full: every buffered record shipped");
+    CHECK(lostInHeaders, "ring full: lost count in every header");
+    CHECK(sequenceGaps == 1, "ring full: no new sequence gaps");
+
+    const NTPTelemetryStats& stats = telemetry.getStats();
+    CHECK(stats.recordsQueued == stats.recordsSent && stats.sendFailures == 0,
+          "stats: every queued record sent");
+
+    printf("%s (%d failure%s)\n", failures ? "FAILED" : "PASSED", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}
@@ -18,9 +18,22 @@
 #define WEB_API_H
 
 #include <Arduino.h>
-#include <ArduinoJson.h>
+#include "BuildConfig.h"
 #include "GPS.h"
+#include "GNSSOptimizer.h"
 #include "NTP.h"
+#include "NTPSocket.h"
+#include "BlackBox.h"
+#include "Atom.h"
+#include "PowerManager.h"
+#include "Failover.h"
+#if FEATURE_OTA
+#include "OTA.h"
+#endif
+
+#if FEATURE_WEB_API
+#include <ArduinoJson.h>
+#endif
 
 // ============================================================================
 // STRUCT DEFINITIONS
@@ -46,8 +59,16 @@ struct SystemMetrics {
     uint32_t freeHeapMin;
     uint32_t loopTime;
     uint32_t peakLoopTime;
+    uint32_t averageLoopTime;                  // Smoothed loop time (us)
+    
+    // Build footprint (filled once at boot)
+    uint32_t sketchSize;                       // Firmware image size (bytes)
+    uint32_t freeSketchSpace;                  // Remaining app partition (bytes)
+    uint32_t heapSize;                         // Total heap after static RAM
 };
 
+#if FEATURE_WEB_API
+
 // ============================================================================
 // NAMESPACE FOR API UTILITIES
 // ============================================================================
@@ -58,6 +79,22 @@ namespace web_api {
 // ENHANCED GPS ENDPOINT
 // ============================================================================
 
+/**
+ * Add NMEA Scan Self-Test and Benchmark Results to JSON
+ */
+void addNMEAScanResults(JsonObject scan) {
+    const NMEAScanBench& scanBench = NMEAScan::getBenchmark();
+    scan["bytes"] = scanBench.bytes;
+    scan["swar_cycles"] = scanBench.swarCycles;
+    scan["reference_cycles"] = scanBench.referenceCycles;
+    scan["swar_bytes_per_kcycle"] = scanBench.swarCycles ?
+        1000.0f * scanBench.bytes / scanBench.swarCycles : 0.0f;
+    scan["reference_bytes_per_kcycle"] = scanBench.referenceCycles ?
+        1000.0f * scanBench.bytes / scanBench.referenceCycles : 0.0f;
+    scan["fuzz_cases"] = scanBench.fuzzCases;
+    scan["fuzz_failures"] = scanBench.fuzzFailures;
+}
+
 /**
  * Generate Enhanced GPS JSON with Satellite Array
  * Returns complete GPS data including individual satellite information
@@ -85,15 +122,15 @@ String generateEnhancedGPSJSON(const GPS& gps) {
     JsonObject position = doc.createNestedObject("position");
     position["valid"] = gpsData.valid;
     if (gpsData.valid) {
-        position["latitude"] = gpsData.latitude;
-        position["longitude"] = gpsData.longitude;
-        position["altitude_m"] = gpsData.altitude;
+        position["latitude"] = gpsData.latitudeE7 / (double)GPS_COORD_SCALE;
+        position["longitude"] = gpsData.longitudeE7 / (double)GPS_COORD_SCALE;
+        position["altitude_m"] = gpsData.altitudeMM / 1000.0f;
     }
     
     // Signal quality
     JsonObject quality = doc.createNestedObject("quality");
     quality["satellites"] = gpsData.satellites;
-    quality["hdop"] = gpsData.hdop;
+    quality["hdop"] = gpsData.hdopX100 / (float)GPS_DOP_SCALE;
     quality["fix_quality"] = gpsData.fixQuality;
     quality["update_age_ms"] = gpsData.updateAge;
     
@@ -119,6 +156,84 @@ String generateEnhancedGPSJSON(const GPS& gps) {
     constellations["beidou_count"] = satTracking.beidouCount;
     constellations["total_tracked"] = satTracking.count;
     constellations["total_in_use"] = satTracking.totalInUse;
+
+    // Sentence scheduling (timing sentences first, GSV/GSA deferred)
+    const GPSSentenceStats& sentenceStats = gps.getSentenceStats();
+    JsonObject sentences = doc.createNestedObject("sentences");
+    sentences["immediate"] = sentenceStats.immediate;
+    sentences["deferred"] = sentenceStats.deferred;
+    sentences["deferred_parsed"] = sentenceStats.deferredParsed;
+    sentences["deferred_dropped"] = sentenceStats.deferredDropped;
+    sentences["checksum_errors"] = sentenceStats.checksumErrors;
+    sentences["queued"] = gps.getDeferredQueued();
+    sentences["peak_queued"] = sentenceStats.peakQueued;
+    sentences["anchors"] = sentenceStats.anchors;
+    sentences["anchor_backlog_bytes"] = sentenceStats.lastAnchorBacklog;
+    sentences["peak_anchor_backlog_bytes"] = sentenceStats.peakAnchorBacklog;
+    sentences["anchor_lag_us"] = sentenceStats.lastAnchorLagMicros;
+    sentences["peak_anchor_lag_us"] = sentenceStats.peakAnchorLagMicros;
+
+    // Word-at-a-time scan kernels vs the strtok/atoi path (last on-demand run)
+    addNMEAScanResults(sentences.createNestedObject("scan"));
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate NMEA Scan JSON
+ * Last self-test and benchmark results (zeros until POST /api/gps/scan)
+ */
+String generateNMEAScanJSON() {
+    StaticJsonDocument<256> doc;
+    addNMEAScanResults(doc.to<JsonObject>());
+
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate GNSS Optimizer JSON
+ * Receiver output level and bytes per epoch before (full) and after
+ */
+String generateGNSSOptimizerJSON(const GNSSOptimizer& optimizer) {
+    const GNSSOptimizerState& state = optimizer.getState();
+    uint32_t now = millis();
+    
+    StaticJsonDocument<1024> doc;
+    doc["enabled"] = state.enabled;
+    doc["level"] = GNSSOptimizer::levelName(state.level);
+    doc["level_age_s"] = (now - state.levelSinceMillis) / 1000;
+    doc["gsv_divisor"] = state.gsvDivisor;
+    doc["on_target"] = state.onTarget;
+    doc["holdoff"] = state.holdoff;
+    doc["steps_up"] = state.stepsUp;
+    doc["steps_back"] = state.stepsBack;
+    doc["resurveys"] = state.resurveys;
+    
+    JsonArray systems = doc.createNestedArray("systems");
+    for (uint8_t i = 0; i < GNSS_OPT_SYSTEMS; i++) {
+        JsonObject system = systems.createNestedObject();
+        system["name"] = GPS::getConstellationName(i + 1);
+        system["enabled"] = (state.constellationMask & (1 << i)) != 0;
+        system["mean_in_use"] = state.useX100[i] / 100.0f;
+    }
+    
+    JsonObject before = doc.createNestedObject("full");
+    before["bytes_per_epoch"] = state.fullBytesPerEpoch;
+    before["gsv_gsa_per_epoch"] = state.fullDeferredPerEpoch;
+    before["uart_pct"] = optimizer.uartPercent(state.fullBytesPerEpoch);
+    
+    JsonObject after = doc.createNestedObject("current");
+    after["bytes_per_epoch"] = state.bytesPerEpoch;
+    after["gsv_gsa_per_epoch"] = state.deferredPerEpoch;
+    after["uart_pct"] = optimizer.uartPercent(state.bytesPerEpoch);
+    
+    if (state.fullBytesPerEpoch > 0 && state.bytesPerEpoch > 0) {
+        doc["bytes_saved_pct"] = 100.0f * (1.0f - state.bytesPerEpoch / state.fullBytesPerEpoch);
+    }
     
     String output;
     serializeJson(doc, output);
@@ -252,7 +367,7 @@ String generateHistoryJSON(const GPS& gps) {
         JsonObject point = points.createNestedObject();
         point["timestamp"] = history.points[idx].timestamp;
         point["satellites"] = history.points[idx].satelliteCount;
-        point["hdop"] = history.points[idx].hdop;
+        point["hdop"] = history.points[idx].hdopX100 / (float)GPS_DOP_SCALE;
         point["fix_quality"] = history.points[idx].fixQuality;
         point["avg_snr"] = history.points[idx].avgSNR;
         point["has_fix"] = history.points[idx].hasValidFix;
@@ -285,11 +400,11 @@ String generateQuickStatusJSON(const GPS& gps, const NTP& ntp, const NetworkStat
     doc["gps_fix"] = gpsData.valid;
     doc["time_valid"] = gpsData.timeValid;
     doc["satellites"] = gpsData.satellites;
-    doc["hdop"] = gpsData.hdop;
+    doc["hdop"] = gpsData.hdopX100 / (float)GPS_DOP_SCALE;
     
     if (gpsData.valid) {
-        doc["lat"] = gpsData.latitude;
-        doc["lon"] = gpsData.longitude;
+        doc["lat"] = gpsData.latitudeE7 / (double)GPS_COORD_SCALE;
+        doc["lon"] = gpsData.longitudeE7 / (double)GPS_COORD_SCALE;
     }
     
     // NTP essentials
@@ -320,7 +435,7 @@ String generateQuickStatusJSON(const GPS& gps, const NTP& ntp, const NetworkStat
 String generateNTPMetricsJSON(const NTP& ntp) {
     const NTPMetrics& metrics = ntp.getMetrics();
     
-    StaticJsonDocument<1024> doc;
+    StaticJsonDocument<2560> doc;
     
     // Request counters
     doc["total_requests"] = metrics.totalRequests;
@@ -329,6 +444,18 @@ String generateNTPMetricsJSON(const NTP& ntp) {
     doc["rate_limited"] = metrics.rateLimitedRequests;
     doc["kod_sent"] = metrics.kodSent;
     doc["no_gps_dropped"] = metrics.noGPSDropped;
+    doc["acl_ignored"] = metrics.aclIgnored;
+    doc["acl_denied"] = metrics.aclDenied;
+    doc["admission_shed"] = metrics.admissionShed;
+    doc["reserve_admitted"] = metrics.reserveAdmitted;
+    
+    // Duplicates and replays
+    JsonObject duplicates = doc.createNestedObject("duplicates");
+    duplicates["retransmits"] = metrics.duplicateRequests;
+    duplicates["answered_from_cache"] = metrics.duplicatesAnswered;
+    duplicates["charged"] = metrics.duplicatesCharged;
+    duplicates["replayed"] = metrics.replayedRequests;
+    duplicates["bogus_origin"] = metrics.bogusOrigin;
     
     // Performance
     doc["avg_response_time_ms"] = metrics.averageResponseTime;
@@ -345,6 +472,49 @@ String generateNTPMetricsJSON(const NTP& ntp) {
     versions["v4"] = metrics.clientVersions[3];
     versions["other"] = metrics.clientVersions[4];
     
+    // Extension fields by type
+    JsonObject extensions = doc.createNestedObject("extension_fields");
+    extensions["requests"] = metrics.extensionRequests;
+    extensions["malformed"] = metrics.malformedExtensions;
+    JsonObject types = extensions.createNestedObject("types");
+    for (uint8_t i = 0; i < EF_COUNTERS; i++) {
+        types[NTPExtensionWalker::counterName(i)] = metrics.extensionFieldCounts[i];
+    }
+    
+    // Receive->transmit latency
+    JsonObject latency = doc.createNestedObject("latency_us");
+    latency["p50"] = NTP::getLatencyPercentile(metrics.latencyHistogram, 50);
+    latency["p99"] = NTP::getLatencyPercentile(metrics.latencyHistogram, 99);
+    latency["peak"] = metrics.peakLatencyMicros;
+    
+    // Capacity calibration
+    const NTPCapacity& capacity = ntp.getCapacity();
+    JsonObject cap = doc.createNestedObject("capacity");
+    cap["adaptive"] = ntp.getConfig().adaptiveCapacity;
+    cap["measured_rps"] = capacity.measuredRps;
+    cap["limit_rps"] = capacity.limitRps;
+    cap["served_rps"] = capacity.servedRps;
+    cap["cost_us"] = capacity.costMicros;
+    cap["loop_period_us"] = capacity.periodMicros;
+    cap["headroom_pct"] = capacity.measuredRps ?
+        100.0f * (1.0f - (float)capacity.servedRps / capacity.measuredRps) : 100.0f;
+    cap["adjustments"] = capacity.adjustments;
+    
+    // Off-path statistics queue
+    const NTPStatsRingStats& ringStats = ntp.getStatsRing().getStats();
+    JsonObject statsQueue = doc.createNestedObject("stats_queue");
+    statsQueue["depth"] = ntp.getStatsRing().depth();
+    statsQueue["peak_depth"] = ringStats.peakDepth;
+    statsQueue["pushed"] = ringStats.pushed;
+    statsQueue["folded"] = ringStats.folded;
+    statsQueue["dropped"] = ringStats.dropped;
+    
+    // Timestamp source
+    JsonObject timebase = doc.createNestedObject("timebase");
+    timebase["source"] = Timebase::sourceName();
+    timebase["resolution_ns"] = TIMEBASE_RESOLUTION_NS;
+    timebase["read_cost_ns"] = Timebase::getReadCostNanos();
+    
     // Status
     doc["currently_serving"] = metrics.currentlyServing;
     doc["status"] = ntp.getStatusString();
@@ -363,10 +533,23 @@ String generateNTPMetricsJSON(const NTP& ntp) {
  * Returns ESP32 system health information
  */
 String generateSystemMetricsJSON(const SystemMetrics& metrics) {
-    StaticJsonDocument<512> doc;
+    StaticJsonDocument<768> doc;
     
     doc["uptime_seconds"] = metrics.uptime;
     doc["free_heap_bytes"] = metrics.freeHeap;
+    doc["min_free_heap_bytes"] = metrics.freeHeapMin;
+    
+    // Loop timing
+    doc["loop_time_us"] = metrics.loopTime;
+    doc["avg_loop_time_us"] = metrics.averageLoopTime;
+    doc["peak_loop_time_us"] = metrics.peakLoopTime;
+    
+    // Build profile footprint
+    JsonObject build = doc.createNestedObject("build");
+    build["profile"] = BUILD_PROFILE_NAME;
+    build["sketch_size_bytes"] = metrics.sketchSize;
+    build["free_sketch_space_bytes"] = metrics.freeSketchSpace;
+    build["heap_size_bytes"] = metrics.heapSize;
     
     // Calculate uptime components
     uint32_t days = metrics.uptime / 86400;
@@ -423,15 +606,15 @@ String generateDashboardJSON(const GPS& gps, const NTP& ntp,
     JsonObject position = gpsObj.createNestedObject("position");
     position["valid"] = gpsData.valid;
     if (gpsData.valid) {
-        position["latitude"] = gpsData.latitude;
-        position["longitude"] = gpsData.longitude;
-        position["altitude_m"] = gpsData.altitude;
+        position["latitude"] = gpsData.latitudeE7 / (double)GPS_COORD_SCALE;
+        position["longitude"] = gpsData.longitudeE7 / (double)GPS_COORD_SCALE;
+        position["altitude_m"] = gpsData.altitudeMM / 1000.0f;
     }
     
     // Quality
     JsonObject quality = gpsObj.createNestedObject("quality");
     quality["satellites"] = gpsData.satellites;
-    quality["hdop"] = gpsData.hdop;
+    quality["hdop"] = gpsData.hdopX100 / (float)GPS_DOP_SCALE;
     quality["fix_quality"] = gpsData.fixQuality;
     
     // Satellites array
@@ -492,13 +675,677 @@ String generateDashboardJSON(const GPS& gps, const NTP& ntp,
     system["free_heap"] = metrics.freeHeap;
     system["free_heap_min"] = metrics.freeHeapMin;
     system["loop_time"] = metrics.loopTime;
+    system["avg_loop_time"] = metrics.averageLoopTime;
     system["peak_loop_time"] = metrics.peakLoopTime;
+    system["build_profile"] = BUILD_PROFILE_NAME;
     
     String output;
     serializeJson(doc, output);
     return output;
 }
 
+// ============================================================================
+// BLACK BOX ENDPOINT
+// ============================================================================
+
+/**
+ * Add Black Box Record to JSON
+ * Loop samples are emitted oldest first
+ */
+void addBlackBoxRecord(JsonObject obj, const BlackBoxRecord& record) {
+    obj["boot_count"] = record.bootCount;
+    obj["uptime_ms"] = record.uptimeMs;
+    obj["loop_count"] = record.loopCount;
+    obj["stage"] = BlackBox::stageString(record.stage);
+    obj["peak_loop_time_us"] = record.peakLoopTime;
+    obj["free_heap_bytes"] = record.freeHeap;
+    obj["min_free_heap_bytes"] = record.minFreeHeap;
+    
+    JsonArray samples = obj.createNestedArray("loop_samples_us");
+    for (uint16_t i = 0; i < BLACKBOX_LOOP_SAMPLES; i++) {
+        samples.add(record.loopSamples[(record.loopHead + i) % BLACKBOX_LOOP_SAMPLES]);
+    }
+    
+    JsonObject http = obj.createNestedObject("last_http");
+    http["route"] = record.lastRoute;
+    http["at_ms"] = record.lastRouteMs;
+    
+    JsonObject ntp = obj.createNestedObject("last_ntp");
+    ntp["client"] = IPAddress(record.lastNtpClient).toString();
+    ntp["at_ms"] = record.lastNtpMs;
+    ntp["requests"] = record.ntpRequests;
+}
+
+/**
+ * Generate Black Box JSON
+ * Returns the record preserved from the previous boot plus the live record
+ */
+String generateBlackBoxJSON(const BlackBox& blackBox) {
+    DynamicJsonDocument doc(3072);
+    const BlackBoxCrash& crash = blackBox.getCrash();
+    
+    doc["reset_reason"] = BlackBox::resetReasonString(crash.resetReason);
+    doc["crashed"] = blackBox.previousCrashed();
+    
+    if (crash.hasBacktrace) {
+        JsonObject bt = doc.createNestedObject("backtrace");
+        bt["task"] = crash.task;
+        char hex[11];
+        snprintf(hex, sizeof(hex), "0x%08x", (unsigned int)crash.pc);
+        bt["pc"] = hex;
+        bt["corrupted"] = crash.corrupted;
+        JsonArray frames = bt.createNestedArray("frames");
+        for (uint8_t i = 0; i < crash.depth; i++) {
+            snprintf(hex, sizeof(hex), "0x%08x", (unsigned int)crash.backtrace[i]);
+            frames.add(hex);
+        }
+    }
+    
+    if (blackBox.hasPrevious()) {
+        addBlackBoxRecord(doc.createNestedObject("previous"), blackBox.getPrevious());
+    } else {
+        doc["previous"] = nullptr;
+    }
+    addBlackBoxRecord(doc.createNestedObject("current"), blackBox.getCurrent());
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+// ============================================================================
+// POWER MANAGEMENT ENDPOINT
+// ============================================================================
+
+/**
+ * Generate Power JSON
+ * Returns clock/sleep state and the NTP latency histogram used by the guard
+ */
+String generatePowerJSON(const PowerManager& power, const NTP& ntp) {
+    const PowerMetrics& pm = power.getMetrics();
+    const PowerConfig& pc = power.getConfig();
+    const NTPMetrics& nm = ntp.getMetrics();
+    
+    StaticJsonDocument<1536> doc;
+    
+    doc["enabled"] = pc.enabled;
+    doc["cpu_mhz"] = pm.currentMhz;
+    doc["frequency_changes"] = pm.frequencyChanges;
+    
+    JsonObject atStep = doc.createNestedObject("time_at_mhz_s");
+    for (uint8_t i = 0; i < PM_FREQ_STEPS; i++) {
+        atStep[String(PowerManager::stepMhz(i))] = pm.timeAtStepMs[i] / 1000;
+    }
+    
+    // Load
+    doc["busy_percent"] = pm.busyPercent;
+    doc["request_rate"] = pm.requestRate;
+    
+    // Sleep
+    JsonObject sleep = doc.createNestedObject("sleep");
+    sleep["enabled"] = pc.lightSleepEnabled;
+    sleep["count"] = pm.sleepCount;
+    sleep["total_ms"] = (uint32_t)(pm.totalSleepMicros / 1000);
+    sleep["peak_us"] = pm.peakSleepMicros;
+    sleep["budget_us"] = pm.sleepBudgetMicros;
+    sleep["blocked_gps"] = pm.sleepsBlockedByGPS;
+    sleep["blocked_socket"] = pm.sleepsBlockedBySocket;
+    sleep["extra_dispersion_s"] = pm.extraDispersion;
+    
+    // Latency guard
+    JsonObject guard = doc.createNestedObject("latency_guard");
+    guard["bound_us"] = pc.latencyBoundMicros;
+    guard["window_p99_us"] = pm.windowP99Micros;
+    guard["trips"] = pm.guardTrips;
+    guard["peak_us"] = nm.peakLatencyMicros;
+    
+    JsonArray histogram = guard.createNestedArray("histogram");
+    for (uint8_t i = 0; i < NTP_LATENCY_BUCKETS; i++) {
+        JsonObject bucket = histogram.createNestedObject();
+        uint32_t bound = NTP::getLatencyBucketBound(i);
+        if (bound == UINT32_MAX) {
+            bucket["le_us"] = nullptr;
+        } else {
+            bucket["le_us"] = bound;
+        }
+        bucket["count"] = nm.latencyHistogram[i];
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+// ============================================================================
+// NTP TRAFFIC TIME SERIES ENDPOINT
+// ============================================================================
+
+/**
+ * Stream One Ring as Compact JSON Arrays
+ * Arrays run oldest to newest; the last element is the current (partial)
+ * interval. Sent in chunks so the full 24 h series never sits in RAM.
+ */
+template <uint16_t SIZE>
+void streamSeriesRing(const NTPSeriesRing<SIZE>& ring, uint32_t intervalSec,
+                      uint32_t endUnix, WebResponse& res) {
+    String chunk;
+    chunk.reserve(2048);
+    
+    chunk = "{\"interval_s\":" + String(intervalSec);
+    chunk += ",\"points\":" + String(SIZE);
+    chunk += ",\"end_unix\":" + String(endUnix);
+    
+    for (uint8_t counter = 0; counter < SERIES_COUNTERS; counter++) {
+        chunk += ",\"";
+        chunk += NTPTimeSeries::counterName(counter);
+        chunk += "\":[";
+        
+        for (uint16_t i = 0; i < SIZE; i++) {
+            if (i > 0) chunk += ',';
+            chunk += String(ring.ago(SIZE - 1 - i).counts[counter]);
+            
+            if (chunk.length() > 1900) {
+                res.sendChunk(chunk);
+                chunk = "";
+            }
+        }
+        chunk += "]";
+    }
+    
+    chunk += "}";
+    res.sendChunk(chunk);
+}
+
+/**
+ * Stream NTP Traffic Time Series JSON
+ * @param ntp NTP server
+ * @param perMinute false = last 10 min at 1 s, true = last 24 h at 1 min
+ * @param endUnix GPS Unix time of the newest bin (0 if unknown)
+ * @param res Response to stream into
+ */
+void streamNTPTrafficSeriesJSON(const NTP& ntp, bool perMinute, uint32_t endUnix, WebResponse& res) {
+    const NTPTimeSeries& series = ntp.getTimeSeries();
+    
+    res.setHeader("Cache-Control", "no-cache");
+    res.beginChunked("application/json");
+    if (perMinute) {
+        streamSeriesRing(series.getMinutes(), 60, endUnix, res);
+    } else {
+        streamSeriesRing(series.getSeconds(), 1, endUnix, res);
+    }
+    res.endChunked();
+}
+
+// ============================================================================
+// ACCESS CONTROL ENDPOINT
+// ============================================================================
+
+/**
+ * Generate ACL JSON
+ * Returns source rules and the compiled range table used for lookups
+ */
+String generateACLJSON(const AccessControl& acl, const char* ruleText) {
+    DynamicJsonDocument doc(3072);
+    
+    doc["rules_text"] = ruleText;
+    doc["error"] = acl.getError();
+    
+    JsonArray rules = doc.createNestedArray("rules");
+    for (uint8_t i = 0; i < acl.getRuleCount(); i++) {
+        const ACLRule& rule = acl.getRule(i);
+        JsonObject obj = rules.createNestedObject();
+        obj["prefix"] = AccessControl::addressToString(rule.network) + "/" + String(rule.prefixLength);
+        obj["flags"] = AccessControl::flagsToString(rule.flags);
+    }
+    
+    JsonArray ranges = doc.createNestedArray("ranges");
+    for (uint8_t i = 0; i < acl.getRangeCount(); i++) {
+        const ACLRange& range = acl.getRange(i);
+        JsonObject obj = ranges.createNestedObject();
+        obj["start"] = AccessControl::addressToString(range.start);
+        obj["flags"] = AccessControl::flagsToString(range.flags);
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+// ============================================================================
+// NTP CLIENT OFFSETS ENDPOINT
+// ============================================================================
+
+/**
+ * Stream Per-Client Offset Estimates JSON
+ * Clients with samples first, largest |offset| first, one chunk per batch
+ * @param ntp NTP server
+ * @param minOffsetMicros Only list clients at or beyond this |offset|
+ * @param res Response to stream into
+ */
+void streamNTPClientOffsetsJSON(const NTP& ntp, float minOffsetMicros, WebResponse& res) {
+    const NTPClient* clients = ntp.getClients();
+    int count = ntp.getClientCount();
+    
+    // Order by |offset| (insertion sort over indices; table is small)
+    uint16_t* order = new (std::nothrow) uint16_t[count > 0 ? count : 1];
+    if (!order) {
+        res.send(503, "application/json", "{\"error\":\"Insufficient memory\"}");
+        return;
+    }
+    int listed = 0;
+    for (int i = 0; i < count; i++) {
+        if (clients[i].offsetSamples == 0 || fabsf(clients[i].offsetMicros) < minOffsetMicros) {
+            continue;
+        }
+        int j = listed++;
+        while (j > 0 && fabsf(clients[order[j - 1]].offsetMicros) < fabsf(clients[i].offsetMicros)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    
+    res.setHeader("Cache-Control", "no-cache");
+    res.beginChunked("application/json");
+    
+    String chunk;
+    chunk.reserve(2048);
+    chunk = "{\"tracked_clients\":" + String(count);
+    chunk += ",\"estimated_clients\":" + String(listed);
+    chunk += ",\"clients\":[";
+    
+    for (int n = 0; n < listed; n++) {
+        const NTPClient& c = clients[order[n]];
+        StaticJsonDocument<256> doc;
+        doc["ip"] = c.ip.toString();
+        doc["offset_us"] = c.offsetMicros;
+        doc["delay_us"] = c.delayMicros;
+        doc["jitter_us"] = c.jitterMicros;
+        doc["last_offset_us"] = c.lastOffsetMicros;
+        doc["samples"] = c.offsetSamples;
+        doc["poll"] = c.lastPollInterval;
+        doc["requests"] = c.requestCount;
+        doc["reputation"] = c.reputation;
+        
+        String entry;
+        serializeJson(doc, entry);
+        if (n > 0) chunk += ',';
+        chunk += entry;
+        
+        if (chunk.length() > 1900) {
+            res.sendChunk(chunk);
+            chunk = "";
+        }
+    }
+    
+    chunk += "]}";
+    res.sendChunk(chunk);
+    res.endChunked();
+    
+    delete[] order;
+}
+
+// ============================================================================
+// NTP PEERING ENDPOINT
+// ============================================================================
+
+/**
+ * Generate NTP Peers JSON
+ * Returns peer associations, selection state and holdover correction
+ */
+String generateNTPPeersJSON(const NTP& ntp) {
+    const NTPPeer* peers = ntp.getPeers();
+    const NTPHoldover& holdover = ntp.getHoldover();
+    
+    StaticJsonDocument<1536> doc;
+    
+    doc["following_peer"] = holdover.active;
+    doc["system_peer"] = ntp.getSystemPeer() >= 0 ? IPAddress(peers[ntp.getSystemPeer()].ip).toString() : "";
+    
+    JsonObject hold = doc.createNestedObject("holdover");
+    hold["correction_us"] = (double)NTPPeerLogic::correctionAt(holdover, Timebase::micros64());
+    hold["freq_ppm"] = holdover.freqPPM;
+    hold["steps"] = holdover.steps;
+    
+    JsonArray list = doc.createNestedArray("peers");
+    for (uint8_t i = 0; i < NTP_MAX_PEERS; i++) {
+        const NTPPeer& p = peers[i];
+        if (p.ip == 0) continue;
+        
+        JsonObject obj = list.createNestedObject();
+        obj["ip"] = IPAddress(p.ip).toString();
+        obj["state"] = NTPPeerLogic::stateString(p.state);
+        obj["reach"] = p.reach;
+        obj["stratum"] = p.stratum;
+        obj["leap"] = p.leap;
+        obj["offset_us"] = (double)p.offsetMicros;
+        obj["delay_us"] = (double)p.delayMicros;
+        obj["jitter_us"] = p.jitterMicros;
+        obj["root_distance_us"] = NTPPeerLogic::rootDistanceMicros(p, millis());
+        obj["sent"] = p.sent;
+        obj["received"] = p.received;
+        obj["duplicates"] = p.duplicates;
+        obj["bogus"] = p.bogus;
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+// ============================================================================
+// NTP PACKET CAPTURE ENDPOINTS
+// ============================================================================
+
+/**
+ * Parse Capture Filter from Request Parameters
+ * ip=<client IPv4>  kod=<code>|any
+ */
+NTPCaptureFilter parseCaptureFilter(const WebRequest& req) {
+    NTPCaptureFilter filter;
+    filter.clientIP = 0;
+    filter.kod[0] = '\0';
+    
+    IPAddress ip;
+    if (req.hasParam("ip") && ip.fromString(req.getParam("ip"))) {
+        filter.clientIP = (uint32_t)ip;
+    }
+    
+    if (req.hasParam("kod")) {
+        String kod = req.getParam("kod");
+        kod.toUpperCase();
+        if (kod == "ANY" || kod == "*") {
+            kod = "*";
+        }
+        strncpy(filter.kod, kod.c_str(), 4);
+        filter.kod[4] = '\0';
+    }
+    
+    return filter;
+}
+
+/**
+ * Stream Captured NTP Exchanges as pcap
+ * Each record is synthesized into a small stack buffer and written
+ * directly from the ring
+ */
+void streamNTPCapturePcap(const NTP& ntp, const NTPCaptureFilter& filter,
+                          uint32_t serverIP, WebResponse& res) {
+    const NTPCapture* capture = ntp.getCapture();
+    uint8_t record[PCAP_MAX_RECORD_LEN];
+    
+    NTPCaptureClock clock;
+    ntp.getCaptureClock(clock);
+    
+    res.setHeader("Content-Disposition", "attachment; filename=\"ntp-capture.pcap\"");
+    res.setHeader("Cache-Control", "no-cache");
+    res.beginRaw("application/vnd.tcpdump.pcap");
+    
+    size_t len = NTPCapture::formatPcapHeader(record);
+    res.writeRaw(record, len);
+    
+    if (capture) {
+        for (uint16_t i = 0; i < capture->size(); i++) {
+            const NTPCaptureEntry& e = capture->at(i);
+            if (!NTPCapture::matches(e, filter)) {
+                continue;
+            }
+            
+            len = NTPCapture::formatPcapRecord(record, e, false, serverIP, ntp.getPort(), clock);
+            if (res.writeRaw(record, len) != len) break;
+            
+            if (e.responseLen > 0) {
+                len = NTPCapture::formatPcapRecord(record, e, true, serverIP, ntp.getPort(), clock);
+                if (res.writeRaw(record, len) != len) break;
+            }
+        }
+    }
+    
+    res.endRaw();
+}
+
+/**
+ * Generate Request Pipeline JSON
+ * Active specialization and per-variant cost, for comparing feature sets
+ */
+String generateNTPPipelineJSON(const NTP& ntp) {
+    StaticJsonDocument<1024> doc;
+    doc["active"] = NTP::pipelineFeatureString(ntp.getPipelineVariant());
+    
+    JsonArray variants = doc.createNestedArray("variants");
+    for (uint8_t v = 0; v < NTP_PIPE_VARIANTS; v++) {
+        const NTPPipelineStats& stats = ntp.getPipelineStats(v);
+        JsonObject variant = variants.createNestedObject();
+        variant["features"] = NTP::pipelineFeatureString(v);
+        variant["packets"] = stats.packets;
+        variant["avg_us"] = stats.packets ? (float)stats.totalMicros / stats.packets : 0;
+        variant["peak_us"] = stats.peakMicros;
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate NTP Socket I/O JSON
+ */
+String generateNTPSocketJSON(const NTPSocket& socket) {
+    const NTPSocketStats& stats = socket.getStats();
+    const NTPNeighborCache& neighbors = socket.getNeighbors();
+    const NTPNeighborStats& nstats = neighbors.getStats();
+    
+    StaticJsonDocument<2560> doc;
+    doc["mode"] = socket.isPipelined() ? "pipelined" : "blocking";
+    doc["sockets"] = socket.getSocketCount();
+    doc["sends"] = stats.sends;
+    doc["send_timeouts"] = stats.sendTimeouts;
+    doc["send_waits"] = stats.sendWaits;
+    doc["avg_wait_us"] = socket.getAverageWaitMicros();
+    doc["peak_send_us"] = stats.peakSendMicros;
+    doc["alt_socket_received"] = stats.altReceived;
+    
+    JsonObject latency = doc.createNestedObject("send_latency");
+    JsonArray bounds = latency.createNestedArray("bounds_us");
+    JsonArray arp = latency.createNestedArray("arp");
+    JsonArray cached = latency.createNestedArray("cached");
+    for (uint8_t i = 0; i < NTP_SOCKET_HIST_BUCKETS; i++) {
+        if (i < NTP_SOCKET_HIST_BUCKETS - 1) {
+            bounds.add(NTPSocket::histogramBound(i));
+        }
+        arp.add(stats.sendLatency[NTP_SOCKET_HIST_ARP][i]);
+        cached.add(stats.sendLatency[NTP_SOCKET_HIST_CACHED][i]);
+    }
+    
+    JsonObject cache = doc.createNestedObject("neighbors");
+    cache["enabled"] = socket.isNeighborCacheEnabled();
+    cache["entries"] = neighbors.size();
+    cache["hits"] = nstats.hits;
+    cache["misses"] = nstats.misses;
+    cache["expired"] = nstats.expired;
+    cache["learned"] = nstats.learned;
+    cache["evicted"] = nstats.evicted;
+    
+    JsonArray table = cache.createNestedArray("table");
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < NTP_NEIGHBOR_ENTRIES; i++) {
+        const NTPNeighbor& n = neighbors.at(i);
+        if (n.ip == 0) continue;
+        
+        char mac[18];
+        snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+                 n.mac[0], n.mac[1], n.mac[2], n.mac[3], n.mac[4], n.mac[5]);
+        JsonObject entry = table.createNestedObject();
+        entry["ip"] = IPAddress(n.ip).toString();
+        entry["mac"] = mac;
+        entry["age_s"] = (now - n.learnedMillis) / 1000;
+        entry["hits"] = n.hits;
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate Crystal Frequency (Drift File) JSON
+ */
+String generateNTPDriftJSON(const ClockDrift& drift) {
+    const DriftState& state = drift.getState();
+    const DriftRecord& record = drift.getRecord();
+    
+    StaticJsonDocument<768> doc;
+    doc["ppm"] = state.ppm;
+    doc["sigma_ppm"] = state.sigmaPPM;
+    doc["converged"] = state.converged;
+    doc["converge_s"] = state.convergeSeconds;
+    doc["restored"] = state.restored;
+    doc["jitter_us"] = state.jitterMicros;
+    doc["baseline_s"] = state.baselineSeconds;
+    doc["samples"] = state.samples;
+    doc["rejected"] = state.rejected;
+    doc["temperature_c"] = state.temperatureC;
+    
+    JsonObject file = doc.createNestedObject("drift_file");
+    file["ppm"] = record.ppm;
+    file["sigma_ppm"] = record.sigmaPPM;
+    file["temperature_c"] = record.temperatureC;
+    if (record.tempcoValid) {
+        file["tempco_ppm_per_c"] = record.tempcoPPMPerC;
+    }
+    file["saves"] = record.saves;
+    file["saved_this_boot"] = state.savedMillis != 0;
+    file["cold_converge_s"] = record.coldConvergeSeconds;
+    file["warm_converge_s"] = record.warmConvergeSeconds;
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate Failover Status JSON
+ */
+String generateFailoverJSON(const Failover& failover) {
+    const FailoverStats& stats = failover.getStats();
+    const FailoverPeer& peer = failover.getPeer();
+    uint32_t now = millis();
+    
+    StaticJsonDocument<768> doc;
+    doc["state"] = Failover::stateString(failover.getState());
+    doc["virtual_ip"] = failover.getConfig().virtualIP.toString();
+    doc["vrid"] = failover.getConfig().vrid;
+    doc["unit_ip"] = failover.getUnitIP().toString();
+    doc["priority"] = failover.getPriority();
+    
+    JsonObject other = doc.createNestedObject("peer");
+    if (peer.unitIP != 0) {
+        other["unit_ip"] = IPAddress(peer.unitIP).toString();
+        other["priority"] = peer.priority;
+        other["stratum"] = peer.stratum;
+        other["serving"] = (peer.flags & FAILOVER_FLAG_SERVING) != 0;
+        other["gps"] = (peer.flags & FAILOVER_FLAG_GPS) != 0;
+        other["root_dispersion_us"] = peer.rootDispersionMicros;
+        other["last_advert_ms_ago"] = now - peer.lastAdvertMillis;
+    }
+    
+    doc["adverts_sent"] = stats.advertsSent;
+    doc["adverts_received"] = stats.advertsReceived;
+    doc["adverts_rejected"] = stats.advertsRejected;
+    doc["takeovers"] = stats.takeovers;
+    doc["releases"] = stats.releases;
+    doc["last_gap_ms"] = stats.lastGapMillis;
+    doc["last_transition_s_ago"] = stats.lastTransitionMillis ? (now - stats.lastTransitionMillis) / 1000 : 0;
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate Telemetry Exporter Status JSON
+ */
+String generateNTPTelemetryJSON(const NTPTelemetry& telemetry) {
+    const NTPTelemetryStats& stats = telemetry.getStats();
+    
+    StaticJsonDocument<384> doc;
+    doc["enabled"] = telemetry.isRunning();
+    doc["collector"] = telemetry.getCollector().toString();
+    doc["port"] = telemetry.getCollectorPort();
+    doc["pending"] = telemetry.pending();
+    doc["capacity"] = NTP_TELEMETRY_RING;
+    doc["records_per_datagram"] = NTP_TELEMETRY_BATCH;
+    doc["records_queued"] = stats.recordsQueued;
+    doc["records_sent"] = stats.recordsSent;
+    doc["records_lost"] = stats.recordsLost;
+    doc["datagrams_sent"] = stats.datagramsSent;
+    doc["send_failures"] = stats.sendFailures;
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+/**
+ * Generate Capture Status JSON
+ */
+String generateNTPCaptureStatusJSON(const NTP& ntp) {
+    const NTPCapture* capture = ntp.getCapture();
+    
+    StaticJsonDocument<256> doc;
+    doc["enabled"] = capture != nullptr;
+    doc["capacity"] = NTP_CAPTURE_ENTRIES;
+    doc["entries"] = capture ? capture->size() : 0;
+    doc["overwritten"] = capture ? capture->overwritten() : 0;
+    doc["memory_bytes"] = capture ? sizeof(NTPCapture) : 0;
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+
+#if FEATURE_OTA
+// ============================================================================
+// OTA STATUS ENDPOINT
+// ============================================================================
+
+/**
+ * Generate OTA Status JSON
+ * Returns upload progress and image confirmation state
+ */
+String generateOTAStatusJSON(const OTA& ota) {
+    const OTAProgress& p = ota.getProgress();
+    
+    StaticJsonDocument<768> doc;
+    
+    doc["state"] = OTA::stateString(p.state);
+    doc["running_partition"] = p.runningPartition;
+    doc["rollback_supported"] = p.rollbackSupported;
+    
+    JsonObject upload = doc.createNestedObject("upload");
+    upload["image_size"] = p.imageSize;
+    upload["received"] = p.received;
+    upload["percent"] = p.imageSize ? (p.received * 100.0 / p.imageSize) : 0;
+    uint32_t elapsed = (p.state == OTAState::RECEIVING) ? millis() - p.startTime : p.durationMs;
+    upload["elapsed_ms"] = elapsed;
+    upload["bytes_per_sec"] = elapsed ? (uint32_t)((uint64_t)p.received * 1000 / elapsed) : 0;
+    upload["chunks"] = p.chunks;
+    upload["yields"] = p.yields;
+    upload["peak_chunk_us"] = p.peakChunkMicros;
+    upload["sha256"] = p.sha256;
+    upload["error"] = p.error;
+    
+    doc["updates_succeeded"] = p.updatesSucceeded;
+    doc["updates_failed"] = p.updatesFailed;
+    
+    String output;
+    serializeJson(doc, output);
+    return output;
+}
+#endif // FEATURE_OTA
+
 } // namespace web_api
 
+#endif // FEATURE_WEB_API
+
 #endif // WEB_API_H
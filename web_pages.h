@@ -1201,8 +1201,104 @@ String generateModernConfigHTML() {
     html += "min='10' max='3600'>";
     html += "</div>";
     
+    html += "<div class='form-group'>";
+    html += "<label class='form-checkbox'>";
+    html += "<input type='checkbox' name='ntpPeeringEnabled'";
+    if (config.ntpPeeringEnabled) html += " checked";
+    html += ">";
+    html += "<span>Enable Symmetric Peering</span>";
+    html += "</label>";
+    html += "<div class='form-help'>Follow the paired unit at stratum 2 while GPS is unavailable (not available with virtual IP failover)</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='ntpPeerIP'>Peer Address</label>";
+    html += "<input type='text' id='ntpPeerIP' name='ntpPeerIP' class='form-input' ";
+    html += "value='" + config.ntpPeerIP.toString() + "' placeholder='192.168.1.101'>";
+    html += "<div class='form-help'>Address of the other unit at this site (both must list each other)</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-checkbox'>";
+    html += "<input type='checkbox' name='ntpTelemetryEnabled'";
+    if (config.ntpTelemetryEnabled) html += " checked";
+    html += ">";
+    html += "<span>Enable Request Telemetry Export</span>";
+    html += "</label>";
+    html += "<div class='form-help'>Send one binary record per NTP request to a UDP collector (see NTPTelemetry.h)</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='ntpTelemetryCollector'>Telemetry Collector</label>";
+    html += "<input type='text' id='ntpTelemetryCollector' name='ntpTelemetryCollector' class='form-input' ";
+    html += "value='" + config.ntpTelemetryCollector.toString() + "' placeholder='192.168.1.10'>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='ntpTelemetryPort'>Telemetry Port</label>";
+    html += "<input type='number' id='ntpTelemetryPort' name='ntpTelemetryPort' class='form-input' ";
+    html += "value='" + String(config.ntpTelemetryPort) + "' min='1' max='65535'>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-checkbox'>";
+    html += "<input type='checkbox' name='failoverEnabled'";
+    if (config.failoverEnabled) html += " checked";
+    html += ">";
+    html += "<span>Enable Virtual IP Failover</span>";
+    html += "</label>";
+    html += "<div class='form-help'>The healthier of two paired units answers on a shared address. Requires a static IP; ";
+    html += "while master this unit is reachable only on the virtual IP. Disables symmetric peering</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='failoverVIP'>Virtual IP</label>";
+    html += "<input type='text' id='failoverVIP' name='failoverVIP' class='form-input' ";
+    html += "value='" + config.failoverVIP.toString() + "' placeholder='192.168.1.123'>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='failoverVRID'>Virtual Router ID</label>";
+    html += "<input type='number' id='failoverVRID' name='failoverVRID' class='form-input' ";
+    html += "value='" + String(config.failoverVRID) + "' min='1' max='255'>";
+    html += "<div class='form-help'>Same value on both units; different for each pair on the network</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='aclRules'>Access Control (restrict list)</label>";
+    html += "<textarea id='aclRules' name='aclRules' class='form-input' rows='4' maxlength='159'>";
+    html += String(config.aclRules);
+    html += "</textarea>";
+    html += "<div class='form-help'>One rule per line: &lt;ip&gt;[/len] or default, then flags ignore, noserve, limited, kod, noquery. ";
+    html += "Longest prefix wins. Empty = everyone served and rate limited with KoD</div>";
+    html += "</div>";
+    
     html += "</div>"; // End NTP section
     
+    // Power Settings
+    html += "<div class='config-section'>";
+    html += "<div class='section-title'>Power Management</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-checkbox'>";
+    html += "<input type='checkbox' name='powerSaveEnabled'";
+    if (config.powerSaveEnabled) html += " checked";
+    html += ">";
+    html += "<span>Enable Power Saving</span>";
+    html += "</label>";
+    html += "<div class='form-help'>Scale CPU clock with load and light-sleep between packets</div>";
+    html += "</div>";
+    
+    html += "<div class='form-group'>";
+    html += "<label class='form-label' for='ntpLatencyBoundUs'>NTP Latency Bound (microseconds)</label>";
+    html += "<input type='number' id='ntpLatencyBoundUs' name='ntpLatencyBoundUs' ";
+    html += "class='form-input' value='" + String(config.ntpLatencyBoundUs) + "' ";
+    html += "min='100' max='20000'>";
+    html += "<div class='form-help'>Maximum receive-to-transmit time; sleep is shortened or suspended to stay under it</div>";
+    html += "</div>";
+    
+    html += "</div>"; // End Power section
+    
     // MQTT Settings
     html += "<div class='config-section'>";
     html += "<div class='section-title'>MQTT Settings</div>";